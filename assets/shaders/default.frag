@@ -33,6 +33,8 @@ layout(std140, set = 0, binding = 1) uniform PixelUniforms {
   int useTextureArray;
   int uDitherEnabled;
   int shadowsEnabled;
+  vec4 positionOffset;
+  vec4 positionScale;
 };
 
 float calculateShadow(vec4 fragPosLightSpace) {
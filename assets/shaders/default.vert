@@ -1,6 +1,11 @@
 #version 450 core
+#ifdef PIXEL_COMPRESSED_VERTEX
+layout (location = 0) in vec4 aPos;    // snorm16, bounds-relative
+layout (location = 1) in vec2 aNormal; // snorm16 octahedral
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoord;
 layout (location = 3) in vec4 aColor;
 
@@ -33,11 +38,29 @@ layout(std140, set = 0, binding = 1) uniform PixelUniforms {
   int useTextureArray;
   int uDitherEnabled;
   int shadowsEnabled;
+  vec4 positionOffset;
+  vec4 positionScale;
 };
 
+#ifdef PIXEL_COMPRESSED_VERTEX
+vec3 octDecode(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+vec3 vertexPosition() { return positionOffset.xyz + aPos.xyz * positionScale.xyz; }
+vec3 vertexNormal() { return octDecode(aNormal); }
+#else
+vec3 vertexPosition() { return aPos; }
+vec3 vertexNormal() { return aNormal; }
+#endif
+
 void main() {
-  FragPos = vec3(model * vec4(aPos, 1.0));
-  Normal = mat3(transpose(inverse(model))) * aNormal;
+  FragPos = vec3(model * vec4(vertexPosition(), 1.0));
+  Normal = mat3(transpose(inverse(model))) * vertexNormal();
   TexCoord = aTexCoord;
   Color = aColor;
   FragPosLightSpace = lightViewProj * vec4(FragPos, 1.0);
@@ -0,0 +1,67 @@
+#version 450 core
+
+layout (location = 0) out vec4 FragColor;
+
+layout (location = 0) in vec2 TexCoord;
+layout (location = 1) in vec4 Color;
+layout (location = 2) in float TextureIndex;
+layout (location = 3) in float LODAlpha;
+
+layout(set = 0, binding = 0) uniform sampler2DArray uTextureArray;
+layout(std140, set = 0, binding = 1) uniform PixelUniforms {
+  mat4 model;
+  mat4 view;
+  mat4 projection;
+  mat4 normalMatrix;
+  mat4 lightViewProj;
+  vec4 materialColor;
+  vec3 lightPos;
+  float alphaCutoff;
+  vec3 viewPos;
+  float baseAlpha;
+  vec3 lightColor;
+  float shadowBias;
+  float uTime;
+  float ditherScale;
+  float crossfadeDuration;
+  float _padMisc;
+  vec4 lightingParams;
+  vec4 materialParams;
+  int useTexture;
+  int useTextureArray;
+  int uDitherEnabled;
+  int shadowsEnabled;
+  vec4 positionOffset;
+  vec4 positionScale;
+};
+
+float getBayerValue(vec2 pos) {
+  int x = int(mod(pos.x, 4.0));
+  int y = int(mod(pos.y, 4.0));
+
+  float bayer[16] = float[16](
+    0.0/16.0,  8.0/16.0,  2.0/16.0, 10.0/16.0,
+    12.0/16.0, 4.0/16.0, 14.0/16.0,  6.0/16.0,
+    3.0/16.0, 11.0/16.0,  1.0/16.0,  9.0/16.0,
+    15.0/16.0, 7.0/16.0, 13.0/16.0,  5.0/16.0
+  );
+
+  return bayer[y * 4 + x];
+}
+
+void main() {
+  if (uDitherEnabled > 0 && LODAlpha < 1.0) {
+    if (LODAlpha < getBayerValue(gl_FragCoord.xy)) {
+      discard;
+    }
+  }
+
+  vec4 texel = texture(uTextureArray, vec3(TexCoord, TextureIndex));
+  float cutoff = alphaCutoff > 0.0 ? alphaCutoff : 0.5;
+  if (texel.a < cutoff) {
+    discard;
+  }
+
+  vec4 baseColor = texel * materialColor * Color;
+  FragColor = vec4(baseColor.rgb, 1.0);
+}
@@ -0,0 +1,65 @@
+#version 450 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aColor;
+
+// Instance attributes (see ImpostorAtlas::make_instance)
+layout (location = 4) in vec3 iPosition;     // billboard centre
+layout (location = 5) in vec3 iRotation;
+layout (location = 6) in vec3 iScale;        // xy = quad half-extent
+layout (location = 7) in vec4 iColor;
+layout (location = 8) in float iTextureIndex; // baked view layer
+layout (location = 9) in float iLODAlpha;
+
+layout (location = 0) out vec2 TexCoord;
+layout (location = 1) out vec4 Color;
+layout (location = 2) out float TextureIndex;
+layout (location = 3) out float LODAlpha;
+
+layout(std140, set = 0, binding = 1) uniform PixelUniforms {
+  mat4 model;
+  mat4 view;
+  mat4 projection;
+  mat4 normalMatrix;
+  mat4 lightViewProj;
+  vec4 materialColor;
+  vec3 lightPos;
+  float alphaCutoff;
+  vec3 viewPos;
+  float baseAlpha;
+  vec3 lightColor;
+  float shadowBias;
+  float uTime;
+  float ditherScale;
+  float crossfadeDuration;
+  float _padMisc;
+  vec4 lightingParams;
+  vec4 materialParams;
+  int useTexture;
+  int useTextureArray;
+  int uDitherEnabled;
+  int shadowsEnabled;
+  vec4 positionOffset;
+  vec4 positionScale;
+};
+
+void main() {
+  // Cylindrical billboard: face the camera around the world Y axis only, to
+  // match the yaw ring the atlas was baked from
+  vec2 rightXZ = vec2(view[0][0], view[2][0]);
+  float rightLen = length(rightXZ);
+  vec3 right = rightLen > 1e-4 ? vec3(rightXZ.x, 0.0, rightXZ.y) / rightLen
+                               : vec3(1.0, 0.0, 0.0);
+  vec3 up = vec3(0.0, 1.0, 0.0);
+
+  vec3 worldPos = iPosition + right * (aPos.x * iScale.x) +
+                  up * (aPos.y * iScale.y);
+
+  TexCoord = aTexCoord;
+  Color = aColor * iColor;
+  TextureIndex = iTextureIndex;
+  LODAlpha = iLODAlpha;
+
+  gl_Position = projection * view * model * vec4(worldPos, 1.0);
+}
@@ -1,6 +1,11 @@
 #version 450 core
+#ifdef PIXEL_COMPRESSED_VERTEX
+layout (location = 0) in vec4 aPos;    // snorm16, bounds-relative
+layout (location = 1) in vec2 aNormal; // snorm16 octahedral
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoord;
 layout (location = 3) in vec4 aColor;
 
@@ -43,8 +48,26 @@ layout(std140, set = 0, binding = 1) uniform PixelUniforms {
   int useTextureArray;
   int uDitherEnabled;
   int shadowsEnabled;
+  vec4 positionOffset;
+  vec4 positionScale;
 };
 
+#ifdef PIXEL_COMPRESSED_VERTEX
+vec3 octDecode(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+vec3 vertexPosition() { return positionOffset.xyz + aPos.xyz * positionScale.xyz; }
+vec3 vertexNormal() { return octDecode(aNormal); }
+#else
+vec3 vertexPosition() { return aPos; }
+vec3 vertexNormal() { return aNormal; }
+#endif
+
 mat4 rotationMatrix(vec3 axis, float angle) {
   axis = normalize(axis);
   float s = sin(angle);
@@ -67,7 +90,7 @@ void main() {
   mat4 rotation = rotZ * rotY * rotX;
 
   // Apply scale and rotation to position
-  vec4 scaledPos = vec4(aPos * iScale, 1.0);
+  vec4 scaledPos = vec4(vertexPosition() * iScale, 1.0);
   vec4 rotatedPos = rotation * scaledPos;
   vec4 instanceWorldPos = rotatedPos + vec4(iPosition, 0.0);
 
@@ -75,7 +98,7 @@ void main() {
   vec4 worldPos = model * instanceWorldPos;
 
   FragPos = worldPos.xyz;
-  vec3 transformedNormal = mat3(rotation) * aNormal;
+  vec3 transformedNormal = mat3(rotation) * vertexNormal();
   Normal = mat3(normalMatrix) * transformedNormal;
   TexCoord = aTexCoord;
   Color = aColor * iColor;
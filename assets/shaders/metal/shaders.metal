@@ -7,9 +7,19 @@ using namespace metal;
 // Common Structures
 // ============================================================================
 
+// PIXEL_COMPRESSED_VERTEX selects the 20-byte layout: snorm16 bounds-relative
+// position, snorm16 octahedral normal, half uv and unorm8 color
+#ifdef PIXEL_COMPRESSED_VERTEX
+typedef float4 PackedPosition;
+typedef float2 PackedNormal;
+#else
+typedef float3 PackedPosition;
+typedef float3 PackedNormal;
+#endif
+
 struct VertexIn {
-    float3 position [[attribute(0)]];
-    float3 normal   [[attribute(1)]];
+    PackedPosition position [[attribute(0)]];
+    PackedNormal normal     [[attribute(1)]];
     float2 texCoord [[attribute(2)]];
     float4 color    [[attribute(3)]];
 };
@@ -17,8 +27,8 @@ struct VertexIn {
 // Combined struct for instanced rendering - all stage_in data in ONE struct
 struct VertexInInstanced {
     // Per-vertex attributes (buffer 0)
-    float3 position [[attribute(0)]];
-    float3 normal   [[attribute(1)]];
+    PackedPosition position [[attribute(0)]];
+    PackedNormal normal     [[attribute(1)]];
     float2 texCoord [[attribute(2)]];
     float4 color    [[attribute(3)]];
 
@@ -74,8 +84,30 @@ struct Uniforms {
     int useTextureArray;
     int uDitherEnabled;
     int shadowsEnabled;
+    float4 positionOffset;
+    float4 positionScale;
 };
 
+inline float3 decode_position(PackedPosition p, constant Uniforms& uniforms) {
+#ifdef PIXEL_COMPRESSED_VERTEX
+    return uniforms.positionOffset.xyz + p.xyz * uniforms.positionScale.xyz;
+#else
+    return p;
+#endif
+}
+
+inline float3 decode_normal(PackedNormal n) {
+#ifdef PIXEL_COMPRESSED_VERTEX
+    float3 v = float3(n, 1.0 - abs(n.x) - abs(n.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+#else
+    return n;
+#endif
+}
+
 float sampleShadow(depth2d<float> shadowMap,
                    sampler shadowSampler,
                    float4 fragPosLightSpace,
@@ -123,12 +155,14 @@ vertex VertexOut vertex_main(
 ) {
     VertexOut out;
     
-    float4 worldPos = uniforms.model * float4(in.position, 1.0);
+    float4 worldPos =
+        uniforms.model * float4(decode_position(in.position, uniforms), 1.0);
     out.fragPos = worldPos.xyz;
     
     // FIXED: Use normalMatrix (inverse-transpose of model) for correct normal transformation
     // This handles non-uniform scaling correctly
-    out.normal = (uniforms.normalMatrix * float4(in.normal, 0.0)).xyz;
+    out.normal =
+        (uniforms.normalMatrix * float4(decode_normal(in.normal), 0.0)).xyz;
     
     out.texCoord = in.texCoord;
     out.color = in.color;
@@ -206,7 +240,8 @@ vertex VertexOutInstanced vertex_instanced(
     VertexOutInstanced out;
 
     // Apply scale, rotation (XYZ Euler), and translation using per-instance data
-    float3 scaledPos = in.position * in.instanceScale;
+    float3 scaledPos =
+        decode_position(in.position, uniforms) * in.instanceScale;
 
     float sx = sin(in.instanceRotation.x);
     float cx = cos(in.instanceRotation.x);
@@ -243,7 +278,7 @@ vertex VertexOutInstanced vertex_instanced(
     out.position = uniforms.projection * uniforms.view * worldPos;
 
     // Transform normal using instance rotation and the uniform normal matrix
-    float3 transformedNormal = rotation * in.normal;
+    float3 transformedNormal = rotation * decode_normal(in.normal);
     out.normal = (uniforms.normalMatrix * float4(transformedNormal, 0.0)).xyz;
 
     // Pass through texture coordinates
@@ -322,6 +357,66 @@ fragment float4 fragment_instanced(
     return float4(result, alpha);
 }
 
+// ============================================================================
+// Impostor Billboards
+// ============================================================================
+
+struct VertexOutImpostor {
+    float4 position [[position]];
+    float2 texCoord;
+    float4 color;
+    float textureIndex;
+    float lodAlpha;
+};
+
+vertex VertexOutImpostor vertex_impostor(
+    VertexInInstanced in [[stage_in]],
+    constant Uniforms& uniforms [[buffer(1)]]
+) {
+    VertexOutImpostor out;
+
+    // Cylindrical billboard around world Y, matching the baked yaw ring
+    float2 rightXZ = float2(uniforms.view[0][0], uniforms.view[2][0]);
+    float rightLen = length(rightXZ);
+    float3 right = rightLen > 1e-4
+        ? float3(rightXZ.x, 0.0, rightXZ.y) / rightLen
+        : float3(1.0, 0.0, 0.0);
+    float3 up = float3(0.0, 1.0, 0.0);
+
+    float3 worldPos = in.instancePosition +
+                      right * (in.position.x * in.instanceScale.x) +
+                      up * (in.position.y * in.instanceScale.y);
+
+    out.position = uniforms.projection * uniforms.view *
+                   uniforms.model * float4(worldPos, 1.0);
+    out.texCoord = in.texCoord;
+    out.color = in.color * in.instanceColor;
+    out.textureIndex = in.instanceTextureIndex;
+    out.lodAlpha = in.instanceLodAlpha;
+    return out;
+}
+
+fragment float4 fragment_impostor(
+    VertexOutImpostor in [[stage_in]],
+    constant Uniforms& uniforms [[buffer(1)]],
+    texture2d_array<float> textureArray [[texture(1)]],
+    sampler textureSampler [[sampler(0)]]
+) {
+    uint layerCount = textureArray.get_array_size();
+    uint texIndex = layerCount > 0
+        ? uint(clamp(in.textureIndex, 0.0f, float(layerCount - 1)))
+        : 0u;
+    float4 texel = textureArray.sample(textureSampler, in.texCoord, texIndex);
+
+    float cutoff = uniforms.alphaCutoff > 0.0 ? uniforms.alphaCutoff : 0.5;
+    if (texel.a < cutoff || in.lodAlpha <= 0.0) {
+        discard_fragment();
+    }
+
+    float4 baseColor = texel * uniforms.materialColor * in.color;
+    return float4(baseColor.rgb, 1.0);
+}
+
 // ============================================================================
 // Shadow Depth Only Pass
 // ============================================================================
@@ -337,7 +432,8 @@ vertex ShadowVertexOut vertex_shadow_depth(
     VertexIn in [[stage_in]],
     constant Uniforms& uniforms [[buffer(1)]]) {
     ShadowVertexOut out;
-    float4 worldPos = uniforms.model * float4(in.position, 1.0);
+    float4 worldPos =
+        uniforms.model * float4(decode_position(in.position, uniforms), 1.0);
     out.position = uniforms.lightViewProj * worldPos;
     out.texCoord = in.texCoord;
     out.vertexAlpha = in.color.a;
@@ -350,7 +446,8 @@ vertex ShadowVertexOut vertex_shadow_depth_instanced(
     constant Uniforms& uniforms [[buffer(1)]]) {
     ShadowVertexOut out;
 
-    float3 scaledPos = in.position * in.instanceScale;
+    float3 scaledPos =
+        decode_position(in.position, uniforms) * in.instanceScale;
 
     float sx = sin(in.instanceRotation.x);
     float cx = cos(in.instanceRotation.x);
@@ -480,3 +577,82 @@ kernel void test_compute(
     accumData[gid] += value;
     outputData[gid] = value * 2u;
 }
+
+// Mirrors meshlet_cull.comp
+struct MeshletCullData {
+    float4 sphere;    // xyz center, w radius (object space)
+    float4 coneApex;  // xyz apex, w cutoff (1 = never cone-culled)
+    float4 coneAxis;
+    uint4 range;      // x first index, y index count
+};
+
+struct MeshletCullUniforms {
+    float4x4 model;
+    float4 cameraPositionObject;  // w = largest model axis scale
+    float4 frustumPlanes[6];
+    uint4 info;                   // x = meshlet count
+};
+
+// DrawIndexedIndirectArgs (MTLDrawIndexedPrimitivesIndirectArguments) plus
+// a meshlet counter; indexCount is the indirect draw's index count
+struct MeshletDrawArgs {
+    atomic_uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+    atomic_uint visibleMeshlets;
+};
+static_assert(sizeof(MeshletDrawArgs) == 24,
+              "MeshletDrawArgs must match MeshletDrawArgsGPU");
+static_assert(offsetof(MeshletDrawArgs, indexCount) == 0,
+              "indexCount must be the indirect index count");
+static_assert(offsetof(MeshletDrawArgs, visibleMeshlets) == 20,
+              "visibleMeshlets must follow the indirect arguments");
+
+kernel void meshlet_cull_compute(
+    constant MeshletCullUniforms& uniforms [[buffer(0)]],
+    device const MeshletCullData* meshlets [[buffer(1)]],
+    device const uint* meshletIndices [[buffer(2)]],
+    device uint* visibleIndices [[buffer(3)]],
+    device MeshletDrawArgs* drawArgs [[buffer(4)]],
+    uint gid [[thread_position_in_grid]],
+    uint gridSize [[threads_per_grid]]
+) {
+    // Stride so every meshlet is covered whatever grid the dispatch rounds to
+    for (uint id = gid; id < uniforms.info.x; id += gridSize) {
+        MeshletCullData meshlet = meshlets[id];
+
+        if (meshlet.coneApex.w < 1.0) {
+            float3 toApex = meshlet.coneApex.xyz - uniforms.cameraPositionObject.xyz;
+            float distance = length(toApex);
+            if (distance > 0.0 &&
+                dot(toApex / distance, meshlet.coneAxis.xyz) >= meshlet.coneApex.w) {
+                continue;
+            }
+        }
+
+        float3 center = (uniforms.model * float4(meshlet.sphere.xyz, 1.0)).xyz;
+        float radius = meshlet.sphere.w * uniforms.cameraPositionObject.w;
+        bool visible = true;
+        for (int i = 0; i < 6; i++) {
+            float4 plane = uniforms.frustumPlanes[i];
+            if (dot(plane.xyz, center) + plane.w < -radius) {
+                visible = false;
+                break;
+            }
+        }
+        if (!visible) {
+            continue;
+        }
+
+        uint count = meshlet.range.y;
+        uint offset = atomic_fetch_add_explicit(&drawArgs->indexCount, count,
+                                                memory_order_relaxed);
+        atomic_fetch_add_explicit(&drawArgs->visibleMeshlets, 1,
+                                  memory_order_relaxed);
+        for (uint i = 0; i < count; i++) {
+            visibleIndices[offset + i] = meshletIndices[meshlet.range.x + i];
+        }
+    }
+}
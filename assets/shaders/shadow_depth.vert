@@ -1,5 +1,9 @@
 #version 450 core
+#ifdef PIXEL_COMPRESSED_VERTEX
+layout (location = 0) in vec4 aPos; // snorm16, bounds-relative
+#else
 layout (location = 0) in vec3 aPos;
+#endif
 layout (location = 2) in vec2 aTexCoord;
 layout (location = 3) in vec4 aColor;
 
@@ -29,10 +33,18 @@ layout(std140, set = 0, binding = 1) uniform PixelUniforms {
   int useTextureArray;
   int uDitherEnabled;
   int shadowsEnabled;
+  vec4 positionOffset;
+  vec4 positionScale;
 };
 
+#ifdef PIXEL_COMPRESSED_VERTEX
+vec3 vertexPosition() { return positionOffset.xyz + aPos.xyz * positionScale.xyz; }
+#else
+vec3 vertexPosition() { return aPos; }
+#endif
+
 void main() {
   TexCoord = aTexCoord;
   VertexAlpha = aColor.a;
-  gl_Position = lightViewProj * model * vec4(aPos, 1.0);
+  gl_Position = lightViewProj * model * vec4(vertexPosition(), 1.0);
 }
@@ -1,6 +1,11 @@
 #version 450 core
+#ifdef PIXEL_COMPRESSED_VERTEX
+layout (location = 0) in vec4 aPos;    // snorm16, bounds-relative
+layout (location = 1) in vec2 aNormal; // snorm16 octahedral
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoord;
 layout (location = 3) in vec4 aColor;
 
@@ -34,8 +39,16 @@ layout(std140, set = 0, binding = 1) uniform PixelUniforms {
   int useTextureArray;
   int uDitherEnabled;
   int shadowsEnabled;
+  vec4 positionOffset;
+  vec4 positionScale;
 };
 
+#ifdef PIXEL_COMPRESSED_VERTEX
+vec3 vertexPosition() { return positionOffset.xyz + aPos.xyz * positionScale.xyz; }
+#else
+vec3 vertexPosition() { return aPos; }
+#endif
+
 layout (location = 0) out vec2 TexCoord;
 layout (location = 1) out float TextureIndex;
 layout (location = 2) out float VertexAlpha;
@@ -60,7 +73,7 @@ void main() {
   mat4 rotZ = rotationMatrix(vec3(0, 0, 1), iRotation.z);
   mat4 rotation = rotZ * rotY * rotX;
 
-  vec4 scaledPos = vec4(aPos * iScale, 1.0);
+  vec4 scaledPos = vec4(vertexPosition() * iScale, 1.0);
   vec4 rotatedPos = rotation * scaledPos;
   vec4 instanceWorldPos = rotatedPos + vec4(iPosition, 0.0);
 
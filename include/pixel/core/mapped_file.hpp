@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace pixel::core {
+
+// Read-only memory mapping of a whole file. Pages are faulted in by the OS on
+// first touch, so loaders can hand sub-spans straight to upload calls without
+// reading the file into a heap buffer first. The mapping lives as long as the
+// MappedFile; spans taken from bytes() must not outlive it.
+class MappedFile {
+public:
+  static std::unique_ptr<MappedFile> open(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  std::span<const std::byte> bytes() const { return {data_, size_}; }
+  size_t size() const { return size_; }
+  const std::string &path() const { return path_; }
+
+private:
+  MappedFile() = default;
+
+  const std::byte *data_ = nullptr;
+  size_t size_ = 0;
+  std::string path_;
+#if defined(_WIN32)
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#endif
+};
+
+} // namespace pixel::core
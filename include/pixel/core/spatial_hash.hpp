@@ -0,0 +1,107 @@
+#pragma once
+#include "pixel/math/vec2.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace pixel::core {
+
+// Uniform-grid spatial hash over 2D points, keyed by dense entity index.
+// rebuild() counting-sorts every entity by hashed cell into flat SoA arrays,
+// so a cell is one contiguous run of slots. move() updates in place while an
+// entity stays in its cell; cell changes go to an overflow entry chained off
+// the new cell's bucket, and the chains are folded back in automatically once
+// they grow.
+//
+// Queries append entity indices to a caller-owned vector and only visit the
+// cells overlapping the query shape.
+class SpatialHash2D {
+public:
+  using Vec2 = pixel::math::Vec2;
+
+  explicit SpatialHash2D(float cell_size = 16.0f);
+
+  // Entity i is at positions[i]; replaces the previous contents
+  void rebuild(std::span<const Vec2> positions);
+
+  void insert(uint32_t entity, Vec2 position);
+  void move(uint32_t entity, Vec2 position);
+  void remove(uint32_t entity);
+  void clear();
+
+  // Folds the overflow chains and removed slots back into the sorted arrays
+  void compact();
+
+  bool contains(uint32_t entity) const;
+  size_t size() const { return live_count_; }
+  float cell_size() const { return cell_size_; }
+
+  void query_rect(Vec2 min, Vec2 max, std::vector<uint32_t> &out) const;
+  void query_radius(Vec2 center, float radius,
+                    std::vector<uint32_t> &out) const;
+
+  struct Neighbor {
+    uint32_t entity;
+    float distance_sq;
+  };
+  // Up to k nearest entities within max_radius, nearest first
+  void query_nearest(Vec2 center, size_t k, std::vector<Neighbor> &out,
+                     float max_radius = 1e30f) const;
+
+private:
+  static constexpr uint32_t kNone = 0xFFFFFFFFu;
+  static constexpr uint32_t kOverflowBit = 0x80000000u;
+
+  struct Cell {
+    int32_t x;
+    int32_t y;
+    bool operator==(const Cell &o) const { return x == o.x && y == o.y; }
+  };
+
+  Cell cell_of(float x, float y) const;
+  uint32_t bucket_of(Cell cell) const;
+  void build_from_scratch();
+  void maybe_compact();
+
+  void push_overflow(uint32_t entity, float x, float y);
+  void link_overflow(uint32_t index);
+  void unlink_overflow(uint32_t index);
+
+  // Visits every live entry in `cell`, overflow included; fn(entity, x, y)
+  template <typename Fn> void for_each_in_cell(Cell cell, Fn &&fn) const;
+  // Visits every live entry; fn(entity, x, y)
+  template <typename Fn> void for_each_entry(Fn &&fn) const;
+
+  float cell_size_ = 16.0f;
+  float inv_cell_size_ = 1.0f / 16.0f;
+  uint32_t bucket_mask_ = 0;
+
+  // bucket b owns slots [bucket_start_[b], bucket_start_[b + 1])
+  std::vector<uint32_t> bucket_start_;
+  std::vector<uint32_t> slot_entity_; // kNone marks a removed slot
+  std::vector<float> slot_x_;
+  std::vector<float> slot_y_;
+
+  // Overflow entries form a doubly linked chain per bucket, so a query only
+  // walks the overflow of the buckets it visits
+  std::vector<uint32_t> overflow_head_;
+  std::vector<uint32_t> overflow_entity_;
+  std::vector<float> overflow_x_;
+  std::vector<float> overflow_y_;
+  std::vector<uint32_t> overflow_prev_;
+  std::vector<uint32_t> overflow_next_;
+
+  // Slot index, kOverflowBit | overflow index, or kNone
+  std::vector<uint32_t> entity_slot_;
+  size_t live_count_ = 0;
+  size_t dead_slots_ = 0;
+
+  // Rebuild scratch, kept to avoid per-frame allocation
+  std::vector<uint32_t> scratch_entity_;
+  std::vector<float> scratch_x_;
+  std::vector<float> scratch_y_;
+  std::vector<uint32_t> scratch_bucket_;
+};
+
+} // namespace pixel::core
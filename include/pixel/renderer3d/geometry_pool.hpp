@@ -0,0 +1,123 @@
+#pragma once
+
+#include "pixel/rhi/rhi.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace pixel::renderer3d {
+
+// Shared vertex/index storage for many meshes. Vertices live in large pages
+// (one set per vertex layout) addressed in whole vertices, so a mesh keeps
+// zero-based indices and is drawn with drawIndexed(..., first_index, ...,
+// base_vertex). Consecutive draws of pooled meshes then share the same
+// vertex and index buffer bindings.
+//
+// The pool must outlive every mesh allocated from it. Freed ranges are
+// reused by the next allocation, so free() is only safe once the GPU is done
+// with every frame that referenced the range; retire() defers the free by
+// Settings::retire_frames begin_frame() calls instead. Meshes retire their
+// ranges when destroyed, and the Renderer calls begin_frame() on its pool.
+class GeometryPool {
+public:
+  struct Settings {
+    size_t vertex_page_bytes = 16 * 1024 * 1024;
+    size_t index_page_bytes = 8 * 1024 * 1024;
+    // Retired ranges are freed this many begin_frame() calls later, once no
+    // frame in flight can still read them
+    uint32_t retire_frames = 3;
+  };
+
+  struct Allocation {
+    rhi::BufferHandle vertex_buffer{0};
+    rhi::BufferHandle index_buffer{0};
+    rhi::VertexLayout vertex_layout = rhi::VertexLayout::Standard;
+    uint32_t base_vertex = 0;
+    uint32_t vertex_count = 0;
+    // Byte range in the index page; always 4-byte aligned
+    size_t index_offset = 0;
+    size_t index_bytes = 0;
+
+    bool valid() const { return vertex_buffer.id != 0; }
+  };
+
+  struct Stats {
+    size_t vertex_pages = 0;
+    size_t index_pages = 0;
+    size_t vertex_bytes_reserved = 0;
+    size_t vertex_bytes_used = 0;
+    size_t index_bytes_reserved = 0;
+    size_t index_bytes_used = 0;
+    size_t allocations = 0; // includes retired ranges not yet freed
+    size_t retiring = 0;
+  };
+
+  static std::unique_ptr<GeometryPool> create(rhi::Device *device);
+  static std::unique_ptr<GeometryPool> create(rhi::Device *device,
+                                              const Settings &settings);
+
+  // Reserves vertex_count vertices of `layout` and index_bytes of index
+  // storage. Grows by a page when nothing fits; requests larger than a page
+  // get a dedicated page. Returns nullopt if buffer creation fails.
+  std::optional<Allocation> allocate(rhi::VertexLayout layout,
+                                     uint32_t vertex_count,
+                                     size_t index_bytes);
+  void free(const Allocation &allocation);
+  // Frees `allocation` once retire_frames more frames have begun
+  void retire(const Allocation &allocation);
+  // Call once per frame; frees the retired ranges that are old enough
+  void begin_frame();
+
+  // Writes through the immediate command list at the allocation's offsets
+  void upload(const Allocation &allocation,
+              std::span<const std::byte> vertex_data,
+              std::span<const std::byte> index_data);
+
+  Stats stats() const;
+
+private:
+  GeometryPool() = default;
+
+  // First-fit free list over [0, capacity), keyed by offset; adjacent free
+  // ranges are merged on release
+  struct Page {
+    rhi::BufferHandle buffer{0};
+    size_t capacity = 0;
+    size_t used = 0;
+    std::map<size_t, size_t> free_ranges; // offset -> size
+
+    std::optional<size_t> acquire(size_t size);
+    void release(size_t offset, size_t size);
+  };
+
+  // capacity is in elements of element_size bytes
+  Page *create_page(rhi::BufferUsage usage, size_t capacity,
+                    size_t element_size, std::vector<Page> &pages);
+  static Page *find_page(std::vector<Page> &pages, rhi::BufferHandle buffer);
+
+  struct Retired {
+    Allocation allocation;
+    uint64_t frame;
+  };
+
+  rhi::Device *device_ = nullptr;
+  Settings settings_{};
+  std::vector<Page> standard_vertex_pages_; // capacity in vertices
+  std::vector<Page> compressed_vertex_pages_;
+  std::vector<Page> index_pages_; // capacity in bytes
+  size_t allocation_count_ = 0;
+  uint64_t frame_ = 0;
+  std::deque<Retired> retired_;
+
+  std::vector<Page> &vertex_pages(rhi::VertexLayout layout) {
+    return layout == rhi::VertexLayout::Compressed ? compressed_vertex_pages_
+                                                   : standard_vertex_pages_;
+  }
+};
+
+} // namespace pixel::renderer3d
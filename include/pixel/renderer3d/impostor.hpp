@@ -0,0 +1,64 @@
+#pragma once
+
+#include "pixel/renderer3d/renderer_instanced.hpp"
+#include "pixel/rhi/rhi.hpp"
+#include <cstdint>
+#include <memory>
+
+namespace pixel::renderer3d {
+
+class Renderer;
+
+// ============================================================================
+// Impostor Atlas
+// ============================================================================
+
+// Billboard impostor baked from a mesh. Each of view_count() views is one
+// layer of a renderable texture array, captured with an orthographic camera
+// orbiting the mesh around +Y (view i looks from yaw 2*pi*i/view_count).
+// Far instances draw as camera-facing quads that sample the nearest view.
+//
+// bake() records its passes on the immediate command list, which the next
+// frame submits, so it must run outside begin_frame()/end_frame() (at load
+// time, before the first frame or between frames); it refuses otherwise.
+class ImpostorAtlas {
+public:
+  static std::unique_ptr<ImpostorAtlas>
+  bake(Renderer &renderer, const InstancedMesh &source, const Vec3 &center,
+       float radius, uint32_t view_count, uint32_t resolution,
+       size_t max_instances);
+
+  // View layer for an instance at `instance_pos` with yaw `instance_yaw`
+  // seen from `camera_pos`.
+  uint32_t select_view(const Vec3 &instance_pos, float instance_yaw,
+                       const Vec3 &camera_pos) const;
+
+  // GPU record for one billboard (position re-centred, quad half-extent in
+  // scale.xy, view layer in texture_index).
+  InstanceGPUData make_instance(const InstanceData &inst,
+                                const Vec3 &camera_pos) const;
+
+  rhi::TextureHandle texture() const { return color_texture_; }
+  uint32_t view_count() const { return view_count_; }
+  uint32_t resolution() const { return resolution_; }
+  const Vec3 &center() const { return center_; }
+  float radius() const { return radius_; }
+
+  InstancedMesh *billboards() { return billboards_.get(); }
+  const InstancedMesh *billboards() const { return billboards_.get(); }
+
+private:
+  ImpostorAtlas() = default;
+
+  rhi::TextureHandle color_texture_{};
+  rhi::TextureHandle depth_texture_{};
+  uint32_t view_count_ = 0;
+  uint32_t resolution_ = 0;
+  Vec3 center_{0, 0, 0};
+  float radius_ = 1.0f;
+
+  std::unique_ptr<Mesh> quad_;
+  std::unique_ptr<InstancedMesh> billboards_;
+};
+
+} // namespace pixel::renderer3d
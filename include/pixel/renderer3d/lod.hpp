@@ -1,10 +1,13 @@
 #pragma once
+#include "impostor.hpp"
 #include "renderer.hpp"
 #include "renderer_instanced.hpp"
 #include "shader_reflection.hpp"
+#include "spatial_index.hpp"
 #include <array>
 #include <memory>
 #include <optional>
+#include <span>
 #include <unordered_map>
 #include <vector>
 
@@ -19,9 +22,10 @@ enum class LODLevel : uint32_t { High = 0, Medium = 1, Low = 2, Culled = 3 };
 // ============================================================================
 
 enum class LODMode {
-  Distance,    // Distance-based LOD
-  ScreenSpace, // Screen-space based LOD (projected size)
-  Hybrid       // Combination of both
+  Distance,        // Distance-based LOD
+  ScreenSpace,     // Screen-space based LOD (projected size)
+  Hybrid,          // Combination of both
+  ScreenSpaceError // Coarsest LOD whose projected geometric error fits
 };
 
 struct LODConfig {
@@ -40,6 +44,13 @@ struct LODConfig {
   // Hybrid mode weight (0.0 = distance only, 1.0 = screenspace only)
   float hybrid_screenspace_weight = 0.5f;
 
+  // ScreenSpaceError mode: world-space geometric error of each LOD relative
+  // to the source surface (from the simplifier or authoring), at scale 1.
+  // The coarsest LOD whose projected error stays under pixel_error_tolerance
+  // is chosen; instances below screenspace_cull pixels are still culled.
+  std::array<float, 3> geometric_error{0.0f, 0.01f, 0.05f};
+  float pixel_error_tolerance = 1.0f;
+
   // Temporal coherence (prevents rapid LOD switching)
   struct TemporalSettings {
     bool enabled = true;
@@ -66,20 +77,98 @@ struct LODConfig {
     // we default this to false until an async path is implemented.
     bool enabled = false;
   } gpu;
+
+  // Billboard impostors drawn for instances past the last geometric LOD
+  // (i.e. ones that would otherwise be culled) up to distance_max. Baked by
+  // the Renderer overload of create() or bake_impostor(); devices without
+  // Caps::layeredRenderTargets get none and cull those instances.
+  struct ImpostorSettings {
+    bool enabled = false;
+    uint32_t view_count = 8;
+    uint32_t resolution = 128;
+    float distance_max = 400.0f;
+  } impostor;
+
+  // CPU selection visits only instances whose bounding sphere intersects the
+  // view frustum, found through a BVH kept in sync by set_instances() and
+  // update_instance(). Everything else is treated as culled this frame.
+  struct SpatialSettings {
+    bool enabled = false;
+    float fat_margin = 1.0f; // world-space slack before a moved leaf refits
+  } spatial;
 };
 
 // ============================================================================
-// LOD State (per instance)
+// Adaptive LOD Budget (global)
 // ============================================================================
 
-struct InstanceLODState {
-  uint32_t current_lod = 0;
-  uint32_t target_lod = 0;
-  uint32_t previous_lod = 0;
-  float transition_time = 0.0f;
-  float transition_alpha = 1.0f;
-  int stable_frames = 0;
-  bool is_crossfading = false;
+// Frame-time driven controller shared by every LODMesh. The bias is a
+// threshold scale >= 1: distance thresholds are divided by it and
+// screen-space thresholds multiplied, so a higher bias selects coarser LODs
+// sooner. Renderer::end_frame() feeds CPU frame time every frame, and GPU
+// frame time a frame or two late on devices with Caps::timerQueries; the
+// controller steers by whichever is slower.
+struct LODBudgetConfig {
+  bool enabled = false;
+  float target_frame_ms = 16.6f;
+  float hysteresis = 0.1f;   // dead band around target (fraction of target)
+  float smoothing = 0.1f;    // EMA weight of the newest sample
+  float raise_step = 0.05f;  // bias added per over-budget frame
+  float lower_step = 0.02f;  // bias removed per under-budget frame
+  int settle_frames = 30;    // under-budget frames required before lowering
+  float min_bias = 1.0f;
+  float max_bias = 4.0f;
+};
+
+namespace lod_budget {
+void configure(const LODBudgetConfig &config);
+const LODBudgetConfig &config();
+
+void submit_cpu_frame_time(double ms);
+void submit_gpu_frame_time(double ms);
+
+// Current global bias (1.0 when the controller is disabled)
+float bias();
+// Manual override; clamped to [min_bias, max_bias]
+void set_bias(float bias);
+void reset();
+} // namespace lod_budget
+
+namespace screen_space {
+// On-screen diameter in pixels of a world-space sphere under a perspective
+// projection
+float calculate_sphere_screen_size(const Vec3 &world_pos, float world_radius,
+                                   const glm::mat4 &view,
+                                   const glm::mat4 &proj,
+                                   int viewport_height);
+} // namespace screen_space
+
+// ============================================================================
+// LOD State (per instance, packed SoA)
+// ============================================================================
+
+// Temporal LOD state for every instance of a LODMesh, 5 bytes per instance
+// split across parallel arrays so the per-frame hysteresis pass streams
+// through memory and vectorises:
+//   lod_bits      current | target << 2 | previous << 4 | crossfading << 6
+//   timer_ms      time the target LOD has been pending (saturates at 65.5 s)
+//   stable_frames frames spent at the current LOD (saturates at 255)
+//   alpha         crossfade alpha quantised to 0..255
+struct InstanceLODStates {
+  std::vector<uint8_t> lod_bits;
+  std::vector<uint16_t> timer_ms;
+  std::vector<uint8_t> stable_frames;
+  std::vector<uint8_t> alpha;
+
+  size_t size() const { return lod_bits.size(); }
+
+  // Resizes and resets every instance to LOD 0, settled
+  void reset(size_t count);
+
+  static uint32_t current_lod(uint8_t bits) { return bits & 3u; }
+  static uint32_t target_lod(uint8_t bits) { return (bits >> 2) & 3u; }
+  static uint32_t previous_lod(uint8_t bits) { return (bits >> 4) & 3u; }
+  static bool is_crossfading(uint8_t bits) { return ((bits >> 6) & 1u) != 0; }
 };
 
 // ============================================================================
@@ -109,10 +198,19 @@ public:
   create(rhi::Device *device, const Mesh &high_detail,
          const Mesh &medium_detail, const Mesh &low_detail,
          size_t max_instances_per_lod, const LODConfig &config = LODConfig());
+  // As above, then bakes the impostor atlas when config.impostor.enabled.
+  // Call at load time, outside a frame.
+  static std::unique_ptr<LODMesh>
+  create(Renderer &renderer, const Mesh &high_detail,
+         const Mesh &medium_detail, const Mesh &low_detail,
+         size_t max_instances_per_lod, const LODConfig &config = LODConfig());
 
   ~LODMesh();
 
-  void set_instances(const std::vector<InstanceData> &instances);
+  // Copies the span into the source set; the rvalue overload adopts the
+  // caller's storage without a copy.
+  void set_instances(std::span<const InstanceData> instances);
+  void set_instances(std::vector<InstanceData> &&instances);
   void update_instance(size_t index, const InstanceData &data);
 
   // Update LOD selection based on camera
@@ -121,19 +219,33 @@ public:
   // Draw all LOD levels
   void draw_all_lods(rhi::CmdList *cmd) const;
 
+  // Render the high-detail mesh into the impostor atlas. Call at load time,
+  // outside a frame; LOD updates never bake, so without an atlas instances
+  // past the last geometric LOD are culled.
+  bool bake_impostor(Renderer &renderer);
+  const ImpostorAtlas *impostor() const { return impostor_.get(); }
+
   InstancedMesh *lod_mesh(size_t lod_index);
   const InstancedMesh *lod_mesh(size_t lod_index) const;
 
+  std::span<const InstanceData> instances() const { return source_instances_; }
+  // World bounding spheres of instances(), user data = instance index. Empty
+  // unless config().spatial.enabled when the instances were set.
+  const SpatialIndex &spatial_index() const { return spatial_index_; }
+
   // Get statistics
   struct LODStats {
     uint32_t total_instances = 0;
     uint32_t instances_per_lod[3] = {0, 0, 0};
     uint32_t visible_per_lod[3] = {0, 0, 0};
     uint32_t culled = 0;
+    uint32_t impostors = 0;
 
     float avg_screen_size_per_lod[3] = {0, 0, 0};
     float min_screen_size = 0.0f;
     float max_screen_size = 0.0f;
+
+    float lod_bias = 1.0f;
   };
 
   LODStats get_stats() const;
@@ -144,6 +256,9 @@ public:
 private:
   LODMesh() = default;
 
+  // desired_lods_ marker for instances rejected by the spatial frustum query
+  static constexpr uint32_t kLODOutsideFrustum = 4;
+
   struct GPUResources {
     bool initialized = false;
     rhi::ShaderHandle compute_shader{};
@@ -161,7 +276,9 @@ private:
   void update_lod_selection_gpu(Renderer &renderer, float delta_time,
                                 bool detailed_log);
 
-  void apply_lod_results(const std::vector<uint32_t> &desired_lods,
+  void update_temporal_states(std::span<const uint32_t> desired_lods,
+                              float delta_time);
+  void apply_lod_results(std::span<const uint32_t> desired_lods,
                          float delta_time, bool detailed_log,
                          Renderer &renderer);
 
@@ -170,22 +287,65 @@ private:
                               const Renderer &renderer) const;
 
   bool initialize_gpu_resources(size_t max_instances);
+  void on_source_instances_changed();
+  void rebuild_spatial_index();
+
+  // config_ thresholds with the global LOD bias applied, refreshed at the
+  // start of every update_lod_selection()
+  struct LODThresholds {
+    float distance_high = 0.0f;
+    float distance_medium = 0.0f;
+    float distance_cull = 0.0f;
+    float screenspace_high = 0.0f;
+    float screenspace_medium = 0.0f;
+    float screenspace_cull = 0.0f;
+    float impostor_distance_max = 0.0f;
+    float pixel_error_tolerance = 0.0f;
+    // Pixels per world unit at distance 1: proj[1][1] * viewport_height / 2
+    float error_projection_scale = 0.0f;
+  };
+  void refresh_thresholds();
 
   rhi::Device *device_ = nullptr;
 
   std::array<std::unique_ptr<InstancedMesh>, 3> lod_meshes_;
 
+  // Bounding sphere of the high-detail mesh (object space)
+  Vec3 bounds_center_{0, 0, 0};
+  float bounds_radius_ = 1.0f;
+  std::unique_ptr<ImpostorAtlas> impostor_;
+
   std::vector<InstanceData> source_instances_;
   size_t total_instance_count_ = 0;
   size_t max_instances_per_lod_ = 0;
 
   LODConfig config_;
-  std::vector<InstanceLODState> instance_lod_states_;
+  LODThresholds thresholds_;
+  InstanceLODStates instance_lod_states_;
+
+  // Bounding spheres of source_instances_ (world space); proxy i belongs to
+  // instance i. Empty while config_.spatial is disabled.
+  SpatialIndex spatial_index_;
+  std::vector<SpatialIndex::ProxyID> spatial_proxies_;
+  std::vector<uint32_t> spatial_candidates_;
+
+  // Per-LOD draw lists rebuilt every frame. Capacity is reserved once in
+  // create() so LOD selection never touches the heap.
+  struct LODDrawEntry {
+    uint32_t instance;
+    float alpha;
+  };
+  std::array<std::vector<LODDrawEntry>, 3> lod_draw_lists_;
+  std::array<std::vector<LODDrawEntry>, 3> crossfade_draw_lists_;
+  std::vector<LODDrawEntry> impostor_draw_list_;
+  std::vector<uint32_t> desired_lods_;
+
   double last_update_time_ = 0.0;
 
   bool use_gpu_lod_ = false;
   GPUResources gpu_{};
   std::vector<uint32_t> gpu_lod_assignments_;
+  std::vector<InstanceGPUData> gpu_source_staging_;
   std::array<uint32_t, 4> gpu_lod_counters_{0, 0, 0, 0};
 
   mutable LODStats last_stats_;
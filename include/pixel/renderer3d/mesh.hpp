@@ -1,37 +1,129 @@
 #pragma once
 
+#include "pixel/renderer3d/geometry_pool.hpp"
 #include "pixel/renderer3d/types.hpp"
 #include "pixel/rhi/rhi.hpp"
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <span>
+#include <string>
 #include <vector>
 
 namespace pixel::renderer3d {
 
+class MeshFile;
+class ShaderReflection;
+
+struct MeshOptions {
+  rhi::VertexLayout vertex_layout = rhi::VertexLayout::Standard;
+  // Store indices as uint16 whenever vertex_count() < 65536
+  bool allow_16bit_indices = true;
+  // Reorder for vertex cache, overdraw and vertex fetch before upload (see
+  // mesh_optimizer.hpp). vertices()/indices() return the reordered data.
+  bool optimize = false;
+  // Sub-allocate from a shared pool instead of creating dedicated buffers.
+  // The pool must outlive the mesh; its range is retired, not freed, on
+  // destruction (GeometryPool::retire()).
+  GeometryPool *pool = nullptr;
+  // Keep vertices()/indices() in system RAM after upload. Off by default;
+  // set it for meshes that are picked (PickingScene) or split into meshlets
+  // (MeshletMesh). See Mesh::release_cpu_data()/reload_cpu_data().
+  bool keep_cpu_data = false;
+};
+
+// How a mesh's GPU buffers are encoded. Anything that binds the buffers
+// (instanced meshes, LOD levels) carries a copy.
+struct MeshFormat {
+  rhi::VertexLayout vertex_layout = rhi::VertexLayout::Standard;
+  rhi::IndexFormat index_format = rhi::IndexFormat::Uint32;
+  // Compressed positions decode as offset + snorm * scale
+  Vec3 position_offset{0, 0, 0};
+  Vec3 position_scale{1, 1, 1};
+  // Where the mesh starts inside its (possibly shared) buffers; pass both to
+  // drawIndexed
+  uint32_t first_index = 0;
+  int32_t base_vertex = 0;
+
+  bool compressed() const {
+    return vertex_layout == rhi::VertexLayout::Compressed;
+  }
+};
+
+// Packs vertices into the compressed layout using format's position
+// offset/scale
+std::vector<CompressedVertex> compress_vertices(std::span<const Vertex> vertices,
+                                                const MeshFormat &format);
+
+// Inverse of compress_vertices, for CPU consumers of compressed data
+std::vector<Vertex> decompress_vertices(std::span<const CompressedVertex> packed,
+                                        const MeshFormat &format);
+
+// Uploads the position dequantisation a compressed mesh needs; no-op for the
+// standard layout
+void set_mesh_format_uniforms(rhi::CmdList *cmd, const MeshFormat &format,
+                              const ShaderReflection &reflection,
+                              bool force_metal_uniforms);
+
 class Mesh {
 public:
   static std::unique_ptr<Mesh> create(rhi::Device *device,
                                       const std::vector<Vertex> &vertices,
-                                      const std::vector<uint32_t> &indices);
+                                      const std::vector<uint32_t> &indices,
+                                      const MeshOptions &options = {});
+  // Uploads one LOD of a .pxmesh straight from the mapped file (see
+  // mesh_file.hpp). The file decides the vertex layout and index format; only
+  // options.pool and options.keep_cpu_data are used. Compressed vertices are
+  // decoded when CPU data is kept.
+  static std::unique_ptr<Mesh> load(rhi::Device *device, const MeshFile &file,
+                                    size_t lod = 0,
+                                    const MeshOptions &options = {});
+  static std::unique_ptr<Mesh> load(rhi::Device *device,
+                                    const std::string &path,
+                                    const MeshOptions &options = {});
   ~Mesh();
+  Mesh(const Mesh &) = delete;
+  Mesh &operator=(const Mesh &) = delete;
 
   rhi::BufferHandle vertex_buffer() const { return vertex_buffer_; }
   rhi::BufferHandle index_buffer() const { return index_buffer_; }
+  bool pooled() const { return pool_ != nullptr; }
+  const MeshFormat &format() const { return format_; }
 
   size_t vertex_count() const { return vertex_count_; }
   size_t index_count() const { return index_count_; }
 
+  // Object-space bounding sphere, kept even without CPU data
+  const Vec3 &bounds_center() const { return bounds_center_; }
+  float bounds_radius() const { return bounds_radius_; }
+
+  // CPU copies of the uploaded geometry; empty once released
   const std::vector<Vertex> &vertices() const { return vertices_; }
   const std::vector<uint32_t> &indices() const { return indices_; }
+  bool has_cpu_data() const { return !vertices_.empty(); }
+  // Frees vertices()/indices(). The GPU buffers are unaffected.
+  void release_cpu_data();
+  // Re-reads the CPU copies from the mesh file a loaded mesh came from;
+  // returns false for meshes built with create()
+  bool reload_cpu_data();
 
 private:
   Mesh() = default;
+  void upload(rhi::Device *device, std::span<const std::byte> vertex_bytes,
+              std::span<const std::byte> index_bytes, GeometryPool *pool);
 
   rhi::BufferHandle vertex_buffer_{0};
   rhi::BufferHandle index_buffer_{0};
   size_t vertex_count_ = 0;
   size_t index_count_ = 0;
+  MeshFormat format_{};
+  GeometryPool *pool_ = nullptr;
+  GeometryPool::Allocation allocation_{};
+  Vec3 bounds_center_{0, 0, 0};
+  float bounds_radius_ = 0.0f;
+  // Set by load() so released CPU data can be restored
+  std::string source_path_;
+  size_t source_lod_ = 0;
 
   std::vector<Vertex> vertices_;
   std::vector<uint32_t> indices_;
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "pixel/core/mapped_file.hpp"
+#include "pixel/renderer3d/mesh.hpp"
+#include "pixel/renderer3d/types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// Binary mesh container (.pxmesh). Everything the GPU needs is stored already
+// encoded, so loading is a header check plus spans into the mapped file:
+//
+//   MeshFileHeader
+//   MeshFileLod[lod_count]
+//   vertex payload  (all LODs, vertex_stride bytes each)   16-byte aligned
+//   index payload   (all LODs, LOD-local indices)          16-byte aligned
+//
+// Integers are little-endian. Each LOD owns a contiguous vertex and index
+// range; u16 index ranges are padded to an even count so every range starts
+// 4-byte aligned.
+namespace pixel::renderer3d {
+
+constexpr char kMeshFileMagic[4] = {'P', 'X', 'M', 'S'};
+constexpr uint32_t kMeshFileVersion = 1;
+constexpr size_t kMeshFilePayloadAlignment = 16;
+
+struct MeshFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t header_size; // sizeof(MeshFileHeader), for forward compatibility
+  uint8_t vertex_layout; // rhi::VertexLayout
+  uint8_t index_format;  // rhi::IndexFormat
+  uint16_t reserved;
+  uint32_t vertex_stride;
+  uint32_t lod_count;
+  float bounds_min[3];
+  float bounds_max[3];
+  // Compressed layout dequantisation, shared by every LOD
+  float position_offset[3];
+  float position_scale[3];
+  uint64_t lod_table_offset;
+  uint64_t vertex_data_offset;
+  uint64_t vertex_data_size;
+  uint64_t index_data_offset;
+  uint64_t index_data_size;
+  uint64_t file_size;
+};
+static_assert(sizeof(MeshFileHeader) == 120,
+              "MeshFileHeader layout is part of the file format");
+
+struct MeshFileLod {
+  uint32_t first_vertex;
+  uint32_t vertex_count;
+  uint32_t first_index; // in index_format units
+  uint32_t index_count;
+  // Camera distance from which this LOD is used (0 for LOD 0)
+  float switch_distance;
+  uint32_t reserved;
+};
+static_assert(sizeof(MeshFileLod) == 24,
+              "MeshFileLod layout is part of the file format");
+
+// Source data for one LOD when writing a file
+struct MeshFileLodSource {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  float switch_distance = 0.0f;
+};
+
+// Encodes `lods` (LOD 0 first) and writes them to `path`. The vertex layout
+// comes from options.vertex_layout; indices are stored as u16 when
+// options.allow_16bit_indices is set and every LOD has fewer than 65536
+// vertices. options.optimize runs mesh_optimizer on each LOD first.
+bool write_mesh_file(const std::string &path,
+                     const std::vector<MeshFileLodSource> &lods,
+                     const MeshOptions &options = {});
+
+// A validated, memory-mapped .pxmesh: header, ranges and every index (against
+// its LOD's vertex count) are checked at open(). All spans point into the
+// mapping.
+class MeshFile {
+public:
+  static std::unique_ptr<MeshFile> open(const std::string &path);
+
+  const std::string &path() const { return file_->path(); }
+  const MeshFileHeader &header() const { return *header_; }
+  std::span<const MeshFileLod> lods() const { return lods_; }
+
+  // GPU-ready bytes and format of one LOD; the format's first_index and
+  // base_vertex are zero (the ranges are already sliced)
+  std::span<const std::byte> vertex_data(size_t lod) const;
+  std::span<const std::byte> index_data(size_t lod) const;
+  MeshFormat format() const;
+
+private:
+  MeshFile() = default;
+
+  std::unique_ptr<core::MappedFile> file_;
+  const MeshFileHeader *header_ = nullptr;
+  std::span<const MeshFileLod> lods_;
+};
+
+} // namespace pixel::renderer3d
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "pixel/renderer3d/types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Build-time index/vertex reordering for indexed triangle lists. Run in the
+// order optimize_mesh() does: vertex cache, then overdraw, then vertex fetch.
+namespace pixel::renderer3d::mesh_optimizer {
+
+// Post-transform cache size the reordering targets
+constexpr uint32_t kDefaultCacheSize = 16;
+
+// Average cache miss ratio: vertex shader invocations per triangle for a FIFO
+// cache of cache_size entries. 0.5 is the ideal for large regular meshes,
+// 3.0 means no reuse at all.
+float average_cache_miss_ratio(std::span<const uint32_t> indices,
+                               size_t vertex_count,
+                               uint32_t cache_size = kDefaultCacheSize);
+
+// Tipsify (Sander, Nehab, Barczak 2007): reorders triangles in place so
+// consecutive triangles share cached vertices. Linear time.
+void optimize_vertex_cache(std::vector<uint32_t> &indices, size_t vertex_count,
+                           uint32_t cache_size = kDefaultCacheSize);
+
+// Splits a cache-optimised index buffer into clusters and orders them
+// outside-in, so outward-facing clusters draw first and occlude the rest.
+// Clusters are only split where their ACMR stays within `threshold` times
+// the enclosing cache run, so cache efficiency is mostly preserved.
+void optimize_overdraw(std::vector<uint32_t> &indices,
+                       std::span<const Vertex> vertices,
+                       uint32_t cache_size = kDefaultCacheSize,
+                       float threshold = 1.05f);
+
+// Renumbers vertices in first-use order and remaps indices so vertex fetch
+// walks memory linearly. Unreferenced vertices are dropped; returns the new
+// vertex count.
+size_t optimize_vertex_fetch(std::vector<Vertex> &vertices,
+                             std::vector<uint32_t> &indices);
+
+// Cache efficiency before and after optimize_mesh(), for callers to log
+struct OptimizeStats {
+  float acmr_before = 0.0f;
+  float acmr_after = 0.0f;
+};
+
+// All three passes. Leaves the mesh untouched (and returns zeroed stats) if
+// the index buffer is not a valid triangle list.
+OptimizeStats optimize_mesh(std::vector<Vertex> &vertices,
+                   std::vector<uint32_t> &indices,
+                   uint32_t cache_size = kDefaultCacheSize);
+
+} // namespace pixel::renderer3d::mesh_optimizer
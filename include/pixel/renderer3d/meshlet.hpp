@@ -0,0 +1,163 @@
+#pragma once
+
+#include "pixel/renderer3d/mesh.hpp"
+#include "pixel/renderer3d/shader_reflection.hpp"
+#include "pixel/renderer3d/spatial_index.hpp"
+#include "pixel/renderer3d/types.hpp"
+#include "pixel/rhi/rhi.hpp"
+#include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace pixel::renderer3d {
+
+// Cluster limits; 64/124 keeps a meshlet's local indices in a byte and its
+// triangle list within 372 indices
+constexpr uint32_t kMeshletMaxVertices = 64;
+constexpr uint32_t kMeshletMaxTriangles = 124;
+
+struct Meshlet {
+  uint32_t vertex_offset;   // into MeshletData::vertices
+  uint32_t triangle_offset; // into MeshletData::triangles, in bytes
+  uint32_t vertex_count;
+  uint32_t triangle_count;
+};
+
+// Object-space culling bounds. A meshlet faces away from a camera at `eye`
+// when dot(normalize(cone_apex - eye), cone_axis) >= cone_cutoff; a cutoff
+// of 1 means the normals are too spread out for backface culling.
+struct MeshletBounds {
+  Vec3 center;
+  float radius = 0.0f;
+  Vec3 cone_apex;
+  Vec3 cone_axis;
+  float cone_cutoff = 1.0f;
+};
+
+struct MeshletData {
+  std::vector<Meshlet> meshlets;
+  std::vector<MeshletBounds> bounds;
+  std::vector<uint32_t> vertices; // mesh vertex index per meshlet vertex
+  std::vector<uint8_t> triangles; // meshlet-local corner indices, 3 per tri
+};
+
+// Greedily splits a triangle list into meshlets in index order. Run it on a
+// cache-optimised index buffer (mesh_optimizer) so clusters are compact.
+// Degenerate triangles are kept; returns empty data for invalid input.
+MeshletData build_meshlets(std::span<const Vertex> vertices,
+                           std::span<const uint32_t> indices,
+                           uint32_t max_vertices = kMeshletMaxVertices,
+                           uint32_t max_triangles = kMeshletMaxTriangles);
+
+// CPU reference of the test meshlet_cull.comp runs. `model` places the mesh;
+// `eye_object` is the camera position in the mesh's object space.
+bool meshlet_visible(const MeshletBounds &bounds, const glm::mat4 &model,
+                     const FrustumPlanes &world_planes,
+                     const glm::vec3 &eye_object);
+
+// Meshlet clusters of a Mesh plus the GPU pass that culls them. Every
+// placement culled in a frame gets its own slot: a compacted 32-bit index
+// buffer drawn against the source mesh's vertex buffer and, with GPU
+// culling, the uniforms and indirect draw arguments meshlet_cull.comp fills
+// in. The source mesh must outlive this object and still have its CPU data
+// when create() runs (MeshOptions::keep_cpu_data).
+//
+// Renderer::draw_meshlets() drives this: prepare_cull() per placement, then
+// one compute pass runs record_culls() for every queued mesh and the draws
+// read their index counts straight from the argument buffers, so nothing is
+// read back. Slots are written from the CPU, so next_frame() cycles through
+// kFramesInFlight slot sets and a set is only rewritten once the GPU is done
+// with the frame that used it. Devices without Caps::computeStorageBuffers and
+// Caps::indirectDraw (or without the compiled shader) cull on the CPU inside
+// prepare_cull() and draw with a plain index count.
+class MeshletMesh {
+public:
+  struct CullSlot {
+    rhi::BufferHandle visible_indices{};
+    rhi::BufferHandle draw_args{};      // GPU culling: DrawIndexedIndirectArgs
+    rhi::BufferHandle uniform_buffer{}; // GPU culling
+    uint32_t index_count = 0;           // CPU culling: indices to draw
+  };
+
+  // Frames the GPU may still be reading a slot set from; matches the
+  // deepest backend frame queue (Metal's triple buffering)
+  static constexpr uint32_t kFramesInFlight = 3;
+
+  static std::unique_ptr<MeshletMesh> create(rhi::Device *device,
+                                             const Mesh &mesh);
+  ~MeshletMesh();
+
+  MeshletMesh(const MeshletMesh &) = delete;
+  MeshletMesh &operator=(const MeshletMesh &) = delete;
+
+  // Takes the next free slot of this frame's set for one placement. CPU culling
+  // finishes here; GPU culling only uploads the slot's inputs and leaves the
+  // work to record_culls(). Returns the slot index, or nullopt when its
+  // buffers cannot be allocated.
+  std::optional<uint32_t> prepare_cull(const glm::mat4 &model,
+                                      const FrustumPlanes &world_planes,
+                                      const glm::vec3 &eye_world);
+  // Records one dispatch per slot prepared since the last record_culls(), so
+  // it can run several times a frame. Call outside a render pass; the caller
+  // issues the memory barrier before drawing. No-op with CPU culling.
+  void record_culls(rhi::CmdList *cmd);
+  // Moves on to the next frame's slot set. Call once per frame the mesh was
+  // culled in, after its draws are recorded.
+  void next_frame();
+
+  const CullSlot &cull_slot(uint32_t slot) const {
+    return frame_slots_[frame_][slot];
+  }
+  // Slots prepared this frame that record_culls() has not dispatched yet
+  uint32_t pending_culls() const { return slots_used_ - slots_recorded_; }
+
+  const Mesh &source() const { return *source_; }
+  size_t meshlet_count() const { return data_.meshlets.size(); }
+  const MeshletData &data() const { return data_; }
+  bool gpu_culling() const { return gpu_.initialized; }
+  // Totals of the CPU culls since the last next_frame(); GPU results stay
+  // on the GPU
+  uint32_t visible_index_count() const { return visible_index_count_; }
+  uint32_t visible_meshlet_count() const { return visible_meshlet_count_; }
+
+private:
+  MeshletMesh() = default;
+  bool initialize_gpu_resources();
+  bool allocate_slot(CullSlot &slot) const;
+  uint32_t cull_cpu(CullSlot &slot, const glm::mat4 &model,
+                    const FrustumPlanes &planes, const glm::vec3 &eye_object);
+
+  struct GPUResources {
+    bool initialized = false;
+    rhi::ShaderHandle compute_shader{};
+    rhi::PipelineHandle compute_pipeline{};
+    rhi::BufferHandle meshlets{};
+    rhi::BufferHandle meshlet_indices{};
+    ShaderReflection reflection{};
+  };
+
+  rhi::Device *device_ = nullptr;
+  const Mesh *source_ = nullptr;
+  MeshletData data_;
+  // Each meshlet's triangles expanded to mesh vertex indices, back to back
+  std::vector<uint32_t> meshlet_indices_;
+  std::vector<uint32_t> meshlet_first_index_;
+  std::vector<uint32_t> cpu_visible_indices_;
+
+  // One slot set per frame in flight, each grown to the most placements seen
+  // in a frame; buffers live as long as the device
+  std::array<std::vector<CullSlot>, kFramesInFlight> frame_slots_;
+  uint32_t frame_ = 0;
+  uint32_t slots_used_ = 0;
+  uint32_t slots_recorded_ = 0;
+  uint32_t visible_index_count_ = 0;
+  uint32_t visible_meshlet_count_ = 0;
+  GPUResources gpu_{};
+};
+
+} // namespace pixel::renderer3d
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "pixel/renderer3d/mesh.hpp"
+#include "pixel/renderer3d/spatial_index.hpp"
+#include "pixel/renderer3d/types.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace pixel::renderer3d {
+
+class LODMesh;
+
+using PickID = uint32_t;
+constexpr PickID INVALID_PICK = 0xFFFFFFFFu;
+
+struct PickResult {
+  uint32_t id = 0;       // caller id passed to add() or add_instances()
+  PickID pickable = INVALID_PICK;
+  // Set when an instance registered through add_instances() was hit
+  const LODMesh *lod_mesh = nullptr;
+  uint32_t instance = 0; // index into lod_mesh->instances()
+  float distance = 0.0f; // along the normalised ray
+  Vec3 position{0, 0, 0};
+  uint32_t triangle = 0; // index of the first index of the hit triangle
+};
+
+// ============================================================================
+// Triangle BVH
+// ============================================================================
+
+// Static bounding volume hierarchy over a mesh's triangles in object space.
+// Built once from the CPU geometry (median split on the longest centroid
+// axis, up to kLeafSize triangles per leaf); keeps its own copy of the
+// triangle corners so later queries do not touch the mesh.
+class TriangleBVH {
+public:
+  static constexpr uint32_t kLeafSize = 4;
+
+  void build(const std::vector<Vertex> &vertices,
+             const std::vector<uint32_t> &indices);
+  void clear();
+
+  bool empty() const { return nodes_.empty(); }
+  size_t triangle_count() const { return triangle_index_.size(); }
+
+  // Closest double-sided hit with t in [0, max_t], t in units of
+  // `direction`; `triangle` is the first index of the hit triangle
+  bool raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+               float max_t, float &t, uint32_t &triangle) const;
+
+private:
+  struct Node {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+    uint32_t first = 0; // leaf: first triangle; interior: left child
+    uint32_t count = 0; // 0 for interior nodes (right child is first + 1)
+  };
+
+  std::vector<Node> nodes_;
+  // Per triangle in leaf order: its corners and its first index in the mesh
+  std::vector<glm::vec3> corners_;
+  std::vector<uint32_t> triangle_index_;
+};
+
+// ============================================================================
+// Picking Scene
+// ============================================================================
+
+// Mesh transforms registered for ray picking. World bounding spheres live in a
+// SpatialIndex; a ray first collects sphere candidates nearest-first, then
+// only those candidates are intersected in object space through their mesh's
+// TriangleBVH, stopping once the next sphere starts beyond the closest hit.
+//
+// add_instances() makes every instance of a LODMesh pickable without copying
+// them: candidates come from the LODMesh's own SpatialIndex (so it needs
+// LODConfig::spatial enabled) and are tested against `mesh`, usually its
+// high-detail source.
+//
+// Meshes and LODMeshes are referenced, not copied, and must outlive their
+// registrations. Meshes need their CPU data (MeshOptions::keep_cpu_data)
+// when registered; the BVH is built then.
+class PickingScene {
+public:
+  PickID add(const Mesh &mesh, const Vec3 &position, const Vec3 &rotation,
+             const Vec3 &scale, uint32_t id);
+  void update(PickID pickable, const Vec3 &position, const Vec3 &rotation,
+              const Vec3 &scale);
+  void remove(PickID pickable);
+
+  PickID add_instances(const LODMesh &lod_mesh, const Mesh &mesh,
+                       uint32_t id);
+  void remove_instances(PickID instances);
+
+  void clear();
+
+  size_t size() const { return index_.size(); }
+
+  std::optional<PickResult> raycast(const Vec3 &origin,
+                                    const Vec3 &direction,
+                                    float max_distance) const;
+
+private:
+  struct MeshData {
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+    TriangleBVH bvh;
+    uint32_t users = 0;
+  };
+
+  struct Pickable {
+    const Mesh *mesh = nullptr;
+    glm::mat4 model{1.0f};
+    glm::mat4 inverse_model{1.0f};
+    SpatialIndex::ProxyID proxy = SpatialIndex::kInvalidProxy;
+    uint32_t id = 0;
+    bool alive = false;
+  };
+
+  struct InstanceSet {
+    const LODMesh *lod_mesh = nullptr;
+    const Mesh *mesh = nullptr;
+    uint32_t id = 0;
+  };
+
+  // Adds a user of `mesh`, building its BVH on first use; false without CPU
+  // geometry
+  bool acquire_mesh(const Mesh &mesh, const char *caller);
+  void release_mesh(const Mesh *mesh);
+
+  void set_transform(Pickable &pickable, const Vec3 &position,
+                     const Vec3 &rotation, const Vec3 &scale,
+                     Vec3 &world_center, float &world_radius) const;
+
+  SpatialIndex index_;
+  std::vector<Pickable> pickables_;
+  std::vector<PickID> free_list_;
+  // Instance sets are never reused; removed ones have a null lod_mesh
+  std::vector<InstanceSet> instance_sets_;
+  std::unordered_map<const Mesh *, MeshData> meshes_;
+
+  // Query scratch; raycast() is not reentrant
+  mutable std::vector<SpatialIndex::RayHit> candidates_;
+};
+
+} // namespace pixel::renderer3d
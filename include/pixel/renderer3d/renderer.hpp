@@ -2,11 +2,13 @@
 #include "pixel/platform/platform.hpp"
 #include "pixel/rhi/rhi.hpp"
 #include "pixel/renderer3d/mesh.hpp"
+#include "pixel/renderer3d/picking.hpp"
 #include "pixel/renderer3d/shader_reflection.hpp"
 #include "pixel/renderer3d/shadow_map.hpp"
 #include "pixel/renderer3d/shader_variant_system.hpp"
 #include <glm/glm.hpp>
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <initializer_list>
 #include <map>
@@ -23,11 +25,17 @@ namespace pixel::platform {
 
 namespace pixel::resources {
   class TextureLoader;
+  class TextureRef;
+  class TextureStreamer;
+  class AsyncTexture;
+  using AsyncTextureRef = std::shared_ptr<const AsyncTexture>;
 }
 
 namespace pixel::renderer3d {
 
 class InstancedMesh;
+class MeshletMesh;
+class ShaderVariantManifest;
 
 // ============================================================================
 // Camera
@@ -54,6 +62,10 @@ public:
   void get_view_matrix(float *out) const;
   void get_projection_matrix(float *out, int width, int height) const;
 
+  // World-space ray through window pixel (screen_x, screen_y), origin top-left
+  void screen_ray(float screen_x, float screen_y, int width, int height,
+                  Vec3 &origin, Vec3 &direction) const;
+
   // Camera controls
   void orbit(float dx, float dy);
   void pan(float dx, float dy);
@@ -77,6 +89,13 @@ public:
   const DefineMap &defines() const { return defines_; }
   std::string cache_key() const;
 
+  // Vertex layout is carried as the PIXEL_COMPRESSED_VERTEX define so each
+  // layout gets its own SPIR-V / Metal variant and pipelines
+  static constexpr std::string_view kCompressedVertexDefine =
+      "PIXEL_COMPRESSED_VERTEX";
+  rhi::VertexLayout vertex_layout() const;
+  ShaderVariantKey with_vertex_layout(rhi::VertexLayout layout) const;
+
   static ShaderVariantKey from_defines(
       std::initializer_list<std::pair<std::string, std::string>> defines);
 
@@ -144,6 +163,15 @@ public:
   std::pair<rhi::ShaderHandle, rhi::ShaderHandle>
   shader_handles(const ShaderVariantKey &variant = ShaderVariantKey{}) const;
 
+  const std::string &vert_path() const { return vert_path_; }
+  const std::string &frag_path() const { return frag_path_; }
+
+  // Adds each (variant, blend mode) the first time pipeline() is asked for
+  // it, before it is built. nullptr stops recording.
+  void set_variant_recorder(ShaderVariantManifest *recorder) {
+    variant_recorder_ = recorder;
+  }
+
 private:
   Shader() = default;
   using VariantData = ShaderVariantData;
@@ -163,6 +191,9 @@ private:
   bool is_instanced_shader_{false};
   std::unique_ptr<ShaderVariantSystem> variant_system_;
   mutable std::unordered_map<std::string, VariantData> variant_cache_;
+  ShaderVariantManifest *variant_recorder_{nullptr};
+  // Blend-mode bits already recorded, by variant cache key
+  mutable std::unordered_map<std::string, uint32_t> recorded_blend_modes_;
 
 public:
   const ShaderReflection &reflection() const;
@@ -194,7 +225,31 @@ public:
                        std::optional<std::string> metal_path = std::nullopt);
   Shader *get_shader(ShaderID id);
 
+  // While on, every pipeline requested through Shader::pipeline() is added
+  // to recorded_shader_variants(). Builds with PIXEL_RECORD_SHADER_VARIANTS
+  // start with it on and save to the source manifest on shutdown.
+  void set_shader_variant_recording(bool enabled);
+  const ShaderVariantManifest *recorded_shader_variants() const {
+    return recorded_variants_.get();
+  }
+  // Recorded variants merged with the manifest warmed up at startup
+  bool save_shader_variants(const std::string &path) const;
+
   rhi::TextureHandle load_texture(const std::string &path);
+  // Counted reference; the texture is destroyed a few frames after the last
+  // reference is dropped (see TextureLoader::acquire)
+  resources::TextureRef acquire_texture(const std::string &path);
+  // Decodes on the texture loader's worker pool; begin_frame() uploads
+  // finished images within the loader's per-frame byte budget. Bind
+  // result->texture(), which is a placeholder until the upload lands.
+  resources::AsyncTextureRef load_texture_async(const std::string &path);
+  // Registers the texture with the mip streamer and returns a stable handle
+  // for Material::texture. Draws report their on-screen size and
+  // begin_frame() streams levels in or out within the streamer's budget.
+  rhi::TextureHandle stream_texture(const std::string &path);
+  resources::TextureStreamer *texture_streamer() {
+    return texture_streamer_.get();
+  }
   rhi::TextureHandle create_texture(int width, int height, const uint8_t *data);
 
   rhi::TextureHandle create_texture_array(int width, int height, int layers);
@@ -208,9 +263,27 @@ public:
                                      int segments = 1);
   std::unique_ptr<Mesh> create_sprite_quad();
 
+  // Shared vertex/index storage used by the create_* helpers above. Pass it
+  // through MeshOptions::pool so meshes share buffer bindings; meshes must
+  // be destroyed before the renderer.
+  GeometryPool *geometry_pool() { return geometry_pool_.get(); }
+
   virtual void draw_mesh(const Mesh &mesh, const Vec3 &position,
                          const Vec3 &rotation, const Vec3 &scale,
                          const Material &material);
+  // Culls `meshlets` for this placement and draws the surviving clusters
+  // with the source mesh's material path. With GPU culling, placements with
+  // an order-independent material (BlendMode::Opaque, depth test and write
+  // on, no stencil) are queued and culled together in one compute pass, then
+  // drawn indirectly. The queue is flushed before the next draw whose result
+  // depends on order (any other material, sprites), before a shadow or
+  // offscreen pass and at end_frame(), so queued draws never land after
+  // transparent ones. Other placements flush at once. Give opaque geometry
+  // BlendMode::Opaque to batch its culls. `meshlets` must stay alive until
+  // end_frame().
+  void draw_meshlets(MeshletMesh &meshlets, const Vec3 &position,
+                     const Vec3 &rotation, const Vec3 &scale,
+                     const Material &material);
   void apply_material_state(rhi::CmdList *cmd,
                             const Material &material) const;
 
@@ -226,6 +299,12 @@ public:
   Camera &camera() { return camera_; }
   const Camera &camera() const { return camera_; }
 
+  // Meshes registered in picking() can be hit-tested under the cursor; the
+  // closest triangle hit along the camera ray wins.
+  PickingScene &picking() { return picking_; }
+  const PickingScene &picking() const { return picking_; }
+  std::optional<PickResult> pick(float screen_x, float screen_y) const;
+
   ShadowMap *shadow_map() { return shadow_map_.get(); }
   const ShadowMap *shadow_map() const { return shadow_map_.get(); }
 
@@ -234,6 +313,11 @@ public:
 
   void begin_shadow_pass();
   void end_shadow_pass();
+
+  // Offscreen render-to-texture pass (e.g. impostor baking). Interrupts the
+  // main pass; the next draw resumes it.
+  void begin_offscreen_pass(const rhi::RenderPassDesc &desc);
+  void end_offscreen_pass();
   void draw_shadow_mesh(const Mesh &mesh, const Vec3 &position,
                         const Vec3 &rotation, const Vec3 &scale,
                         const Material *material = nullptr);
@@ -241,11 +325,14 @@ public:
   int window_width() const;
   int window_height() const;
   double time() const;
+  // Between begin_frame() and end_frame()
+  bool frame_in_progress() const { return frame_in_progress_; }
 
   ShaderID default_shader() const { return default_shader_; }
   ShaderID sprite_shader() const { return sprite_shader_; }
   ShaderID instanced_shader() const { return instanced_shader_; }
   ShaderID shadow_instanced_shader() const { return shadow_instanced_shader_; }
+  ShaderID impostor_shader() const { return impostor_shader_; }
 
   const char *backend_name() const;
 
@@ -258,9 +345,33 @@ public:
 protected:
   Renderer() = default;
   void setup_default_shaders();
+  void load_shader_variant_manifest();
+  // Builds the pipelines the startup manifest lists for `shader`
+  void warm_up_shader_variants(Shader &shader);
+  rhi::PipelineHandle create_shadow_pipeline(ShaderID shader_id,
+                                             rhi::VertexLayout layout);
   void reset_depth_bias(rhi::CmdList *cmd);
+  // Main-pass draw of `index_count` indices from `index_buffer` against the
+  // mesh's vertex buffer and format. With `indirect_args` the counts and
+  // base vertex come from that DrawIndexedIndirectArgs buffer instead.
+  void draw_mesh_indices(const Mesh &mesh, const glm::mat4 &model,
+                         const Material &material,
+                         rhi::BufferHandle index_buffer,
+                         rhi::IndexFormat index_format, uint32_t first_index,
+                         uint32_t index_count,
+                         rhi::BufferHandle indirect_args = {});
+  // Records the queued meshlet culls in one compute pass and draws them.
+  // Slots stay taken until end_frame() moves each mesh to its next set.
+  void flush_meshlet_draws();
+  // Current texture for a streamed handle (no usage feedback); other
+  // handles pass through
+  rhi::TextureHandle resolve_texture(rhi::TextureHandle handle) const;
   void ensure_swapchain_depth_texture();
   bool needs_explicit_swapchain_sync() const;
+  void begin_gpu_frame_timer(rhi::CmdList *cmd);
+  void end_gpu_frame_timer(rhi::CmdList *cmd);
+  // Feeds finished timer results to lod_budget without waiting on the GPU
+  void collect_gpu_frame_times();
 
   platform::Window *window_ = nullptr;
   rhi::Device *device_ = nullptr;
@@ -270,22 +381,58 @@ protected:
   ShaderID default_shader_ = INVALID_SHADER;
   ShaderID sprite_shader_ = INVALID_SHADER;
   ShaderID instanced_shader_ = INVALID_SHADER;
+  ShaderID impostor_shader_ = INVALID_SHADER;
+
+  // ShaderVariantManifest::kDefaultPath, when the build shipped one
+  std::unique_ptr<ShaderVariantManifest> warm_up_variants_;
+  // Non-null while recording
+  std::unique_ptr<ShaderVariantManifest> recorded_variants_;
 
   std::unique_ptr<resources::TextureLoader> texture_loader_;
+  std::unique_ptr<resources::TextureStreamer> texture_streamer_;
 
+  // Declared before sprite_mesh_ so pooled meshes release into it first
+  std::unique_ptr<GeometryPool> geometry_pool_;
   std::unique_ptr<Mesh> sprite_mesh_;
 
   std::unique_ptr<ShadowMap> shadow_map_;
   DirectionalLight directional_light_{};
   rhi::PipelineHandle shadow_pipeline_{};
+  rhi::PipelineHandle shadow_compressed_pipeline_{}; // created on first use
   ShaderID shadow_shader_ = INVALID_SHADER;
   rhi::PipelineHandle shadow_instanced_pipeline_{};
+  rhi::PipelineHandle shadow_instanced_compressed_pipeline_{};
   ShaderID shadow_instanced_shader_ = INVALID_SHADER;
 
   bool shadow_pass_active_{false};
+  bool offscreen_pass_active_{false};
   bool command_list_open_{false};
+  bool frame_in_progress_{false};
+
+  // CPU time between begin_frame() and end_frame(), fed to lod_budget
+  std::chrono::steady_clock::time_point frame_begin_time_{};
+
+  // GPU time of each frame, read back a frame or two later and fed to
+  // lod_budget; only on devices with Caps::timerQueries
+  static constexpr uint32_t kGpuTimerFrames = 3;
+  std::array<rhi::QueryHandle, kGpuTimerFrames> gpu_frame_queries_{};
+  std::array<bool, kGpuTimerFrames> gpu_frame_query_pending_{};
+  uint32_t gpu_frame_index_ = 0;
+  bool gpu_frame_timer_active_ = false;
+
+  // GPU-culled meshlet placements waiting for flush_meshlet_draws()
+  struct MeshletDraw {
+    MeshletMesh *meshlets = nullptr;
+    uint32_t slot = 0;
+    glm::mat4 model{1.0f};
+    Material material;
+  };
+  std::vector<MeshletDraw> pending_meshlet_draws_;
+  // Meshes with cull slots in use this frame
+  std::vector<MeshletMesh *> culled_meshlets_;
 
   Camera camera_;
+  PickingScene picking_;
 
   rhi::RenderPassDesc current_pass_desc_{};
   bool render_pass_active_ = false;
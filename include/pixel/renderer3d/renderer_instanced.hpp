@@ -2,6 +2,7 @@
 #include "renderer.hpp"
 #include <array>
 #include <memory>
+#include <span>
 #include <vector>
 
 namespace pixel::renderer3d {
@@ -60,9 +61,17 @@ public:
   create(rhi::Device *device, const Mesh &mesh, size_t max_instances);
   ~InstancedMesh();
 
-  void set_instances(const std::vector<InstanceData> &instances);
+  void set_instances(std::span<const InstanceData> instances);
+  // Upload records already in GPU layout; skips InstanceData conversion.
+  void set_gpu_instances(std::span<const InstanceGPUData> instances);
   void update_instance(size_t index, const InstanceData &data);
 
+  // Direct GPU-format write path. begin_instance_write() returns persistent
+  // staging for up to max_instances() records; fill it and call
+  // commit_instances() to upload. No per-call heap allocation.
+  std::span<InstanceGPUData> begin_instance_write(size_t count);
+  void commit_instances(size_t count);
+
   void draw(rhi::CmdList *cmd) const;
 
   size_t instance_count() const { return instance_count_; }
@@ -73,6 +82,7 @@ public:
   rhi::BufferHandle vertex_buffer() const { return vertex_buffer_; }
   rhi::BufferHandle index_buffer() const { return index_buffer_; }
   rhi::BufferHandle instance_buffer() const { return instance_buffer_; }
+  const MeshFormat &format() const { return format_; }
 
 private:
   InstancedMesh() = default;
@@ -81,13 +91,15 @@ private:
   rhi::BufferHandle vertex_buffer_{0};
   rhi::BufferHandle index_buffer_{0};
   rhi::BufferHandle instance_buffer_{0};
+  MeshFormat format_{};
 
   size_t vertex_count_ = 0;
   size_t index_count_ = 0;
   size_t instance_count_ = 0;
   size_t max_instances_ = 0;
 
-  std::vector<InstanceData> instance_data_;
+  // GPU-format staging; capacity reserved to max_instances_ at creation
+  std::vector<InstanceGPUData> gpu_instances_;
 };
 
 // ============================================================================
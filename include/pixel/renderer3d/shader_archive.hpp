@@ -0,0 +1,83 @@
+#pragma once
+
+#include "pixel/core/mapped_file.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pixel::renderer3d {
+
+// All compiled shader variants in one memory-mapped file, written at build
+// time by pixel_shader_packer. Entries are keyed by the .spv path a variant
+// would otherwise load (make_spirv_path(): shader path plus variant suffix)
+// and found through an open-addressed hash table stored in the file, so a
+// lookup is one hash and usually one probe with no file I/O. Each entry holds
+// the SPIR-V words and the stage's serialized reflection.
+//
+// Layout (little endian):
+//   header   magic "PXSHAR01", version, entry count, slot count, reserved
+//   entries  key hash, name offset/size, bytecode offset/size,
+//            reflection offset/size
+//   slots    entry index + 1 per slot (0 = empty), power-of-two count
+//   data     names and 8-byte aligned blobs
+class ShaderArchive {
+public:
+  struct Entry {
+    std::span<const uint8_t> bytecode;
+    std::span<const uint8_t> reflection;
+  };
+
+  // Relative resource path of the archive the build produces
+  static constexpr const char *kDefaultPath = "assets/shaders/shaders.pxsa";
+
+  static std::unique_ptr<ShaderArchive> open(const std::string &path);
+
+  // Archive at kDefaultPath, mapped on first use and kept for the process
+  // lifetime. nullptr when the build did not produce one; callers fall back
+  // to loose .spv files.
+  static const ShaderArchive *shared();
+
+  static uint64_t hash_key(std::string_view key);
+
+  std::optional<Entry> find(std::string_view key) const;
+  size_t size() const { return entry_count_; }
+
+private:
+  ShaderArchive() = default;
+  bool parse();
+
+  std::unique_ptr<core::MappedFile> file_;
+  const uint8_t *data_ = nullptr;
+  size_t entry_count_ = 0;
+  size_t slot_count_ = 0;
+};
+
+// Collects stages and writes them in the ShaderArchive format
+class ShaderArchiveWriter {
+public:
+  // Replaces any earlier entry with the same key
+  void add(std::string key, std::vector<uint8_t> bytecode,
+           std::vector<uint8_t> reflection);
+  bool write(const std::string &path) const;
+
+  size_t size() const { return entries_.size(); }
+
+private:
+  struct PendingEntry {
+    std::string key;
+    std::vector<uint8_t> bytecode;
+    std::vector<uint8_t> reflection;
+  };
+  std::vector<PendingEntry> entries_;
+};
+
+// SPIR-V for a resource path, from the shared archive when present, else
+// read with platform::load_shader_bytecode(). Throws on failure.
+std::vector<uint8_t> load_spirv_bytecode(const std::string &spirv_path);
+
+} // namespace pixel::renderer3d
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "pixel/renderer3d/shader_reflection.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace pixel::renderer3d {
+
+class ShaderVariantKey;
+
+// Compiles GLSL stages to SPIR-V at runtime for variants the build did not
+// precompile (PIXEL_SHADER_VARIANTS). Requires a build with
+// PIXEL_RUNTIME_SHADER_COMPILER, which links glslang; without it available()
+// is false and nothing is compiled.
+class ShaderCompiler {
+public:
+  static bool available();
+
+  // Process-wide compiler with one background thread, started on first use
+  static ShaderCompiler &shared();
+
+  ShaderCompiler() = default;
+  ~ShaderCompiler();
+  ShaderCompiler(const ShaderCompiler &) = delete;
+  ShaderCompiler &operator=(const ShaderCompiler &) = delete;
+
+  // GLSL source -> SPIR-V words, with the variant's defines added the way
+  // glslangValidator -D does. `name` only labels errors. Throws
+  // std::runtime_error with the compiler log on failure.
+  static std::vector<uint32_t> compile(std::string_view source,
+                                       ShaderStage stage,
+                                       const ShaderVariantKey &variant,
+                                       std::string_view name);
+
+  // Queues the resource-relative GLSL file for compilation on the worker
+  // thread and writes the result to spirv_path under the resource directory,
+  // where later launches load it like a precompiled variant. Requests for a
+  // spirv_path already queued or finished share that job's future, which
+  // reports whether the file was written.
+  std::shared_future<bool> request(const std::string &source_path,
+                                   const std::string &spirv_path,
+                                   ShaderStage stage,
+                                   const ShaderVariantKey &variant);
+
+private:
+  struct Job;
+
+  void worker_loop();
+  static bool run(const Job &job);
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::deque<std::shared_ptr<Job>> queue_;
+  std::unordered_map<std::string, std::shared_future<bool>> jobs_;
+  std::thread worker_;
+  bool stopping_{false};
+};
+
+} // namespace pixel::renderer3d
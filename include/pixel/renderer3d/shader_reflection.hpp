@@ -74,6 +74,20 @@ struct ShaderBlock {
   bool is_storage() const { return type == ShaderBlockType::Storage; }
 };
 
+// `layout(constant_id = N) const bool/int/uint/float NAME = default;`
+// Variant defines with the same name are applied as constant values at
+// pipeline creation instead of selecting a separately compiled module.
+struct ShaderSpecializationConstant {
+  std::string name;
+  ShaderUniformType type{ShaderUniformType::Unknown};
+  uint32_t constant_id{0};
+  uint32_t default_value{0}; // raw 32 bits, as in the SPIR-V
+  uint32_t stage_mask{0};
+
+  void add_stage(ShaderStage stage);
+  bool uses_stage(ShaderStage stage) const;
+};
+
 class ShaderReflection {
 public:
   void merge(const ShaderReflection &other);
@@ -89,13 +103,21 @@ public:
   std::optional<uint32_t> binding_for_block(std::string_view name,
                                             ShaderBlockType type) const;
 
+  const ShaderSpecializationConstant *
+  find_specialization_constant(std::string_view name) const;
+
   std::vector<ShaderBlock> blocks() const { return blocks_order_; }
   std::unordered_map<std::string, ShaderUniform> uniforms() const {
     return uniforms_;
   }
+  const std::vector<ShaderSpecializationConstant> &
+  specialization_constants() const {
+    return specialization_constants_;
+  }
 
   void add_uniform(ShaderUniform uniform);
   void add_block(ShaderBlock block);
+  void add_specialization_constant(ShaderSpecializationConstant constant);
 
 private:
   static uint32_t stage_bit(ShaderStage stage);
@@ -103,9 +125,22 @@ private:
   std::unordered_map<std::string, ShaderUniform> uniforms_;
   std::vector<ShaderBlock> blocks_order_;
   std::unordered_map<std::string, size_t> block_lookup_;
+  std::vector<ShaderSpecializationConstant> specialization_constants_;
 };
 
 ShaderReflection reflect_spirv(std::span<const uint32_t> words,
                                ShaderStage stage);
 
+// OpSpecConstant* declarations carrying a SpecId, read straight from the
+// SPIR-V words (reflect_spirv() includes them). Constants without an OpName
+// are named "constant_<id>".
+std::vector<ShaderSpecializationConstant>
+reflect_specialization_constants(std::span<const uint32_t> words,
+                                 ShaderStage stage);
+
+// Binary form used by the .reflection.bin cache and the shader archive.
+// deserialize_reflection throws std::runtime_error on malformed input.
+std::vector<uint8_t> serialize_reflection(const ShaderReflection &reflection);
+ShaderReflection deserialize_reflection(std::span<const uint8_t> bytes);
+
 } // namespace pixel::renderer3d
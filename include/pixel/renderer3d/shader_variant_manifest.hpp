@@ -0,0 +1,61 @@
+#pragma once
+
+#include "pixel/renderer3d/renderer.hpp"
+#include "pixel/rhi/types.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace pixel::renderer3d {
+
+// Pipelines requested through Shader::pipeline(), one record per distinct
+// (shader, variant, blend mode, colour format). The renderer records them
+// while running (Renderer::set_shader_variant_recording) and warms them up
+// again when a matching shader is loaded; the SPIR-V build precompiles the
+// module defines of every record (src/renderer3d/CMakeLists.txt).
+//
+// A text file with one tab-separated record per line:
+//   variant <vert> <frag> <blend> <format> <module defines> <defines>
+// Defines use the PIXEL_SHADER_VARIANTS syntax (NAME=VALUE,NAME=VALUE) and
+// may be empty. <module defines> is the subset compiled into the SPIR-V
+// module; the rest are specialization constants. Lines starting with '#' are
+// comments.
+class ShaderVariantManifest {
+public:
+  struct Entry {
+    std::string vert_path;
+    std::string frag_path;
+    ShaderVariantKey variant;
+    ShaderVariantKey module_variant;
+    Material::BlendMode blend_mode{Material::BlendMode::Alpha};
+    rhi::Format color_format{rhi::Format::BGRA8};
+  };
+
+  // Relative resource path the renderer warms up from
+  static constexpr const char *kDefaultPath = "assets/shaders/variants.manifest";
+
+  static std::optional<ShaderVariantManifest> load(const std::string &path);
+  bool save(const std::string &path) const;
+
+  // False when an identical record is already present
+  bool add(Entry entry);
+  void merge(const ShaderVariantManifest &other);
+
+  const std::vector<Entry> &entries() const { return entries_; }
+  bool empty() const { return entries_.empty(); }
+  size_t size() const { return entries_.size(); }
+
+  static std::string format_defines(const ShaderVariantKey &variant);
+  static std::optional<ShaderVariantKey> parse_defines(std::string_view text);
+
+private:
+  static std::string make_record(const Entry &entry);
+
+  std::vector<Entry> entries_;
+  std::unordered_set<std::string> records_;
+};
+
+} // namespace pixel::renderer3d
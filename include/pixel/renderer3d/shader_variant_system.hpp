@@ -14,6 +14,8 @@ class ShaderVariantKey;
 
 struct ShaderVariantData {
   static constexpr size_t kPipelineCount = 4;
+  // Render-target format every variant pipeline is built for
+  static constexpr rhi::Format kColorFormat = rhi::Format::BGRA8;
   std::array<rhi::PipelineHandle, kPipelineCount> pipelines{};
   rhi::ShaderHandle vs{0};
   rhi::ShaderHandle fs{0};
@@ -59,6 +61,20 @@ public:
 
   virtual ShaderVariantData build_variant(const ShaderVariantBuildContext &context,
                                           const ShaderVariantKey &variant) const = 0;
+
+  // False while a stage of the variant is still being compiled at runtime
+  // (see ShaderCompiler); build_variant() would block until it finishes
+  virtual bool variant_ready(const ShaderVariantBuildContext &context,
+                             const ShaderVariantKey &variant) const {
+    (void)context;
+    (void)variant;
+    return true;
+  }
+
+  // Defines compiled into the variant's shader modules; the rest of
+  // `variant` only changes pipeline state (specialization constants)
+  virtual ShaderVariantKey module_variant(const ShaderVariantBuildContext &context,
+                                          const ShaderVariantKey &variant) const = 0;
 };
 
 std::unique_ptr<ShaderReflectionSystem> create_spirv_reflection_system();
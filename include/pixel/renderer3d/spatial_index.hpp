@@ -0,0 +1,98 @@
+#pragma once
+
+#include "pixel/renderer3d/types.hpp"
+#include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pixel::renderer3d {
+
+// Frustum planes in (normal, d) form with normals pointing inward, so a point
+// p is inside when dot(normal, p) + d >= 0. Order: left, right, bottom, top,
+// near, far.
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
+FrustumPlanes extract_frustum_planes(const glm::mat4 &view_proj);
+
+// ============================================================================
+// Spatial Index
+// ============================================================================
+
+// Dynamic bounding volume hierarchy over bounding spheres. Leaves store the
+// exact sphere plus an enlarged ("fat") AABB so small moves are absorbed
+// without touching the tree; larger moves re-insert the leaf. Insertion uses
+// a surface-area cost and the tree is kept height-balanced with rotations.
+//
+// Queries append the user_data of every hit to a caller-owned vector and do
+// not allocate. They are const and may run concurrently with each other, but
+// not with insert/move/remove.
+class SpatialIndex {
+public:
+  using ProxyID = uint32_t;
+  static constexpr ProxyID kInvalidProxy = 0xFFFFFFFFu;
+
+  // `fat_margin` is the world-space slack added around each leaf's AABB
+  explicit SpatialIndex(float fat_margin = 0.5f);
+
+  ProxyID insert(const Vec3 &center, float radius, uint32_t user_data);
+  // Returns true when the leaf had to be re-inserted
+  bool move(ProxyID proxy, const Vec3 &center, float radius);
+  void remove(ProxyID proxy);
+  void clear();
+  void reserve(size_t proxies);
+
+  size_t size() const { return proxy_count_; }
+  bool empty() const { return proxy_count_ == 0; }
+  int height() const;
+  uint32_t user_data(ProxyID proxy) const { return nodes_[proxy].user_data; }
+
+  void query_frustum(const FrustumPlanes &planes,
+                     std::vector<uint32_t> &out) const;
+  void query_sphere(const Vec3 &center, float radius,
+                    std::vector<uint32_t> &out) const;
+  void query_aabb(const Vec3 &min, const Vec3 &max,
+                  std::vector<uint32_t> &out) const;
+
+  struct RayHit {
+    uint32_t user_data;
+    float t; // distance along the (normalised) ray to the sphere entry
+  };
+  // Hits are sorted nearest first
+  void query_ray(const Vec3 &origin, const Vec3 &direction, float max_t,
+                 std::vector<RayHit> &out) const;
+
+private:
+  static constexpr uint32_t kNull = 0xFFFFFFFFu;
+  static constexpr size_t kMaxStack = 128;
+
+  struct Node {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+    glm::vec3 center{0.0f}; // leaf sphere
+    float radius = 0.0f;
+    uint32_t parent = kNull; // doubles as the free-list link
+    uint32_t child0 = kNull;
+    uint32_t child1 = kNull;
+    int32_t height = -1; // -1 = free, 0 = leaf
+    uint32_t user_data = 0;
+
+    bool is_leaf() const { return child0 == kNull; }
+  };
+
+  uint32_t allocate_node();
+  void free_node(uint32_t index);
+  void insert_leaf(uint32_t leaf);
+  void remove_leaf(uint32_t leaf);
+  uint32_t balance(uint32_t index);
+  void refit_upwards(uint32_t index);
+
+  std::vector<Node> nodes_;
+  uint32_t root_ = kNull;
+  uint32_t free_list_ = kNull;
+  size_t proxy_count_ = 0;
+  float fat_margin_ = 0.5f;
+};
+
+} // namespace pixel::renderer3d
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "pixel/math/math.hpp"
+#include <cstdint>
 
 namespace pixel::renderer3d {
 
@@ -16,4 +17,14 @@ struct Vertex {
   Color color;
 };
 
+// GPU layout for rhi::VertexLayout::Compressed (20 bytes)
+struct CompressedVertex {
+  int16_t position[4];  // snorm16 relative to the mesh bounds; w unused
+  int16_t normal[2];    // snorm16 octahedral
+  uint16_t texcoord[2]; // half float
+  uint8_t color[4];     // unorm8 RGBA
+};
+static_assert(sizeof(CompressedVertex) == 20,
+              "CompressedVertex must match the compressed vertex layout");
+
 } // namespace pixel::renderer3d
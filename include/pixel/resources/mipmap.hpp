@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace pixel::resources {
+
+/**
+ * @brief Options for CPU mip chain generation
+ */
+struct MipmapOptions {
+  // Treat RGB as sRGB-encoded and average in linear light. Alpha is always
+  // averaged linearly. Turn off for data textures (normal maps, masks,
+  // roughness) whose values are not gamma-encoded.
+  bool srgb = true;
+  // When > 0, rescale each level's alpha so the fraction of texels passing
+  // `alpha > alpha_cutoff` matches level 0 (keeps cutout foliage and sprites
+  // from thinning out at distance). 0 disables.
+  float alpha_cutoff = 0.0f;
+  // Maximum number of levels including level 0; 0 means the full chain
+  uint32_t max_levels = 0;
+  // Weight colour by alpha while filtering and store RGB multiplied by alpha
+  // (after encoding, so it matches blending on RGBA8 textures). Level 0 is
+  // converted too. Draw with premultiplied blending (One, OneMinusSrcAlpha).
+  bool premultiply_alpha = false;
+
+  bool operator==(const MipmapOptions&) const = default;
+};
+
+/**
+ * @brief RGBA8 mip chain stored back to back in one allocation
+ */
+struct MipChain {
+  struct Level {
+    uint32_t width;
+    uint32_t height;
+    size_t offset; // into data, in bytes
+    size_t size;
+  };
+
+  std::vector<uint8_t> data;
+  std::vector<Level> levels;
+
+  std::span<const std::byte> level_data(size_t level) const {
+    return std::as_bytes(std::span<const uint8_t>(data))
+        .subspan(levels[level].offset, levels[level].size);
+  }
+};
+
+/**
+ * @brief Number of levels in a full chain down to 1x1
+ */
+uint32_t mip_level_count(uint32_t width, uint32_t height);
+
+/**
+ * @brief Build a mip chain from tightly packed RGBA8 pixels
+ *
+ * Each level is a 2x2 box filter of the previous one, computed in float with
+ * SSE2/NEON where available. Level sizes follow the GPU rule max(1, n / 2),
+ * so halving an odd dimension drops its last row/column. Level 0 is a copy
+ * of the input unless premultiply_alpha is set. Returns an empty chain for a
+ * null or zero-sized image.
+ */
+MipChain generate_mipmaps(const uint8_t* rgba, uint32_t width, uint32_t height,
+                          const MipmapOptions& options = {});
+
+} // namespace pixel::resources
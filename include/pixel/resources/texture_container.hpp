@@ -0,0 +1,82 @@
+#pragma once
+
+#include "pixel/core/mapped_file.hpp"
+#include "pixel/rhi/types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace pixel::resources {
+
+/**
+ * @brief A memory-mapped KTX2 or DDS texture
+ *
+ * The file is validated on open() and each mip level is exposed as a span
+ * into the mapping, in the GPU's native layout (including BC1-BC7 blocks),
+ * so uploads read straight from the mapped pages with no decode buffer.
+ *
+ * Supported: single 2D images (no arrays, cubemaps or volumes) in any
+ * rhi::Format that is sampleable. KTX2 files must not be supercompressed.
+ */
+class TextureContainer {
+public:
+  enum class Kind { KTX2, DDS };
+
+  /**
+   * @brief Whether a path names a container this class can open (.ktx2/.dds)
+   */
+  static bool is_container_path(const std::string& path);
+
+  /**
+   * @brief Map and validate a container file
+   * @return The container, or nullptr (with a message) on failure
+   */
+  static std::unique_ptr<TextureContainer> open(const std::string& path);
+
+  Kind kind() const { return kind_; }
+  rhi::Format format() const { return format_; }
+  uint32_t width() const { return width_; }
+  uint32_t height() const { return height_; }
+  uint32_t level_count() const { return static_cast<uint32_t>(levels_.size()); }
+  const std::string& path() const { return file_->path(); }
+  /**
+   * @brief Whether colour is stored premultiplied by alpha
+   *
+   * From the KTX2 data format descriptor's alpha-premultiplied flag or the
+   * DDS DX10 header's alpha mode. Such texels need (One, OneMinusSrcAlpha)
+   * blending instead of straight alpha blending.
+   */
+  bool premultiplied_alpha() const { return premultiplied_alpha_; }
+  // The whole mapped file, headers included
+  std::span<const std::byte> file_bytes() const { return file_->bytes(); }
+
+  /**
+   * @brief Tightly packed bytes of one mip level, level 0 being the largest
+   */
+  std::span<const std::byte> level_data(uint32_t level) const {
+    return levels_[level];
+  }
+
+  /**
+   * @brief Sum of all level sizes
+   */
+  size_t payload_bytes() const;
+
+private:
+  TextureContainer() = default;
+  bool parse_ktx2();
+  bool parse_dds();
+
+  std::unique_ptr<core::MappedFile> file_;
+  Kind kind_ = Kind::KTX2;
+  rhi::Format format_ = rhi::Format::Unknown;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  bool premultiplied_alpha_ = false;
+  std::vector<std::span<const std::byte>> levels_;
+};
+
+} // namespace pixel::resources
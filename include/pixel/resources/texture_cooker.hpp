@@ -0,0 +1,191 @@
+#pragma once
+
+#include "pixel/resources/mipmap.hpp"
+#include "pixel/rhi/types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pixel::resources {
+
+// ============================================================================
+// Cooking
+// ============================================================================
+
+/**
+ * @brief How an RGBA8 image is turned into a GPU-ready texture
+ */
+struct CookOptions {
+  // Filtering, premultiplied alpha and level limits for the mip chain
+  MipmapOptions mipmaps;
+  // Store the full chain; otherwise only level 0
+  bool generate_mips = true;
+  // Encode BC1 for opaque images and BC3 for images with alpha. Devices
+  // without Caps::textureCompressionBC fall back to the source image.
+  bool block_compress = false;
+};
+
+/**
+ * @brief Encoded levels ready to be written to a container
+ */
+struct CookedTexture {
+  rhi::Format format = rhi::Format::Unknown;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  bool premultiplied_alpha = false;
+  // Level 0 first, each tightly packed in `format`
+  std::vector<std::vector<uint8_t>> levels;
+};
+
+/**
+ * @brief Build the mip chain for an image and encode it per `options`
+ *
+ * @return The cooked texture; format is Unknown for a null or empty image
+ */
+CookedTexture cook_texture(const uint8_t* rgba, uint32_t width, uint32_t height,
+                           const CookOptions& options = CookOptions{});
+
+/**
+ * @brief Encode one RGBA8 level into BC1/BC3/BC4/BC5 blocks
+ *
+ * Partial blocks at the right and bottom edges repeat the last texel. BC4
+ * reads the red channel and BC5 red and green.
+ *
+ * @return Blocks in row-major order, or empty for an unsupported format
+ */
+std::vector<uint8_t> compress_bc(const uint8_t* rgba, uint32_t width,
+                                 uint32_t height, rhi::Format format);
+
+/**
+ * @brief Write a cooked texture as a KTX2 file TextureContainer can open
+ *
+ * Emits a basic data format descriptor (sRGB transfer and premultiplied
+ * alpha flagged), a KTXwriter entry, and no supercompression. Supports R8,
+ * RGBA8/RGBA8Srgb and the BC formats.
+ */
+bool write_ktx2(const std::string& path, const CookedTexture& texture);
+
+/**
+ * @brief Where the cooker puts the blob for a source image: the full source
+ * path plus .ktx2 (rock.png -> rock.png.ktx2), so rock.png and rock.jpg get
+ * distinct blobs
+ */
+std::string cooked_texture_path(const std::string& source_path);
+
+/**
+ * @brief Whether a cooked blob exists and is at least as new as its source
+ *
+ * A blob without a source counts as current, so shipped builds may omit
+ * the original images.
+ */
+bool cooked_texture_is_current(const std::string& source_path,
+                               const std::string& cooked_path);
+
+// ============================================================================
+// Atlas packing
+// ============================================================================
+
+struct AtlasImage {
+  std::string name;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  const uint8_t* rgba = nullptr;
+};
+
+struct AtlasRect {
+  std::string name;
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+struct Atlas {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint8_t> rgba;
+  // Texel rectangles of each image, padding excluded, in input order
+  std::vector<AtlasRect> rects;
+};
+
+/**
+ * @brief Shelf-pack images into one RGBA8 atlas
+ *
+ * Each image is surrounded by `padding` texels copied from its own edges,
+ * so filtering never pulls in a neighbour. Mip levels stay clean while the
+ * padding lasts: about log2(padding) + 1 levels. The atlas width is a power
+ * of two; the height is as small as the shelves allow.
+ *
+ * @return The atlas, or nullopt if the images do not fit in max_extent
+ */
+std::optional<Atlas> pack_atlas(std::span<const AtlasImage> images,
+                                uint32_t padding = 4,
+                                uint32_t max_extent = 4096);
+
+// ============================================================================
+// Manifest
+// ============================================================================
+
+/**
+ * @brief Index of cooked textures and atlas sprites, written by the cooker
+ *
+ * A text file with one tab-separated record per line:
+ *   options <cooker settings the textures were built with>
+ *   texture <source> <cooked> <format> <width> <height> <levels> <alpha>
+ *   sprite  <name> <cooked atlas> <x> <y> <width> <height>
+ * Paths are relative to the manifest's directory; <alpha> is "straight" or
+ * "premultiplied". Lines starting with '#' are comments.
+ */
+class TextureManifest {
+public:
+  struct Texture {
+    std::string source;
+    std::string cooked;
+    rhi::Format format = rhi::Format::Unknown;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t levels = 0;
+    bool premultiplied_alpha = false;
+  };
+
+  struct Sprite {
+    std::string name;
+    std::string atlas;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+  };
+
+  /**
+   * @brief Parse a manifest
+   * @return The manifest, or nullopt (with a message) if unreadable
+   */
+  static std::optional<TextureManifest> load(const std::string& path);
+
+  bool save(const std::string& path) const;
+
+  // Free-form; the cooker re-cooks everything when it changes
+  const std::string& options() const { return options_; }
+  void set_options(std::string options) { options_ = std::move(options); }
+
+  void add_texture(Texture texture) { textures_.push_back(std::move(texture)); }
+  void add_sprite(Sprite sprite) { sprites_.push_back(std::move(sprite)); }
+
+  const Texture* find_texture(const std::string& source) const;
+  const Sprite* find_sprite(const std::string& name) const;
+
+  const std::vector<Texture>& textures() const { return textures_; }
+  const std::vector<Sprite>& sprites() const { return sprites_; }
+
+private:
+  std::string options_;
+  std::vector<Texture> textures_;
+  std::vector<Sprite> sprites_;
+};
+
+} // namespace pixel::resources
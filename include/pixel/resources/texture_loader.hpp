@@ -1,9 +1,18 @@
 #pragma once
 
+#include "pixel/resources/mipmap.hpp"
+#include "pixel/resources/texture_container.hpp"
 #include "pixel/rhi/handles.hpp"
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace pixel::rhi {
@@ -12,34 +21,239 @@ class Device;
 
 namespace pixel::resources {
 
+/**
+ * @brief Counted reference to a texture owned by a TextureLoader cache
+ *
+ * Copies share one reference. When the last copy of every TextureRef for a
+ * texture is gone, the loader destroys it a few process_releases() calls
+ * later. May be dropped on any thread and may outlive the loader.
+ */
+class TextureRef {
+public:
+  TextureRef() = default;
+
+  rhi::TextureHandle texture() const { return texture_; }
+  explicit operator bool() const { return lease_ != nullptr; }
+  void reset() {
+    lease_.reset();
+    texture_ = {0};
+  }
+
+private:
+  friend class TextureLoader;
+  struct Lease;
+
+  TextureRef(std::shared_ptr<const Lease> lease, rhi::TextureHandle texture)
+      : lease_(std::move(lease)), texture_(texture) {}
+
+  std::shared_ptr<const Lease> lease_;
+  rhi::TextureHandle texture_{0};
+};
+
+/**
+ * @brief Result of TextureLoader::load_async
+ *
+ * texture() returns the loader's placeholder until the decoded image has been
+ * uploaded, then the real texture. Query it when binding rather than storing
+ * the handle. State changes only on the render thread (process_uploads).
+ */
+class AsyncTexture {
+public:
+  enum class State { Pending, Ready, Failed };
+
+  rhi::TextureHandle texture() const {
+    return state_ == State::Ready ? texture_ : placeholder_;
+  }
+  State state() const { return state_; }
+  bool ready() const { return state_ == State::Ready; }
+  bool failed() const { return state_ == State::Failed; }
+  // Canonical path of the image
+  const std::string& path() const { return path_; }
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+private:
+  friend class TextureLoader;
+
+  std::string path_;
+  // Cache key: path_, tagged when the load overrides the mip options
+  std::string key_;
+  MipmapOptions mipmaps_;
+  State state_ = State::Pending;
+  rhi::TextureHandle texture_{0};
+  rhi::TextureHandle placeholder_{0};
+  int width_ = 0;
+  int height_ = 0;
+  // Set when a load_async() call joined; the texture is then never released
+  bool pin_ = false;
+  // Keeps an acquire_async() texture alive while the result is held
+  TextureRef ref_;
+};
+
+using AsyncTextureRef = std::shared_ptr<const AsyncTexture>;
+
 /**
  * @brief TextureLoader handles loading and caching of texture resources
  *
  * Separates resource management from rendering concerns, providing:
  * - Texture loading from files (via STB Image)
+ * - KTX2/DDS containers uploaded straight from a memory mapping
+ * - Cooked KTX2 blobs used in place of their source images
  * - Texture creation from raw data
- * - Automatic caching to avoid duplicate loads
+ * - Caching by canonical path, with optional content-hash deduplication
+ * - Reference-counted handles (TextureRef) with deferred destruction
  * - Support for texture arrays
+ * - Background decoding on a worker pool with budgeted uploads
+ * - CPU mip chain generation for loaded images
  */
 class TextureLoader {
 public:
+  struct Settings {
+    // Decode threads; 0 picks hardware_concurrency() - 1 (at least one)
+    uint32_t worker_count = 0;
+    // RGBA8 bytes uploaded per process_uploads() call. A single image larger
+    // than the budget is still uploaded, alone, so nothing starves.
+    size_t upload_budget_bytes = 8u * 1024u * 1024u;
+    // Build full mip chains for load()/load_async() images (on the worker
+    // thread for async loads) and upload them in one transfer
+    bool generate_mipmaps = true;
+    // For images loaded without their own MipmapOptions. The sRGB default
+    // suits colour textures; load data textures with srgb = false.
+    MipmapOptions mipmaps;
+    // Hash file contents so identical images under different paths share
+    // one texture. Costs one pass over each newly loaded file.
+    bool dedupe_by_content = true;
+    // Released textures are destroyed this many process_releases() calls
+    // later, once no frame in flight can still sample them
+    uint32_t release_delay_frames = 3;
+    // Load an image's cooked .ktx2 sibling (see cooked_texture_path()) when
+    // it is up to date, skipping the decode and mip generation. Blobs whose
+    // alpha mode differs from mipmaps.premultiply_alpha are ignored.
+    bool prefer_cooked = true;
+  };
+
+  struct CacheStats {
+    size_t textures = 0;        // Live cached textures
+    size_t bytes = 0;           // Their uploaded size
+    size_t hits = 0;            // Path lookups answered by the cache
+    size_t misses = 0;          // Path lookups that had to load
+    size_t content_dedupes = 0; // Loads resolved to an identical texture
+    size_t pending_releases = 0;
+    size_t released = 0;        // Textures destroyed so far
+  };
+
+  /**
+   * @brief Cache key for a path: absolute, normalized, symlinks resolved
+   *
+   * "./a.png", "a.png" and "dir/../a.png" map to the same key. Paths that
+   * do not exist are normalized lexically.
+   */
+  static std::string canonical_path(const std::string& path);
+
   /**
    * @brief Construct a TextureLoader with a RHI device
    * @param device The RHI device to use for texture creation
    */
   explicit TextureLoader(rhi::Device* device);
+  TextureLoader(rhi::Device* device, const Settings& settings);
+  ~TextureLoader();
+
+  TextureLoader(const TextureLoader&) = delete;
+  TextureLoader& operator=(const TextureLoader&) = delete;
 
   /**
    * @brief Load a texture from a file path
    *
    * Automatically caches textures - subsequent calls with the same path
-   * will return the cached texture handle.
+   * will return the cached texture handle. .ktx2 and .dds files keep their
+   * stored format and mip chain (including BCn) and skip decoding.
+   *
+   * The texture is pinned: it stays loaded until clear_cache(). Use
+   * acquire() for textures that should be unloaded when unused.
    *
    * @param path File path to the texture image
    * @return Handle to the loaded texture, or invalid handle on failure
    */
   rhi::TextureHandle load(const std::string& path);
 
+  /**
+   * @brief load() with mip options for this image instead of
+   * Settings::mipmaps, e.g. srgb = false for normal maps and masks
+   *
+   * Each distinct set of options is cached as its own texture. Cooked blobs
+   * are only used when the options match Settings::mipmaps, the options
+   * they were cooked with.
+   */
+  rhi::TextureHandle load(const std::string& path,
+                          const MipmapOptions& mipmaps);
+
+  /**
+   * @brief Load (or find) a texture and take a counted reference to it
+   *
+   * @param path File path to the texture image
+   * @return Reference to the texture, or an empty TextureRef on failure
+   */
+  TextureRef acquire(const std::string& path);
+  TextureRef acquire(const std::string& path, const MipmapOptions& mipmaps);
+
+  /**
+   * @brief Queue a texture for decoding on the worker pool
+   *
+   * Returns immediately. Cached paths come back already Ready, and repeated
+   * requests for a path still in flight share one result. The image is
+   * uploaded by a later process_uploads() call on the render thread.
+   *
+   * @param path File path to the texture image
+   * @return Shared load state; texture() is the placeholder until ready
+   */
+  AsyncTextureRef load_async(const std::string& path);
+  AsyncTextureRef load_async(const std::string& path,
+                             const MipmapOptions& mipmaps);
+
+  /**
+   * @brief Like load_async(), but the texture is released once every copy
+   * of the returned result is gone instead of being pinned
+   */
+  AsyncTextureRef acquire_async(const std::string& path);
+  AsyncTextureRef acquire_async(const std::string& path,
+                                const MipmapOptions& mipmaps);
+
+  /**
+   * @brief Upload decoded images, up to the per-call byte budget
+   *
+   * Call once per frame on the render thread, outside a render pass.
+   *
+   * @return Number of textures that became Ready or Failed
+   */
+  size_t process_uploads();
+
+  /**
+   * @brief Number of async loads that are decoding or waiting for upload
+   */
+  size_t pending_async_loads() const;
+
+  /**
+   * @brief Handle TextureRefs dropped since the last call and destroy
+   * textures released at least release_delay_frames calls ago
+   *
+   * Call once per frame on the render thread.
+   *
+   * @return Number of textures destroyed
+   */
+  size_t process_releases();
+
+  const CacheStats& cache_stats() const { return stats_; }
+
+  /**
+   * @brief 1x1 opaque white texture handed out while async loads are pending
+   */
+  rhi::TextureHandle placeholder();
+
+  void set_upload_budget(size_t bytes) {
+    settings_.upload_budget_bytes = bytes;
+  }
+  size_t upload_budget() const { return settings_.upload_budget_bytes; }
+
   /**
    * @brief Create a texture from raw pixel data
    *
@@ -50,6 +264,23 @@ public:
    */
   rhi::TextureHandle create(int width, int height, const uint8_t* data);
 
+  /**
+   * @brief Create a mipmapped texture and upload every level of a chain
+   *
+   * @param chain RGBA8 levels from generate_mipmaps()
+   * @return Handle to the created texture, or invalid handle on failure
+   */
+  rhi::TextureHandle create(const MipChain& chain);
+
+  /**
+   * @brief Create a texture from a KTX2/DDS container, uploading every level
+   * directly from the mapped file
+   *
+   * @return Handle to the created texture, or invalid handle if the device
+   *         cannot sample the container's format
+   */
+  rhi::TextureHandle create(const TextureContainer& container);
+
   /**
    * @brief Create an empty texture array
    *
@@ -84,9 +315,11 @@ public:
                        int width, int height, const uint8_t* data);
 
   /**
-   * @brief Clear the texture cache
+   * @brief Drop the pins taken by load() and load_async()
    *
-   * Note: This does not destroy the textures, only clears the path->handle mapping
+   * Textures no TextureRef holds are then destroyed by process_releases()
+   * after the usual delay, so handles returned by load() must not be used
+   * past that point. Referenced textures stay cached.
    */
   void clear_cache();
 
@@ -97,8 +330,90 @@ public:
   rhi::Device* device() const { return device_; }
 
 private:
+  friend struct TextureRef::Lease;
+
+  struct CacheEntry {
+    rhi::TextureHandle texture{0};
+    std::vector<std::string> paths; // Every cache key mapped to it
+    uint64_t content_hash = 0;      // 0 when not hashed
+    std::string content_path;       // File content_hash was computed over
+    MipmapOptions mipmaps;          // What the chain was built with
+    size_t bytes = 0;
+    uint32_t refs = 0;              // Live TextureRef leases
+    bool pinned = false;            // Held by load()/load_async()
+    uint64_t release_frame = 0;     // When refs last dropped to zero
+  };
+
+  struct PendingRelease {
+    uint32_t texture_id;
+    uint64_t frame;
+  };
+
+  // TextureRef leases report here; shared so leases can outlive the loader
+  struct ReleaseQueue {
+    std::mutex mutex;
+    std::vector<uint32_t> released;
+  };
+
+  struct DecodedImage {
+    std::shared_ptr<AsyncTexture> target;
+    uint64_t content_hash = 0;
+    std::string content_path; // File content_hash was computed over
+    MipmapOptions mipmaps;
+    // Exactly one is set on success
+    MipChain chain;
+    std::unique_ptr<TextureContainer> container;
+
+    bool failed() const { return chain.levels.empty() && !container; }
+    size_t upload_bytes() const {
+      return container ? container->payload_bytes() : chain.data.size();
+    }
+  };
+
+  MipChain build_chain(const uint8_t* rgba, int width, int height,
+                       const MipmapOptions& mipmaps) const;
+  void decode(const std::string& path, const MipmapOptions& mipmaps,
+              DecodedImage& image) const;
+  void worker_loop();
+  AsyncTextureRef request_async(const std::string& path,
+                                const MipmapOptions& mipmaps, bool pin);
+  std::string cache_key(const std::string& canonical,
+                        const MipmapOptions& mipmaps) const;
+
+  CacheEntry* find_cached(const std::string& key);
+  CacheEntry* find_duplicate(const DecodedImage& image);
+  CacheEntry& insert_cached(const std::string& key, rhi::TextureHandle texture,
+                            const DecodedImage& image);
+  CacheEntry* load_entry(const std::string& path,
+                         const MipmapOptions& mipmaps);
+  TextureRef make_ref(CacheEntry& entry);
+  void schedule_release(CacheEntry& entry);
+
   rhi::Device* device_;
-  std::unordered_map<std::string, rhi::TextureHandle> cache_;
+  Settings settings_;
+  CacheStats stats_;
+  rhi::TextureHandle placeholder_{0};
+
+  // Cache, keyed by texture id, plus path and content indices into it
+  std::unordered_map<uint32_t, CacheEntry> entries_;
+  std::unordered_map<std::string, uint32_t> by_path_;
+  std::unordered_map<uint64_t, uint32_t> by_content_;
+
+  std::shared_ptr<ReleaseQueue> release_queue_ =
+      std::make_shared<ReleaseQueue>();
+  std::deque<PendingRelease> pending_releases_;
+  uint64_t frame_ = 1;
+
+  // Async loads by canonical path while pending (render thread only)
+  std::unordered_map<std::string, std::shared_ptr<AsyncTexture>> in_flight_;
+
+  // Worker pool; decode_queue_ and decoded_ are guarded by mutex_
+  std::vector<std::thread> workers_;
+  mutable std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::deque<std::shared_ptr<AsyncTexture>> decode_queue_;
+  std::deque<DecodedImage> decoded_;
+  bool stopping_ = false;
 };
 
 } // namespace pixel::resources
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "pixel/resources/mipmap.hpp"
+#include "pixel/resources/texture_container.hpp"
+#include "pixel/rhi/handles.hpp"
+#include "pixel/rhi/types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pixel::rhi {
+class Device;
+}
+
+namespace pixel::resources {
+
+/**
+ * @brief Finest mip level worth sampling for a texture drawn at a given size
+ *
+ * @param texture_extent Largest dimension of level 0, in texels
+ * @param screen_extent Pixels the texture spans on screen (one UV repeat)
+ * @return Level giving roughly one texel per pixel; 0 when magnified
+ */
+uint32_t mip_for_screen_extent(uint32_t texture_extent, float screen_extent);
+
+/**
+ * @brief Keeps textures within a fixed memory budget by streaming mip levels
+ *
+ * Each streamed texture has a resident mip range [resident_mip, last level].
+ * Draw submission reports how large a texture appears (resolve() with a
+ * screen extent, or request() with a level) and update() raises residency
+ * toward the finest requested level. When the budget would be exceeded, the
+ * least recently used textures lose their finest levels first; a small mip
+ * tail always stays resident so every texture can be drawn.
+ *
+ * The RHI cannot change a texture's level count in place, so a residency
+ * change creates a texture for the new range, uploads it from the source,
+ * and destroys the old one a few update()s later. Callers keep the stable
+ * handle returned by add() (e.g. in a Material) and bind resolve(handle).
+ *
+ * Sources stay available for re-uploads: KTX2/DDS containers remain memory
+ * mapped (the OS pages levels in on demand); other images are decoded once
+ * and their RGBA8 mip chain is kept in system memory.
+ */
+class TextureStreamer {
+public:
+  struct Settings {
+    // Texture memory the streamer may keep resident
+    size_t budget_bytes = 256u * 1024u * 1024u;
+    // Bytes uploaded per update(). A single texture larger than this is
+    // still uploaded, alone, so nothing starves.
+    size_t upload_budget_bytes = 8u * 1024u * 1024u;
+    // Levels whose largest dimension is at most this many texels are never
+    // evicted
+    uint32_t tail_extent = 64;
+    // Replaced textures are destroyed this many update() calls later, once
+    // no frame in flight can still sample them. They do not count against
+    // budget_bytes meanwhile.
+    uint32_t retire_frames = 3;
+    // Used when decoding plain images added without their own options
+    MipmapOptions mipmaps;
+    // Stream an image's up-to-date cooked .ktx2 sibling instead of decoding,
+    // when its alpha mode matches mipmaps.premultiply_alpha
+    bool prefer_cooked = true;
+  };
+
+  struct Stats {
+    size_t textures = 0;
+    size_t resident_bytes = 0;
+    // From the most recent update()
+    size_t uploaded_bytes = 0;
+    size_t levels_streamed_in = 0;
+    size_t levels_evicted = 0;
+    // Replaced textures waiting for destruction
+    size_t retiring = 0;
+  };
+
+  explicit TextureStreamer(rhi::Device* device);
+  TextureStreamer(rhi::Device* device, const Settings& settings);
+  ~TextureStreamer();
+
+  TextureStreamer(const TextureStreamer&) = delete;
+  TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+  /**
+   * @brief Start streaming a texture file
+   *
+   * Only the mip tail is uploaded here; finer levels arrive through update()
+   * once the texture is requested.
+   *
+   * @return Stable handle for resolve()/request(), or invalid on failure
+   */
+  rhi::TextureHandle add(const std::string& path);
+
+  /**
+   * @brief add() with mip options for this image instead of
+   * Settings::mipmaps, e.g. srgb = false for normal maps and masks
+   *
+   * Cooked blobs are only streamed when the options match Settings::mipmaps.
+   */
+  rhi::TextureHandle add(const std::string& path,
+                         const MipmapOptions& mipmaps);
+
+  /**
+   * @brief Stream an RGBA8 mip chain (see generate_mipmaps()), kept in
+   * system memory
+   */
+  rhi::TextureHandle add(MipChain chain);
+
+  /**
+   * @brief Stream levels straight from a mapped KTX2/DDS container
+   */
+  rhi::TextureHandle add(std::unique_ptr<TextureContainer> container);
+
+  /**
+   * @brief Stop streaming a texture and release its memory
+   */
+  void remove(rhi::TextureHandle handle);
+
+  bool is_streamed(rhi::TextureHandle handle) const;
+
+  /**
+   * @brief Texture to bind for a stable handle, without recording usage
+   *
+   * Handles the streamer does not own are returned unchanged.
+   */
+  rhi::TextureHandle resolve(rhi::TextureHandle handle) const;
+
+  /**
+   * @brief Texture to bind, recording that it spans `screen_extent` pixels
+   */
+  rhi::TextureHandle resolve(rhi::TextureHandle handle, float screen_extent);
+
+  /**
+   * @brief Ask for `mip` (and everything coarser) to be resident
+   *
+   * Requests accumulate until the next update(), which keeps the finest.
+   */
+  void request(rhi::TextureHandle handle, uint32_t mip);
+
+  /**
+   * @brief Finest resident level, or 0 for unknown handles
+   */
+  uint32_t resident_mip(rhi::TextureHandle handle) const;
+
+  /**
+   * @brief Apply this frame's requests within the memory and upload budgets
+   *
+   * Call once per frame on the render thread, outside a render pass.
+   *
+   * @return Number of textures whose resident range changed
+   */
+  size_t update();
+
+  void set_budget(size_t bytes) { settings_.budget_bytes = bytes; }
+  size_t budget() const { return settings_.budget_bytes; }
+  const Stats& stats() const { return stats_; }
+
+private:
+  struct Level {
+    uint32_t width;
+    uint32_t height;
+    std::span<const std::byte> data;
+  };
+
+  struct Entry {
+    // Exactly one source is set; levels point into it
+    MipChain chain;
+    std::unique_ptr<TextureContainer> container;
+    rhi::Format format = rhi::Format::RGBA8;
+    std::vector<Level> levels;
+
+    rhi::TextureHandle texture{0};
+    uint32_t resident_mip = 0;
+    uint32_t tail_mip = 0;
+    uint32_t requested_mip = kNoRequest;
+    uint32_t target_mip = 0; // scratch for update()
+    uint64_t last_used = 0;
+  };
+
+  struct Retired {
+    rhi::TextureHandle texture;
+    uint64_t frame;
+  };
+
+  static constexpr uint32_t kNoRequest = ~0u;
+
+  rhi::TextureHandle add_entry(Entry entry);
+  size_t range_bytes(const Entry& entry, uint32_t first_mip) const;
+  rhi::TextureHandle upload(const Entry& entry, uint32_t first_mip);
+  void retire(rhi::TextureHandle texture);
+
+  rhi::Device* device_;
+  Settings settings_;
+  Stats stats_;
+  uint64_t frame_ = 1;
+
+  // Keyed by the stable handle id handed out by add()
+  std::unordered_map<uint32_t, Entry> entries_;
+  std::deque<Retired> retired_;
+};
+
+} // namespace pixel::resources
@@ -50,6 +50,7 @@ public:
 
   BufferHandle createBuffer(const BufferDesc &desc) override;
   TextureHandle createTexture(const TextureDesc &desc) override;
+  void destroyTexture(TextureHandle handle) override;
   SamplerHandle createSampler(const SamplerDesc &desc) override;
   ShaderHandle createShader(std::string_view stage,
                             std::span<const uint8_t> bytes) override;
@@ -91,7 +92,8 @@ public:
   void beginRender(const RenderPassDesc &desc) override;
   void setPipeline(PipelineHandle handle) override;
   void setVertexBuffer(BufferHandle handle, size_t offset = 0) override;
-  void setIndexBuffer(BufferHandle handle, size_t offset = 0) override;
+  void setIndexBuffer(BufferHandle handle, size_t offset = 0,
+                      IndexFormat format = IndexFormat::Uint32) override;
   void setInstanceBuffer(BufferHandle handle, size_t stride,
                          size_t offset = 0) override;
   void setDepthStencilState(const DepthStencilState &state) override;
@@ -126,7 +128,9 @@ public:
   void signalFence(FenceHandle handle) override;
 
   void drawIndexed(uint32_t indexCount, uint32_t firstIndex = 0,
-                   uint32_t instanceCount = 1) override;
+                   uint32_t instanceCount = 1,
+                   int32_t baseVertex = 0) override;
+  void drawIndexedIndirect(BufferHandle args, size_t offset = 0) override;
   void endRender() override;
   void copyToBuffer(BufferHandle handle, size_t dstOff,
                     std::span<const std::byte> src) override;
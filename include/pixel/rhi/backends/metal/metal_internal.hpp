@@ -62,6 +62,8 @@ struct Uniforms {
   int32_t useTextureArray{0};
   int32_t uDitherEnabled{0};
   int32_t shadowsEnabled{0};
+  alignas(16) float positionOffset[4]{};
+  alignas(16) float positionScale[4]{1.0f, 1.0f, 1.0f, 0.0f};
 };
 
 static_assert(alignof(Uniforms) == 16, "Metal uniform block must stay 16-byte aligned");
@@ -94,6 +96,10 @@ static_assert(offsetof(Uniforms, uDitherEnabled) == 488,
               "Unexpected dither flag offset");
 static_assert(offsetof(Uniforms, shadowsEnabled) == 492,
               "Unexpected shadowsEnabled offset");
+static_assert(offsetof(Uniforms, positionOffset) == 496,
+              "Unexpected position offset uniform offset");
+static_assert(offsetof(Uniforms, positionScale) == 512,
+              "Unexpected position scale uniform offset");
 
 struct UniformAllocator {
   struct Allocation {
@@ -210,13 +216,18 @@ struct PipelineCacheKey {
   uint32_t fs_id{0};
   uint32_t cs_id{0};
   bool instanced{false};
+  VertexLayout vertex_layout{VertexLayout::Standard};
   uint32_t color_attachment_count{0};
   std::array<ColorAttachmentDesc, kMaxColorAttachments> color_attachments{};
+  uint32_t specialization_count{0};
+  std::array<SpecializationConstant, kMaxSpecializationConstants>
+      specialization_constants{};
 
   bool operator==(const PipelineCacheKey &other) const {
     if (vs_id != other.vs_id || fs_id != other.fs_id || cs_id != other.cs_id ||
-        instanced != other.instanced ||
-        color_attachment_count != other.color_attachment_count) {
+        instanced != other.instanced || vertex_layout != other.vertex_layout ||
+        color_attachment_count != other.color_attachment_count ||
+        specialization_count != other.specialization_count) {
       return false;
     }
 
@@ -226,6 +237,12 @@ struct PipelineCacheKey {
       }
     }
 
+    for (uint32_t i = 0; i < specialization_count; ++i) {
+      if (!(specialization_constants[i] == other.specialization_constants[i])) {
+        return false;
+      }
+    }
+
     return true;
   }
 };
@@ -240,6 +257,7 @@ struct PipelineCacheKeyHash {
     hash_combine(std::hash<uint32_t>{}(key.fs_id));
     hash_combine(std::hash<uint32_t>{}(key.cs_id));
     hash_combine(std::hash<bool>{}(key.instanced));
+    hash_combine(std::hash<uint32_t>{}(static_cast<uint32_t>(key.vertex_layout)));
     hash_combine(std::hash<uint32_t>{}(key.color_attachment_count));
 
     using FormatUnderlying = std::underlying_type_t<Format>;
@@ -265,6 +283,12 @@ struct PipelineCacheKeyHash {
       hash_combine(std::hash<BlendOpUnderlying>{}(
           static_cast<BlendOpUnderlying>(blend.alphaOp)));
     }
+
+    hash_combine(std::hash<uint32_t>{}(key.specialization_count));
+    for (uint32_t i = 0; i < key.specialization_count; ++i) {
+      hash_combine(std::hash<uint32_t>{}(key.specialization_constants[i].id));
+      hash_combine(std::hash<uint32_t>{}(key.specialization_constants[i].value));
+    }
     return seed;
   }
 };
@@ -360,8 +384,10 @@ struct MetalDevice::Impl {
     immediate_ = std::make_unique<MetalCmdList>(this);
   }
 
-  MTLVertexDescriptor *getOrCreateVertexDescriptor(bool instanced) {
-    size_t key = instanced ? 1u : 0u;
+  MTLVertexDescriptor *getOrCreateVertexDescriptor(bool instanced,
+                                                   VertexLayout layout) {
+    size_t key = (instanced ? 1u : 0u) |
+                 (layout == VertexLayout::Compressed ? 2u : 0u);
     auto it = vertex_descriptor_library_.find(key);
     if (it != vertex_descriptor_library_.end()) {
       return it->second;
@@ -370,23 +396,43 @@ struct MetalDevice::Impl {
     MTLVertexDescriptor *vertexDesc = [MTLVertexDescriptor vertexDescriptor];
 
     // Per-vertex attributes (buffer 0, locations 0-3)
-    vertexDesc.attributes[0].format = MTLVertexFormatFloat3; // Position
-    vertexDesc.attributes[0].offset = 0;
-    vertexDesc.attributes[0].bufferIndex = 0;
-
-    vertexDesc.attributes[1].format = MTLVertexFormatFloat3; // Normal
-    vertexDesc.attributes[1].offset = 12;
-    vertexDesc.attributes[1].bufferIndex = 0;
-
-    vertexDesc.attributes[2].format = MTLVertexFormatFloat2; // TexCoord
-    vertexDesc.attributes[2].offset = 24;
-    vertexDesc.attributes[2].bufferIndex = 0;
-
-    vertexDesc.attributes[3].format = MTLVertexFormatFloat4; // Color
-    vertexDesc.attributes[3].offset = 32;
-    vertexDesc.attributes[3].bufferIndex = 0;
+    if (layout == VertexLayout::Compressed) {
+      // Bounds-relative position
+      vertexDesc.attributes[0].format = MTLVertexFormatShort4Normalized;
+      vertexDesc.attributes[0].offset = 0;
+      vertexDesc.attributes[0].bufferIndex = 0;
+
+      // Octahedral normal
+      vertexDesc.attributes[1].format = MTLVertexFormatShort2Normalized;
+      vertexDesc.attributes[1].offset = 8;
+      vertexDesc.attributes[1].bufferIndex = 0;
+
+      vertexDesc.attributes[2].format = MTLVertexFormatHalf2; // TexCoord
+      vertexDesc.attributes[2].offset = 12;
+      vertexDesc.attributes[2].bufferIndex = 0;
+
+      vertexDesc.attributes[3].format = MTLVertexFormatUChar4Normalized;
+      vertexDesc.attributes[3].offset = 16;
+      vertexDesc.attributes[3].bufferIndex = 0;
+    } else {
+      vertexDesc.attributes[0].format = MTLVertexFormatFloat3; // Position
+      vertexDesc.attributes[0].offset = 0;
+      vertexDesc.attributes[0].bufferIndex = 0;
+
+      vertexDesc.attributes[1].format = MTLVertexFormatFloat3; // Normal
+      vertexDesc.attributes[1].offset = 12;
+      vertexDesc.attributes[1].bufferIndex = 0;
+
+      vertexDesc.attributes[2].format = MTLVertexFormatFloat2; // TexCoord
+      vertexDesc.attributes[2].offset = 24;
+      vertexDesc.attributes[2].bufferIndex = 0;
+
+      vertexDesc.attributes[3].format = MTLVertexFormatFloat4; // Color
+      vertexDesc.attributes[3].offset = 32;
+      vertexDesc.attributes[3].bufferIndex = 0;
+    }
 
-    vertexDesc.layouts[0].stride = 48;
+    vertexDesc.layouts[0].stride = vertex_layout_stride(layout);
     vertexDesc.layouts[0].stepFunction = MTLVertexStepFunctionPerVertex;
 
     if (instanced) {
@@ -537,6 +583,7 @@ struct MetalCmdList::Impl {
   BufferHandle current_ib_{0};
   size_t current_vb_offset_ = 0;
   size_t current_ib_offset_ = 0;
+  IndexFormat current_ib_format_ = IndexFormat::Uint32;
 
   // Ring buffer tracking
   uint32_t *frame_index_; // Pointer to device's frame index
@@ -5,6 +5,7 @@
 #include <span>
 #include <string_view>
 #include <functional>
+#include <memory>
 
 struct GLFWwindow;
 
@@ -18,6 +19,11 @@ struct Caps {
   bool uniformBuffers{true};
   bool clipSpaceYDown{false};            // Requires Y axis flip in clip space
   bool clipSpaceDepthZeroToOne{false};   // Requires Z remapping to [0, 1]
+  bool textureCompressionBC{false};      // BC1-BC7 textures can be sampled
+  bool timerQueries{false};              // QueryType::TimeElapsed results
+  bool layeredRenderTargets{false};      // Render passes honour arraySlice
+  bool computeStorageBuffers{false};     // setStorageBuffer + dispatch
+  bool indirectDraw{false};              // drawIndexedIndirect
 };
 
 struct SwapchainDesc {
@@ -27,8 +33,13 @@ struct SwapchainDesc {
 
 struct PipelineDesc {
   ShaderHandle vs, fs, cs; // cs = compute shader
+  VertexLayout vertexLayout{VertexLayout::Standard};
   uint32_t colorAttachmentCount{0};
   std::array<ColorAttachmentDesc, kMaxColorAttachments> colorAttachments{};
+  // Applied to every stage; ids a stage does not declare are ignored
+  uint32_t specializationConstantCount{0};
+  std::array<SpecializationConstant, kMaxSpecializationConstants>
+      specializationConstants{};
 };
 
 struct FramebufferAttachmentDesc {
@@ -88,7 +99,8 @@ struct CmdList {
   virtual void beginRender(const RenderPassDesc &desc) = 0;
   virtual void setPipeline(PipelineHandle) = 0;
   virtual void setVertexBuffer(BufferHandle, size_t offset = 0) = 0;
-  virtual void setIndexBuffer(BufferHandle, size_t offset = 0) = 0;
+  virtual void setIndexBuffer(BufferHandle, size_t offset = 0,
+                              IndexFormat format = IndexFormat::Uint32) = 0;
   virtual void setInstanceBuffer(BufferHandle, size_t stride,
                                  size_t offset = 0) = 0;
 
@@ -128,8 +140,15 @@ struct CmdList {
   virtual void endQuery(QueryHandle handle, QueryType type) = 0;
   virtual void signalFence(FenceHandle handle) = 0;
 
+  // baseVertex is added to every fetched index, so meshes sub-allocated in
+  // a shared vertex buffer can keep zero-based indices
   virtual void drawIndexed(uint32_t indexCount, uint32_t firstIndex = 0,
-                           uint32_t instanceCount = 1) = 0;
+                           uint32_t instanceCount = 1,
+                           int32_t baseVertex = 0) = 0;
+  // Draws with a DrawIndexedIndirectArgs read from `args` at `offset` when
+  // the GPU executes it, against the bound index buffer; the buffer needs
+  // BufferUsage::Indirect
+  virtual void drawIndexedIndirect(BufferHandle args, size_t offset = 0) = 0;
   virtual void endRender() = 0;
   virtual void copyToBuffer(BufferHandle, size_t dstOff,
                             std::span<const std::byte> src) = 0;
@@ -144,6 +163,10 @@ struct Device {
 
   virtual BufferHandle createBuffer(const BufferDesc &) = 0;
   virtual TextureHandle createTexture(const TextureDesc &) = 0;
+  // Frees the texture immediately. The caller must make sure no submitted
+  // frame still samples it (e.g. by deferring a few frames); the id is never
+  // handed out again.
+  virtual void destroyTexture(TextureHandle handle) = 0;
   virtual SamplerHandle createSampler(const SamplerDesc &) = 0;
   virtual ShaderHandle createShader(std::string_view stage,
                                     std::span<const uint8_t> bytes) = 0;
@@ -16,9 +16,74 @@ enum class Format {
   RG16F,
   RGBA16F,
   D24S8,
-  D32F
+  D32F,
+  RGBA8Srgb,
+  // Block-compressed (4x4 texel blocks); sampling requires
+  // Caps::textureCompressionBC
+  BC1,
+  BC1Srgb,
+  BC3,
+  BC3Srgb,
+  BC4,
+  BC5,
+  BC7,
+  BC7Srgb,
 };
 
+inline bool format_is_block_compressed(Format format) {
+  switch (format) {
+  case Format::BC1:
+  case Format::BC1Srgb:
+  case Format::BC3:
+  case Format::BC3Srgb:
+  case Format::BC4:
+  case Format::BC5:
+  case Format::BC7:
+  case Format::BC7Srgb:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Bytes per texel, or per 4x4 block for block-compressed formats
+inline uint32_t format_block_bytes(Format format) {
+  switch (format) {
+  case Format::R8:
+    return 1;
+  case Format::R16F:
+    return 2;
+  case Format::RGBA16F:
+  case Format::BC1:
+  case Format::BC1Srgb:
+  case Format::BC4:
+    return 8;
+  case Format::BC3:
+  case Format::BC3Srgb:
+  case Format::BC5:
+  case Format::BC7:
+  case Format::BC7Srgb:
+    return 16;
+  default:
+    return 4;
+  }
+}
+
+// Bytes in one row of texels (or of blocks) of a mip level
+inline size_t format_row_pitch(Format format, uint32_t width) {
+  const uint32_t units =
+      format_is_block_compressed(format) ? (width + 3) / 4 : width;
+  return static_cast<size_t>(units) * format_block_bytes(format);
+}
+
+// Tightly packed size of one mip level
+inline size_t format_level_size(Format format, uint32_t width,
+                                uint32_t height) {
+  const uint32_t rows =
+      format_is_block_compressed(format) ? (height + 3) / 4 : height;
+  return format_row_pitch(format, width) * rows;
+}
+
 enum class LoadOp : uint8_t {
   Load,
   Clear,
@@ -84,7 +149,8 @@ enum class BufferUsage : uint32_t {
   Uniform = 4,
   Storage = 8,      // For compute shader read/write
   TransferSrc = 16,
-  TransferDst = 32
+  TransferDst = 32,
+  Indirect = 64     // Argument buffer for drawIndexedIndirect
 };
 inline BufferUsage operator|(BufferUsage a, BufferUsage b) {
   return BufferUsage(uint32_t(a) | uint32_t(b));
@@ -98,6 +164,34 @@ struct BufferDesc {
   BufferUsage usage;
   bool hostVisible{false};
 };
+
+enum class IndexFormat : uint8_t { Uint32, Uint16 };
+
+inline size_t index_format_size(IndexFormat format) {
+  return format == IndexFormat::Uint16 ? 2u : 4u;
+}
+
+// One drawIndexedIndirect record; same layout as Metal's
+// MTLDrawIndexedPrimitivesIndirectArguments and VkDrawIndexedIndirectCommand
+struct DrawIndexedIndirectArgs {
+  uint32_t indexCount{0};
+  uint32_t instanceCount{1};
+  uint32_t firstIndex{0};
+  int32_t baseVertex{0};
+  uint32_t firstInstance{0};
+};
+static_assert(sizeof(DrawIndexedIndirectArgs) == 20,
+              "DrawIndexedIndirectArgs must match the GPU layout");
+
+// Vertex buffer layouts understood by the graphics pipelines.
+//   Standard:   float3 position, float3 normal, float2 uv, float4 color (48 B)
+//   Compressed: snorm16x4 position (bounds-relative), snorm16x2 octahedral
+//               normal, half2 uv, unorm8x4 color (20 B)
+enum class VertexLayout : uint8_t { Standard, Compressed };
+
+inline uint32_t vertex_layout_stride(VertexLayout layout) {
+  return layout == VertexLayout::Compressed ? 20u : 48u;
+}
 struct TextureDesc {
   Extent2D size;
   Format format;
@@ -171,6 +265,21 @@ struct DepthBiasState {
 
 constexpr size_t kMaxColorAttachments = 4;
 
+enum class SpecializationConstantType : uint8_t { Bool, Int, UInt, Float };
+
+// Vulkan specialization constant / Metal function constant, identified by
+// constant_id / [[function_constant(id)]]. `value` holds the raw 32 bits
+// (0 or 1 for Bool, the IEEE bits for Float).
+struct SpecializationConstant {
+  uint32_t id{0};
+  SpecializationConstantType type{SpecializationConstantType::Bool};
+  uint32_t value{0};
+
+  bool operator==(const SpecializationConstant &) const = default;
+};
+
+constexpr size_t kMaxSpecializationConstants = 16;
+
 inline BlendState make_disabled_blend_state() {
   BlendState state;
   state.enabled = false;
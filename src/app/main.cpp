@@ -85,7 +85,10 @@ std::unique_ptr<Mesh> create_sphere_mesh(Renderer &renderer, int segments = 48,
     }
   }
 
-  return Mesh::create(renderer.device(), vertices, indices);
+  pixel::renderer3d::MeshOptions options;
+  options.optimize = true;
+  options.pool = renderer.geometry_pool();
+  return Mesh::create(renderer.device(), vertices, indices, options);
 }
 
 void configure_camera(Camera &camera) {
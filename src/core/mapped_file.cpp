@@ -0,0 +1,108 @@
+#include "pixel/core/mapped_file.hpp"
+#include <iostream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pixel::core {
+
+#if defined(_WIN32)
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string &path) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    std::cerr << "MappedFile: failed to open " << path << std::endl;
+    return nullptr;
+  }
+
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    std::cerr << "MappedFile: empty or unreadable file " << path << std::endl;
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  const void *view =
+      mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!view) {
+    std::cerr << "MappedFile: failed to map " << path << std::endl;
+    if (mapping)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  auto mapped = std::unique_ptr<MappedFile>(new MappedFile());
+  mapped->data_ = static_cast<const std::byte *>(view);
+  mapped->size_ = static_cast<size_t>(size.QuadPart);
+  mapped->path_ = path;
+  mapped->file_ = file;
+  mapped->mapping_ = mapping;
+  return mapped;
+}
+
+MappedFile::~MappedFile() {
+  if (data_)
+    UnmapViewOfFile(data_);
+  if (mapping_)
+    CloseHandle(static_cast<HANDLE>(mapping_));
+  if (file_)
+    CloseHandle(static_cast<HANDLE>(file_));
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "MappedFile: failed to open " << path << std::endl;
+    return nullptr;
+  }
+
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    std::cerr << "MappedFile: empty or unreadable file " << path << std::endl;
+    ::close(fd);
+    return nullptr;
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+  void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    std::cerr << "MappedFile: failed to map " << path << std::endl;
+    return nullptr;
+  }
+  // Loaders mostly stream the payload front to back into upload buffers
+  madvise(view, size, MADV_SEQUENTIAL);
+
+  auto mapped = std::unique_ptr<MappedFile>(new MappedFile());
+  mapped->data_ = static_cast<const std::byte *>(view);
+  mapped->size_ = size;
+  mapped->path_ = path;
+  return mapped;
+}
+
+MappedFile::~MappedFile() {
+  if (data_)
+    munmap(const_cast<std::byte *>(data_), size_);
+}
+
+#endif
+
+} // namespace pixel::core
@@ -0,0 +1,413 @@
+#include "pixel/core/spatial_hash.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace pixel::core {
+
+namespace {
+constexpr uint32_t kMinBuckets = 1024;
+
+int32_t to_cell(float v) {
+  constexpr float kLimit = 1.0e9f;
+  return static_cast<int32_t>(std::floor(std::clamp(v, -kLimit, kLimit)));
+}
+
+bool nearer(const SpatialHash2D::Neighbor &a, const SpatialHash2D::Neighbor &b) {
+  return a.distance_sq < b.distance_sq;
+}
+} // namespace
+
+SpatialHash2D::SpatialHash2D(float cell_size)
+    : cell_size_(cell_size > 0.0f ? cell_size : 16.0f),
+      inv_cell_size_(1.0f / cell_size_) {
+  clear();
+}
+
+SpatialHash2D::Cell SpatialHash2D::cell_of(float x, float y) const {
+  return {to_cell(x * inv_cell_size_), to_cell(y * inv_cell_size_)};
+}
+
+uint32_t SpatialHash2D::bucket_of(Cell cell) const {
+  const uint32_t h = (static_cast<uint32_t>(cell.x) * 73856093u) ^
+                     (static_cast<uint32_t>(cell.y) * 19349663u);
+  return h & bucket_mask_;
+}
+
+void SpatialHash2D::clear() {
+  bucket_mask_ = kMinBuckets - 1;
+  bucket_start_.assign(kMinBuckets + 1, 0);
+  slot_entity_.clear();
+  slot_x_.clear();
+  slot_y_.clear();
+  overflow_head_.assign(kMinBuckets, kNone);
+  overflow_entity_.clear();
+  overflow_x_.clear();
+  overflow_y_.clear();
+  overflow_prev_.clear();
+  overflow_next_.clear();
+  entity_slot_.clear();
+  live_count_ = 0;
+  dead_slots_ = 0;
+}
+
+void SpatialHash2D::rebuild(std::span<const Vec2> positions) {
+  scratch_entity_.resize(positions.size());
+  scratch_x_.resize(positions.size());
+  scratch_y_.resize(positions.size());
+  for (size_t i = 0; i < positions.size(); ++i) {
+    scratch_entity_[i] = static_cast<uint32_t>(i);
+    scratch_x_[i] = positions[i].x;
+    scratch_y_[i] = positions[i].y;
+  }
+  entity_slot_.assign(positions.size(), kNone);
+  build_from_scratch();
+}
+
+void SpatialHash2D::compact() {
+  scratch_entity_.clear();
+  scratch_x_.clear();
+  scratch_y_.clear();
+  for (size_t s = 0; s < slot_entity_.size(); ++s) {
+    if (slot_entity_[s] == kNone)
+      continue;
+    scratch_entity_.push_back(slot_entity_[s]);
+    scratch_x_.push_back(slot_x_[s]);
+    scratch_y_.push_back(slot_y_[s]);
+  }
+  scratch_entity_.insert(scratch_entity_.end(), overflow_entity_.begin(),
+                         overflow_entity_.end());
+  scratch_x_.insert(scratch_x_.end(), overflow_x_.begin(), overflow_x_.end());
+  scratch_y_.insert(scratch_y_.end(), overflow_y_.begin(), overflow_y_.end());
+  build_from_scratch();
+}
+
+// Counting sort of the scratch entries into bucket-contiguous slots
+void SpatialHash2D::build_from_scratch() {
+  const size_t count = scratch_entity_.size();
+
+  uint32_t bucket_count = kMinBuckets;
+  while (bucket_count < count * 2 && bucket_count < (1u << 30))
+    bucket_count <<= 1;
+  bucket_mask_ = bucket_count - 1;
+
+  bucket_start_.assign(bucket_count + 1, 0);
+  scratch_bucket_.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t b = bucket_of(cell_of(scratch_x_[i], scratch_y_[i]));
+    scratch_bucket_[i] = b;
+    ++bucket_start_[b + 1];
+  }
+  for (uint32_t b = 0; b < bucket_count; ++b)
+    bucket_start_[b + 1] += bucket_start_[b];
+
+  slot_entity_.resize(count);
+  slot_x_.resize(count);
+  slot_y_.resize(count);
+  // bucket_start_[b] doubles as the write cursor, then is shifted back
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t slot = bucket_start_[scratch_bucket_[i]]++;
+    slot_entity_[slot] = scratch_entity_[i];
+    slot_x_[slot] = scratch_x_[i];
+    slot_y_[slot] = scratch_y_[i];
+    entity_slot_[scratch_entity_[i]] = slot;
+  }
+  for (uint32_t b = bucket_count; b > 0; --b)
+    bucket_start_[b] = bucket_start_[b - 1];
+  bucket_start_[0] = 0;
+
+  overflow_head_.assign(bucket_count, kNone);
+  overflow_entity_.clear();
+  overflow_x_.clear();
+  overflow_y_.clear();
+  overflow_prev_.clear();
+  overflow_next_.clear();
+  live_count_ = count;
+  dead_slots_ = 0;
+}
+
+void SpatialHash2D::maybe_compact() {
+  const size_t limit = std::max<size_t>(256, slot_entity_.size() / 8);
+  if (overflow_entity_.size() + dead_slots_ > limit)
+    compact();
+}
+
+void SpatialHash2D::push_overflow(uint32_t entity, float x, float y) {
+  const uint32_t index = static_cast<uint32_t>(overflow_entity_.size());
+  entity_slot_[entity] = kOverflowBit | index;
+  overflow_entity_.push_back(entity);
+  overflow_x_.push_back(x);
+  overflow_y_.push_back(y);
+  overflow_prev_.push_back(kNone);
+  overflow_next_.push_back(kNone);
+  link_overflow(index);
+}
+
+void SpatialHash2D::link_overflow(uint32_t index) {
+  uint32_t &head =
+      overflow_head_[bucket_of(cell_of(overflow_x_[index], overflow_y_[index]))];
+  overflow_prev_[index] = kNone;
+  overflow_next_[index] = head;
+  if (head != kNone)
+    overflow_prev_[head] = index;
+  head = index;
+}
+
+void SpatialHash2D::unlink_overflow(uint32_t index) {
+  const uint32_t prev = overflow_prev_[index];
+  const uint32_t next = overflow_next_[index];
+  if (prev != kNone)
+    overflow_next_[prev] = next;
+  else
+    overflow_head_[bucket_of(
+        cell_of(overflow_x_[index], overflow_y_[index]))] = next;
+  if (next != kNone)
+    overflow_prev_[next] = prev;
+}
+
+bool SpatialHash2D::contains(uint32_t entity) const {
+  return entity < entity_slot_.size() && entity_slot_[entity] != kNone;
+}
+
+void SpatialHash2D::insert(uint32_t entity, Vec2 position) {
+  if (entity >= entity_slot_.size())
+    entity_slot_.resize(static_cast<size_t>(entity) + 1, kNone);
+  if (entity_slot_[entity] != kNone) {
+    move(entity, position);
+    return;
+  }
+  push_overflow(entity, position.x, position.y);
+  ++live_count_;
+  maybe_compact();
+}
+
+void SpatialHash2D::move(uint32_t entity, Vec2 position) {
+  if (!contains(entity))
+    return;
+
+  const uint32_t slot = entity_slot_[entity];
+  if (slot & kOverflowBit) {
+    const uint32_t index = slot & ~kOverflowBit;
+    const bool rechain =
+        bucket_of(cell_of(overflow_x_[index], overflow_y_[index])) !=
+        bucket_of(cell_of(position.x, position.y));
+    if (rechain)
+      unlink_overflow(index);
+    overflow_x_[index] = position.x;
+    overflow_y_[index] = position.y;
+    if (rechain)
+      link_overflow(index);
+    return;
+  }
+
+  if (cell_of(slot_x_[slot], slot_y_[slot]) ==
+      cell_of(position.x, position.y)) {
+    slot_x_[slot] = position.x;
+    slot_y_[slot] = position.y;
+    return;
+  }
+
+  slot_entity_[slot] = kNone;
+  ++dead_slots_;
+  push_overflow(entity, position.x, position.y);
+  maybe_compact();
+}
+
+void SpatialHash2D::remove(uint32_t entity) {
+  if (!contains(entity))
+    return;
+
+  const uint32_t slot = entity_slot_[entity];
+  entity_slot_[entity] = kNone;
+  --live_count_;
+
+  if (!(slot & kOverflowBit)) {
+    slot_entity_[slot] = kNone;
+    ++dead_slots_;
+    maybe_compact();
+    return;
+  }
+
+  // Swap-remove from the overflow arrays, re-pointing the moved entry's
+  // chain neighbours at its new index
+  const uint32_t index = slot & ~kOverflowBit;
+  const uint32_t last = static_cast<uint32_t>(overflow_entity_.size() - 1);
+  unlink_overflow(index);
+  if (index != last) {
+    unlink_overflow(last);
+    overflow_entity_[index] = overflow_entity_[last];
+    overflow_x_[index] = overflow_x_[last];
+    overflow_y_[index] = overflow_y_[last];
+    link_overflow(index);
+    entity_slot_[overflow_entity_[index]] = kOverflowBit | index;
+  }
+  overflow_entity_.pop_back();
+  overflow_x_.pop_back();
+  overflow_y_.pop_back();
+  overflow_prev_.pop_back();
+  overflow_next_.pop_back();
+}
+
+// Buckets are shared by colliding cells, so entries are re-checked against
+// the requested cell; this also keeps each entity from being visited twice.
+template <typename Fn>
+void SpatialHash2D::for_each_in_cell(Cell cell, Fn &&fn) const {
+  const uint32_t b = bucket_of(cell);
+  for (uint32_t s = bucket_start_[b], end = bucket_start_[b + 1]; s < end;
+       ++s) {
+    const uint32_t entity = slot_entity_[s];
+    if (entity == kNone)
+      continue;
+    const float x = slot_x_[s];
+    const float y = slot_y_[s];
+    if (cell_of(x, y) == cell)
+      fn(entity, x, y);
+  }
+  for (uint32_t i = overflow_head_[b]; i != kNone; i = overflow_next_[i]) {
+    const float x = overflow_x_[i];
+    const float y = overflow_y_[i];
+    if (cell_of(x, y) == cell)
+      fn(overflow_entity_[i], x, y);
+  }
+}
+
+template <typename Fn> void SpatialHash2D::for_each_entry(Fn &&fn) const {
+  for (size_t s = 0; s < slot_entity_.size(); ++s) {
+    if (slot_entity_[s] != kNone)
+      fn(slot_entity_[s], slot_x_[s], slot_y_[s]);
+  }
+  for (size_t i = 0; i < overflow_entity_.size(); ++i)
+    fn(overflow_entity_[i], overflow_x_[i], overflow_y_[i]);
+}
+
+void SpatialHash2D::query_rect(Vec2 min, Vec2 max,
+                               std::vector<uint32_t> &out) const {
+  auto test = [&](uint32_t entity, float x, float y) {
+    if (x >= min.x && x <= max.x && y >= min.y && y <= max.y)
+      out.push_back(entity);
+  };
+
+  const Cell lo = cell_of(min.x, min.y);
+  const Cell hi = cell_of(max.x, max.y);
+  if (hi.x < lo.x || hi.y < lo.y)
+    return;
+
+  // Rects covering more cells than there are buckets scan the slots directly
+  const uint64_t cells = static_cast<uint64_t>(hi.x - lo.x + 1) *
+                         static_cast<uint64_t>(hi.y - lo.y + 1);
+  if (cells > bucket_mask_ + 1ull) {
+    for_each_entry(test);
+    return;
+  }
+  for (int32_t cy = lo.y; cy <= hi.y; ++cy)
+    for (int32_t cx = lo.x; cx <= hi.x; ++cx)
+      for_each_in_cell({cx, cy}, test);
+}
+
+void SpatialHash2D::query_radius(Vec2 center, float radius,
+                                 std::vector<uint32_t> &out) const {
+  if (radius < 0.0f)
+    return;
+  const float radius_sq = radius * radius;
+  auto test = [&](uint32_t entity, float x, float y) {
+    const float dx = x - center.x;
+    const float dy = y - center.y;
+    if (dx * dx + dy * dy <= radius_sq)
+      out.push_back(entity);
+  };
+
+  const Cell lo = cell_of(center.x - radius, center.y - radius);
+  const Cell hi = cell_of(center.x + radius, center.y + radius);
+  const uint64_t cells = static_cast<uint64_t>(hi.x - lo.x + 1) *
+                         static_cast<uint64_t>(hi.y - lo.y + 1);
+  if (cells > bucket_mask_ + 1ull) {
+    for_each_entry(test);
+    return;
+  }
+  for (int32_t cy = lo.y; cy <= hi.y; ++cy)
+    for (int32_t cx = lo.x; cx <= hi.x; ++cx)
+      for_each_in_cell({cx, cy}, test);
+}
+
+// Expanding rings of cells around the centre; `out` past `first` is used as
+// a max-heap of the best k candidates so far. Ring r only holds points at
+// least (r - 1) * cell_size away, which bounds when the search can stop.
+void SpatialHash2D::query_nearest(Vec2 center, size_t k,
+                                  std::vector<Neighbor> &out,
+                                  float max_radius) const {
+  if (k == 0 || live_count_ == 0)
+    return;
+
+  const size_t first = out.size();
+  const float max_radius_sq = max_radius * max_radius;
+  auto heap_begin = [&] {
+    return out.begin() + static_cast<std::ptrdiff_t>(first);
+  };
+  auto consider = [&](uint32_t entity, float x, float y) {
+    const float dx = x - center.x;
+    const float dy = y - center.y;
+    const float d2 = dx * dx + dy * dy;
+    if (d2 > max_radius_sq)
+      return;
+    if (out.size() - first < k) {
+      out.push_back({entity, d2});
+      std::push_heap(heap_begin(), out.end(), nearer);
+    } else if (d2 < out[first].distance_sq) {
+      std::pop_heap(heap_begin(), out.end(), nearer);
+      out.back() = {entity, d2};
+      std::push_heap(heap_begin(), out.end(), nearer);
+    }
+  };
+
+  const Cell origin = cell_of(center.x, center.y);
+  const int32_t max_ring = static_cast<int32_t>(
+      std::min(max_radius * inv_cell_size_ + 1.0f, 1.0e6f));
+  size_t seen = 0;
+
+  for (int32_t ring = 0; ring <= max_ring && seen < live_count_; ++ring) {
+    if (out.size() - first == k && ring > 0) {
+      const float reach = static_cast<float>(ring - 1) * cell_size_;
+      if (reach * reach > out[first].distance_sq)
+        break;
+    }
+
+    // Once a ring square spans more cells than there are buckets, a single
+    // pass over the entries left outside the visited square is cheaper
+    const uint64_t side = 2ull * static_cast<uint64_t>(ring) + 1ull;
+    if (side * side > bucket_mask_ + 1ull) {
+      for_each_entry([&](uint32_t entity, float x, float y) {
+        const Cell c = cell_of(x, y);
+        const int64_t dx = std::abs(static_cast<int64_t>(c.x) - origin.x);
+        const int64_t dy = std::abs(static_cast<int64_t>(c.y) - origin.y);
+        if (std::max(dx, dy) >= ring)
+          consider(entity, x, y);
+      });
+      break;
+    }
+
+    auto visit = [&](int32_t cx, int32_t cy) {
+      for_each_in_cell({cx, cy}, [&](uint32_t entity, float x, float y) {
+        ++seen;
+        consider(entity, x, y);
+      });
+    };
+
+    if (ring == 0) {
+      visit(origin.x, origin.y);
+      continue;
+    }
+    const int32_t x0 = origin.x - ring, x1 = origin.x + ring;
+    const int32_t y0 = origin.y - ring, y1 = origin.y + ring;
+    for (int32_t cx = x0; cx <= x1; ++cx) {
+      visit(cx, y0);
+      visit(cx, y1);
+    }
+    for (int32_t cy = y0 + 1; cy < y1; ++cy) {
+      visit(x0, cy);
+      visit(x1, cy);
+    }
+  }
+
+  std::sort_heap(heap_begin(), out.end(), nearer);
+}
+
+} // namespace pixel::core
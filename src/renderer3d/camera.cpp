@@ -1,6 +1,8 @@
 #include "pixel/renderer3d/renderer.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <iostream>
 // ============================================================================
@@ -51,6 +53,37 @@ void Camera::get_projection_matrix(float *out_mat4, int w, int h) const {
   memcpy(out_mat4, glm::value_ptr(proj), 16 * sizeof(float));
 }
 
+void Camera::screen_ray(float screen_x, float screen_y, int width, int height,
+                        Vec3 &out_origin, Vec3 &out_direction) const {
+  const float w = static_cast<float>(std::max(width, 1));
+  const float h = static_cast<float>(std::max(height, 1));
+  const float aspect = w / h;
+  const float ndc_x = 2.0f * screen_x / w - 1.0f;
+  const float ndc_y = 1.0f - 2.0f * screen_y / h;
+
+  // Camera basis matching glm::lookAt
+  const glm::vec3 pos(position.x, position.y, position.z);
+  const glm::vec3 forward = glm::normalize(
+      glm::vec3(target.x, target.y, target.z) - pos);
+  const glm::vec3 right =
+      glm::normalize(glm::cross(forward, glm::vec3(up.x, up.y, up.z)));
+  const glm::vec3 cam_up = glm::cross(right, forward);
+
+  glm::vec3 origin = pos;
+  glm::vec3 direction = forward;
+  if (mode == ProjectionMode::Perspective) {
+    const float tan_half = std::tan(glm::radians(fov) * 0.5f);
+    direction = glm::normalize(forward + right * (ndc_x * tan_half * aspect) +
+                               cam_up * (ndc_y * tan_half));
+  } else {
+    origin = pos + right * (ndc_x * ortho_size * aspect) +
+             cam_up * (ndc_y * ortho_size);
+  }
+
+  out_origin = Vec3(origin.x, origin.y, origin.z);
+  out_direction = Vec3(direction.x, direction.y, direction.z);
+}
+
 void Camera::orbit(float dx, float dy) {
   glm::vec3 dir = glm::normalize(glm::vec3(
       position.x - target.x, position.y - target.y, position.z - target.z));
@@ -0,0 +1,251 @@
+#include "pixel/renderer3d/geometry_pool.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+namespace pixel::renderer3d {
+
+namespace {
+
+constexpr size_t kIndexAlignment = 4;
+
+size_t align_up(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+// ============================================================================
+// Page free list
+// ============================================================================
+
+std::optional<size_t> GeometryPool::Page::acquire(size_t size) {
+  for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+    if (it->second < size)
+      continue;
+    const size_t offset = it->first;
+    const size_t remaining = it->second - size;
+    free_ranges.erase(it);
+    if (remaining > 0)
+      free_ranges.emplace(offset + size, remaining);
+    used += size;
+    return offset;
+  }
+  return std::nullopt;
+}
+
+void GeometryPool::Page::release(size_t offset, size_t size) {
+  used -= size;
+  auto next = free_ranges.lower_bound(offset);
+  if (next != free_ranges.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      size += prev->second;
+      free_ranges.erase(prev);
+    }
+  }
+  if (next != free_ranges.end() && offset + size == next->first) {
+    size += next->second;
+    free_ranges.erase(next);
+  }
+  free_ranges.emplace(offset, size);
+}
+
+// ============================================================================
+// GeometryPool
+// ============================================================================
+
+std::unique_ptr<GeometryPool> GeometryPool::create(rhi::Device *device) {
+  return create(device, Settings{});
+}
+
+std::unique_ptr<GeometryPool> GeometryPool::create(rhi::Device *device,
+                                                   const Settings &settings) {
+  if (!device) {
+    std::cerr << "GeometryPool::create() requires a device" << std::endl;
+    return nullptr;
+  }
+  auto pool = std::unique_ptr<GeometryPool>(new GeometryPool());
+  pool->device_ = device;
+  pool->settings_ = settings;
+  return pool;
+}
+
+GeometryPool::Page *GeometryPool::create_page(rhi::BufferUsage usage,
+                                              size_t capacity,
+                                              size_t element_size,
+                                              std::vector<Page> &pages) {
+  const bool vertex = usage == rhi::BufferUsage::Vertex;
+
+  rhi::BufferDesc desc;
+  desc.size = capacity * element_size;
+  desc.usage = usage;
+  desc.hostVisible = true;
+  rhi::BufferHandle buffer = device_->createBuffer(desc);
+  if (buffer.id == 0) {
+    std::cerr << "GeometryPool: failed to allocate " << desc.size
+              << " byte " << (vertex ? "vertex" : "index") << " page"
+              << std::endl;
+    return nullptr;
+  }
+
+  std::cout << "GeometryPool: new " << (vertex ? "vertex" : "index")
+            << " page handle=" << buffer.id << " size=" << desc.size
+            << std::endl;
+
+  Page page;
+  page.buffer = buffer;
+  page.capacity = capacity;
+  page.free_ranges.emplace(0, capacity);
+  pages.push_back(std::move(page));
+  return &pages.back();
+}
+
+GeometryPool::Page *GeometryPool::find_page(std::vector<Page> &pages,
+                                            rhi::BufferHandle buffer) {
+  for (auto &page : pages) {
+    if (page.buffer.id == buffer.id)
+      return &page;
+  }
+  return nullptr;
+}
+
+std::optional<GeometryPool::Allocation>
+GeometryPool::allocate(rhi::VertexLayout layout, uint32_t vertex_count,
+                       size_t index_bytes) {
+  if (vertex_count == 0 || index_bytes == 0)
+    return std::nullopt;
+
+  const size_t index_size = align_up(index_bytes, kIndexAlignment);
+  std::vector<Page> &vb_pages = vertex_pages(layout);
+
+  Page *vertex_page = nullptr;
+  std::optional<size_t> base_vertex;
+  for (auto &page : vb_pages) {
+    if ((base_vertex = page.acquire(vertex_count))) {
+      vertex_page = &page;
+      break;
+    }
+  }
+  if (!vertex_page) {
+    const size_t stride = rhi::vertex_layout_stride(layout);
+    vertex_page = create_page(
+        rhi::BufferUsage::Vertex,
+        std::max<size_t>(settings_.vertex_page_bytes / stride, vertex_count),
+        stride, vb_pages);
+    if (!vertex_page)
+      return std::nullopt;
+    base_vertex = vertex_page->acquire(vertex_count);
+  }
+
+  Page *index_page = nullptr;
+  std::optional<size_t> index_offset;
+  for (auto &page : index_pages_) {
+    if ((index_offset = page.acquire(index_size))) {
+      index_page = &page;
+      break;
+    }
+  }
+  if (!index_page) {
+    // create_page may reallocate index_pages_, but vertex_page points into a
+    // different vector
+    index_page = create_page(
+        rhi::BufferUsage::Index,
+        align_up(std::max(settings_.index_page_bytes, index_size),
+                 kIndexAlignment),
+        1, index_pages_);
+    if (!index_page) {
+      vertex_page->release(*base_vertex, vertex_count);
+      return std::nullopt;
+    }
+    index_offset = index_page->acquire(index_size);
+  }
+
+  Allocation allocation;
+  allocation.vertex_buffer = vertex_page->buffer;
+  allocation.index_buffer = index_page->buffer;
+  allocation.vertex_layout = layout;
+  allocation.base_vertex = static_cast<uint32_t>(*base_vertex);
+  allocation.vertex_count = vertex_count;
+  allocation.index_offset = *index_offset;
+  allocation.index_bytes = index_size;
+  ++allocation_count_;
+  return allocation;
+}
+
+void GeometryPool::free(const Allocation &allocation) {
+  if (!allocation.valid())
+    return;
+
+  Page *vertex_page =
+      find_page(vertex_pages(allocation.vertex_layout), allocation.vertex_buffer);
+  Page *index_page = find_page(index_pages_, allocation.index_buffer);
+  if (!vertex_page || !index_page) {
+    std::cerr << "GeometryPool::free() called with an allocation from another "
+                 "pool"
+              << std::endl;
+    return;
+  }
+  vertex_page->release(allocation.base_vertex, allocation.vertex_count);
+  index_page->release(allocation.index_offset, allocation.index_bytes);
+  --allocation_count_;
+}
+
+void GeometryPool::retire(const Allocation &allocation) {
+  if (allocation.valid())
+    retired_.push_back(Retired{allocation, frame_});
+}
+
+void GeometryPool::begin_frame() {
+  ++frame_;
+  while (!retired_.empty() &&
+         retired_.front().frame + settings_.retire_frames <= frame_) {
+    free(retired_.front().allocation);
+    retired_.pop_front();
+  }
+}
+
+void GeometryPool::upload(const Allocation &allocation,
+                          std::span<const std::byte> vertex_data,
+                          std::span<const std::byte> index_data) {
+  const size_t stride = rhi::vertex_layout_stride(allocation.vertex_layout);
+  if (vertex_data.size() > size_t(allocation.vertex_count) * stride ||
+      index_data.size() > allocation.index_bytes) {
+    std::cerr << "GeometryPool::upload() data exceeds allocation" << std::endl;
+    return;
+  }
+
+  auto *cmd = device_->getImmediate();
+  cmd->begin();
+  cmd->copyToBuffer(allocation.vertex_buffer,
+                    size_t(allocation.base_vertex) * stride, vertex_data);
+  cmd->copyToBuffer(allocation.index_buffer, allocation.index_offset,
+                    index_data);
+  cmd->end();
+}
+
+GeometryPool::Stats GeometryPool::stats() const {
+  Stats stats;
+  auto add_vertex_pages = [&stats](const std::vector<Page> &pages,
+                                   rhi::VertexLayout layout) {
+    const size_t stride = rhi::vertex_layout_stride(layout);
+    for (const auto &page : pages) {
+      ++stats.vertex_pages;
+      stats.vertex_bytes_reserved += page.capacity * stride;
+      stats.vertex_bytes_used += page.used * stride;
+    }
+  };
+  add_vertex_pages(standard_vertex_pages_, rhi::VertexLayout::Standard);
+  add_vertex_pages(compressed_vertex_pages_, rhi::VertexLayout::Compressed);
+  for (const auto &page : index_pages_) {
+    ++stats.index_pages;
+    stats.index_bytes_reserved += page.capacity;
+    stats.index_bytes_used += page.used;
+  }
+  stats.allocations = allocation_count_;
+  stats.retiring = retired_.size();
+  return stats;
+}
+
+} // namespace pixel::renderer3d
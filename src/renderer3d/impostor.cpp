@@ -0,0 +1,256 @@
+// src/renderer3d/impostor.cpp - Billboard impostor baking
+#include "pixel/renderer3d/impostor.hpp"
+#include "pixel/renderer3d/clip_space.hpp"
+#include "pixel/renderer3d/renderer.hpp"
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace pixel::renderer3d {
+
+namespace {
+
+// Unit billboard in the XY plane; +Y maps to the top row (v = 0) of each view
+std::unique_ptr<Mesh> create_billboard_quad(rhi::Device *device) {
+  std::vector<Vertex> vertices = {
+      {{-1.0f, -1.0f, 0.0f}, {0, 0, 1}, {0, 1}, Color::White()},
+      {{1.0f, -1.0f, 0.0f}, {0, 0, 1}, {1, 1}, Color::White()},
+      {{1.0f, 1.0f, 0.0f}, {0, 0, 1}, {1, 0}, Color::White()},
+      {{-1.0f, 1.0f, 0.0f}, {0, 0, 1}, {0, 0}, Color::White()}};
+  std::vector<uint32_t> indices = {0, 1, 2, 2, 3, 0};
+  return Mesh::create(device, vertices, indices);
+}
+
+} // namespace
+
+std::unique_ptr<ImpostorAtlas>
+ImpostorAtlas::bake(Renderer &renderer, const InstancedMesh &source,
+                    const Vec3 &center, float radius, uint32_t view_count,
+                    uint32_t resolution, size_t max_instances) {
+  rhi::Device *device = renderer.device();
+  if (!device || view_count == 0 || resolution == 0 ||
+      source.index_count() == 0) {
+    std::cerr << "[Impostor] Cannot bake: invalid device, view count,"
+              << " resolution or source mesh" << std::endl;
+    return nullptr;
+  }
+
+  // The passes below would end the frame's main render pass
+  if (renderer.frame_in_progress()) {
+    std::cerr << "[Impostor] Cannot bake: call outside begin_frame() /"
+              << " end_frame()" << std::endl;
+    return nullptr;
+  }
+
+  // Each view renders into its own array layer at the atlas resolution;
+  // backends that bind only layer 0 at swapchain size would smear every view
+  // together, so they get no impostors and far instances are culled instead
+  if (!device->caps().layeredRenderTargets) {
+    std::cerr << "[Impostor] Cannot bake: backend cannot render to texture"
+              << " array layers" << std::endl;
+    return nullptr;
+  }
+
+  Shader *shader = renderer.get_shader(renderer.default_shader());
+  if (!shader) {
+    std::cerr << "[Impostor] Cannot bake: default shader missing" << std::endl;
+    return nullptr;
+  }
+
+  auto atlas = std::unique_ptr<ImpostorAtlas>(new ImpostorAtlas());
+  atlas->view_count_ = view_count;
+  atlas->resolution_ = resolution;
+  atlas->center_ = center;
+  atlas->radius_ = std::max(radius, 0.0001f);
+
+  std::cout << "[Impostor] Baking " << view_count << " views at "
+            << resolution << "x" << resolution << " (radius "
+            << atlas->radius_ << ")" << std::endl;
+
+  // Views are rendered with the regular default-shader pipelines, which are
+  // built against the BGRA8 swapchain format.
+  rhi::TextureDesc color_desc{};
+  color_desc.size = {resolution, resolution};
+  color_desc.format = rhi::Format::BGRA8;
+  color_desc.mipLevels = 1;
+  color_desc.layers = view_count;
+  color_desc.renderTarget = true;
+  atlas->color_texture_ = device->createTexture(color_desc);
+
+  rhi::TextureDesc depth_desc{};
+  depth_desc.size = {resolution, resolution};
+  depth_desc.format = rhi::Format::D32F;
+  depth_desc.mipLevels = 1;
+  depth_desc.layers = 1;
+  depth_desc.renderTarget = true;
+  atlas->depth_texture_ = device->createTexture(depth_desc);
+
+  if (atlas->color_texture_.id == 0 || atlas->depth_texture_.id == 0) {
+    std::cerr << "[Impostor] Failed to create atlas render targets"
+              << std::endl;
+    return nullptr;
+  }
+
+  const char *backend_name = device->backend_name();
+  std::string_view backend_view = backend_name ? std::string_view(backend_name)
+                                              : std::string_view{};
+  const bool force_metal_uniforms =
+      backend_view.find("Metal") != std::string_view::npos;
+
+  Material bake_material{};
+  bake_material.blend_mode = Material::BlendMode::Opaque;
+  bake_material.depth_test = true;
+  bake_material.depth_write = true;
+
+  bake_material.shader_variant = bake_material.shader_variant.with_vertex_layout(
+      source.format().vertex_layout);
+
+  const ShaderReflection &reflection =
+      shader->reflection(bake_material.shader_variant);
+  rhi::PipelineHandle pipeline =
+      shader->pipeline(bake_material.shader_variant, bake_material.blend_mode);
+  if (pipeline.id == 0) {
+    std::cerr << "[Impostor] Cannot bake: default pipeline invalid"
+              << std::endl;
+    return nullptr;
+  }
+
+  const float r = atlas->radius_;
+  const glm::vec3 target(center.x, center.y, center.z);
+  glm::mat4 projection = glm::ortho(-r, r, -r, r, 0.01f * r, 4.0f * r);
+  projection = apply_clip_space_correction(projection, device->caps());
+  const glm::mat4 identity(1.0f);
+
+  auto *cmd = device->getImmediate();
+  for (uint32_t view_index = 0; view_index < view_count; ++view_index) {
+    const float yaw = glm::two_pi<float>() * static_cast<float>(view_index) /
+                      static_cast<float>(view_count);
+    const glm::vec3 eye =
+        target + glm::vec3(std::sin(yaw), 0.0f, std::cos(yaw)) * (2.0f * r);
+    const glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+
+    // The pass attachments select the layer themselves
+    // (Caps::layeredRenderTargets), so no per-view framebuffer is created;
+    // the RHI has no way to destroy one
+    rhi::RenderPassDesc pass{};
+    pass.colorAttachmentCount = 1;
+    pass.colorAttachments[0].texture = atlas->color_texture_;
+    pass.colorAttachments[0].arraySlice = view_index;
+    pass.colorAttachments[0].loadOp = rhi::LoadOp::Clear;
+    pass.colorAttachments[0].storeOp = rhi::StoreOp::Store;
+    pass.hasDepthAttachment = true;
+    pass.depthAttachment.texture = atlas->depth_texture_;
+    pass.depthAttachment.depthLoadOp = rhi::LoadOp::Clear;
+    pass.depthAttachment.depthStoreOp = rhi::StoreOp::DontCare;
+    pass.depthAttachment.clearDepth = 1.0f;
+
+    renderer.begin_offscreen_pass(pass);
+    cmd->setPipeline(pipeline);
+    renderer.apply_material_state(cmd, bake_material);
+
+    // Lit by a headlight so every view carries comparable shading
+    float eye_pos[3] = {eye.x, eye.y, eye.z};
+    float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    float lighting_params[4] = {1.0f, 0.6f, 0.0f, 0.0f};
+    float material_params[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+
+    if (reflection.has_uniform("model") || force_metal_uniforms)
+      cmd->setUniformMat4("model", glm::value_ptr(identity));
+    if (reflection.has_uniform("normalMatrix") || force_metal_uniforms)
+      cmd->setUniformMat4("normalMatrix", glm::value_ptr(identity));
+    if (reflection.has_uniform("view") || force_metal_uniforms)
+      cmd->setUniformMat4("view", glm::value_ptr(view));
+    if (reflection.has_uniform("projection") || force_metal_uniforms)
+      cmd->setUniformMat4("projection", glm::value_ptr(projection));
+    if (reflection.has_uniform("lightPos") || force_metal_uniforms)
+      cmd->setUniformVec3("lightPos", eye_pos);
+    if (reflection.has_uniform("viewPos") || force_metal_uniforms)
+      cmd->setUniformVec3("viewPos", eye_pos);
+    if (reflection.has_uniform("lightColor") || force_metal_uniforms)
+      cmd->setUniformVec3("lightColor", white);
+    if (reflection.has_uniform("lightingParams") || force_metal_uniforms)
+      cmd->setUniformVec4("lightingParams", lighting_params);
+    if (reflection.has_uniform("materialColor") || force_metal_uniforms)
+      cmd->setUniformVec4("materialColor", white);
+    if (reflection.has_uniform("materialParams") || force_metal_uniforms)
+      cmd->setUniformVec4("materialParams", material_params);
+    if (reflection.has_uniform("useTexture") || force_metal_uniforms)
+      cmd->setUniformInt("useTexture", 0);
+    if (reflection.has_uniform("shadowsEnabled") || force_metal_uniforms)
+      cmd->setUniformInt("shadowsEnabled", 0);
+    if (reflection.has_uniform("shadowBias") || force_metal_uniforms)
+      cmd->setUniformFloat("shadowBias", 0.0f);
+
+    set_mesh_format_uniforms(cmd, source.format(), reflection,
+                             force_metal_uniforms);
+    cmd->setVertexBuffer(source.vertex_buffer());
+    cmd->setIndexBuffer(source.index_buffer(), 0, source.format().index_format);
+    cmd->drawIndexed(static_cast<uint32_t>(source.index_count()),
+                     source.format().first_index, 1,
+                     source.format().base_vertex);
+
+    renderer.end_offscreen_pass();
+  }
+
+  rhi::ResourceBarrierDesc to_sampled{};
+  to_sampled.type = rhi::BarrierType::Texture;
+  to_sampled.texture = atlas->color_texture_;
+  to_sampled.srcStage = rhi::PipelineStage::FragmentShader;
+  to_sampled.dstStage = rhi::PipelineStage::FragmentShader;
+  to_sampled.srcState = rhi::ResourceState::RenderTarget;
+  to_sampled.dstState = rhi::ResourceState::ShaderRead;
+  to_sampled.levelCount = 1;
+  to_sampled.layerCount = view_count;
+  std::array<rhi::ResourceBarrierDesc, 1> barriers{to_sampled};
+  cmd->resourceBarrier(barriers);
+
+  atlas->quad_ = create_billboard_quad(device);
+  if (!atlas->quad_) {
+    std::cerr << "[Impostor] Failed to create billboard quad" << std::endl;
+    return nullptr;
+  }
+  atlas->billboards_ =
+      InstancedMesh::create(device, *atlas->quad_, max_instances);
+
+  std::cout << "[Impostor] Bake complete" << std::endl;
+  return atlas;
+}
+
+uint32_t ImpostorAtlas::select_view(const Vec3 &instance_pos,
+                                    float instance_yaw,
+                                    const Vec3 &camera_pos) const {
+  const float dx = camera_pos.x - instance_pos.x;
+  const float dz = camera_pos.z - instance_pos.z;
+  float angle = std::atan2(dx, dz) - instance_yaw;
+
+  const float step = glm::two_pi<float>() / static_cast<float>(view_count_);
+  int index = static_cast<int>(std::lround(angle / step)) %
+              static_cast<int>(view_count_);
+  if (index < 0)
+    index += static_cast<int>(view_count_);
+  return static_cast<uint32_t>(index);
+}
+
+InstanceGPUData ImpostorAtlas::make_instance(const InstanceData &inst,
+                                             const Vec3 &camera_pos) const {
+  const float max_scale = std::max({inst.scale.x, inst.scale.y, inst.scale.z});
+
+  InstanceGPUData gpu = inst.to_gpu_data();
+  gpu.position[0] = inst.position.x + center_.x * inst.scale.x;
+  gpu.position[1] = inst.position.y + center_.y * inst.scale.y;
+  gpu.position[2] = inst.position.z + center_.z * inst.scale.z;
+  gpu.scale[0] = radius_ * max_scale;
+  gpu.scale[1] = radius_ * max_scale;
+  gpu.scale[2] = 1.0f;
+  gpu.texture_index = static_cast<float>(
+      select_view(inst.position, inst.rotation.y, camera_pos));
+  return gpu;
+}
+
+} // namespace pixel::renderer3d
@@ -1,8 +1,9 @@
 // src/renderer3d/lod.cpp - Enhanced with detailed logging
 #include "pixel/renderer3d/lod.hpp"
 #include "pixel/renderer3d/clip_space.hpp"
+#include "pixel/renderer3d/shader_archive.hpp"
 #include "pixel/renderer3d/shader_reflection.hpp"
-#include "pixel/platform/shader_loader.hpp"
+#include "pixel/renderer3d/spatial_index.hpp"
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <array>
@@ -13,7 +14,9 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <string_view>
 #include <span>
+#include <utility>
 #include <vector>
 
 namespace pixel::renderer3d {
@@ -32,7 +35,6 @@ float calculate_sphere_screen_size(const Vec3 &world_pos, float world_radius,
                                    const glm::mat4 &view,
                                    const glm::mat4 &proj,
                                    int viewport_height) {
-  (void)viewport_height;
   // Transform to view space
   glm::vec4 view_pos = view *
                        glm::vec4(world_pos.x, world_pos.y, world_pos.z, 1.0f);
@@ -44,14 +46,110 @@ float calculate_sphere_screen_size(const Vec3 &world_pos, float world_radius,
   // Get FOV from projection matrix
   float fov_y_rad = 2.0f * std::atan(1.0f / std::abs(proj[1][1]));
 
-  // Calculate screen-space size as fraction of screen height
+  // Projected radius as a fraction of the half-height, converted to the
+  // sphere's on-screen diameter in pixels
   float size_fraction = (world_radius / distance) / std::tan(fov_y_rad * 0.5f);
 
-  return size_fraction;
+  return size_fraction * static_cast<float>(viewport_height);
+}
+
+float calculate_projected_error(float world_error, float distance,
+                                float projection_scale) {
+  return world_error * projection_scale / std::max(distance, 0.001f);
 }
 
 } // namespace screen_space
 
+// ============================================================================
+// Adaptive LOD Budget
+// ============================================================================
+
+namespace lod_budget {
+namespace {
+struct BudgetState {
+  LODBudgetConfig config;
+  float bias = 1.0f;
+  double cpu_ms = 0.0;
+  double gpu_ms = 0.0;
+  bool has_sample = false;
+  int under_budget_frames = 0;
+};
+
+BudgetState &state() {
+  static BudgetState s;
+  return s;
+}
+
+double smooth(double current, double sample, float weight, bool first) {
+  return first ? sample : current + (sample - current) * weight;
+}
+
+// Runs once per frame (on CPU submission). The dead band around the target
+// plus the settle counter keep the bias from oscillating frame to frame.
+void step() {
+  auto &s = state();
+  if (!s.config.enabled)
+    return;
+
+  const double frame_ms = std::max(s.cpu_ms, s.gpu_ms);
+  const double target = s.config.target_frame_ms;
+  const double band = target * s.config.hysteresis;
+
+  if (frame_ms > target + band) {
+    s.bias += s.config.raise_step;
+    s.under_budget_frames = 0;
+  } else if (frame_ms < target - band) {
+    if (++s.under_budget_frames >= s.config.settle_frames) {
+      s.bias -= s.config.lower_step;
+    }
+  } else {
+    s.under_budget_frames = 0;
+  }
+  s.bias = std::clamp(s.bias, s.config.min_bias, s.config.max_bias);
+}
+} // namespace
+
+void configure(const LODBudgetConfig &config) {
+  auto &s = state();
+  s.config = config;
+  s.bias = std::clamp(s.bias, config.min_bias, config.max_bias);
+}
+
+const LODBudgetConfig &config() { return state().config; }
+
+void submit_cpu_frame_time(double ms) {
+  auto &s = state();
+  s.cpu_ms = smooth(s.cpu_ms, ms, s.config.smoothing, !s.has_sample);
+  s.has_sample = true;
+  step();
+}
+
+void submit_gpu_frame_time(double ms) {
+  auto &s = state();
+  s.gpu_ms = smooth(s.gpu_ms, ms, s.config.smoothing, s.gpu_ms == 0.0);
+}
+
+float bias() {
+  const auto &s = state();
+  return s.config.enabled ? s.bias : 1.0f;
+}
+
+void set_bias(float bias) {
+  auto &s = state();
+  s.bias = std::clamp(bias, s.config.min_bias, s.config.max_bias);
+  s.under_budget_frames = 0;
+}
+
+void reset() {
+  auto &s = state();
+  s.bias = s.config.min_bias;
+  s.cpu_ms = 0.0;
+  s.gpu_ms = 0.0;
+  s.has_sample = false;
+  s.under_budget_frames = 0;
+}
+} // namespace lod_budget
+
 // ============================================================================
 // LODMesh Implementation
 // ============================================================================
@@ -73,6 +171,17 @@ LODMesh::create(rhi::Device *device, const Mesh &high_detail,
   lod_mesh->lod_meshes_[2] =
       InstancedMesh::create(device, low_detail, max_instances_per_lod);
 
+  for (size_t lod = 0; lod < 3; ++lod) {
+    lod_mesh->lod_draw_lists_[lod].reserve(max_instances_per_lod);
+    lod_mesh->crossfade_draw_lists_[lod].reserve(max_instances_per_lod);
+  }
+  lod_mesh->impostor_draw_list_.reserve(max_instances_per_lod);
+  lod_mesh->desired_lods_.reserve(max_instances_per_lod);
+
+  // Bounding sphere of the high-detail mesh, used to frame impostor views
+  lod_mesh->bounds_center_ = high_detail.bounds_center();
+  lod_mesh->bounds_radius_ = high_detail.bounds_radius();
+
   lod_mesh->use_gpu_lod_ =
       config.gpu.enabled &&
       lod_mesh->initialize_gpu_resources(max_instances_per_lod);
@@ -89,6 +198,10 @@ LODMesh::create(rhi::Device *device, const Mesh &high_detail,
   case LODMode::Hybrid:
     std::cout << "Hybrid";
     break;
+  case LODMode::ScreenSpaceError:
+    std::cout << "Screen-space error (" << config.pixel_error_tolerance
+              << " px)";
+    break;
   }
   std::cout << std::endl;
   std::cout << "  High detail: " << high_detail.vertex_count() << " verts"
@@ -107,93 +220,107 @@ LODMesh::create(rhi::Device *device, const Mesh &high_detail,
   return lod_mesh;
 }
 
+std::unique_ptr<LODMesh>
+LODMesh::create(Renderer &renderer, const Mesh &high_detail,
+                const Mesh &medium_detail, const Mesh &low_detail,
+                size_t max_instances_per_lod, const LODConfig &config) {
+  auto lod_mesh = create(renderer.device(), high_detail, medium_detail,
+                         low_detail, max_instances_per_lod, config);
+  if (lod_mesh && config.impostor.enabled) {
+    lod_mesh->bake_impostor(renderer);
+  }
+  return lod_mesh;
+}
+
 LODMesh::~LODMesh() {}
 
-void LODMesh::set_instances(const std::vector<InstanceData> &instances) {
-  source_instances_ = instances;
-  if (source_instances_.size() > max_instances_per_lod_) {
-    std::cerr << "Warning: LOD instance count " << source_instances_.size()
+void LODMesh::set_instances(std::span<const InstanceData> instances) {
+  const size_t count = std::min(instances.size(), max_instances_per_lod_);
+  if (instances.size() > count) {
+    std::cerr << "Warning: LOD instance count " << instances.size()
               << " exceeds capacity " << max_instances_per_lod_ << ", clamping"
               << std::endl;
-    source_instances_.resize(max_instances_per_lod_);
   }
-  total_instance_count_ = source_instances_.size();
+  source_instances_.assign(instances.begin(), instances.begin() + count);
+  on_source_instances_changed();
+}
 
-  std::cout << "\n========================================\n";
-  std::cout << "LODMesh::set_instances() called\n";
-  std::cout << "========================================\n";
-  std::cout << "Total instances: " << instances.size() << "\n";
-
-  if (instances.size() > 0) {
-    // Calculate position bounds
-    Vec3 min_pos = instances[0].position;
-    Vec3 max_pos = instances[0].position;
-    float min_scale = instances[0].scale.x;
-    float max_scale = instances[0].scale.x;
-
-    for (const auto &inst : instances) {
-      min_pos.x = std::min(min_pos.x, inst.position.x);
-      min_pos.y = std::min(min_pos.y, inst.position.y);
-      min_pos.z = std::min(min_pos.z, inst.position.z);
-      max_pos.x = std::max(max_pos.x, inst.position.x);
-      max_pos.y = std::max(max_pos.y, inst.position.y);
-      max_pos.z = std::max(max_pos.z, inst.position.z);
-      min_scale = std::min(min_scale, inst.scale.x);
-      max_scale = std::max(max_scale, inst.scale.x);
-    }
+void LODMesh::set_instances(std::vector<InstanceData> &&instances) {
+  if (instances.size() > max_instances_per_lod_) {
+    std::cerr << "Warning: LOD instance count " << instances.size()
+              << " exceeds capacity " << max_instances_per_lod_ << ", clamping"
+              << std::endl;
+    instances.resize(max_instances_per_lod_);
+  }
+  source_instances_ = std::move(instances);
+  on_source_instances_changed();
+}
 
-    std::cout << std::fixed << std::setprecision(2);
-    std::cout << "Position bounds:\n";
-    std::cout << "  X: [" << min_pos.x << ", " << max_pos.x << "]\n";
-    std::cout << "  Y: [" << min_pos.y << ", " << max_pos.y << "]\n";
-    std::cout << "  Z: [" << min_pos.z << ", " << max_pos.z << "]\n";
-    std::cout << "Scale range: [" << min_scale << ", " << max_scale << "]\n";
+void LODMesh::on_source_instances_changed() {
+  total_instance_count_ = source_instances_.size();
 
-    // Show first few instances
-    std::cout << "\nFirst 5 instances:\n";
-    for (size_t i = 0; i < std::min(size_t(5), instances.size()); ++i) {
-      const auto &inst = instances[i];
-      std::cout << "  [" << i << "] pos=(" << inst.position.x << ", "
-                << inst.position.y << ", " << inst.position.z
-                << "), scale=" << inst.scale.x << "\n";
-    }
-  }
-  std::cout << "========================================\n\n";
+  std::cout << "LODMesh::set_instances(): " << total_instance_count_
+            << " instances" << std::endl;
 
   if (config_.temporal.enabled &&
       instance_lod_states_.size() != source_instances_.size()) {
-    instance_lod_states_.resize(source_instances_.size());
-
-    for (auto &state : instance_lod_states_) {
-      state.current_lod = 0;
-      state.target_lod = 0;
-      state.transition_time = 0.0f;
-      state.stable_frames = 0;
-    }
+    instance_lod_states_.reset(source_instances_.size());
   }
 
   if (use_gpu_lod_ && gpu_.initialized) {
-    std::vector<InstanceGPUData> gpu_data;
-    gpu_data.reserve(source_instances_.size());
+    gpu_lod_assignments_.resize(source_instances_.size());
+
+    gpu_source_staging_.resize(source_instances_.size());
     for (size_t i = 0; i < source_instances_.size(); ++i) {
-      gpu_data.push_back(source_instances_[i].to_gpu_data());
+      gpu_source_staging_[i] = source_instances_[i].to_gpu_data();
     }
 
-    gpu_lod_assignments_.resize(source_instances_.size());
-
-    if (gpu_.source_instances.id != 0 && !gpu_data.empty()) {
+    if (gpu_.source_instances.id != 0 && !gpu_source_staging_.empty()) {
       auto *cmd = device_->getImmediate();
       std::span<const std::byte> bytes(
-          reinterpret_cast<const std::byte *>(gpu_data.data()),
-          gpu_data.size() * sizeof(InstanceGPUData));
+          reinterpret_cast<const std::byte *>(gpu_source_staging_.data()),
+          gpu_source_staging_.size() * sizeof(InstanceGPUData));
       cmd->copyToBuffer(gpu_.source_instances, 0, bytes);
     }
   }
+
+  if (config_.spatial.enabled) {
+    rebuild_spatial_index();
+  }
+}
+
+namespace {
+float instance_bounding_radius(const InstanceData &inst) {
+  return inst.culling_radius *
+         std::max({inst.scale.x, inst.scale.y, inst.scale.z});
+}
+} // namespace
+
+void LODMesh::rebuild_spatial_index() {
+  spatial_index_ = SpatialIndex(config_.spatial.fat_margin);
+  spatial_index_.reserve(source_instances_.size());
+  spatial_proxies_.resize(source_instances_.size());
+  spatial_candidates_.reserve(source_instances_.size());
+
+  for (size_t i = 0; i < source_instances_.size(); ++i) {
+    const InstanceData &inst = source_instances_[i];
+    spatial_proxies_[i] =
+        spatial_index_.insert(inst.position, instance_bounding_radius(inst),
+                              static_cast<uint32_t>(i));
+  }
+
+  std::cout << "LODMesh: spatial index built for " << spatial_index_.size()
+            << " instances (height " << spatial_index_.height() << ")"
+            << std::endl;
 }
 
 void LODMesh::update_instance(size_t index, const InstanceData &data) {
   if (index < source_instances_.size()) {
     source_instances_[index] = data;
+    if (index < spatial_proxies_.size()) {
+      spatial_index_.move(spatial_proxies_[index], data.position,
+                          instance_bounding_radius(data));
+    }
     if (use_gpu_lod_ && gpu_.initialized && gpu_.source_instances.id != 0) {
       InstanceGPUData gpu_data = data.to_gpu_data();
       auto *cmd = device_->getImmediate();
@@ -209,22 +336,38 @@ void LODMesh::update_instance(size_t index, const InstanceData &data) {
 uint32_t LODMesh::compute_lod_direct(const InstanceData &inst, float distance,
                                      float screen_size,
                                      const Renderer &renderer) const {
-  if (config_.mode == LODMode::Distance) {
-    if (distance < config_.distance_high) {
+  (void)renderer;
+  if (config_.mode == LODMode::ScreenSpaceError) {
+    if (screen_size < thresholds_.screenspace_cull) {
+      return 3;
+    }
+    const float max_scale =
+        std::max({inst.scale.x, inst.scale.y, inst.scale.z});
+    for (uint32_t lod = 2; lod > 0; --lod) {
+      const float error_px = screen_space::calculate_projected_error(
+          config_.geometric_error[lod] * max_scale, distance,
+          thresholds_.error_projection_scale);
+      if (error_px <= thresholds_.pixel_error_tolerance) {
+        return lod;
+      }
+    }
+    return 0;
+  } else if (config_.mode == LODMode::Distance) {
+    if (distance < thresholds_.distance_high) {
       return 0;
-    } else if (distance < config_.distance_medium) {
+    } else if (distance < thresholds_.distance_medium) {
       return 1;
-    } else if (distance < config_.distance_cull) {
+    } else if (distance < thresholds_.distance_cull) {
       return 2;
     } else {
       return 3;
     }
   } else if (config_.mode == LODMode::ScreenSpace) {
-    if (screen_size >= config_.screenspace_high) {
+    if (screen_size >= thresholds_.screenspace_high) {
       return 0;
-    } else if (screen_size >= config_.screenspace_medium) {
+    } else if (screen_size >= thresholds_.screenspace_medium) {
       return 1;
-    } else if (screen_size >= config_.screenspace_cull) {
+    } else if (screen_size >= thresholds_.screenspace_cull) {
       return 2;
     } else {
       return 3;
@@ -233,30 +376,30 @@ uint32_t LODMesh::compute_lod_direct(const InstanceData &inst, float distance,
     // Hybrid mode
     float distance_score, screenspace_score;
 
-    if (distance < config_.distance_high) {
+    if (distance < thresholds_.distance_high) {
       distance_score = 0.0f;
-    } else if (distance < config_.distance_medium) {
+    } else if (distance < thresholds_.distance_medium) {
       distance_score =
-          1.0f + (distance - config_.distance_high) /
-                     (config_.distance_medium - config_.distance_high);
-    } else if (distance < config_.distance_cull) {
+          1.0f + (distance - thresholds_.distance_high) /
+                     (thresholds_.distance_medium - thresholds_.distance_high);
+    } else if (distance < thresholds_.distance_cull) {
       distance_score =
-          2.0f + (distance - config_.distance_medium) /
-                     (config_.distance_cull - config_.distance_medium);
+          2.0f + (distance - thresholds_.distance_medium) /
+                     (thresholds_.distance_cull - thresholds_.distance_medium);
     } else {
       distance_score = 3.0f;
     }
 
-    if (screen_size >= config_.screenspace_high) {
+    if (screen_size >= thresholds_.screenspace_high) {
       screenspace_score = 0.0f;
-    } else if (screen_size >= config_.screenspace_medium) {
+    } else if (screen_size >= thresholds_.screenspace_medium) {
       screenspace_score =
-          1.0f + (config_.screenspace_high - screen_size) /
-                     (config_.screenspace_high - config_.screenspace_medium);
-    } else if (screen_size >= config_.screenspace_cull) {
+          1.0f + (thresholds_.screenspace_high - screen_size) /
+                     (thresholds_.screenspace_high - thresholds_.screenspace_medium);
+    } else if (screen_size >= thresholds_.screenspace_cull) {
       screenspace_score =
-          2.0f + (config_.screenspace_medium - screen_size) /
-                     (config_.screenspace_medium - config_.screenspace_cull);
+          2.0f + (thresholds_.screenspace_medium - screen_size) /
+                     (thresholds_.screenspace_medium - thresholds_.screenspace_cull);
     } else {
       screenspace_score = 3.0f;
     }
@@ -277,6 +420,19 @@ uint32_t LODMesh::compute_lod_direct(const InstanceData &inst, float distance,
   }
 }
 
+void LODMesh::refresh_thresholds() {
+  const float bias = lod_budget::bias();
+  thresholds_.distance_high = config_.distance_high / bias;
+  thresholds_.distance_medium = config_.distance_medium / bias;
+  thresholds_.distance_cull = config_.distance_cull / bias;
+  thresholds_.screenspace_high = config_.screenspace_high * bias;
+  thresholds_.screenspace_medium = config_.screenspace_medium * bias;
+  thresholds_.screenspace_cull = config_.screenspace_cull * bias;
+  thresholds_.impostor_distance_max = config_.impostor.distance_max / bias;
+  thresholds_.pixel_error_tolerance = config_.pixel_error_tolerance * bias;
+  last_stats_.lod_bias = bias;
+}
+
 void LODMesh::update_lod_selection(Renderer &renderer, double current_time) {
   float delta_time = 0.0f;
   if (last_update_time_ > 0.0) {
@@ -284,10 +440,14 @@ void LODMesh::update_lod_selection(Renderer &renderer, double current_time) {
   }
   last_update_time_ = current_time;
 
+  refresh_thresholds();
+
   bool do_detailed_log = (g_log_frame_counter < 3);
   g_log_frame_counter++;
 
-  if (use_gpu_lod_ && gpu_.initialized) {
+  // The compute shader has no error-metric path; ScreenSpaceError runs on CPU
+  if (use_gpu_lod_ && gpu_.initialized &&
+      config_.mode != LODMode::ScreenSpaceError) {
     update_lod_selection_gpu(renderer, delta_time, do_detailed_log);
   } else {
     update_lod_selection_cpu(renderer, delta_time, do_detailed_log);
@@ -325,10 +485,33 @@ void LODMesh::update_lod_selection_cpu(Renderer &renderer, float delta_time,
   proj_matrix = apply_clip_space_correction(proj_matrix,
                                             renderer.device()->caps());
   int viewport_height = renderer.window_height();
+  thresholds_.error_projection_scale =
+      std::abs(proj_matrix[1][1]) * static_cast<float>(viewport_height) * 0.5f;
+
+  // With the spatial index only frustum candidates are evaluated. The rest
+  // are marked outside the frustum, which hides them without feeding the
+  // temporal state, so they reappear at their previous LOD without delay.
+  const bool use_spatial = config_.spatial.enabled;
+  desired_lods_.assign(source_instances_.size(),
+                       use_spatial ? kLODOutsideFrustum : 3u);
+
+  if (use_spatial) {
+    if (spatial_proxies_.size() != source_instances_.size()) {
+      rebuild_spatial_index();
+    }
+    spatial_candidates_.clear();
+    spatial_index_.query_frustum(
+        extract_frustum_planes(proj_matrix * view_matrix), spatial_candidates_);
+    if (do_detailed_log) {
+      std::cout << "Spatial index candidates: " << spatial_candidates_.size()
+                << " / " << source_instances_.size() << "\n";
+    }
+  }
+  const size_t visit_count =
+      use_spatial ? spatial_candidates_.size() : source_instances_.size();
 
-  std::vector<uint32_t> desired_lods(source_instances_.size(), 3);
-
-  for (size_t i = 0; i < source_instances_.size(); ++i) {
+  for (size_t k = 0; k < visit_count; ++k) {
+    const size_t i = use_spatial ? spatial_candidates_[k] : k;
     const auto &inst = source_instances_[i];
 
     float dx = inst.position.x - cam_pos.x;
@@ -336,8 +519,7 @@ void LODMesh::update_lod_selection_cpu(Renderer &renderer, float delta_time,
     float dz = inst.position.z - cam_pos.z;
     float dist = std::sqrt(dx * dx + dy * dy + dz * dz);
 
-    float max_scale = std::max({inst.scale.x, inst.scale.y, inst.scale.z});
-    float effective_radius = inst.culling_radius * max_scale;
+    float effective_radius = instance_bounding_radius(inst);
 
     float screen_size = screen_space::calculate_sphere_screen_size(
         inst.position, effective_radius, view_matrix, proj_matrix,
@@ -345,7 +527,7 @@ void LODMesh::update_lod_selection_cpu(Renderer &renderer, float delta_time,
 
     uint32_t desired_lod =
         compute_lod_direct(inst, dist, screen_size, renderer);
-    desired_lods[i] = desired_lod;
+    desired_lods_[i] = desired_lod;
 
     if (do_detailed_log && i < 10) {
       std::cout << "\nInstance " << i << ":\n";
@@ -371,7 +553,7 @@ void LODMesh::update_lod_selection_cpu(Renderer &renderer, float delta_time,
     }
   }
 
-  apply_lod_results(desired_lods, delta_time, do_detailed_log, renderer);
+  apply_lod_results(desired_lods_, delta_time, do_detailed_log, renderer);
 }
 
 namespace {
@@ -384,49 +566,6 @@ struct LODUniformsGPU {
   glm::vec4 screenspaceThresholds{0.0f};
   glm::vec4 frustumPlanes[6]{};
 };
-
-glm::vec4 normalize_plane(const glm::vec4 &plane) {
-  glm::vec3 normal = glm::vec3(plane);
-  float length = glm::length(normal);
-  if (length <= 0.0f)
-    return plane;
-  return plane / length;
-}
-
-void extract_frustum_planes(const glm::mat4 &view_proj,
-                            glm::vec4 (&planes)[6]) {
-  // Column-major layout in GLM
-  // Left
-  planes[0] = normalize_plane(glm::vec4(view_proj[0][3] + view_proj[0][0],
-                                        view_proj[1][3] + view_proj[1][0],
-                                        view_proj[2][3] + view_proj[2][0],
-                                        view_proj[3][3] + view_proj[3][0]));
-  // Right
-  planes[1] = normalize_plane(glm::vec4(view_proj[0][3] - view_proj[0][0],
-                                        view_proj[1][3] - view_proj[1][0],
-                                        view_proj[2][3] - view_proj[2][0],
-                                        view_proj[3][3] - view_proj[3][0]));
-  // Bottom
-  planes[2] = normalize_plane(glm::vec4(view_proj[0][3] + view_proj[0][1],
-                                        view_proj[1][3] + view_proj[1][1],
-                                        view_proj[2][3] + view_proj[2][1],
-                                        view_proj[3][3] + view_proj[3][1]));
-  // Top
-  planes[3] = normalize_plane(glm::vec4(view_proj[0][3] - view_proj[0][1],
-                                        view_proj[1][3] - view_proj[1][1],
-                                        view_proj[2][3] - view_proj[2][1],
-                                        view_proj[3][3] - view_proj[3][1]));
-  // Near
-  planes[4] = normalize_plane(glm::vec4(view_proj[0][3] + view_proj[0][2],
-                                        view_proj[1][3] + view_proj[1][2],
-                                        view_proj[2][3] + view_proj[2][2],
-                                        view_proj[3][3] + view_proj[3][2]));
-  // Far
-  planes[5] = normalize_plane(glm::vec4(view_proj[0][3] - view_proj[0][2],
-                                        view_proj[1][3] - view_proj[1][2],
-                                        view_proj[2][3] - view_proj[2][2],
-                                        view_proj[3][3] - view_proj[3][2]));
-}
 } // namespace
 
 void LODMesh::update_lod_selection_gpu(Renderer &renderer, float delta_time,
@@ -476,12 +615,14 @@ void LODMesh::update_lod_selection_gpu(Renderer &renderer, float delta_time,
                                      renderer.window_height(),
                                      static_cast<int>(config_.mode), 0);
   uniforms.distanceThresholds =
-      glm::vec4(config_.distance_high, config_.distance_medium,
-                config_.distance_cull, 0.0f);
+      glm::vec4(thresholds_.distance_high, thresholds_.distance_medium,
+                thresholds_.distance_cull, 0.0f);
   uniforms.screenspaceThresholds =
-      glm::vec4(config_.screenspace_high, config_.screenspace_medium,
-                config_.screenspace_cull, config_.hybrid_screenspace_weight);
-  extract_frustum_planes(view_proj, uniforms.frustumPlanes);
+      glm::vec4(thresholds_.screenspace_high, thresholds_.screenspace_medium,
+                thresholds_.screenspace_cull,
+                config_.hybrid_screenspace_weight);
+  const FrustumPlanes planes = extract_frustum_planes(view_proj);
+  std::copy(planes.begin(), planes.end(), uniforms.frustumPlanes);
 
   std::span<const std::byte> uniform_bytes(
       reinterpret_cast<const std::byte *>(&uniforms), sizeof(LODUniformsGPU));
@@ -575,23 +716,124 @@ void LODMesh::update_lod_selection_gpu(Renderer &renderer, float delta_time,
   std::cout << "[GPU LOD] Completed GPU-driven LOD update" << std::endl;
 }
 
-void LODMesh::apply_lod_results(const std::vector<uint32_t> &desired_lods,
+void InstanceLODStates::reset(size_t count) {
+  lod_bits.assign(count, 0u);
+  timer_ms.assign(count, 0u);
+  stable_frames.assign(count, 0u);
+  alpha.assign(count, 255u);
+}
+
+// Branchless hysteresis over the packed SoA state. Every field update is a
+// select on integer masks, so the loop has no data-dependent branches and the
+// compiler can vectorise it. Instances the spatial index rejected keep their
+// state untouched, so they resume where they left off when they come back.
+void LODMesh::update_temporal_states(std::span<const uint32_t> desired_lods,
+                                     float delta_time) {
+  const size_t count =
+      std::min(instance_lod_states_.size(), desired_lods.size());
+
+  auto to_ms = [](float seconds) {
+    return static_cast<uint32_t>(
+        std::clamp(seconds, 0.0f, 65.0f) * 1000.0f + 0.5f);
+  };
+  const uint32_t dt_ms = to_ms(delta_time);
+  const uint32_t upgrade_ms = to_ms(config_.temporal.upgrade_delay);
+  const uint32_t downgrade_ms = to_ms(config_.temporal.downgrade_delay);
+  const uint32_t min_stable = static_cast<uint32_t>(
+      std::clamp(config_.temporal.min_stable_frames, 0, 255));
+  const uint32_t fade_on = config_.dither.enabled ? 1u : 0u;
+  const float alpha_step =
+      255.0f * delta_time /
+      std::max(config_.dither.crossfade_duration, 0.0001f);
+
+  uint8_t *lod_bits = instance_lod_states_.lod_bits.data();
+  uint16_t *timer_ms = instance_lod_states_.timer_ms.data();
+  uint8_t *stable_frames = instance_lod_states_.stable_frames.data();
+  uint8_t *alpha = instance_lod_states_.alpha.data();
+  const uint32_t *desired = desired_lods.data();
+
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t bits = lod_bits[i];
+    const uint32_t cur = bits & 3u;
+    const uint32_t tgt = (bits >> 2) & 3u;
+    const uint32_t prev = (bits >> 4) & 3u;
+    const uint32_t fade = (bits >> 6) & 1u;
+    const uint32_t visible =
+        static_cast<uint32_t>(desired[i] != kLODOutsideFrustum);
+    const uint32_t want = visible ? std::min(desired[i], 3u) : cur;
+
+    // changed: selection differs from the drawn LOD
+    // pending: ...and it asked for the same LOD last frame too
+    // commit:  ...for long enough to switch
+    const uint32_t changed = static_cast<uint32_t>(want != cur);
+    const uint32_t pending = changed & static_cast<uint32_t>(want == tgt);
+    const uint32_t timer = std::min<uint32_t>(timer_ms[i] + dt_ms, 0xFFFFu);
+    const uint32_t delay = want < cur ? upgrade_ms : downgrade_ms;
+    const uint32_t commit = pending & static_cast<uint32_t>(timer >= delay);
+
+    const uint32_t stable = stable_frames[i];
+    const uint32_t stable_inc = std::min<uint32_t>(stable + 1u, 255u);
+    const uint32_t next_stable =
+        commit ? 0u : (changed ? stable : stable_inc);
+    const uint32_t settled =
+        (changed ^ 1u) & static_cast<uint32_t>(next_stable >= min_stable);
+
+    const uint32_t next_cur = commit ? want : cur;
+    const uint32_t next_tgt = changed ? want : tgt;
+    const uint32_t next_prev = commit ? cur : prev;
+    const uint32_t next_fade = commit ? (fade | fade_on) : (fade & (settled ^ 1u));
+    const uint32_t next_timer = (pending & (commit ^ 1u)) ? timer : 0u;
+
+    const uint32_t next_bits =
+        next_cur | (next_tgt << 2) | (next_prev << 4) | (next_fade << 6);
+    const uint32_t next_alpha = static_cast<uint32_t>(
+        std::min(static_cast<float>(next_stable) * alpha_step, 255.0f) + 0.5f);
+
+    lod_bits[i] = static_cast<uint8_t>(visible ? next_bits : bits);
+    timer_ms[i] = static_cast<uint16_t>(visible ? next_timer : timer_ms[i]);
+    stable_frames[i] = static_cast<uint8_t>(visible ? next_stable : stable);
+    alpha[i] = static_cast<uint8_t>(visible ? next_alpha : alpha[i]);
+  }
+}
+
+void LODMesh::apply_lod_results(std::span<const uint32_t> desired_lods,
                                 float delta_time, bool do_detailed_log,
                                 Renderer &renderer) {
-  (void)renderer;
-  std::vector<InstanceData> lod_instances[3];
-  std::vector<std::pair<InstanceData, float>> crossfade_instances[3];
   int lod_counts[4] = {0, 0, 0, 0};
 
+  for (size_t lod = 0; lod < 3; ++lod) {
+    lod_draw_lists_[lod].clear();
+    crossfade_draw_lists_[lod].clear();
+  }
+  impostor_draw_list_.clear();
+
+  InstancedMesh *billboards = impostor_ ? impostor_->billboards() : nullptr;
+  const Vec3 cam_pos = renderer.camera().position;
+  const float impostor_max_sq =
+      thresholds_.impostor_distance_max * thresholds_.impostor_distance_max;
+  auto add_impostor = [&](size_t i, float alpha) {
+    const auto &pos = source_instances_[i].position;
+    float dx = pos.x - cam_pos.x;
+    float dy = pos.y - cam_pos.y;
+    float dz = pos.z - cam_pos.z;
+    if (dx * dx + dy * dy + dz * dz < impostor_max_sq) {
+      impostor_draw_list_.push_back({static_cast<uint32_t>(i), alpha});
+    }
+  };
+
   if (desired_lods.empty()) {
     for (int lod = 0; lod < 3; ++lod) {
       if (lod_meshes_[lod]) {
-        lod_meshes_[lod]->set_instances({});
+        lod_meshes_[lod]->commit_instances(0);
         last_stats_.instances_per_lod[lod] = 0;
         last_stats_.visible_per_lod[lod] = 0;
       }
     }
+    if (billboards) {
+      billboards->commit_instances(0);
+    }
     last_stats_.culled = 0;
+    last_stats_.impostors = 0;
     last_stats_.total_instances = 0;
     if (do_detailed_log) {
       std::cout << "No instances available for LOD processing.\n";
@@ -600,77 +842,55 @@ void LODMesh::apply_lod_results(const std::vector<uint32_t> &desired_lods,
     return;
   }
 
+  const bool temporal =
+      config_.temporal.enabled &&
+      instance_lod_states_.size() == source_instances_.size() &&
+      desired_lods.size() >= source_instances_.size();
+  if (temporal) {
+    update_temporal_states(desired_lods, delta_time);
+  }
+
   for (size_t i = 0; i < source_instances_.size(); ++i) {
     uint32_t desired_lod = (i < desired_lods.size()) ? desired_lods[i] : 3u;
+    if (desired_lod == kLODOutsideFrustum) {
+      lod_counts[3]++;
+      continue;
+    }
     if (desired_lod > 3)
       desired_lod = 3;
     lod_counts[desired_lod]++;
 
-    auto inst = source_instances_[i];
-
-    if (config_.temporal.enabled && i < instance_lod_states_.size()) {
-      auto &state = instance_lod_states_[i];
+    const uint32_t index = static_cast<uint32_t>(i);
 
-      if (desired_lod != state.current_lod) {
-        if (desired_lod != state.target_lod) {
-          state.target_lod = desired_lod;
-          state.transition_time = 0.0f;
-        } else {
-          state.transition_time += delta_time;
+    if (temporal) {
+      const uint8_t bits = instance_lod_states_.lod_bits[i];
+      const uint32_t current_lod = InstanceLODStates::current_lod(bits);
 
-          float required_delay = (desired_lod < state.current_lod)
-                                     ? config_.temporal.upgrade_delay
-                                     : config_.temporal.downgrade_delay;
+      if (InstanceLODStates::is_crossfading(bits)) {
+        const float alpha = instance_lod_states_.alpha[i] * (1.0f / 255.0f);
+        const uint32_t previous_lod = InstanceLODStates::previous_lod(bits);
 
-          if (state.transition_time >= required_delay) {
-            state.previous_lod = state.current_lod;
-            state.current_lod = state.target_lod;
-            state.transition_time = 0.0f;
-            state.stable_frames = 0;
-
-            if (config_.dither.enabled) {
-              state.is_crossfading = true;
-            }
-          }
+        if (previous_lod < 3) {
+          crossfade_draw_lists_[previous_lod].push_back({index, 1.0f - alpha});
         }
-      } else {
-        state.stable_frames++;
-        state.transition_time = 0.0f;
 
-        if (state.is_crossfading &&
-            state.stable_frames >= config_.temporal.min_stable_frames) {
-          state.is_crossfading = false;
-        }
-      }
-
-      if (state.is_crossfading) {
-        float alpha = std::min(state.stable_frames * delta_time /
-                                   std::max(config_.dither.crossfade_duration,
-                                            0.0001f),
-                               1.0f);
-        inst.lod_transition_alpha = alpha;
-
-        if (state.previous_lod < 3) {
-          auto fade_inst = inst;
-          fade_inst.lod_transition_alpha = 1.0f - alpha;
-          crossfade_instances[state.previous_lod].push_back(
-              {fade_inst, 1.0f - alpha});
-        }
-
-        if (state.current_lod < 3) {
-          inst.lod_transition_alpha = alpha;
-          lod_instances[state.current_lod].push_back(inst);
+        if (current_lod < 3) {
+          lod_draw_lists_[current_lod].push_back({index, alpha});
+        } else if (billboards) {
+          add_impostor(i, alpha);
         }
       } else {
-        if (state.current_lod < 3) {
-          inst.lod_transition_alpha = 1.0f;
-          lod_instances[state.current_lod].push_back(inst);
+        if (current_lod < 3) {
+          lod_draw_lists_[current_lod].push_back({index, 1.0f});
+        } else if (billboards) {
+          add_impostor(i, 1.0f);
         }
       }
     } else {
       if (desired_lod < 3) {
-        inst.lod_transition_alpha = 1.0f;
-        lod_instances[desired_lod].push_back(inst);
+        lod_draw_lists_[desired_lod].push_back({index, 1.0f});
+      } else if (billboards) {
+        add_impostor(i, 1.0f);
       }
     }
   }
@@ -683,37 +903,74 @@ void LODMesh::apply_lod_results(const std::vector<uint32_t> &desired_lods,
     std::cout << "  Culled: " << lod_counts[3] << "\n";
   }
 
+  // Write GPU-format records straight into each LOD's instance staging:
+  // regular entries first, crossfading ones from the previous LOD after.
+  size_t assigned[3] = {0, 0, 0};
   for (int lod = 0; lod < 3; ++lod) {
-    for (auto &[inst, alpha] : crossfade_instances[lod]) {
-      lod_instances[lod].push_back(inst);
+    InstancedMesh *mesh = lod_meshes_[lod].get();
+    if (!mesh)
+      continue;
+
+    const auto &regular = lod_draw_lists_[lod];
+    const auto &fading = crossfade_draw_lists_[lod];
+    std::span<InstanceGPUData> out =
+        mesh->begin_instance_write(regular.size() + fading.size());
+
+    size_t written = 0;
+    for (const auto *list : {&regular, &fading}) {
+      for (const LODDrawEntry &entry : *list) {
+        if (written >= out.size())
+          break;
+        InstanceGPUData &gpu = out[written++];
+        gpu = source_instances_[entry.instance].to_gpu_data();
+        gpu.lod_transition_alpha = entry.alpha;
+      }
     }
-  }
 
-  if (do_detailed_log) {
-    std::cout << "\nInstances assigned to LOD buffers:\n";
-    std::cout << "  High: " << lod_instances[0].size() << "\n";
-    std::cout << "  Medium: " << lod_instances[1].size() << "\n";
-    std::cout << "  Low: " << lod_instances[2].size() << "\n";
+    mesh->commit_instances(written);
+    assigned[lod] = regular.size() + fading.size();
+
+    if (do_detailed_log) {
+      std::cout << "LOD " << lod << " buffer updated with " << written
+                << " instances\n";
+    }
   }
 
-  for (int lod = 0; lod < 3; ++lod) {
-    if (lod_meshes_[lod]) {
-      lod_meshes_[lod]->set_instances(lod_instances[lod]);
-      if (do_detailed_log) {
-        std::cout << "LOD " << lod << " buffer updated with "
-                  << lod_instances[lod].size() << " instances\n";
-      }
+  size_t impostor_count = 0;
+  if (billboards) {
+    std::span<InstanceGPUData> out =
+        billboards->begin_instance_write(impostor_draw_list_.size());
+    for (const LODDrawEntry &entry : impostor_draw_list_) {
+      if (impostor_count >= out.size())
+        break;
+      InstanceGPUData &gpu = out[impostor_count++];
+      gpu = impostor_->make_instance(source_instances_[entry.instance],
+                                     cam_pos);
+      gpu.lod_transition_alpha = entry.alpha;
     }
+    billboards->commit_instances(impostor_count);
+  }
+
+  if (do_detailed_log) {
+    std::cout << "\nInstances assigned to LOD buffers:\n";
+    std::cout << "  High: " << assigned[0] << "\n";
+    std::cout << "  Medium: " << assigned[1] << "\n";
+    std::cout << "  Low: " << assigned[2] << "\n";
+    std::cout << "  Impostor: " << impostor_count << "\n";
   }
 
   last_stats_.total_instances = total_instance_count_;
   for (int i = 0; i < 3; ++i) {
-    last_stats_.instances_per_lod[i] = lod_instances[i].size();
+    last_stats_.instances_per_lod[i] = static_cast<uint32_t>(assigned[i]);
     if (lod_meshes_[i]) {
       last_stats_.visible_per_lod[i] = lod_meshes_[i]->instance_count();
     }
   }
-  last_stats_.culled = lod_counts[3];
+  last_stats_.impostors = static_cast<uint32_t>(impostor_count);
+  const uint32_t culled_count = static_cast<uint32_t>(lod_counts[3]);
+  last_stats_.culled = culled_count > last_stats_.impostors
+                           ? culled_count - last_stats_.impostors
+                           : 0;
 
   if (do_detailed_log) {
     std::cout << "========================================\n\n";
@@ -728,8 +985,7 @@ bool LODMesh::initialize_gpu_resources(size_t max_instances) {
 
   std::vector<uint8_t> compute_bytes;
   try {
-    compute_bytes =
-        pixel::platform::load_shader_bytecode("assets/shaders/spirv/lod.comp.spv");
+    compute_bytes = load_spirv_bytecode("assets/shaders/spirv/lod.comp.spv");
   } catch (const std::exception &e) {
     std::cerr << "Failed to load GPU LOD shader: " << e.what() << std::endl;
     return false;
@@ -798,6 +1054,19 @@ bool LODMesh::initialize_gpu_resources(size_t max_instances) {
   return true;
 }
 
+bool LODMesh::bake_impostor(Renderer &renderer) {
+  if (!lod_meshes_[0]) {
+    std::cerr << "LODMesh::bake_impostor(): no high-detail mesh" << std::endl;
+    return false;
+  }
+
+  impostor_ = ImpostorAtlas::bake(renderer, *lod_meshes_[0], bounds_center_,
+                                  bounds_radius_, config_.impostor.view_count,
+                                  config_.impostor.resolution,
+                                  max_instances_per_lod_);
+  return impostor_ != nullptr;
+}
+
 void LODMesh::draw_all_lods(rhi::CmdList *cmd) const {
   for (int i = 0; i < 3; i++) {
     if (lod_meshes_[i]) {
@@ -906,12 +1175,76 @@ void RendererLOD::draw_lod(Renderer &renderer, LODMesh &mesh,
     cmd->setUniformInt("useTextureArray", 0);
   }
 
+  // Levels may use different vertex layouts; switch variants as needed
+  rhi::VertexLayout bound_layout = base_material.shader_variant.vertex_layout();
   for (size_t lod = 0; lod < 3; ++lod) {
     const InstancedMesh *instanced_mesh = mesh.lod_mesh(lod);
     if (instanced_mesh && instanced_mesh->instance_count() > 0) {
+      const MeshFormat &format = instanced_mesh->format();
+      const ShaderVariantKey variant =
+          base_material.shader_variant.with_vertex_layout(format.vertex_layout);
+      if (format.vertex_layout != bound_layout) {
+        cmd->setPipeline(shader->pipeline(variant, base_material.blend_mode));
+        bound_layout = format.vertex_layout;
+      }
+      set_mesh_format_uniforms(cmd, format, shader->reflection(variant), false);
       instanced_mesh->draw(cmd);
     }
   }
+
+  // Impostor billboards for instances past the last geometric LOD
+  const ImpostorAtlas *impostor = mesh.impostor();
+  if (!impostor || !impostor->billboards() ||
+      impostor->billboards()->instance_count() == 0)
+    return;
+
+  Shader *impostor_shader = renderer.get_shader(renderer.impostor_shader());
+  if (!impostor_shader)
+    return;
+
+  cmd->setPipeline(impostor_shader->pipeline(base_material.shader_variant,
+                                             base_material.blend_mode));
+  const ShaderReflection &impostor_reflection =
+      impostor_shader->reflection(base_material.shader_variant);
+  const bool force_metal_uniforms =
+      renderer.device()->backend_name() &&
+      std::string_view(renderer.device()->backend_name()).find("Metal") !=
+          std::string_view::npos;
+
+  glm::mat4 projection_matrix = apply_clip_space_correction(
+      glm::make_mat4(projection), renderer.device()->caps());
+  float material_color[4] = {base_material.color.r, base_material.color.g,
+                             base_material.color.b, base_material.color.a};
+
+  if (impostor_reflection.has_uniform("model") || force_metal_uniforms) {
+    cmd->setUniformMat4("model", glm::value_ptr(model));
+  }
+  if (impostor_reflection.has_uniform("view") || force_metal_uniforms) {
+    cmd->setUniformMat4("view", view);
+  }
+  if (impostor_reflection.has_uniform("projection") || force_metal_uniforms) {
+    cmd->setUniformMat4("projection", glm::value_ptr(projection_matrix));
+  }
+  if (impostor_reflection.has_uniform("materialColor") ||
+      force_metal_uniforms) {
+    cmd->setUniformVec4("materialColor", material_color);
+  }
+  if (impostor_reflection.has_uniform("uDitherEnabled") ||
+      force_metal_uniforms) {
+    cmd->setUniformInt("uDitherEnabled", 1);
+  }
+  if (impostor_reflection.has_sampler("uTextureArray") ||
+      force_metal_uniforms) {
+    uint32_t binding = 0u;
+    if (const ShaderUniform *uniform =
+            impostor_reflection.find_uniform("uTextureArray")) {
+      if (uniform->binding)
+        binding = *uniform->binding;
+    }
+    cmd->setTexture("uTextureArray", impostor->texture(), binding);
+  }
+
+  impostor->billboards()->draw(cmd);
 }
 
 } // namespace pixel::renderer3d
@@ -1,18 +1,212 @@
 #include "pixel/renderer3d/mesh.hpp"
+#include "pixel/renderer3d/mesh_optimizer.hpp"
+#include "pixel/renderer3d/shader_reflection.hpp"
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <iostream>
 
 namespace pixel::renderer3d {
 
+namespace {
+
+int16_t encode_snorm16(float v) {
+  v = std::clamp(v, -1.0f, 1.0f);
+  return static_cast<int16_t>(std::lround(v * 32767.0f));
+}
+
+uint8_t encode_unorm8(float v) {
+  v = std::clamp(v, 0.0f, 1.0f);
+  return static_cast<uint8_t>(std::lround(v * 255.0f));
+}
+
+// IEEE 754 binary16, round to nearest even; overflow saturates to infinity
+uint16_t float_to_half(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign = (bits >> 16) & 0x8000u;
+  const uint32_t abs_bits = bits & 0x7FFFFFFFu;
+
+  if (abs_bits >= 0x7F800000u) // inf / nan
+    return static_cast<uint16_t>(sign | 0x7C00u |
+                                 (abs_bits > 0x7F800000u ? 0x200u : 0u));
+  if (abs_bits >= 0x477FF000u) // rounds past the largest finite half
+    return static_cast<uint16_t>(sign | 0x7C00u);
+  if (abs_bits < 0x38800000u) { // subnormal half or zero
+    if (abs_bits < 0x33000000u)
+      return static_cast<uint16_t>(sign);
+    const uint32_t exponent = abs_bits >> 23;
+    const uint32_t mantissa = (abs_bits & 0x7FFFFFu) | 0x800000u;
+    const uint32_t shift = 126u - exponent;
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+    const uint32_t halfway = 1u << (shift - 1u);
+    if (remainder > halfway || (remainder == halfway && (half & 1u)))
+      ++half;
+    return static_cast<uint16_t>(sign | half);
+  }
+
+  uint32_t half = (abs_bits - 0x38000000u) >> 13;
+  const uint32_t remainder = abs_bits & 0x1FFFu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+    ++half;
+  return static_cast<uint16_t>(sign | half);
+}
+
+float half_to_float(uint16_t half) {
+  const uint32_t sign = uint32_t(half & 0x8000u) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1Fu;
+  uint32_t mantissa = half & 0x3FFu;
+  uint32_t bits;
+  if (exponent == 0x1Fu) {
+    bits = sign | 0x7F800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    bits = sign;
+  } else { // subnormal: renormalise
+    uint32_t e = 113;
+    while ((mantissa & 0x400u) == 0) {
+      mantissa <<= 1;
+      --e;
+    }
+    bits = sign | (e << 23) | ((mantissa & 0x3FFu) << 13);
+  }
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+float decode_snorm16(int16_t v) {
+  return std::max(static_cast<float>(v) / 32767.0f, -1.0f);
+}
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2
+void encode_octahedral(const Vec3 &n, int16_t out[2]) {
+  const float len = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  if (len <= 0.0f) {
+    out[0] = 0;
+    out[1] = 0;
+    return;
+  }
+  float x = n.x / len;
+  float y = n.y / len;
+  if (n.z < 0.0f) {
+    const float ox = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    const float oy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = ox;
+    y = oy;
+  }
+  out[0] = encode_snorm16(x);
+  out[1] = encode_snorm16(y);
+}
+
+} // namespace
+
+std::vector<CompressedVertex> compress_vertices(std::span<const Vertex> vertices,
+                                                const MeshFormat &format) {
+  std::vector<CompressedVertex> packed(vertices.size());
+  const float inv_scale[3] = {
+      format.position_scale.x > 0.0f ? 1.0f / format.position_scale.x : 0.0f,
+      format.position_scale.y > 0.0f ? 1.0f / format.position_scale.y : 0.0f,
+      format.position_scale.z > 0.0f ? 1.0f / format.position_scale.z : 0.0f};
+
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const Vertex &v = vertices[i];
+    CompressedVertex &out = packed[i];
+    out.position[0] =
+        encode_snorm16((v.position.x - format.position_offset.x) * inv_scale[0]);
+    out.position[1] =
+        encode_snorm16((v.position.y - format.position_offset.y) * inv_scale[1]);
+    out.position[2] =
+        encode_snorm16((v.position.z - format.position_offset.z) * inv_scale[2]);
+    out.position[3] = 32767;
+    encode_octahedral(v.normal, out.normal);
+    out.texcoord[0] = float_to_half(v.texcoord.x);
+    out.texcoord[1] = float_to_half(v.texcoord.y);
+    out.color[0] = encode_unorm8(v.color.r);
+    out.color[1] = encode_unorm8(v.color.g);
+    out.color[2] = encode_unorm8(v.color.b);
+    out.color[3] = encode_unorm8(v.color.a);
+  }
+  return packed;
+}
+
+std::vector<Vertex> decompress_vertices(std::span<const CompressedVertex> packed,
+                                        const MeshFormat &format) {
+  std::vector<Vertex> vertices(packed.size());
+  for (size_t i = 0; i < packed.size(); ++i) {
+    const CompressedVertex &in = packed[i];
+    Vertex &v = vertices[i];
+    v.position = Vec3(format.position_offset.x +
+                          decode_snorm16(in.position[0]) * format.position_scale.x,
+                      format.position_offset.y +
+                          decode_snorm16(in.position[1]) * format.position_scale.y,
+                      format.position_offset.z +
+                          decode_snorm16(in.position[2]) * format.position_scale.z);
+    float x = decode_snorm16(in.normal[0]);
+    float y = decode_snorm16(in.normal[1]);
+    const float z = 1.0f - std::abs(x) - std::abs(y);
+    if (z < 0.0f) {
+      const float ox = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+      const float oy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+      x = ox;
+      y = oy;
+    }
+    const float len = std::sqrt(x * x + y * y + z * z);
+    v.normal = len > 0.0f ? Vec3(x / len, y / len, z / len) : Vec3(0, 0, 1);
+    v.texcoord = Vec2(half_to_float(in.texcoord[0]),
+                      half_to_float(in.texcoord[1]));
+    v.color = Color(in.color[0] / 255.0f, in.color[1] / 255.0f,
+                    in.color[2] / 255.0f, in.color[3] / 255.0f);
+  }
+  return vertices;
+}
+
+void set_mesh_format_uniforms(rhi::CmdList *cmd, const MeshFormat &format,
+                              const ShaderReflection &reflection,
+                              bool force_metal_uniforms) {
+  if (!format.compressed())
+    return;
+
+  float offset[4] = {format.position_offset.x, format.position_offset.y,
+                     format.position_offset.z, 0.0f};
+  float scale[4] = {format.position_scale.x, format.position_scale.y,
+                    format.position_scale.z, 0.0f};
+  if (reflection.has_uniform("positionOffset") || force_metal_uniforms)
+    cmd->setUniformVec4("positionOffset", offset);
+  if (reflection.has_uniform("positionScale") || force_metal_uniforms)
+    cmd->setUniformVec4("positionScale", scale);
+}
+
 std::unique_ptr<Mesh> Mesh::create(rhi::Device *device,
                                    const std::vector<Vertex> &vertices,
-                                   const std::vector<uint32_t> &indices) {
+                                   const std::vector<uint32_t> &indices,
+                                   const MeshOptions &options) {
+  if (options.optimize) {
+    std::vector<Vertex> optimized_vertices = vertices;
+    std::vector<uint32_t> optimized_indices = indices;
+    mesh_optimizer::optimize_mesh(optimized_vertices, optimized_indices);
+
+    MeshOptions upload_options = options;
+    upload_options.optimize = false;
+    return create(device, optimized_vertices, optimized_indices,
+                  upload_options);
+  }
+
   auto mesh = std::unique_ptr<Mesh>(new Mesh());
   mesh->vertex_count_ = vertices.size();
   mesh->index_count_ = indices.size();
-  mesh->vertices_ = vertices;
-  mesh->indices_ = indices;
+  if (options.keep_cpu_data) {
+    mesh->vertices_ = vertices;
+    mesh->indices_ = indices;
+  }
+
+  MeshFormat &format = mesh->format_;
+  format.vertex_layout = options.vertex_layout;
+  if (options.allow_16bit_indices && vertices.size() < 65536) {
+    format.index_format = rhi::IndexFormat::Uint16;
+  }
 
   if (!vertices.empty()) {
     Vec3 min_pos = vertices.front().position;
@@ -26,6 +220,18 @@ std::unique_ptr<Mesh> Mesh::create(rhi::Device *device,
       max_pos.z = std::max(max_pos.z, v.position.z);
     }
 
+    mesh->bounds_center_ = Vec3((min_pos.x + max_pos.x) * 0.5f,
+                                (min_pos.y + max_pos.y) * 0.5f,
+                                (min_pos.z + max_pos.z) * 0.5f);
+    float radius_sq = 0.0f;
+    for (const auto &v : vertices) {
+      const float dx = v.position.x - mesh->bounds_center_.x;
+      const float dy = v.position.y - mesh->bounds_center_.y;
+      const float dz = v.position.z - mesh->bounds_center_.z;
+      radius_sq = std::max(radius_sq, dx * dx + dy * dy + dz * dz);
+    }
+    mesh->bounds_radius_ = std::sqrt(radius_sq);
+
     std::cout << "Mesh::create()" << std::endl;
     std::cout << "  vertex_count: " << mesh->vertex_count_ << std::endl;
     std::cout << "  index_count:  " << mesh->index_count_ << std::endl;
@@ -37,58 +243,131 @@ std::unique_ptr<Mesh> Mesh::create(rhi::Device *device,
               << first.position.y << ", " << first.position.z << ") normal(" <<
         first.normal.x << ", " << first.normal.y << ", " << first.normal.z
               << ")" << std::endl;
+
+    if (format.compressed()) {
+      format.position_offset = Vec3((min_pos.x + max_pos.x) * 0.5f,
+                                    (min_pos.y + max_pos.y) * 0.5f,
+                                    (min_pos.z + max_pos.z) * 0.5f);
+      format.position_scale = Vec3((max_pos.x - min_pos.x) * 0.5f,
+                                   (max_pos.y - min_pos.y) * 0.5f,
+                                   (max_pos.z - min_pos.z) * 0.5f);
+    }
   } else {
     std::cerr << "Mesh::create() received empty vertex array" << std::endl;
   }
 
+  std::vector<CompressedVertex> packed_vertices;
+  std::span<const std::byte> vertex_bytes(
+      reinterpret_cast<const std::byte *>(vertices.data()),
+      vertices.size() * sizeof(Vertex));
+  if (format.compressed()) {
+    packed_vertices = compress_vertices(vertices, format);
+    vertex_bytes = std::span<const std::byte>(
+        reinterpret_cast<const std::byte *>(packed_vertices.data()),
+        packed_vertices.size() * sizeof(CompressedVertex));
+  }
+
+  std::vector<uint16_t> indices16;
+  std::span<const std::byte> index_bytes(
+      reinterpret_cast<const std::byte *>(indices.data()),
+      indices.size() * sizeof(uint32_t));
+  if (format.index_format == rhi::IndexFormat::Uint16) {
+    // Padded to a 4-byte multiple for backends that copy in words
+    indices16.reserve(indices.size() + 1);
+    indices16.assign(indices.begin(), indices.end());
+    if (indices16.size() % 2 != 0)
+      indices16.push_back(0);
+    index_bytes = std::span<const std::byte>(
+        reinterpret_cast<const std::byte *>(indices16.data()),
+        indices16.size() * sizeof(uint16_t));
+  }
+
+  std::cout << "  layout: "
+            << (format.compressed() ? "compressed" : "standard")
+            << " index format: "
+            << (format.index_format == rhi::IndexFormat::Uint16 ? "u16"
+                                                                : "u32")
+            << std::endl;
+
+  mesh->upload(device, vertex_bytes, index_bytes, options.pool);
+  return mesh;
+}
+
+void Mesh::upload(rhi::Device *device, std::span<const std::byte> vertex_bytes,
+                  std::span<const std::byte> index_bytes, GeometryPool *pool) {
+  if (pool) {
+    auto allocation = pool->allocate(
+        format_.vertex_layout, static_cast<uint32_t>(vertex_count_),
+        index_bytes.size());
+    if (allocation) {
+      pool->upload(*allocation, vertex_bytes, index_bytes);
+      pool_ = pool;
+      allocation_ = *allocation;
+      vertex_buffer_ = allocation->vertex_buffer;
+      index_buffer_ = allocation->index_buffer;
+      format_.base_vertex = static_cast<int32_t>(allocation->base_vertex);
+      format_.first_index = static_cast<uint32_t>(
+          allocation->index_offset / rhi::index_format_size(format_.index_format));
+      std::cout << "  Pooled: vertex buffer " << vertex_buffer_.id
+                << " base_vertex=" << format_.base_vertex << ", index buffer "
+                << index_buffer_.id
+                << " first_index=" << format_.first_index << std::endl;
+      return;
+    }
+    std::cerr << "  WARNING: Geometry pool allocation failed, using dedicated "
+                 "buffers"
+              << std::endl;
+  }
+
   // Create vertex buffer
   rhi::BufferDesc vb_desc;
-  vb_desc.size = vertices.size() * sizeof(Vertex);
+  vb_desc.size = vertex_bytes.size();
   vb_desc.usage = rhi::BufferUsage::Vertex;
   vb_desc.hostVisible = true;
-  mesh->vertex_buffer_ = device->createBuffer(vb_desc);
-  if (mesh->vertex_buffer_.id == 0) {
+  vertex_buffer_ = device->createBuffer(vb_desc);
+  if (vertex_buffer_.id == 0) {
     std::cerr << "  ERROR: Failed to allocate vertex buffer" << std::endl;
   } else {
-    std::cout << "  Vertex buffer handle: " << mesh->vertex_buffer_.id
+    std::cout << "  Vertex buffer handle: " << vertex_buffer_.id
               << " size=" << vb_desc.size << std::endl;
   }
 
   // Upload vertex data
   auto *cmd = device->getImmediate();
   cmd->begin();
-  cmd->copyToBuffer(mesh->vertex_buffer_, 0,
-                    std::span<const std::byte>(
-                        reinterpret_cast<const std::byte *>(vertices.data()),
-                        vertices.size() * sizeof(Vertex)));
+  cmd->copyToBuffer(vertex_buffer_, 0, vertex_bytes);
   cmd->end();
 
   // Create index buffer
   rhi::BufferDesc ib_desc;
-  ib_desc.size = indices.size() * sizeof(uint32_t);
+  ib_desc.size = index_bytes.size();
   ib_desc.usage = rhi::BufferUsage::Index;
   ib_desc.hostVisible = true;
-  mesh->index_buffer_ = device->createBuffer(ib_desc);
-  if (mesh->index_buffer_.id == 0) {
+  index_buffer_ = device->createBuffer(ib_desc);
+  if (index_buffer_.id == 0) {
     std::cerr << "  ERROR: Failed to allocate index buffer" << std::endl;
   } else {
-    std::cout << "  Index buffer handle: " << mesh->index_buffer_.id
+    std::cout << "  Index buffer handle: " << index_buffer_.id
               << " size=" << ib_desc.size << std::endl;
   }
 
   // Upload index data
   cmd->begin();
-  cmd->copyToBuffer(mesh->index_buffer_, 0,
-                    std::span<const std::byte>(
-                        reinterpret_cast<const std::byte *>(indices.data()),
-                        indices.size() * sizeof(uint32_t)));
+  cmd->copyToBuffer(index_buffer_, 0, index_bytes);
   cmd->end();
+}
 
-  return mesh;
+void Mesh::release_cpu_data() {
+  std::vector<Vertex>().swap(vertices_);
+  std::vector<uint32_t>().swap(indices_);
 }
 
 Mesh::~Mesh() {
-  // RHI device will handle cleanup through handle management
+  // Dedicated buffers are cleaned up by the RHI device through handle
+  // management; pooled ranges go back to the pool once frames in flight
+  // that may still draw this mesh have finished
+  if (pool_)
+    pool_->retire(allocation_);
 }
 
 } // namespace pixel::renderer3d
@@ -0,0 +1,417 @@
+#include "pixel/renderer3d/mesh_file.hpp"
+#include "pixel/renderer3d/mesh_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace pixel::renderer3d {
+
+static_assert(sizeof(Vertex) == 48,
+              "Vertex must match the standard vertex layout stride");
+
+namespace {
+
+size_t align_up(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T> void append_bytes(std::vector<std::byte> &out,
+                                        const T *data, size_t count) {
+  const auto *bytes = reinterpret_cast<const std::byte *>(data);
+  out.insert(out.end(), bytes, bytes + count * sizeof(T));
+}
+
+bool range_in_file(uint64_t offset, uint64_t size, size_t file_size) {
+  return offset <= file_size && size <= file_size - offset;
+}
+
+// Every stored index of a LOD (the u16 padding index excluded) must address
+// one of its own vertices
+template <typename Index>
+bool indices_in_range(const std::byte *data, uint32_t count,
+                      uint32_t vertex_count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    Index index;
+    std::memcpy(&index, data + size_t(i) * sizeof(Index), sizeof(Index));
+    if (index >= vertex_count)
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+bool write_mesh_file(const std::string &path,
+                     const std::vector<MeshFileLodSource> &lods,
+                     const MeshOptions &options) {
+  if (lods.empty()) {
+    std::cerr << "write_mesh_file(): no LODs given for " << path << std::endl;
+    return false;
+  }
+
+  std::vector<MeshFileLodSource> sources = lods;
+  bool fits_16bit = options.allow_16bit_indices;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    auto &lod = sources[i];
+    const bool valid_indices = std::all_of(
+        lod.indices.begin(), lod.indices.end(),
+        [&](uint32_t index) { return index < lod.vertices.size(); });
+    if (lod.vertices.empty() || lod.indices.empty() ||
+        lod.indices.size() % 3 != 0 || !valid_indices) {
+      std::cerr << "write_mesh_file(): LOD " << i
+                << " is not a valid triangle list" << std::endl;
+      return false;
+    }
+    if (options.optimize)
+      mesh_optimizer::optimize_mesh(lod.vertices, lod.indices);
+    fits_16bit = fits_16bit && lod.vertices.size() < 65536;
+  }
+
+  MeshFormat format;
+  format.vertex_layout = options.vertex_layout;
+  format.index_format =
+      fits_16bit ? rhi::IndexFormat::Uint16 : rhi::IndexFormat::Uint32;
+
+  Vec3 min_pos = sources.front().vertices.front().position;
+  Vec3 max_pos = min_pos;
+  for (const auto &lod : sources) {
+    for (const auto &v : lod.vertices) {
+      min_pos.x = std::min(min_pos.x, v.position.x);
+      min_pos.y = std::min(min_pos.y, v.position.y);
+      min_pos.z = std::min(min_pos.z, v.position.z);
+      max_pos.x = std::max(max_pos.x, v.position.x);
+      max_pos.y = std::max(max_pos.y, v.position.y);
+      max_pos.z = std::max(max_pos.z, v.position.z);
+    }
+  }
+  if (format.compressed()) {
+    format.position_offset = Vec3((min_pos.x + max_pos.x) * 0.5f,
+                                  (min_pos.y + max_pos.y) * 0.5f,
+                                  (min_pos.z + max_pos.z) * 0.5f);
+    format.position_scale = Vec3((max_pos.x - min_pos.x) * 0.5f,
+                                 (max_pos.y - min_pos.y) * 0.5f,
+                                 (max_pos.z - min_pos.z) * 0.5f);
+  }
+
+  std::vector<MeshFileLod> lod_table(sources.size());
+  std::vector<std::byte> vertex_payload;
+  std::vector<std::byte> index_payload;
+  uint32_t vertex_cursor = 0;
+  uint32_t index_cursor = 0;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    const auto &lod = sources[i];
+    MeshFileLod &entry = lod_table[i];
+    entry = {};
+    entry.first_vertex = vertex_cursor;
+    entry.vertex_count = static_cast<uint32_t>(lod.vertices.size());
+    entry.first_index = index_cursor;
+    entry.index_count = static_cast<uint32_t>(lod.indices.size());
+    entry.switch_distance = i == 0 ? 0.0f : lod.switch_distance;
+
+    if (format.compressed()) {
+      auto packed = compress_vertices(lod.vertices, format);
+      append_bytes(vertex_payload, packed.data(), packed.size());
+    } else {
+      append_bytes(vertex_payload, lod.vertices.data(), lod.vertices.size());
+    }
+
+    if (format.index_format == rhi::IndexFormat::Uint16) {
+      std::vector<uint16_t> indices16(lod.indices.begin(), lod.indices.end());
+      if (indices16.size() % 2 != 0)
+        indices16.push_back(0);
+      append_bytes(index_payload, indices16.data(), indices16.size());
+      index_cursor += static_cast<uint32_t>(indices16.size());
+    } else {
+      append_bytes(index_payload, lod.indices.data(), lod.indices.size());
+      index_cursor += entry.index_count;
+    }
+    vertex_cursor += entry.vertex_count;
+  }
+
+  MeshFileHeader header{};
+  std::memcpy(header.magic, kMeshFileMagic, sizeof(header.magic));
+  header.version = kMeshFileVersion;
+  header.header_size = sizeof(MeshFileHeader);
+  header.vertex_layout = static_cast<uint8_t>(format.vertex_layout);
+  header.index_format = static_cast<uint8_t>(format.index_format);
+  header.vertex_stride =
+      static_cast<uint32_t>(rhi::vertex_layout_stride(format.vertex_layout));
+  header.lod_count = static_cast<uint32_t>(lod_table.size());
+  header.bounds_min[0] = min_pos.x;
+  header.bounds_min[1] = min_pos.y;
+  header.bounds_min[2] = min_pos.z;
+  header.bounds_max[0] = max_pos.x;
+  header.bounds_max[1] = max_pos.y;
+  header.bounds_max[2] = max_pos.z;
+  header.position_offset[0] = format.position_offset.x;
+  header.position_offset[1] = format.position_offset.y;
+  header.position_offset[2] = format.position_offset.z;
+  header.position_scale[0] = format.position_scale.x;
+  header.position_scale[1] = format.position_scale.y;
+  header.position_scale[2] = format.position_scale.z;
+  header.lod_table_offset = sizeof(MeshFileHeader);
+  header.vertex_data_offset =
+      align_up(header.lod_table_offset + lod_table.size() * sizeof(MeshFileLod),
+               kMeshFilePayloadAlignment);
+  header.vertex_data_size = vertex_payload.size();
+  header.index_data_offset =
+      align_up(header.vertex_data_offset + header.vertex_data_size,
+               kMeshFilePayloadAlignment);
+  header.index_data_size = index_payload.size();
+  header.file_size = header.index_data_offset + header.index_data_size;
+
+  std::vector<std::byte> file(header.file_size, std::byte{0});
+  std::memcpy(file.data(), &header, sizeof(header));
+  std::memcpy(file.data() + header.lod_table_offset, lod_table.data(),
+              lod_table.size() * sizeof(MeshFileLod));
+  std::memcpy(file.data() + header.vertex_data_offset, vertex_payload.data(),
+              vertex_payload.size());
+  std::memcpy(file.data() + header.index_data_offset, index_payload.data(),
+              index_payload.size());
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "write_mesh_file(): cannot open " << path << std::endl;
+    return false;
+  }
+  out.write(reinterpret_cast<const char *>(file.data()),
+            static_cast<std::streamsize>(file.size()));
+  if (!out) {
+    std::cerr << "write_mesh_file(): write failed for " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// ============================================================================
+// MeshFile
+// ============================================================================
+
+std::unique_ptr<MeshFile> MeshFile::open(const std::string &path) {
+  auto mapped = core::MappedFile::open(path);
+  if (!mapped)
+    return nullptr;
+
+  const auto bytes = mapped->bytes();
+  auto fail = [&](const char *reason) -> std::unique_ptr<MeshFile> {
+    std::cerr << "MeshFile::open(): " << path << ": " << reason << std::endl;
+    return nullptr;
+  };
+
+  if (bytes.size() < sizeof(MeshFileHeader))
+    return fail("file too small");
+  // The mapping is page aligned, so the header can be read in place
+  const auto *header = reinterpret_cast<const MeshFileHeader *>(bytes.data());
+  if (std::memcmp(header->magic, kMeshFileMagic, sizeof(header->magic)) != 0)
+    return fail("not a pxmesh file");
+  if (header->version != kMeshFileVersion ||
+      header->header_size != sizeof(MeshFileHeader))
+    return fail("unsupported version");
+  if (header->vertex_layout > static_cast<uint8_t>(rhi::VertexLayout::Compressed) ||
+      header->index_format > static_cast<uint8_t>(rhi::IndexFormat::Uint16))
+    return fail("unknown vertex layout or index format");
+  const auto layout = static_cast<rhi::VertexLayout>(header->vertex_layout);
+  const auto index_format = static_cast<rhi::IndexFormat>(header->index_format);
+  if (header->vertex_stride != rhi::vertex_layout_stride(layout))
+    return fail("vertex stride does not match layout");
+  if (header->file_size != bytes.size())
+    return fail("truncated");
+  if (header->lod_count == 0 ||
+      header->lod_table_offset % alignof(MeshFileLod) != 0 ||
+      !range_in_file(header->lod_table_offset,
+                     uint64_t(header->lod_count) * sizeof(MeshFileLod),
+                     bytes.size()))
+    return fail("bad LOD table");
+  if (!range_in_file(header->vertex_data_offset, header->vertex_data_size,
+                     bytes.size()) ||
+      !range_in_file(header->index_data_offset, header->index_data_size,
+                     bytes.size()))
+    return fail("payload out of range");
+
+  std::span<const MeshFileLod> lods(
+      reinterpret_cast<const MeshFileLod *>(bytes.data() +
+                                            header->lod_table_offset),
+      header->lod_count);
+  const size_t index_size = rhi::index_format_size(index_format);
+  for (const auto &lod : lods) {
+    const uint64_t stored_indices =
+        index_size == sizeof(uint16_t) ? align_up(lod.index_count, 2)
+                                       : lod.index_count;
+    if (lod.vertex_count == 0 || lod.index_count == 0 ||
+        !range_in_file(uint64_t(lod.first_vertex) * header->vertex_stride,
+                       uint64_t(lod.vertex_count) * header->vertex_stride,
+                       header->vertex_data_size) ||
+        !range_in_file(uint64_t(lod.first_index) * index_size,
+                       stored_indices * index_size,
+                       header->index_data_size))
+      return fail("LOD range out of payload");
+
+    // One pass at open so neither the GPU nor read_cpu_data() consumers
+    // (picking, meshlets, LOD) can be sent outside the vertex range
+    const std::byte *lod_indices = bytes.data() + header->index_data_offset +
+                                   size_t(lod.first_index) * index_size;
+    const bool in_range =
+        index_format == rhi::IndexFormat::Uint16
+            ? indices_in_range<uint16_t>(lod_indices, lod.index_count,
+                                         lod.vertex_count)
+            : indices_in_range<uint32_t>(lod_indices, lod.index_count,
+                                         lod.vertex_count);
+    if (!in_range)
+      return fail("index out of LOD vertex range");
+  }
+
+  auto file = std::unique_ptr<MeshFile>(new MeshFile());
+  file->header_ = header;
+  file->lods_ = lods;
+  file->file_ = std::move(mapped);
+  return file;
+}
+
+std::span<const std::byte> MeshFile::vertex_data(size_t lod) const {
+  const MeshFileLod &entry = lods_[lod];
+  const auto bytes = file_->bytes();
+  return bytes.subspan(header_->vertex_data_offset +
+                           size_t(entry.first_vertex) * header_->vertex_stride,
+                       size_t(entry.vertex_count) * header_->vertex_stride);
+}
+
+std::span<const std::byte> MeshFile::index_data(size_t lod) const {
+  const MeshFileLod &entry = lods_[lod];
+  const size_t index_size = rhi::index_format_size(
+      static_cast<rhi::IndexFormat>(header_->index_format));
+  // u16 ranges include their padding index so uploads stay 4-byte sized
+  const size_t count = index_size == sizeof(uint16_t)
+                           ? align_up(entry.index_count, 2)
+                           : entry.index_count;
+  const auto bytes = file_->bytes();
+  return bytes.subspan(header_->index_data_offset +
+                           size_t(entry.first_index) * index_size,
+                       count * index_size);
+}
+
+MeshFormat MeshFile::format() const {
+  MeshFormat format;
+  format.vertex_layout = static_cast<rhi::VertexLayout>(header_->vertex_layout);
+  format.index_format = static_cast<rhi::IndexFormat>(header_->index_format);
+  if (format.compressed()) {
+    format.position_offset =
+        Vec3(header_->position_offset[0], header_->position_offset[1],
+             header_->position_offset[2]);
+    format.position_scale =
+        Vec3(header_->position_scale[0], header_->position_scale[1],
+             header_->position_scale[2]);
+  }
+  return format;
+}
+
+// ============================================================================
+// Mesh loading
+// ============================================================================
+
+namespace {
+
+// Decodes one LOD's payload back into Vertex/uint32 form
+void read_cpu_data(const MeshFile &file, size_t lod,
+                   std::vector<Vertex> &vertices,
+                   std::vector<uint32_t> &indices) {
+  const MeshFileLod &entry = file.lods()[lod];
+  const MeshFormat format = file.format();
+  const auto vertex_bytes = file.vertex_data(lod);
+  const auto index_bytes = file.index_data(lod);
+
+  if (format.compressed()) {
+    std::vector<CompressedVertex> packed(entry.vertex_count);
+    std::memcpy(packed.data(), vertex_bytes.data(), vertex_bytes.size());
+    vertices = decompress_vertices(packed, format);
+  } else {
+    vertices.resize(entry.vertex_count);
+    std::memcpy(vertices.data(), vertex_bytes.data(), vertex_bytes.size());
+  }
+
+  indices.resize(entry.index_count);
+  if (format.index_format == rhi::IndexFormat::Uint16) {
+    for (size_t i = 0; i < entry.index_count; ++i) {
+      uint16_t index;
+      std::memcpy(&index, index_bytes.data() + i * sizeof(index),
+                  sizeof(index));
+      indices[i] = index;
+    }
+  } else {
+    std::memcpy(indices.data(), index_bytes.data(),
+                entry.index_count * sizeof(uint32_t));
+  }
+}
+
+} // namespace
+
+std::unique_ptr<Mesh> Mesh::load(rhi::Device *device, const MeshFile &file,
+                                 size_t lod, const MeshOptions &options) {
+  if (lod >= file.lods().size()) {
+    std::cerr << "Mesh::load(): LOD " << lod << " out of range" << std::endl;
+    return nullptr;
+  }
+
+  const MeshFileLod &entry = file.lods()[lod];
+  auto mesh = std::unique_ptr<Mesh>(new Mesh());
+  mesh->vertex_count_ = entry.vertex_count;
+  mesh->index_count_ = entry.index_count;
+  mesh->format_ = file.format();
+  mesh->source_path_ = file.path();
+  mesh->source_lod_ = lod;
+
+  // The file stores one box for all LODs; its circumscribed sphere avoids a
+  // pass over the vertices
+  const MeshFileHeader &header = file.header();
+  const Vec3 half_extent((header.bounds_max[0] - header.bounds_min[0]) * 0.5f,
+                         (header.bounds_max[1] - header.bounds_min[1]) * 0.5f,
+                         (header.bounds_max[2] - header.bounds_min[2]) * 0.5f);
+  mesh->bounds_center_ = Vec3(header.bounds_min[0] + half_extent.x,
+                              header.bounds_min[1] + half_extent.y,
+                              header.bounds_min[2] + half_extent.z);
+  mesh->bounds_radius_ =
+      std::sqrt(half_extent.x * half_extent.x + half_extent.y * half_extent.y +
+                half_extent.z * half_extent.z);
+
+  if (options.keep_cpu_data)
+    read_cpu_data(file, lod, mesh->vertices_, mesh->indices_);
+
+  mesh->upload(device, file.vertex_data(lod), file.index_data(lod),
+               options.pool);
+  return mesh;
+}
+
+bool Mesh::reload_cpu_data() {
+  if (has_cpu_data())
+    return true;
+  if (source_path_.empty())
+    return false;
+
+  auto file = MeshFile::open(source_path_);
+  if (!file || source_lod_ >= file->lods().size() ||
+      file->lods()[source_lod_].vertex_count != vertex_count_ ||
+      file->lods()[source_lod_].index_count != index_count_) {
+    std::cerr << "Mesh::reload_cpu_data(): " << source_path_
+              << " no longer matches the uploaded mesh" << std::endl;
+    return false;
+  }
+  read_cpu_data(*file, source_lod_, vertices_, indices_);
+  return true;
+}
+
+std::unique_ptr<Mesh> Mesh::load(rhi::Device *device, const std::string &path,
+                                 const MeshOptions &options) {
+  auto file = MeshFile::open(path);
+  if (!file)
+    return nullptr;
+  std::cout << "Mesh::load(): " << path << " (" << file->lods().size()
+            << " LODs)" << std::endl;
+  return load(device, *file, 0, options);
+}
+
+} // namespace pixel::renderer3d
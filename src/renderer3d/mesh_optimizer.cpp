@@ -0,0 +1,368 @@
+// src/renderer3d/mesh_optimizer.cpp - Vertex cache / overdraw / fetch ordering
+#include "pixel/renderer3d/mesh_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace pixel::renderer3d::mesh_optimizer {
+
+namespace {
+
+constexpr uint32_t kInvalidIndex = 0xFFFFFFFFu;
+
+// FIFO post-transform cache as most hardware models it
+class FifoCache {
+public:
+  FifoCache(size_t vertex_count, uint32_t cache_size)
+      : cache_size_(cache_size), timestamps_(vertex_count, 0) {}
+
+  // Returns true on a miss
+  bool access(uint32_t vertex) {
+    if (time_ - timestamps_[vertex] < cache_size_ && timestamps_[vertex] != 0)
+      return false;
+    timestamps_[vertex] = ++time_;
+    return true;
+  }
+
+  void reset() { time_ += cache_size_ + 1; }
+
+private:
+  uint32_t cache_size_;
+  uint32_t time_ = 0;
+  std::vector<uint32_t> timestamps_;
+};
+
+bool valid_triangle_list(std::span<const uint32_t> indices,
+                         size_t vertex_count) {
+  if (indices.size() % 3 != 0)
+    return false;
+  return std::all_of(indices.begin(), indices.end(),
+                     [vertex_count](uint32_t i) { return i < vertex_count; });
+}
+
+// Per-vertex triangle adjacency in CSR form
+struct Adjacency {
+  std::vector<uint32_t> offsets;   // vertex_count + 1
+  std::vector<uint32_t> triangles; // 3 per triangle
+};
+
+Adjacency build_adjacency(std::span<const uint32_t> indices,
+                          size_t vertex_count) {
+  Adjacency adjacency;
+  adjacency.offsets.assign(vertex_count + 1, 0);
+  for (uint32_t index : indices)
+    ++adjacency.offsets[index + 1];
+  for (size_t v = 0; v < vertex_count; ++v)
+    adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+  adjacency.triangles.resize(indices.size());
+  std::vector<uint32_t> cursor(adjacency.offsets.begin(),
+                               adjacency.offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); ++i)
+    adjacency.triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  return adjacency;
+}
+
+} // namespace
+
+float average_cache_miss_ratio(std::span<const uint32_t> indices,
+                               size_t vertex_count, uint32_t cache_size) {
+  if (indices.size() < 3 || !valid_triangle_list(indices, vertex_count))
+    return 0.0f;
+
+  FifoCache cache(vertex_count, cache_size);
+  size_t misses = 0;
+  for (uint32_t index : indices)
+    misses += cache.access(index) ? 1 : 0;
+  return static_cast<float>(misses) /
+         static_cast<float>(indices.size() / 3);
+}
+
+// ============================================================================
+// Tipsify
+// ============================================================================
+
+void optimize_vertex_cache(std::vector<uint32_t> &indices, size_t vertex_count,
+                           uint32_t cache_size) {
+  if (indices.size() < 6 || !valid_triangle_list(indices, vertex_count))
+    return;
+
+  const size_t triangle_count = indices.size() / 3;
+  const Adjacency adjacency = build_adjacency(indices, vertex_count);
+
+  std::vector<uint32_t> live(vertex_count);
+  for (size_t v = 0; v < vertex_count; ++v)
+    live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+  // cache_time[v]: stamp when v entered the cache; in cache while
+  // stamp - cache_time[v] < cache_size
+  std::vector<uint32_t> cache_time(vertex_count, 0);
+  uint32_t stamp = cache_size + 1;
+
+  std::vector<bool> emitted(triangle_count, false);
+  std::vector<uint32_t> dead_end;
+  dead_end.reserve(indices.size());
+  std::vector<uint32_t> candidates;
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+
+  size_t cursor = 0;
+  uint32_t fanning = indices[0];
+
+  while (fanning != kInvalidIndex) {
+    candidates.clear();
+
+    for (uint32_t k = adjacency.offsets[fanning];
+         k < adjacency.offsets[fanning + 1]; ++k) {
+      const uint32_t triangle = adjacency.triangles[k];
+      if (emitted[triangle])
+        continue;
+      emitted[triangle] = true;
+
+      for (int corner = 0; corner < 3; ++corner) {
+        const uint32_t v = indices[triangle * 3 + corner];
+        output.push_back(v);
+        dead_end.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (stamp - cache_time[v] > cache_size)
+          cache_time[v] = stamp++;
+      }
+    }
+
+    // Prefer the candidate that stays in cache longest while it still has
+    // triangles to fan
+    uint32_t best = kInvalidIndex;
+    int best_priority = -1;
+    for (uint32_t v : candidates) {
+      if (live[v] == 0)
+        continue;
+      int priority = 0;
+      if (stamp - cache_time[v] + 2 * live[v] <= cache_size)
+        priority = static_cast<int>(stamp - cache_time[v]);
+      if (priority > best_priority) {
+        best_priority = priority;
+        best = v;
+      }
+    }
+
+    if (best == kInvalidIndex) {
+      // Dead end: recently touched vertices first, then input order
+      while (!dead_end.empty()) {
+        const uint32_t v = dead_end.back();
+        dead_end.pop_back();
+        if (live[v] > 0) {
+          best = v;
+          break;
+        }
+      }
+      while (best == kInvalidIndex && cursor < vertex_count) {
+        if (live[cursor] > 0)
+          best = static_cast<uint32_t>(cursor);
+        ++cursor;
+      }
+    }
+
+    fanning = best;
+  }
+
+  indices.swap(output);
+}
+
+// ============================================================================
+// Overdraw
+// ============================================================================
+
+void optimize_overdraw(std::vector<uint32_t> &indices,
+                       std::span<const Vertex> vertices, uint32_t cache_size,
+                       float threshold) {
+  if (indices.size() < 6 || !valid_triangle_list(indices, vertices.size()))
+    return;
+
+  const size_t triangle_count = indices.size() / 3;
+
+  // Hard boundaries: triangles where every corner misses, i.e. where the
+  // cache ordering had to restart
+  std::vector<uint32_t> hard;
+  {
+    FifoCache cache(vertices.size(), cache_size);
+    for (size_t t = 0; t < triangle_count; ++t) {
+      int misses = 0;
+      for (int corner = 0; corner < 3; ++corner)
+        misses += cache.access(indices[t * 3 + corner]) ? 1 : 0;
+      if (t == 0 || misses == 3)
+        hard.push_back(static_cast<uint32_t>(t));
+    }
+    hard.push_back(static_cast<uint32_t>(triangle_count));
+  }
+
+  // Soft boundaries: split a hard run once its prefix is as cache-friendly
+  // as the whole run (within threshold), restarting the cache at each cut
+  std::vector<uint32_t> clusters;
+  {
+    FifoCache cache(vertices.size(), cache_size);
+    for (size_t h = 0; h + 1 < hard.size(); ++h) {
+      const uint32_t begin = hard[h];
+      const uint32_t end = hard[h + 1];
+
+      cache.reset();
+      size_t run_misses = 0;
+      for (uint32_t t = begin; t < end; ++t)
+        for (int corner = 0; corner < 3; ++corner)
+          run_misses += cache.access(indices[t * 3 + corner]) ? 1 : 0;
+      const float run_acmr =
+          static_cast<float>(run_misses) / static_cast<float>(end - begin);
+
+      cache.reset();
+      clusters.push_back(begin);
+      size_t misses = 0;
+      size_t count = 0;
+      for (uint32_t t = begin; t < end; ++t) {
+        for (int corner = 0; corner < 3; ++corner)
+          misses += cache.access(indices[t * 3 + corner]) ? 1 : 0;
+        ++count;
+        if (t + 1 < end &&
+            static_cast<float>(misses) / static_cast<float>(count) <=
+                run_acmr * threshold) {
+          clusters.push_back(t + 1);
+          cache.reset();
+          misses = 0;
+          count = 0;
+        }
+      }
+    }
+    clusters.push_back(static_cast<uint32_t>(triangle_count));
+  }
+
+  const size_t cluster_count = clusters.size() - 1;
+  if (cluster_count < 2)
+    return;
+
+  // Mesh centroid, area weighted
+  double mesh_center[3] = {0.0, 0.0, 0.0};
+  double mesh_area = 0.0;
+
+  struct ClusterInfo {
+    float centroid[3] = {0.0f, 0.0f, 0.0f};
+    float normal[3] = {0.0f, 0.0f, 0.0f};
+    float sort_key = 0.0f;
+  };
+  std::vector<ClusterInfo> info(cluster_count);
+
+  for (size_t c = 0; c < cluster_count; ++c) {
+    double centroid[3] = {0.0, 0.0, 0.0};
+    double normal[3] = {0.0, 0.0, 0.0};
+    double area_sum = 0.0;
+
+    for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+      const Vec3 &a = vertices[indices[t * 3 + 0]].position;
+      const Vec3 &b = vertices[indices[t * 3 + 1]].position;
+      const Vec3 &p = vertices[indices[t * 3 + 2]].position;
+
+      const float e1[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+      const float e2[3] = {p.x - a.x, p.y - a.y, p.z - a.z};
+      const double n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                           e1[2] * e2[0] - e1[0] * e2[2],
+                           e1[0] * e2[1] - e1[1] * e2[0]};
+      const double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+      centroid[0] += (a.x + b.x + p.x) * area / 3.0;
+      centroid[1] += (a.y + b.y + p.y) * area / 3.0;
+      centroid[2] += (a.z + b.z + p.z) * area / 3.0;
+      normal[0] += n[0];
+      normal[1] += n[1];
+      normal[2] += n[2];
+      area_sum += area;
+    }
+
+    mesh_center[0] += centroid[0];
+    mesh_center[1] += centroid[1];
+    mesh_center[2] += centroid[2];
+    mesh_area += area_sum;
+
+    const double inv_area = area_sum > 0.0 ? 1.0 / area_sum : 0.0;
+    const double normal_length = std::sqrt(
+        normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    const double inv_normal = normal_length > 0.0 ? 1.0 / normal_length : 0.0;
+    for (int k = 0; k < 3; ++k) {
+      info[c].centroid[k] = static_cast<float>(centroid[k] * inv_area);
+      info[c].normal[k] = static_cast<float>(normal[k] * inv_normal);
+    }
+  }
+
+  const double inv_mesh_area = mesh_area > 0.0 ? 1.0 / mesh_area : 0.0;
+  for (ClusterInfo &cluster : info) {
+    float key = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+      const float offset = cluster.centroid[k] -
+                           static_cast<float>(mesh_center[k] * inv_mesh_area);
+      key += offset * cluster.normal[k];
+    }
+    cluster.sort_key = key;
+  }
+
+  // Outward-facing clusters far from the centre are likely occluders
+  std::vector<uint32_t> order(cluster_count);
+  for (size_t c = 0; c < cluster_count; ++c)
+    order[c] = static_cast<uint32_t>(c);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return info[a].sort_key > info[b].sort_key;
+  });
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+  for (uint32_t c : order) {
+    output.insert(output.end(), indices.begin() + clusters[c] * 3,
+                  indices.begin() + clusters[c + 1] * 3);
+  }
+  indices.swap(output);
+}
+
+// ============================================================================
+// Vertex fetch
+// ============================================================================
+
+size_t optimize_vertex_fetch(std::vector<Vertex> &vertices,
+                             std::vector<uint32_t> &indices) {
+  if (!valid_triangle_list(indices, vertices.size()))
+    return vertices.size();
+
+  std::vector<uint32_t> remap(vertices.size(), kInvalidIndex);
+  std::vector<Vertex> reordered;
+  reordered.reserve(vertices.size());
+
+  for (uint32_t &index : indices) {
+    if (remap[index] == kInvalidIndex) {
+      remap[index] = static_cast<uint32_t>(reordered.size());
+      reordered.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+
+  vertices.swap(reordered);
+  return vertices.size();
+}
+
+OptimizeStats optimize_mesh(std::vector<Vertex> &vertices,
+                            std::vector<uint32_t> &indices,
+                            uint32_t cache_size) {
+  if (!valid_triangle_list(indices, vertices.size())) {
+    std::cerr << "mesh_optimizer::optimize_mesh(): index buffer is not a "
+                 "valid triangle list, skipping"
+              << std::endl;
+    return {};
+  }
+
+  OptimizeStats stats;
+  stats.acmr_before =
+      average_cache_miss_ratio(indices, vertices.size(), cache_size);
+  optimize_vertex_cache(indices, vertices.size(), cache_size);
+  optimize_overdraw(indices, vertices, cache_size);
+  optimize_vertex_fetch(vertices, indices);
+  stats.acmr_after =
+      average_cache_miss_ratio(indices, vertices.size(), cache_size);
+  return stats;
+}
+
+} // namespace pixel::renderer3d::mesh_optimizer
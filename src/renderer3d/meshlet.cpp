@@ -0,0 +1,499 @@
+#include "pixel/renderer3d/meshlet.hpp"
+#include "pixel/renderer3d/shader_archive.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <string_view>
+
+namespace pixel::renderer3d {
+
+namespace {
+
+constexpr uint32_t kCullGroupSize = 64;
+
+// Matches MeshletGPU in meshlet_cull.comp (std430)
+struct MeshletGPU {
+  float sphere[4];    // xyz center, w radius
+  float cone_apex[4]; // xyz apex, w cutoff
+  float cone_axis[4];
+  uint32_t range[4]; // x first index, y index count
+};
+static_assert(sizeof(MeshletGPU) == 64, "MeshletGPU must match the shader");
+
+// Matches MeshletCullUniforms in meshlet_cull.comp (std140)
+struct MeshletCullUniformsGPU {
+  glm::mat4 model;
+  glm::vec4 eye_object; // xyz camera in object space, w max model scale
+  glm::vec4 frustum_planes[6];
+  glm::uvec4 info; // x meshlet count
+};
+static_assert(sizeof(MeshletCullUniformsGPU) == 192,
+              "MeshletCullUniformsGPU must match the shader");
+
+// Matches DrawArgsBuffer in meshlet_cull.comp and MeshletDrawArgs in
+// shaders.metal
+struct MeshletDrawArgsGPU {
+  rhi::DrawIndexedIndirectArgs draw;
+  uint32_t visible_meshlets;
+};
+static_assert(sizeof(MeshletDrawArgsGPU) == 24,
+              "MeshletDrawArgsGPU must match the shader");
+static_assert(offsetof(MeshletDrawArgsGPU, draw.indexCount) == 0,
+              "indexCount must be the indirect index count");
+static_assert(offsetof(MeshletDrawArgsGPU, visible_meshlets) == 20,
+              "visible_meshlets must follow the indirect arguments");
+
+glm::vec3 to_glm(const Vec3 &v) { return glm::vec3(v.x, v.y, v.z); }
+
+float max_axis_scale(const glm::mat4 &model) {
+  return std::sqrt(std::max({glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                             glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                             glm::dot(glm::vec3(model[2]), glm::vec3(model[2]))}));
+}
+
+MeshletBounds compute_bounds(const Meshlet &meshlet, const MeshletData &data,
+                             std::span<const Vertex> vertices) {
+  MeshletBounds bounds;
+
+  glm::vec3 min_pos(std::numeric_limits<float>::max());
+  glm::vec3 max_pos(std::numeric_limits<float>::lowest());
+  for (uint32_t i = 0; i < meshlet.vertex_count; ++i) {
+    const glm::vec3 p =
+        to_glm(vertices[data.vertices[meshlet.vertex_offset + i]].position);
+    min_pos = glm::min(min_pos, p);
+    max_pos = glm::max(max_pos, p);
+  }
+  const glm::vec3 center = (min_pos + max_pos) * 0.5f;
+  float radius_sq = 0.0f;
+  for (uint32_t i = 0; i < meshlet.vertex_count; ++i) {
+    const glm::vec3 d =
+        to_glm(vertices[data.vertices[meshlet.vertex_offset + i]].position) -
+        center;
+    radius_sq = std::max(radius_sq, glm::dot(d, d));
+  }
+  bounds.center = Vec3(center.x, center.y, center.z);
+  bounds.radius = std::sqrt(radius_sq);
+
+  // Normal cone over the face normals (not the vertex normals, which
+  // backface culling does not look at)
+  std::array<glm::vec3, kMeshletMaxTriangles> normals_storage;
+  std::vector<glm::vec3> normals_heap;
+  glm::vec3 *normals = normals_storage.data();
+  if (meshlet.triangle_count > normals_storage.size()) {
+    normals_heap.resize(meshlet.triangle_count);
+    normals = normals_heap.data();
+  }
+  std::array<glm::vec3, kMeshletMaxTriangles> corners_storage;
+  std::vector<glm::vec3> corners_heap;
+  glm::vec3 *corners = corners_storage.data();
+  if (meshlet.triangle_count > corners_storage.size()) {
+    corners_heap.resize(meshlet.triangle_count);
+    corners = corners_heap.data();
+  }
+
+  uint32_t face_count = 0;
+  glm::vec3 axis_sum(0.0f);
+  for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+    const uint8_t *tri = &data.triangles[meshlet.triangle_offset + t * 3];
+    const glm::vec3 p0 = to_glm(
+        vertices[data.vertices[meshlet.vertex_offset + tri[0]]].position);
+    const glm::vec3 p1 = to_glm(
+        vertices[data.vertices[meshlet.vertex_offset + tri[1]]].position);
+    const glm::vec3 p2 = to_glm(
+        vertices[data.vertices[meshlet.vertex_offset + tri[2]]].position);
+    const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+    const float area = glm::length(n);
+    if (area <= 0.0f)
+      continue;
+    normals[face_count] = n / area;
+    corners[face_count] = p0;
+    axis_sum += normals[face_count];
+    ++face_count;
+  }
+
+  const float axis_length = glm::length(axis_sum);
+  if (face_count == 0 || axis_length <= 0.0f)
+    return bounds;
+  const glm::vec3 axis = axis_sum / axis_length;
+
+  float min_dp = 1.0f;
+  for (uint32_t i = 0; i < face_count; ++i)
+    min_dp = std::min(min_dp, glm::dot(axis, normals[i]));
+  // Cones wider than ~84 degrees cull too rarely to be worth the test
+  if (min_dp <= 0.1f)
+    return bounds;
+
+  // Move the apex back along the axis until every face plane is in front of
+  // it, so the cone test is conservative for cameras close to the cluster
+  float max_t = 0.0f;
+  for (uint32_t i = 0; i < face_count; ++i) {
+    const float dc = glm::dot(center - corners[i], normals[i]);
+    const float dn = glm::dot(axis, normals[i]);
+    max_t = std::max(max_t, dc / dn);
+  }
+  const glm::vec3 apex = center - axis * max_t;
+
+  bounds.cone_apex = Vec3(apex.x, apex.y, apex.z);
+  bounds.cone_axis = Vec3(axis.x, axis.y, axis.z);
+  bounds.cone_cutoff = std::sqrt(1.0f - min_dp * min_dp);
+  return bounds;
+}
+
+} // namespace
+
+// ============================================================================
+// Clustering
+// ============================================================================
+
+MeshletData build_meshlets(std::span<const Vertex> vertices,
+                           std::span<const uint32_t> indices,
+                           uint32_t max_vertices, uint32_t max_triangles) {
+  MeshletData data;
+  if (indices.size() % 3 != 0 || max_vertices < 3 || max_vertices > 256 ||
+      max_triangles == 0)
+    return data;
+  for (uint32_t index : indices) {
+    if (index >= vertices.size())
+      return data;
+  }
+
+  // Mesh vertex -> local slot in the open meshlet, -1 when absent
+  std::vector<int16_t> local(vertices.size(), -1);
+  Meshlet current{0, 0, 0, 0};
+
+  auto finish = [&]() {
+    if (current.triangle_count == 0)
+      return;
+    for (uint32_t i = 0; i < current.vertex_count; ++i)
+      local[data.vertices[current.vertex_offset + i]] = -1;
+    data.meshlets.push_back(current);
+    current = Meshlet{static_cast<uint32_t>(data.vertices.size()),
+                      static_cast<uint32_t>(data.triangles.size()), 0, 0};
+  };
+
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const uint32_t a = indices[i];
+    const uint32_t b = indices[i + 1];
+    const uint32_t c = indices[i + 2];
+    const uint32_t new_vertices = (local[a] < 0) +
+                                  (local[b] < 0 && b != a) +
+                                  (local[c] < 0 && c != a && c != b);
+    if (current.vertex_count + new_vertices > max_vertices ||
+        current.triangle_count + 1 > max_triangles)
+      finish();
+
+    for (uint32_t v : {a, b, c}) {
+      if (local[v] < 0) {
+        local[v] = static_cast<int16_t>(current.vertex_count++);
+        data.vertices.push_back(v);
+      }
+      data.triangles.push_back(static_cast<uint8_t>(local[v]));
+    }
+    ++current.triangle_count;
+  }
+  finish();
+
+  data.bounds.reserve(data.meshlets.size());
+  for (const Meshlet &meshlet : data.meshlets)
+    data.bounds.push_back(compute_bounds(meshlet, data, vertices));
+  return data;
+}
+
+bool meshlet_visible(const MeshletBounds &bounds, const glm::mat4 &model,
+                     const FrustumPlanes &world_planes,
+                     const glm::vec3 &eye_object) {
+  // Backface cone; face orientation survives any affine transform, so the
+  // test runs in object space
+  if (bounds.cone_cutoff < 1.0f) {
+    const glm::vec3 to_apex = to_glm(bounds.cone_apex) - eye_object;
+    const float distance = glm::length(to_apex);
+    if (distance > 0.0f &&
+        glm::dot(to_apex / distance, to_glm(bounds.cone_axis)) >=
+            bounds.cone_cutoff)
+      return false;
+  }
+
+  const glm::vec3 center =
+      glm::vec3(model * glm::vec4(to_glm(bounds.center), 1.0f));
+  const float radius = bounds.radius * max_axis_scale(model);
+  for (const glm::vec4 &plane : world_planes) {
+    if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+      return false;
+  }
+  return true;
+}
+
+// ============================================================================
+// MeshletMesh
+// ============================================================================
+
+std::unique_ptr<MeshletMesh> MeshletMesh::create(rhi::Device *device,
+                                                 const Mesh &mesh) {
+  if (!device || !mesh.has_cpu_data()) {
+    std::cerr << "MeshletMesh::create(): mesh has no CPU geometry (create it "
+                 "with keep_cpu_data or call reload_cpu_data())"
+              << std::endl;
+    return nullptr;
+  }
+
+  auto meshlet_mesh = std::unique_ptr<MeshletMesh>(new MeshletMesh());
+  meshlet_mesh->device_ = device;
+  meshlet_mesh->source_ = &mesh;
+  meshlet_mesh->data_ = build_meshlets(mesh.vertices(), mesh.indices());
+  const MeshletData &data = meshlet_mesh->data_;
+  if (data.meshlets.empty()) {
+    std::cerr << "MeshletMesh::create(): mesh is not a valid triangle list"
+              << std::endl;
+    return nullptr;
+  }
+
+  std::vector<MeshletGPU> gpu_meshlets(data.meshlets.size());
+  auto &indices = meshlet_mesh->meshlet_indices_;
+  auto &first_index = meshlet_mesh->meshlet_first_index_;
+  indices.reserve(mesh.index_count());
+  first_index.reserve(data.meshlets.size());
+  for (size_t m = 0; m < data.meshlets.size(); ++m) {
+    const Meshlet &meshlet = data.meshlets[m];
+    const MeshletBounds &bounds = data.bounds[m];
+    first_index.push_back(static_cast<uint32_t>(indices.size()));
+    for (uint32_t t = 0; t < meshlet.triangle_count * 3; ++t) {
+      indices.push_back(
+          data.vertices[meshlet.vertex_offset +
+                        data.triangles[meshlet.triangle_offset + t]]);
+    }
+
+    MeshletGPU &gpu = gpu_meshlets[m];
+    gpu = MeshletGPU{{bounds.center.x, bounds.center.y, bounds.center.z,
+                      bounds.radius},
+                     {bounds.cone_apex.x, bounds.cone_apex.y,
+                      bounds.cone_apex.z, bounds.cone_cutoff},
+                     {bounds.cone_axis.x, bounds.cone_axis.y,
+                      bounds.cone_axis.z, 0.0f},
+                     {first_index.back(), meshlet.triangle_count * 3, 0, 0}};
+  }
+
+  const rhi::Caps &caps = device->caps();
+  if (caps.computeStorageBuffers && caps.indirectDraw &&
+      meshlet_mesh->initialize_gpu_resources()) {
+    auto *cmd = device->getImmediate();
+    cmd->begin();
+    cmd->copyToBuffer(meshlet_mesh->gpu_.meshlets, 0,
+                      std::as_bytes(std::span(gpu_meshlets)));
+    cmd->copyToBuffer(meshlet_mesh->gpu_.meshlet_indices, 0,
+                      std::as_bytes(std::span(indices)));
+    cmd->end();
+  }
+
+  std::cout << "MeshletMesh::create(): " << data.meshlets.size()
+            << " meshlets for " << mesh.index_count() / 3 << " triangles ("
+            << (meshlet_mesh->gpu_.initialized ? "GPU" : "CPU")
+            << " culling)" << std::endl;
+  return meshlet_mesh;
+}
+
+MeshletMesh::~MeshletMesh() {
+  // Buffers and pipelines are released with the RHI device
+}
+
+bool MeshletMesh::initialize_gpu_resources() {
+  GPUResources resources{};
+
+  std::vector<uint8_t> compute_bytes;
+  try {
+    compute_bytes =
+        load_spirv_bytecode("assets/shaders/spirv/meshlet_cull.comp.spv");
+  } catch (const std::exception &e) {
+    std::cerr << "Failed to load meshlet culling shader: " << e.what()
+              << std::endl;
+    return false;
+  }
+  if (compute_bytes.empty() ||
+      (compute_bytes.size() % sizeof(uint32_t)) != 0) {
+    std::cerr << "Meshlet culling shader bytecode is invalid" << std::endl;
+    return false;
+  }
+
+  std::span<const uint32_t> shader_words(
+      reinterpret_cast<const uint32_t *>(compute_bytes.data()),
+      compute_bytes.size() / sizeof(uint32_t));
+  resources.reflection = reflect_spirv(shader_words, ShaderStage::Compute);
+  resources.compute_shader = device_->createShaderFromBytecode(
+      "cs_meshlet_cull",
+      std::span<const uint8_t>(compute_bytes.data(), compute_bytes.size()));
+  if (resources.compute_shader.id == 0)
+    return false;
+
+  rhi::PipelineDesc pipeline_desc{};
+  pipeline_desc.cs = resources.compute_shader;
+  resources.compute_pipeline = device_->createPipeline(pipeline_desc);
+  if (resources.compute_pipeline.id == 0)
+    return false;
+
+  auto create_buffer = [&](size_t size, rhi::BufferUsage usage) {
+    rhi::BufferDesc desc{};
+    desc.size = size;
+    desc.usage = usage;
+    desc.hostVisible = true;
+    return device_->createBuffer(desc);
+  };
+  resources.meshlets = create_buffer(
+      data_.meshlets.size() * sizeof(MeshletGPU), rhi::BufferUsage::Storage);
+  resources.meshlet_indices =
+      create_buffer(meshlet_indices_.size() * sizeof(uint32_t),
+                    rhi::BufferUsage::Storage);
+  if (resources.meshlets.id == 0 || resources.meshlet_indices.id == 0)
+    return false;
+
+  resources.initialized = true;
+  gpu_ = resources;
+  return true;
+}
+
+bool MeshletMesh::allocate_slot(CullSlot &slot) const {
+  // Host-visible so per-frame uploads are plain writes that do not interrupt
+  // the render pass
+  auto create_buffer = [&](size_t size, rhi::BufferUsage usage) {
+    rhi::BufferDesc desc{};
+    desc.size = size;
+    desc.usage = usage;
+    desc.hostVisible = true;
+    return device_->createBuffer(desc);
+  };
+  slot.visible_indices =
+      create_buffer(meshlet_indices_.size() * sizeof(uint32_t),
+                    rhi::BufferUsage::Storage | rhi::BufferUsage::Index);
+  if (slot.visible_indices.id == 0)
+    return false;
+  if (!gpu_.initialized)
+    return true;
+
+  slot.draw_args = create_buffer(sizeof(MeshletDrawArgsGPU),
+                                 rhi::BufferUsage::Storage |
+                                     rhi::BufferUsage::Indirect);
+  slot.uniform_buffer = create_buffer(sizeof(MeshletCullUniformsGPU),
+                                      rhi::BufferUsage::Uniform);
+  return slot.draw_args.id != 0 && slot.uniform_buffer.id != 0;
+}
+
+std::optional<uint32_t>
+MeshletMesh::prepare_cull(const glm::mat4 &model,
+                          const FrustumPlanes &world_planes,
+                          const glm::vec3 &eye_world) {
+  std::vector<CullSlot> &slots = frame_slots_[frame_];
+  if (slots_used_ == slots.size()) {
+    CullSlot slot;
+    if (!allocate_slot(slot)) {
+      std::cerr << "MeshletMesh::prepare_cull(): failed to allocate cull "
+                   "buffers"
+                << std::endl;
+      return std::nullopt;
+    }
+    slots.push_back(slot);
+  }
+  const uint32_t slot_index = slots_used_++;
+  CullSlot &slot = slots[slot_index];
+  const glm::vec3 eye_object =
+      glm::vec3(glm::inverse(model) * glm::vec4(eye_world, 1.0f));
+
+  if (!gpu_.initialized) {
+    cull_cpu(slot, model, world_planes, eye_object);
+    return slot_index;
+  }
+
+  auto *cmd = device_->getImmediate();
+
+  MeshletCullUniformsGPU uniforms{};
+  uniforms.model = model;
+  uniforms.eye_object = glm::vec4(eye_object, max_axis_scale(model));
+  std::copy(world_planes.begin(), world_planes.end(),
+            uniforms.frustum_planes);
+  uniforms.info =
+      glm::uvec4(static_cast<uint32_t>(data_.meshlets.size()), 0u, 0u, 0u);
+  cmd->copyToBuffer(slot.uniform_buffer, 0,
+                    std::as_bytes(std::span(&uniforms, 1)));
+
+  // The shader adds the surviving indices to draw.indexCount; only
+  // base_vertex carries over from the source mesh since the compacted
+  // indices are mesh-relative
+  MeshletDrawArgsGPU args{};
+  args.draw.baseVertex = source_->format().base_vertex;
+  cmd->copyToBuffer(slot.draw_args, 0, std::as_bytes(std::span(&args, 1)));
+  return slot_index;
+}
+
+void MeshletMesh::record_culls(rhi::CmdList *cmd) {
+  if (!gpu_.initialized || slots_recorded_ == slots_used_)
+    return;
+
+  cmd->setComputePipeline(gpu_.compute_pipeline);
+  auto resolve_binding = [&](std::string_view name, ShaderBlockType type,
+                             uint32_t fallback) {
+    return gpu_.reflection.binding_for_block(name, type).value_or(fallback);
+  };
+  const uint32_t uniform_binding =
+      resolve_binding("MeshletCullUniforms", ShaderBlockType::Uniform, 0);
+  const uint32_t visible_binding =
+      resolve_binding("VisibleIndexBuffer", ShaderBlockType::Storage, 3);
+  const uint32_t args_binding =
+      resolve_binding("DrawArgsBuffer", ShaderBlockType::Storage, 4);
+  cmd->setStorageBuffer(
+      resolve_binding("MeshletBuffer", ShaderBlockType::Storage, 1),
+      gpu_.meshlets);
+  cmd->setStorageBuffer(
+      resolve_binding("MeshletIndexBuffer", ShaderBlockType::Storage, 2),
+      gpu_.meshlet_indices);
+
+  // Placements write disjoint slots, so the dispatches need no barriers
+  // between them
+  const uint32_t group_count =
+      (static_cast<uint32_t>(data_.meshlets.size()) + kCullGroupSize - 1) /
+      kCullGroupSize;
+  for (uint32_t i = slots_recorded_; i < slots_used_; ++i) {
+    const CullSlot &slot = frame_slots_[frame_][i];
+    cmd->setUniformBuffer(uniform_binding, slot.uniform_buffer);
+    cmd->setStorageBuffer(visible_binding, slot.visible_indices);
+    cmd->setStorageBuffer(args_binding, slot.draw_args);
+    cmd->dispatch(group_count, 1, 1);
+  }
+  slots_recorded_ = slots_used_;
+}
+
+void MeshletMesh::next_frame() {
+  frame_ = (frame_ + 1) % kFramesInFlight;
+  slots_used_ = 0;
+  slots_recorded_ = 0;
+  visible_index_count_ = 0;
+  visible_meshlet_count_ = 0;
+}
+
+uint32_t MeshletMesh::cull_cpu(CullSlot &slot, const glm::mat4 &model,
+                               const FrustumPlanes &planes,
+                               const glm::vec3 &eye_object) {
+  cpu_visible_indices_.clear();
+  for (size_t m = 0; m < data_.meshlets.size(); ++m) {
+    if (!meshlet_visible(data_.bounds[m], model, planes, eye_object))
+      continue;
+    const uint32_t first = meshlet_first_index_[m];
+    const uint32_t count = data_.meshlets[m].triangle_count * 3;
+    cpu_visible_indices_.insert(cpu_visible_indices_.end(),
+                                meshlet_indices_.begin() + first,
+                                meshlet_indices_.begin() + first + count);
+    ++visible_meshlet_count_;
+  }
+
+  slot.index_count = static_cast<uint32_t>(cpu_visible_indices_.size());
+  visible_index_count_ += slot.index_count;
+  if (slot.index_count > 0) {
+    device_->getImmediate()->copyToBuffer(
+        slot.visible_indices, 0,
+        std::as_bytes(std::span(cpu_visible_indices_)));
+  }
+  return slot.index_count;
+}
+
+} // namespace pixel::renderer3d
@@ -0,0 +1,450 @@
+// src/renderer3d/picking.cpp - Ray picking against registered meshes
+#include "pixel/renderer3d/picking.hpp"
+#include "pixel/renderer3d/lod.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace pixel::renderer3d {
+
+namespace {
+
+// Same composition as Renderer::draw_mesh()
+glm::mat4 make_model_matrix(const Vec3 &position, const Vec3 &rotation,
+                            const Vec3 &scale) {
+  glm::mat4 model = glm::mat4(1.0f);
+  model = glm::translate(model, glm::vec3(position.x, position.y, position.z));
+  model = glm::rotate(model, rotation.z, glm::vec3(0, 0, 1));
+  model = glm::rotate(model, rotation.y, glm::vec3(0, 1, 0));
+  model = glm::rotate(model, rotation.x, glm::vec3(1, 0, 0));
+  model = glm::scale(model, glm::vec3(scale.x, scale.y, scale.z));
+  return model;
+}
+
+// Double-sided Moller-Trumbore; t is in units of `dir`
+bool intersect_triangle(const glm::vec3 &origin, const glm::vec3 &dir,
+                        const glm::vec3 &v0, const glm::vec3 &v1,
+                        const glm::vec3 &v2, float &t_out) {
+  constexpr float kEpsilon = 1e-8f;
+  const glm::vec3 e1 = v1 - v0;
+  const glm::vec3 e2 = v2 - v0;
+  const glm::vec3 p = glm::cross(dir, e2);
+  const float det = glm::dot(e1, p);
+  if (std::abs(det) < kEpsilon)
+    return false;
+  const float inv_det = 1.0f / det;
+
+  const glm::vec3 s = origin - v0;
+  const float u = glm::dot(s, p) * inv_det;
+  if (u < 0.0f || u > 1.0f)
+    return false;
+
+  const glm::vec3 q = glm::cross(s, e1);
+  const float v = glm::dot(dir, q) * inv_det;
+  if (v < 0.0f || u + v > 1.0f)
+    return false;
+
+  t_out = glm::dot(e2, q) * inv_det;
+  return t_out >= 0.0f;
+}
+
+// Slab test; returns the entry distance, or +inf when the box is missed
+// within [0, max_t]
+float ray_enter_aabb(const glm::vec3 &origin, const glm::vec3 &inv_dir,
+                     float max_t, const glm::vec3 &min, const glm::vec3 &max) {
+  const glm::vec3 t0 = (min - origin) * inv_dir;
+  const glm::vec3 t1 = (max - origin) * inv_dir;
+  const glm::vec3 t_small = glm::min(t0, t1);
+  const glm::vec3 t_big = glm::max(t0, t1);
+  const float t_enter = std::max({t_small.x, t_small.y, t_small.z, 0.0f});
+  const float t_exit = std::min({t_big.x, t_big.y, t_big.z, max_t});
+  return t_enter <= t_exit ? t_enter : std::numeric_limits<float>::infinity();
+}
+
+glm::vec3 to_glm(const Vec3 &v) { return glm::vec3(v.x, v.y, v.z); }
+
+} // namespace
+
+// ============================================================================
+// TriangleBVH Implementation
+// ============================================================================
+
+void TriangleBVH::clear() {
+  nodes_.clear();
+  corners_.clear();
+  triangle_index_.clear();
+}
+
+void TriangleBVH::build(const std::vector<Vertex> &vertices,
+                        const std::vector<uint32_t> &indices) {
+  clear();
+  const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+  if (triangle_count == 0)
+    return;
+
+  std::vector<uint32_t> order(triangle_count);
+  std::vector<glm::vec3> centroids(triangle_count);
+  for (uint32_t tri = 0; tri < triangle_count; ++tri) {
+    order[tri] = tri;
+    centroids[tri] = (to_glm(vertices[indices[tri * 3]].position) +
+                      to_glm(vertices[indices[tri * 3 + 1]].position) +
+                      to_glm(vertices[indices[tri * 3 + 2]].position)) *
+                     (1.0f / 3.0f);
+  }
+
+  // A median split tree has at most 2 * ceil(n / kLeafSize) - 1 nodes
+  nodes_.reserve(2 * ((triangle_count + kLeafSize - 1) / kLeafSize));
+
+  struct Range {
+    uint32_t node;
+    uint32_t begin;
+    uint32_t end;
+  };
+  std::vector<Range> pending;
+  nodes_.emplace_back();
+  pending.push_back({0, 0, triangle_count});
+
+  while (!pending.empty()) {
+    const Range range = pending.back();
+    pending.pop_back();
+
+    glm::vec3 box_min(std::numeric_limits<float>::max());
+    glm::vec3 box_max(-std::numeric_limits<float>::max());
+    glm::vec3 centroid_min = box_min;
+    glm::vec3 centroid_max = box_max;
+    for (uint32_t i = range.begin; i < range.end; ++i) {
+      const uint32_t tri = order[i];
+      for (uint32_t corner = 0; corner < 3; ++corner) {
+        const glm::vec3 p =
+            to_glm(vertices[indices[tri * 3 + corner]].position);
+        box_min = glm::min(box_min, p);
+        box_max = glm::max(box_max, p);
+      }
+      centroid_min = glm::min(centroid_min, centroids[tri]);
+      centroid_max = glm::max(centroid_max, centroids[tri]);
+    }
+    nodes_[range.node].min = box_min;
+    nodes_[range.node].max = box_max;
+
+    const uint32_t count = range.end - range.begin;
+    if (count <= kLeafSize) {
+      nodes_[range.node].first = range.begin;
+      nodes_[range.node].count = count;
+      continue;
+    }
+
+    const glm::vec3 extent = centroid_max - centroid_min;
+    int axis = 0;
+    if (extent.y > extent.x)
+      axis = 1;
+    if (extent.z > extent[axis])
+      axis = 2;
+    const uint32_t mid = range.begin + count / 2;
+    std::nth_element(order.begin() + range.begin, order.begin() + mid,
+                     order.begin() + range.end,
+                     [&](uint32_t a, uint32_t b) {
+                       return centroids[a][axis] < centroids[b][axis];
+                     });
+
+    // Children are allocated as a pair so the node only stores the left one
+    const uint32_t left = static_cast<uint32_t>(nodes_.size());
+    const uint32_t right = left + 1;
+    nodes_.emplace_back();
+    nodes_.emplace_back();
+    nodes_[range.node].first = left;
+    nodes_[range.node].count = 0;
+    pending.push_back({right, mid, range.end});
+    pending.push_back({left, range.begin, mid});
+  }
+
+  corners_.resize(static_cast<size_t>(triangle_count) * 3);
+  triangle_index_.resize(triangle_count);
+  for (uint32_t i = 0; i < triangle_count; ++i) {
+    const uint32_t tri = order[i];
+    for (uint32_t corner = 0; corner < 3; ++corner) {
+      corners_[i * 3 + corner] =
+          to_glm(vertices[indices[tri * 3 + corner]].position);
+    }
+    triangle_index_[i] = tri * 3;
+  }
+}
+
+bool TriangleBVH::raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                          float max_t, float &t, uint32_t &triangle) const {
+  if (nodes_.empty())
+    return false;
+
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  const glm::vec3 inv_dir(direction.x != 0.0f ? 1.0f / direction.x : inf,
+                          direction.y != 0.0f ? 1.0f / direction.y : inf,
+                          direction.z != 0.0f ? 1.0f / direction.z : inf);
+
+  float best_t = max_t;
+  bool hit = false;
+
+  // Median splits keep the depth near log2(n / kLeafSize)
+  std::array<uint32_t, 64> stack;
+  size_t top = 0;
+  if (ray_enter_aabb(origin, inv_dir, best_t, nodes_[0].min, nodes_[0].max) ==
+      inf)
+    return false;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    const Node &node = nodes_[stack[--top]];
+
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        float tri_t = 0.0f;
+        if (intersect_triangle(origin, direction, corners_[i * 3],
+                               corners_[i * 3 + 1], corners_[i * 3 + 2],
+                               tri_t) &&
+            tri_t <= best_t) {
+          best_t = tri_t;
+          triangle = triangle_index_[i];
+          hit = true;
+        }
+      }
+      continue;
+    }
+
+    // Visit the nearer child first so its hits prune the farther one
+    uint32_t near_child = node.first;
+    uint32_t far_child = node.first + 1;
+    float near_t = ray_enter_aabb(origin, inv_dir, best_t,
+                                  nodes_[near_child].min,
+                                  nodes_[near_child].max);
+    float far_t = ray_enter_aabb(origin, inv_dir, best_t,
+                                 nodes_[far_child].min, nodes_[far_child].max);
+    if (far_t < near_t) {
+      std::swap(near_child, far_child);
+      std::swap(near_t, far_t);
+    }
+    if (far_t != inf && top < stack.size())
+      stack[top++] = far_child;
+    if (near_t != inf && top < stack.size())
+      stack[top++] = near_child;
+  }
+
+  if (hit)
+    t = best_t;
+  return hit;
+}
+
+// ============================================================================
+// PickingScene Implementation
+// ============================================================================
+
+void PickingScene::set_transform(Pickable &pickable, const Vec3 &position,
+                                 const Vec3 &rotation, const Vec3 &scale,
+                                 Vec3 &world_center,
+                                 float &world_radius) const {
+  pickable.model = make_model_matrix(position, rotation, scale);
+  pickable.inverse_model = glm::inverse(pickable.model);
+
+  const MeshData &bounds = meshes_.at(pickable.mesh);
+  const glm::vec4 center = pickable.model * glm::vec4(bounds.center, 1.0f);
+  const float max_scale = std::max(
+      {std::abs(scale.x), std::abs(scale.y), std::abs(scale.z)});
+  world_center = Vec3(center.x, center.y, center.z);
+  world_radius = bounds.radius * max_scale;
+}
+
+bool PickingScene::acquire_mesh(const Mesh &mesh, const char *caller) {
+  auto it = meshes_.find(&mesh);
+  if (it != meshes_.end()) {
+    ++it->second.users;
+    return true;
+  }
+
+  if (mesh.vertices().empty() || mesh.indices().size() < 3) {
+    std::cerr << "PickingScene::" << caller
+              << "(): mesh has no CPU geometry (create it with keep_cpu_data "
+                 "or call reload_cpu_data())"
+              << std::endl;
+    return false;
+  }
+
+  MeshData &data = meshes_[&mesh];
+  data.center = to_glm(mesh.bounds_center());
+  data.radius = mesh.bounds_radius();
+  data.bvh.build(mesh.vertices(), mesh.indices());
+  data.users = 1;
+  return true;
+}
+
+void PickingScene::release_mesh(const Mesh *mesh) {
+  auto it = meshes_.find(mesh);
+  if (it != meshes_.end() && --it->second.users == 0)
+    meshes_.erase(it);
+}
+
+PickID PickingScene::add(const Mesh &mesh, const Vec3 &position,
+                         const Vec3 &rotation, const Vec3 &scale,
+                         uint32_t id) {
+  if (!acquire_mesh(mesh, "add"))
+    return INVALID_PICK;
+
+  PickID pick_id;
+  if (!free_list_.empty()) {
+    pick_id = free_list_.back();
+    free_list_.pop_back();
+  } else {
+    pick_id = static_cast<PickID>(pickables_.size());
+    pickables_.emplace_back();
+  }
+
+  Pickable &pickable = pickables_[pick_id];
+  pickable.mesh = &mesh;
+  pickable.id = id;
+  pickable.alive = true;
+
+  Vec3 center;
+  float radius = 0.0f;
+  set_transform(pickable, position, rotation, scale, center, radius);
+  pickable.proxy = index_.insert(center, radius, pick_id);
+  return pick_id;
+}
+
+void PickingScene::update(PickID pick_id, const Vec3 &position,
+                          const Vec3 &rotation, const Vec3 &scale) {
+  if (pick_id >= pickables_.size() || !pickables_[pick_id].alive)
+    return;
+
+  Pickable &pickable = pickables_[pick_id];
+  Vec3 center;
+  float radius = 0.0f;
+  set_transform(pickable, position, rotation, scale, center, radius);
+  index_.move(pickable.proxy, center, radius);
+}
+
+void PickingScene::remove(PickID pick_id) {
+  if (pick_id >= pickables_.size() || !pickables_[pick_id].alive)
+    return;
+
+  Pickable &pickable = pickables_[pick_id];
+  index_.remove(pickable.proxy);
+  release_mesh(pickable.mesh);
+
+  pickable = Pickable{};
+  free_list_.push_back(pick_id);
+}
+
+PickID PickingScene::add_instances(const LODMesh &lod_mesh, const Mesh &mesh,
+                                   uint32_t id) {
+  if (!lod_mesh.config().spatial.enabled) {
+    std::cerr << "PickingScene::add_instances(): LODMesh has no spatial "
+                 "index (enable LODConfig::spatial)"
+              << std::endl;
+    return INVALID_PICK;
+  }
+  if (!acquire_mesh(mesh, "add_instances"))
+    return INVALID_PICK;
+
+  instance_sets_.push_back({&lod_mesh, &mesh, id});
+  return static_cast<PickID>(instance_sets_.size() - 1);
+}
+
+void PickingScene::remove_instances(PickID instances) {
+  if (instances >= instance_sets_.size() ||
+      !instance_sets_[instances].lod_mesh)
+    return;
+  release_mesh(instance_sets_[instances].mesh);
+  instance_sets_[instances] = InstanceSet{};
+}
+
+void PickingScene::clear() {
+  index_.clear();
+  pickables_.clear();
+  free_list_.clear();
+  instance_sets_.clear();
+  meshes_.clear();
+}
+
+std::optional<PickResult> PickingScene::raycast(const Vec3 &origin,
+                                                const Vec3 &direction,
+                                                float max_distance) const {
+  glm::vec3 dir = to_glm(direction);
+  const float length = glm::length(dir);
+  if (length <= 0.0f)
+    return std::nullopt;
+  dir = dir * (1.0f / length);
+  const glm::vec3 o = to_glm(origin);
+
+  std::optional<PickResult> best;
+  float best_t = max_distance;
+
+  // Narrow phase in object space. An affine transform keeps the ray
+  // parameter, so t stays world distance.
+  auto test_mesh = [&](const Mesh *mesh, const glm::mat4 &inverse_model) {
+    const MeshData &data = meshes_.at(mesh);
+    const glm::vec3 local_o = glm::vec3(inverse_model * glm::vec4(o, 1.0f));
+    const glm::vec3 local_d =
+        glm::vec3(inverse_model * glm::vec4(dir, 0.0f));
+    float t = 0.0f;
+    uint32_t triangle = 0;
+    if (!data.bvh.raycast(local_o, local_d, best_t, t, triangle) ||
+        (best && t >= best_t))
+      return false;
+    best_t = t;
+    best = PickResult{};
+    best->distance = t;
+    best->triangle = triangle;
+    return true;
+  };
+
+  if (!index_.empty()) {
+    candidates_.clear();
+    index_.query_ray(origin, direction, max_distance, candidates_);
+    for (const SpatialIndex::RayHit &hit : candidates_) {
+      // Candidates are sorted by sphere entry; nothing further can be closer
+      if (hit.t > best_t)
+        break;
+      const Pickable &pickable = pickables_[hit.user_data];
+      if (test_mesh(pickable.mesh, pickable.inverse_model)) {
+        best->id = pickable.id;
+        best->pickable = hit.user_data;
+      }
+    }
+  }
+
+  for (size_t set_index = 0; set_index < instance_sets_.size(); ++set_index) {
+    const InstanceSet &set = instance_sets_[set_index];
+    if (!set.lod_mesh)
+      continue;
+    // The index is only in step with the instances while spatial is enabled
+    const SpatialIndex &instance_index = set.lod_mesh->spatial_index();
+    const std::span<const InstanceData> instances = set.lod_mesh->instances();
+    if (instance_index.empty() || instance_index.size() != instances.size())
+      continue;
+
+    candidates_.clear();
+    instance_index.query_ray(origin, direction, best_t, candidates_);
+    for (const SpatialIndex::RayHit &hit : candidates_) {
+      if (hit.t > best_t)
+        break;
+      const InstanceData &inst = instances[hit.user_data];
+      if (inst.scale.x == 0.0f || inst.scale.y == 0.0f || inst.scale.z == 0.0f)
+        continue;
+      const glm::mat4 inverse_model = glm::inverse(
+          make_model_matrix(inst.position, inst.rotation, inst.scale));
+      if (test_mesh(set.mesh, inverse_model)) {
+        best->id = set.id;
+        best->pickable = static_cast<PickID>(set_index);
+        best->lod_mesh = set.lod_mesh;
+        best->instance = hit.user_data;
+      }
+    }
+  }
+
+  if (best) {
+    const glm::vec3 p = o + dir * best->distance;
+    best->position = Vec3(p.x, p.y, p.z);
+  }
+  return best;
+}
+
+} // namespace pixel::renderer3d
@@ -2,16 +2,22 @@
 #include "pixel/renderer3d/renderer.hpp"
 #include "pixel/renderer3d/renderer_instanced.hpp"
 #include "pixel/renderer3d/clip_space.hpp"
+#include "pixel/renderer3d/lod.hpp"
+#include "pixel/renderer3d/meshlet.hpp"
 #include "pixel/renderer3d/primitives.hpp"
 #include "pixel/renderer3d/renderer_fwd.hpp"
+#include "pixel/renderer3d/shader_variant_manifest.hpp"
 #include "pixel/rhi/rhi.hpp"
 #include "pixel/resources/texture_loader.hpp"
+#include "pixel/resources/texture_streamer.hpp"
+#include "pixel/platform/resources.hpp"
 #include "pixel/platform/shader_loader.hpp"
 #include "pixel/platform/window.hpp"
 #include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstring>
+#include <filesystem>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
@@ -23,6 +29,18 @@
 
 namespace pixel::renderer3d {
 
+namespace {
+
+// Opaque, depth-tested and depth-writing draws give the same image in any
+// order, so queued meshlet draws may be reordered past them
+bool draw_order_independent(const Material &material) {
+  return material.blend_mode == Material::BlendMode::Opaque &&
+         material.depth_test && material.depth_write &&
+         !material.stencil_enable;
+}
+
+} // namespace
+
 // ============================================================================
 // Renderer Implementation
 // ============================================================================
@@ -93,6 +111,8 @@ Renderer::create(const pixel::platform::WindowSpec &spec) {
     // Initialize texture loader
     renderer->texture_loader_ =
         std::make_unique<resources::TextureLoader>(renderer->device_);
+    renderer->texture_streamer_ =
+        std::make_unique<resources::TextureStreamer>(renderer->device_);
     std::cout << "Texture loader initialized" << std::endl;
 
     renderer->shadow_map_ = std::make_unique<ShadowMap>();
@@ -107,14 +127,35 @@ Renderer::create(const pixel::platform::WindowSpec &spec) {
                              e.what());
   }
 
+  renderer->load_shader_variant_manifest();
+#if defined(PIXEL_SHADER_VARIANT_MANIFEST_OUTPUT)
+  renderer->set_shader_variant_recording(true);
+#endif
   renderer->setup_default_shaders();
+  renderer->geometry_pool_ = GeometryPool::create(renderer->device_);
   renderer->sprite_mesh_ = renderer->create_sprite_quad();
 
   return renderer;
 }
 
 Renderer::~Renderer() {
+#if defined(PIXEL_SHADER_VARIANT_MANIFEST_OUTPUT)
+  if (recorded_variants_ &&
+      save_shader_variants(PIXEL_SHADER_VARIANT_MANIFEST_OUTPUT)) {
+    std::cout << "Saved shader variant usage to "
+              << PIXEL_SHADER_VARIANT_MANIFEST_OUTPUT << std::endl;
+  }
+#endif
+
+  // Destroys its textures, so it must go before the device
+  texture_streamer_.reset();
+
   if (device_) {
+    for (rhi::QueryHandle query : gpu_frame_queries_) {
+      if (query.id != 0) {
+        device_->destroyQuery(query);
+      }
+    }
     delete device_;
     device_ = nullptr;
   }
@@ -156,6 +197,14 @@ void Renderer::setup_default_shaders() {
     std::cerr << "Failed to load instanced shader" << std::endl;
   }
 
+  std::cout << "Loading impostor shader pair: assets/shaders/impostor.vert &"
+            << " assets/shaders/impostor.frag" << std::endl;
+  impostor_shader_ = load_shader("assets/shaders/impostor.vert",
+                                 "assets/shaders/impostor.frag", metal_source);
+  if (!impostor_shader_) {
+    std::cerr << "Failed to load impostor shader" << std::endl;
+  }
+
   std::cout
       << "Loading shadow depth shader pair: assets/shaders/shadow_depth.vert &"
       << " assets/shaders/shadow_depth.frag" << std::endl;
@@ -165,17 +214,10 @@ void Renderer::setup_default_shaders() {
   if (!shadow_shader_) {
     std::cerr << "Failed to load shadow depth shader" << std::endl;
   } else if (device_) {
-    Shader *shadow_shader = get_shader(shadow_shader_);
-    if (shadow_shader) {
-      auto handles = shadow_shader->shader_handles();
-      rhi::PipelineDesc depth_desc{};
-      depth_desc.vs = handles.first;
-      depth_desc.fs = handles.second;
-      depth_desc.colorAttachmentCount = 0;
-      shadow_pipeline_ = device_->createPipeline(depth_desc);
-      if (shadow_pipeline_.id == 0) {
-        std::cerr << "Failed to create shadow pipeline" << std::endl;
-      }
+    shadow_pipeline_ =
+        create_shadow_pipeline(shadow_shader_, rhi::VertexLayout::Standard);
+    if (shadow_pipeline_.id == 0) {
+      std::cerr << "Failed to create shadow pipeline" << std::endl;
     }
   }
 
@@ -188,22 +230,31 @@ void Renderer::setup_default_shaders() {
   if (!shadow_instanced_shader_) {
     std::cerr << "Failed to load instanced shadow depth shader" << std::endl;
   } else if (device_) {
-    Shader *shadow_shader = get_shader(shadow_instanced_shader_);
-    if (shadow_shader) {
-      auto handles = shadow_shader->shader_handles();
-      rhi::PipelineDesc depth_desc{};
-      depth_desc.vs = handles.first;
-      depth_desc.fs = handles.second;
-      depth_desc.colorAttachmentCount = 0;
-      shadow_instanced_pipeline_ = device_->createPipeline(depth_desc);
-      if (shadow_instanced_pipeline_.id == 0) {
-        std::cerr << "Failed to create instanced shadow pipeline" << std::endl;
-      }
+    shadow_instanced_pipeline_ = create_shadow_pipeline(
+        shadow_instanced_shader_, rhi::VertexLayout::Standard);
+    if (shadow_instanced_pipeline_.id == 0) {
+      std::cerr << "Failed to create instanced shadow pipeline" << std::endl;
     }
   }
   sprite_shader_ = default_shader_; // Use same for sprites
 }
 
+rhi::PipelineHandle Renderer::create_shadow_pipeline(ShaderID shader_id,
+                                                     rhi::VertexLayout layout) {
+  Shader *shadow_shader = get_shader(shader_id);
+  if (!shadow_shader || !device_)
+    return rhi::PipelineHandle{0};
+
+  auto handles =
+      shadow_shader->shader_handles(ShaderVariantKey{}.with_vertex_layout(layout));
+  rhi::PipelineDesc depth_desc{};
+  depth_desc.vs = handles.first;
+  depth_desc.fs = handles.second;
+  depth_desc.vertexLayout = layout;
+  depth_desc.colorAttachmentCount = 0;
+  return device_->createPipeline(depth_desc);
+}
+
 void Renderer::reset_depth_bias(rhi::CmdList *cmd) {
   if (!cmd)
     return;
@@ -290,6 +341,9 @@ void Renderer::begin_shadow_pass() {
     return;
   }
 
+  // Queued meshlet draws belong to the main pass this interrupts
+  flush_meshlet_draws();
+
   auto *cmd = device_->getImmediate();
   if (!command_list_open_) {
     cmd->begin();
@@ -366,10 +420,18 @@ void Renderer::draw_shadow_mesh(const Mesh &mesh, const Vec3 &position,
     return;
   }
 
+  const MeshFormat &format = mesh.format();
+  rhi::PipelineHandle pipeline = shadow_pipeline_;
+  if (format.compressed()) {
+    if (shadow_compressed_pipeline_.id == 0) {
+      shadow_compressed_pipeline_ =
+          create_shadow_pipeline(shadow_shader_, format.vertex_layout);
+    }
+    pipeline = shadow_compressed_pipeline_;
+  }
+
   auto *cmd = device_->getImmediate();
-  cmd->setPipeline(shadow_pipeline_);
-  cmd->setVertexBuffer(mesh.vertex_buffer());
-  cmd->setIndexBuffer(mesh.index_buffer());
+  cmd->setPipeline(pipeline);
 
   rhi::DepthStencilState depth_state{};
   depth_state.depthTestEnable = true;
@@ -377,11 +439,15 @@ void Renderer::draw_shadow_mesh(const Mesh &mesh, const Vec3 &position,
   depth_state.depthCompare = rhi::CompareOp::LessEqual;
   cmd->setDepthStencilState(depth_state);
 
-  const ShaderReflection &reflection = shader->reflection();
+  const ShaderReflection &reflection = shader->reflection(
+      ShaderVariantKey{}.with_vertex_layout(format.vertex_layout));
   const bool force_metal_uniforms =
       device_ && device_->backend_name() &&
       std::string_view(device_->backend_name()).find("Metal") !=
           std::string_view::npos;
+  cmd->setVertexBuffer(mesh.vertex_buffer());
+  cmd->setIndexBuffer(mesh.index_buffer(), 0, format.index_format);
+  set_mesh_format_uniforms(cmd, format, reflection, force_metal_uniforms);
 
   glm::mat4 model = glm::mat4(1.0f);
   model = glm::translate(model, glm::vec3(position.x, position.y, position.z));
@@ -428,13 +494,14 @@ void Renderer::draw_shadow_mesh(const Mesh &mesh, const Vec3 &position,
 
   if (material && material->texture.id != 0 &&
       reflection.has_sampler("uTexture")) {
-    cmd->setTexture("uTexture", material->texture,
+    cmd->setTexture("uTexture", resolve_texture(material->texture),
                     sampler_binding("uTexture"));
   }
 
   std::cout << "[Renderer] Drawing shadow mesh with " << mesh.index_count()
             << " indices" << std::endl;
-  cmd->drawIndexed(mesh.index_count(), 0, 1);
+  cmd->drawIndexed(mesh.index_count(), format.first_index, 1,
+                   format.base_vertex);
 }
 
 void Renderer::draw_shadow_mesh_instanced(const InstancedMesh &mesh,
@@ -470,10 +537,28 @@ void Renderer::draw_shadow_mesh_instanced(const InstancedMesh &mesh,
     return;
   }
 
+  const MeshFormat &format = mesh.format();
+  rhi::PipelineHandle pipeline = shadow_instanced_pipeline_;
+  if (format.compressed()) {
+    if (shadow_instanced_compressed_pipeline_.id == 0) {
+      shadow_instanced_compressed_pipeline_ =
+          create_shadow_pipeline(shadow_instanced_shader_, format.vertex_layout);
+    }
+    pipeline = shadow_instanced_compressed_pipeline_;
+  }
+
   auto *cmd = device_->getImmediate();
-  cmd->setPipeline(shadow_instanced_pipeline_);
+  cmd->setPipeline(pipeline);
+
+  const ShaderReflection &reflection = shader->reflection(
+      ShaderVariantKey{}.with_vertex_layout(format.vertex_layout));
+  const bool force_metal_uniforms =
+      device_ && device_->backend_name() &&
+      std::string_view(device_->backend_name()).find("Metal") !=
+          std::string_view::npos;
   cmd->setVertexBuffer(mesh.vertex_buffer());
-  cmd->setIndexBuffer(mesh.index_buffer());
+  cmd->setIndexBuffer(mesh.index_buffer(), 0, format.index_format);
+  set_mesh_format_uniforms(cmd, format, reflection, force_metal_uniforms);
   cmd->setInstanceBuffer(mesh.instance_buffer(), sizeof(InstanceGPUData));
 
   rhi::DepthStencilState depth_state{};
@@ -482,12 +567,6 @@ void Renderer::draw_shadow_mesh_instanced(const InstancedMesh &mesh,
   depth_state.depthCompare = rhi::CompareOp::LessEqual;
   cmd->setDepthStencilState(depth_state);
 
-  const ShaderReflection &reflection = shader->reflection();
-  const bool force_metal_uniforms =
-      device_ && device_->backend_name() &&
-      std::string_view(device_->backend_name()).find("Metal") !=
-          std::string_view::npos;
-
   glm::mat4 model = glm::mat4(1.0f);
   model = glm::translate(model, glm::vec3(position.x, position.y, position.z));
   model = glm::rotate(model, rotation.z, glm::vec3(0, 0, 1));
@@ -543,7 +622,7 @@ void Renderer::draw_shadow_mesh_instanced(const InstancedMesh &mesh,
                       sampler_binding("uTextureArray"));
     } else if (material->texture.id != 0 &&
                reflection.has_sampler("uTexture")) {
-      cmd->setTexture("uTexture", material->texture,
+      cmd->setTexture("uTexture", resolve_texture(material->texture),
                       sampler_binding("uTexture"));
     }
   }
@@ -551,7 +630,8 @@ void Renderer::draw_shadow_mesh_instanced(const InstancedMesh &mesh,
   std::cout << "[Renderer] Drawing instanced shadow mesh with "
             << mesh.index_count() << " indices for " << mesh.instance_count()
             << " instances" << std::endl;
-  cmd->drawIndexed(mesh.index_count(), 0, mesh.instance_count());
+  cmd->drawIndexed(mesh.index_count(), format.first_index,
+                   mesh.instance_count(), format.base_vertex);
 }
 
 void Renderer::begin_frame(const Color &clear_color) {
@@ -561,13 +641,32 @@ void Renderer::begin_frame(const Color &clear_color) {
   std::cout << "  Clear color: (" << clear_color.r << ", " << clear_color.g
             << ", " << clear_color.b << ", " << clear_color.a << ")"
             << std::endl;
+  frame_begin_time_ = std::chrono::steady_clock::now();
   ensure_swapchain_depth_texture();
 
+  // Budgeted uploads of textures decoded in the background, then deferred
+  // destruction of textures whose last reference went away
+  if (texture_loader_ && !command_list_open_) {
+    texture_loader_->process_uploads();
+    texture_loader_->process_releases();
+  }
+
+  // Mip residency changes driven by last frame's draws
+  if (texture_streamer_ && !command_list_open_) {
+    texture_streamer_->update();
+  }
+
+  // Pooled geometry of meshes destroyed a few frames ago
+  if (geometry_pool_ && !command_list_open_) {
+    geometry_pool_->begin_frame();
+  }
+
   auto *cmd = device_->getImmediate();
   if (!command_list_open_) {
     cmd->begin();
     command_list_open_ = true;
   }
+  begin_gpu_frame_timer(cmd);
 
   if (shadow_pass_active_ && shadow_map_) {
     shadow_map_->end(cmd);
@@ -635,19 +734,22 @@ void Renderer::begin_frame(const Color &clear_color) {
   pass.depthAttachment.texture =
       use_explicit_depth ? swapchain_depth_texture_ : rhi::TextureHandle{0};
   pass.depthAttachment.depthLoadOp = rhi::LoadOp::Clear;
-  pass.depthAttachment.depthStoreOp = rhi::StoreOp::DontCare;
+  // Depth and stencil are stored so a pass paused for compute work resumes
+  // with them (resume_render_pass())
+  pass.depthAttachment.depthStoreOp = rhi::StoreOp::Store;
   pass.depthAttachment.clearDepth = 1.0f;
   pass.depthAttachment.hasStencil =
       use_explicit_depth ? swapchain_depth_has_stencil_ : true;
   pass.depthAttachment.stencilLoadOp =
       pass.depthAttachment.hasStencil ? rhi::LoadOp::Clear
                                       : rhi::LoadOp::DontCare;
-  pass.depthAttachment.stencilStoreOp = rhi::StoreOp::DontCare;
+  pass.depthAttachment.stencilStoreOp = rhi::StoreOp::Store;
   pass.depthAttachment.clearStencil = 0;
 
   current_pass_desc_ = pass;
   cmd->beginRender(current_pass_desc_);
   render_pass_active_ = true;
+  frame_in_progress_ = true;
 
   reset_depth_bias(cmd);
   std::cout << "  Render pass begun successfully" << std::endl;
@@ -657,6 +759,12 @@ void Renderer::begin_frame(const Color &clear_color) {
 
 void Renderer::end_frame() {
   std::cout << "Renderer::end_frame()" << std::endl;
+  flush_meshlet_draws();
+  for (MeshletMesh *meshlets : culled_meshlets_) {
+    meshlets->next_frame();
+  }
+  culled_meshlets_.clear();
+  frame_in_progress_ = false;
   auto *cmd = device_->getImmediate();
   if (render_pass_active_) {
     cmd->endRender();
@@ -687,12 +795,110 @@ void Renderer::end_frame() {
   }
 
   if (command_list_open_) {
+    end_gpu_frame_timer(cmd);
     cmd->end();
     command_list_open_ = false;
   }
 
+  lod_budget::submit_cpu_frame_time(
+      std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - frame_begin_time_)
+          .count());
+
   device_->present();
   std::cout << "  Presented frame to swapchain" << std::endl;
+  collect_gpu_frame_times();
+}
+
+void Renderer::begin_gpu_frame_timer(rhi::CmdList *cmd) {
+  if (!device_->caps().timerQueries || gpu_frame_timer_active_) {
+    return;
+  }
+
+  // A slot still pending after kGpuTimerFrames frames is overwritten; the
+  // GPU is far enough behind that the sample would be stale anyway
+  const uint32_t slot = gpu_frame_index_ % kGpuTimerFrames;
+  rhi::QueryHandle &query = gpu_frame_queries_[slot];
+  if (query.id == 0) {
+    query = device_->createQuery(rhi::QueryType::TimeElapsed);
+    if (query.id == 0) {
+      return;
+    }
+  }
+  cmd->beginQuery(query, rhi::QueryType::TimeElapsed);
+  gpu_frame_query_pending_[slot] = false;
+  gpu_frame_timer_active_ = true;
+}
+
+void Renderer::end_gpu_frame_timer(rhi::CmdList *cmd) {
+  if (!gpu_frame_timer_active_) {
+    return;
+  }
+  const uint32_t slot = gpu_frame_index_ % kGpuTimerFrames;
+  cmd->endQuery(gpu_frame_queries_[slot], rhi::QueryType::TimeElapsed);
+  gpu_frame_query_pending_[slot] = true;
+  gpu_frame_timer_active_ = false;
+  ++gpu_frame_index_;
+}
+
+void Renderer::collect_gpu_frame_times() {
+  // Oldest first, so lod_budget sees samples in frame order
+  for (uint32_t age = kGpuTimerFrames; age > 0; --age) {
+    const uint32_t slot =
+        (gpu_frame_index_ + kGpuTimerFrames - age) % kGpuTimerFrames;
+    if (!gpu_frame_query_pending_[slot]) {
+      continue;
+    }
+    uint64_t elapsed_ns = 0;
+    if (!device_->getQueryResult(gpu_frame_queries_[slot], elapsed_ns,
+                                 false)) {
+      break;
+    }
+    gpu_frame_query_pending_[slot] = false;
+    lod_budget::submit_gpu_frame_time(static_cast<double>(elapsed_ns) * 1e-6);
+  }
+}
+
+void Renderer::begin_offscreen_pass(const rhi::RenderPassDesc &desc) {
+  if (!device_) {
+    std::cerr << "[Renderer] Cannot begin offscreen pass: device not available"
+              << std::endl;
+    return;
+  }
+
+  if (offscreen_pass_active_ || shadow_pass_active_) {
+    std::cerr << "[Renderer] Cannot begin offscreen pass: another pass is"
+              << " active" << std::endl;
+    return;
+  }
+
+  // Queued meshlet draws belong to the main pass this interrupts
+  flush_meshlet_draws();
+
+  auto *cmd = device_->getImmediate();
+  if (!command_list_open_) {
+    cmd->begin();
+    command_list_open_ = true;
+  }
+
+  if (render_pass_active_) {
+    cmd->endRender();
+    render_pass_active_ = false;
+  }
+
+  cmd->beginRender(desc);
+  offscreen_pass_active_ = true;
+}
+
+void Renderer::end_offscreen_pass() {
+  if (!offscreen_pass_active_ || !device_) {
+    std::cerr << "[Renderer] Cannot end offscreen pass: no pass active"
+              << std::endl;
+    return;
+  }
+
+  device_->getImmediate()->endRender();
+  offscreen_pass_active_ = false;
 }
 
 void Renderer::pause_render_pass() {
@@ -718,6 +924,14 @@ void Renderer::resume_render_pass() {
     shadow_pass_active_ = false;
     reset_depth_bias(cmd);
   }
+  // Keep what was drawn before the pause instead of clearing it again
+  for (uint32_t i = 0; i < current_pass_desc_.colorAttachmentCount; ++i) {
+    current_pass_desc_.colorAttachments[i].loadOp = rhi::LoadOp::Load;
+  }
+  current_pass_desc_.depthAttachment.depthLoadOp = rhi::LoadOp::Load;
+  if (current_pass_desc_.depthAttachment.hasStencil) {
+    current_pass_desc_.depthAttachment.stencilLoadOp = rhi::LoadOp::Load;
+  }
   cmd->beginRender(current_pass_desc_);
   render_pass_active_ = true;
 }
@@ -741,6 +955,10 @@ ShaderID Renderer::load_shader(const std::string &vert_path,
   ShaderID id = next_shader_id_++;
   shaders_[id] =
       Shader::create(device_, vert_path, frag_path, std::move(metal_path));
+  if (Shader *shader = shaders_[id].get()) {
+    warm_up_shader_variants(*shader);
+    shader->set_variant_recorder(recorded_variants_.get());
+  }
   return id;
 }
 
@@ -749,6 +967,72 @@ Shader *Renderer::get_shader(ShaderID id) {
   return it != shaders_.end() ? it->second.get() : nullptr;
 }
 
+void Renderer::set_shader_variant_recording(bool enabled) {
+  if (enabled == (recorded_variants_ != nullptr))
+    return;
+  recorded_variants_ =
+      enabled ? std::make_unique<ShaderVariantManifest>() : nullptr;
+  for (auto &[id, shader] : shaders_) {
+    if (shader)
+      shader->set_variant_recorder(recorded_variants_.get());
+  }
+}
+
+bool Renderer::save_shader_variants(const std::string &path) const {
+  ShaderVariantManifest manifest;
+  if (warm_up_variants_)
+    manifest.merge(*warm_up_variants_);
+  if (recorded_variants_)
+    manifest.merge(*recorded_variants_);
+  return manifest.save(path);
+}
+
+void Renderer::load_shader_variant_manifest() {
+  const std::string path =
+      platform::get_resource_path() + ShaderVariantManifest::kDefaultPath;
+  std::error_code ec;
+  if (!std::filesystem::exists(path, ec))
+    return;
+
+  if (auto manifest = ShaderVariantManifest::load(path)) {
+    std::cout << "Loaded " << manifest->size()
+              << " shader variants to warm up from " << path << std::endl;
+    warm_up_variants_ =
+        std::make_unique<ShaderVariantManifest>(std::move(*manifest));
+  }
+}
+
+void Renderer::warm_up_shader_variants(Shader &shader) {
+  if (!warm_up_variants_)
+    return;
+
+  // Runs before the shader is attached to the recorder so replayed entries
+  // are not counted as use; variants still compiling at runtime are queued
+  // and draw with their fallback until they land
+  size_t warmed = 0;
+  for (const ShaderVariantManifest::Entry &entry :
+       warm_up_variants_->entries()) {
+    if (entry.vert_path != shader.vert_path() ||
+        entry.frag_path != shader.frag_path() ||
+        entry.color_format != ShaderVariantData::kColorFormat) {
+      continue;
+    }
+    try {
+      shader.pipeline(entry.variant, entry.blend_mode);
+      ++warmed;
+    } catch (const std::exception &e) {
+      std::cerr << "Failed to warm up shader variant '"
+                << ShaderVariantManifest::format_defines(entry.variant)
+                << "' of " << shader.vert_path() << ": " << e.what()
+                << std::endl;
+    }
+  }
+  if (warmed > 0) {
+    std::cout << "Warmed up " << warmed << " pipelines for "
+              << shader.vert_path() << std::endl;
+  }
+}
+
 void Renderer::apply_material_state(rhi::CmdList *cmd,
                                     const Material &material) const {
   if (!cmd)
@@ -792,7 +1076,9 @@ std::unique_ptr<Mesh> Renderer::create_quad(float size) {
   std::vector<uint32_t> indices = {0, 1, 2, 2, 3, 0};
   std::cout << "Creating quad mesh: vertex_count=" << verts.size()
             << " index_count=" << indices.size() << std::endl;
-  return Mesh::create(device_, verts, indices);
+  MeshOptions options;
+  options.pool = geometry_pool_.get();
+  return Mesh::create(device_, verts, indices, options);
 }
 
 std::unique_ptr<Mesh> Renderer::create_sprite_quad() {
@@ -807,7 +1093,9 @@ std::unique_ptr<Mesh> Renderer::create_cube(float size) {
   std::cout << "Creating cube mesh: vertex_count=" << verts.size()
             << " index_count=" << indices.size() << " size=" << size
             << std::endl;
-  return Mesh::create(device_, verts, indices);
+  MeshOptions options;
+  options.pool = geometry_pool_.get();
+  return Mesh::create(device_, verts, indices, options);
 }
 
 std::unique_ptr<Mesh> Renderer::create_plane(float width, float depth,
@@ -817,7 +1105,9 @@ std::unique_ptr<Mesh> Renderer::create_plane(float width, float depth,
   std::vector<uint32_t> indices;
   for (uint32_t i = 0; i < verts.size(); ++i)
     indices.push_back(i);
-  return Mesh::create(device_, verts, indices);
+  MeshOptions options;
+  options.pool = geometry_pool_.get();
+  return Mesh::create(device_, verts, indices, options);
 }
 
 void Renderer::draw_mesh(const Mesh &mesh, const Vec3 &position,
@@ -833,33 +1123,123 @@ void Renderer::draw_mesh(const Mesh &mesh, const Vec3 &position,
   std::cout << "  scale:    (" << scale.x << ", " << scale.y << ", " << scale.z
             << ")" << std::endl;
 
+  // Build model matrix
+  glm::mat4 model = glm::mat4(1.0f);
+  model = glm::translate(model, glm::vec3(position.x, position.y, position.z));
+  model = glm::rotate(model, rotation.z, glm::vec3(0, 0, 1));
+  model = glm::rotate(model, rotation.y, glm::vec3(0, 1, 0));
+  model = glm::rotate(model, rotation.x, glm::vec3(1, 0, 0));
+  model = glm::scale(model, glm::vec3(scale.x, scale.y, scale.z));
+
+  draw_mesh_indices(mesh, model, material, mesh.index_buffer(),
+                    mesh.format().index_format, mesh.format().first_index,
+                    static_cast<uint32_t>(mesh.index_count()));
+}
+
+void Renderer::draw_meshlets(MeshletMesh &meshlets, const Vec3 &position,
+                             const Vec3 &rotation, const Vec3 &scale,
+                             const Material &material) {
+  glm::mat4 model = glm::mat4(1.0f);
+  model = glm::translate(model, glm::vec3(position.x, position.y, position.z));
+  model = glm::rotate(model, rotation.z, glm::vec3(0, 0, 1));
+  model = glm::rotate(model, rotation.y, glm::vec3(0, 1, 0));
+  model = glm::rotate(model, rotation.x, glm::vec3(1, 0, 0));
+  model = glm::scale(model, glm::vec3(scale.x, scale.y, scale.z));
+
+  float view_raw[16];
+  float proj_raw[16];
+  camera_.get_view_matrix(view_raw);
+  camera_.get_projection_matrix(proj_raw, window_width(), window_height());
+  const FrustumPlanes planes = extract_frustum_planes(
+      glm::make_mat4(proj_raw) * glm::make_mat4(view_raw));
+  const glm::vec3 eye(camera_.position.x, camera_.position.y,
+                      camera_.position.z);
+
+  const std::optional<uint32_t> slot =
+      meshlets.prepare_cull(model, planes, eye);
+  if (!slot)
+    return;
+  if (std::find(culled_meshlets_.begin(), culled_meshlets_.end(),
+                &meshlets) == culled_meshlets_.end()) {
+    culled_meshlets_.push_back(&meshlets);
+  }
+  if (meshlets.gpu_culling()) {
+    pending_meshlet_draws_.push_back({&meshlets, *slot, model, material});
+    if (!draw_order_independent(material))
+      flush_meshlet_draws();
+    return;
+  }
+
+  // The compacted buffer holds mesh-relative indices, so only base_vertex
+  // carries over from the source mesh
+  const MeshletMesh::CullSlot &cull = meshlets.cull_slot(*slot);
+  if (cull.index_count == 0)
+    return;
+  draw_mesh_indices(meshlets.source(), model, material, cull.visible_indices,
+                    rhi::IndexFormat::Uint32, 0, cull.index_count);
+}
+
+void Renderer::flush_meshlet_draws() {
+  if (pending_meshlet_draws_.empty())
+    return;
+  if (!render_pass_active_) {
+    std::cerr << "Renderer::flush_meshlet_draws(): no main render pass, "
+                 "dropping "
+              << pending_meshlet_draws_.size() << " meshlet draws"
+              << std::endl;
+    pending_meshlet_draws_.clear();
+    return;
+  }
+
+  // One compute pass for every placement queued since the last flush; the
+  // draws then take their index counts from the argument buffers it filled in
+  auto *cmd = device_->getImmediate();
+  pause_render_pass();
+  for (MeshletMesh *meshlets : culled_meshlets_) {
+    meshlets->record_culls(cmd);
+  }
+  cmd->memoryBarrier();
+  resume_render_pass();
+
+  std::vector<MeshletDraw> draws;
+  draws.swap(pending_meshlet_draws_);
+  for (const MeshletDraw &draw : draws) {
+    const MeshletMesh::CullSlot &cull = draw.meshlets->cull_slot(draw.slot);
+    draw_mesh_indices(draw.meshlets->source(), draw.model, draw.material,
+                      cull.visible_indices, rhi::IndexFormat::Uint32, 0, 0,
+                      cull.draw_args);
+  }
+}
+
+void Renderer::draw_mesh_indices(const Mesh &mesh, const glm::mat4 &model,
+                                 const Material &material,
+                                 rhi::BufferHandle index_buffer,
+                                 rhi::IndexFormat index_format,
+                                 uint32_t first_index, uint32_t index_count,
+                                 rhi::BufferHandle indirect_args) {
+  if (indirect_args.id == 0 && !draw_order_independent(material))
+    flush_meshlet_draws();
+
   Shader *shader = get_shader(default_shader_);
   if (!shader)
     return;
 
   auto *cmd = device_->getImmediate();
-  auto pipeline_handle =
-      shader->pipeline(material.shader_variant, material.blend_mode);
+  const ShaderVariantKey variant =
+      material.shader_variant.with_vertex_layout(mesh.format().vertex_layout);
+  auto pipeline_handle = shader->pipeline(variant, material.blend_mode);
   std::cout << "  pipeline handle: " << pipeline_handle.id << std::endl;
   cmd->setPipeline(pipeline_handle);
   apply_material_state(cmd, material);
-  cmd->setVertexBuffer(mesh.vertex_buffer());
-  cmd->setIndexBuffer(mesh.index_buffer());
 
-  const ShaderReflection &reflection =
-      shader->reflection(material.shader_variant);
+  const ShaderReflection &reflection = shader->reflection(variant);
   const bool force_metal_uniforms =
       device_ && device_->backend_name() &&
       std::string_view(device_->backend_name()).find("Metal") !=
           std::string_view::npos;
-
-  // Build model matrix
-  glm::mat4 model = glm::mat4(1.0f);
-  model = glm::translate(model, glm::vec3(position.x, position.y, position.z));
-  model = glm::rotate(model, rotation.z, glm::vec3(0, 0, 1));
-  model = glm::rotate(model, rotation.y, glm::vec3(0, 1, 0));
-  model = glm::rotate(model, rotation.x, glm::vec3(1, 0, 0));
-  model = glm::scale(model, glm::vec3(scale.x, scale.y, scale.z));
+  cmd->setVertexBuffer(mesh.vertex_buffer());
+  cmd->setIndexBuffer(index_buffer, 0, index_format);
+  set_mesh_format_uniforms(cmd, mesh.format(), reflection, force_metal_uniforms);
 
   // Get view and projection matrices
   float view_raw[16], projection_raw[16];
@@ -935,8 +1315,29 @@ void Renderer::draw_mesh(const Mesh &mesh, const Vec3 &position,
   };
 
   if (material.texture.id != 0 && reflection.has_sampler("uTexture")) {
-    cmd->setTexture("uTexture", material.texture,
-                    sampler_binding("uTexture"));
+    rhi::TextureHandle texture = material.texture;
+    if (texture_streamer_ && texture_streamer_->is_streamed(texture)) {
+      // Assumes the UVs span the texture once across the mesh, so the
+      // texture covers about the bounding sphere's on-screen diameter
+      const glm::vec4 center =
+          model * glm::vec4(mesh.bounds_center().x, mesh.bounds_center().y,
+                            mesh.bounds_center().z, 1.0f);
+      const float scale = std::max(
+          {glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+           glm::length(glm::vec3(model[2]))});
+      const float radius = mesh.bounds_radius() * scale;
+      float screen_extent = 0.0f;
+      if (camera_.mode == Camera::ProjectionMode::Orthographic) {
+        screen_extent = radius / camera_.ortho_size *
+                        static_cast<float>(window_height());
+      } else {
+        screen_extent = screen_space::calculate_sphere_screen_size(
+            {center.x, center.y, center.z}, radius, view_mat, projection_mat,
+            window_height());
+      }
+      texture = texture_streamer_->resolve(texture, screen_extent);
+    }
+    cmd->setTexture("uTexture", texture, sampler_binding("uTexture"));
   }
 
   const bool shadow_map_available =
@@ -998,11 +1399,16 @@ void Renderer::draw_mesh(const Mesh &mesh, const Vec3 &position,
   }
 
   // Draw
-  cmd->drawIndexed(mesh.index_count(), 0, 1);
+  if (indirect_args.id != 0) {
+    cmd->drawIndexedIndirect(indirect_args);
+  } else {
+    cmd->drawIndexed(index_count, first_index, 1, mesh.format().base_vertex);
+  }
 }
 
 void Renderer::draw_sprite(rhi::TextureHandle texture, const Vec3 &position,
                            const Vec2 &size, const Color &tint) {
+  flush_meshlet_draws();
   Shader *shader = get_shader(sprite_shader_);
   if (!shader)
     return;
@@ -1018,8 +1424,11 @@ void Renderer::draw_sprite(rhi::TextureHandle texture, const Vec3 &position,
 
   if (sprite_mesh_) {
     cmd->setVertexBuffer(sprite_mesh_->vertex_buffer());
-    cmd->setIndexBuffer(sprite_mesh_->index_buffer());
-    cmd->drawIndexed(sprite_mesh_->index_count(), 0, 1);
+    cmd->setIndexBuffer(sprite_mesh_->index_buffer(), 0,
+                        sprite_mesh_->format().index_format);
+    cmd->drawIndexed(sprite_mesh_->index_count(),
+                     sprite_mesh_->format().first_index, 1,
+                     sprite_mesh_->format().base_vertex);
   }
 }
 
@@ -1029,6 +1438,14 @@ int Renderer::window_height() const { return window_ ? window_->height() : 0; }
 
 double Renderer::time() const { return window_ ? window_->time() : 0.0; }
 
+std::optional<PickResult> Renderer::pick(float screen_x, float screen_y) const {
+  Vec3 origin;
+  Vec3 direction;
+  camera_.screen_ray(screen_x, screen_y, window_width(), window_height(),
+                     origin, direction);
+  return picking_.raycast(origin, direction, camera_.far_clip);
+}
+
 const char *Renderer::backend_name() const {
   if (device_) {
     return device_->backend_name();
@@ -1048,6 +1465,35 @@ rhi::TextureHandle Renderer::load_texture(const std::string &path) {
   return texture_loader_->load(path);
 }
 
+resources::TextureRef Renderer::acquire_texture(const std::string &path) {
+  if (!texture_loader_) {
+    std::cerr << "Renderer: TextureLoader not initialized" << std::endl;
+    return {};
+  }
+  return texture_loader_->acquire(path);
+}
+
+resources::AsyncTextureRef
+Renderer::load_texture_async(const std::string &path) {
+  if (!texture_loader_) {
+    std::cerr << "Renderer: TextureLoader not initialized" << std::endl;
+    return nullptr;
+  }
+  return texture_loader_->load_async(path);
+}
+
+rhi::TextureHandle Renderer::stream_texture(const std::string &path) {
+  if (!texture_streamer_) {
+    std::cerr << "Renderer: TextureStreamer not initialized" << std::endl;
+    return {0};
+  }
+  return texture_streamer_->add(path);
+}
+
+rhi::TextureHandle Renderer::resolve_texture(rhi::TextureHandle handle) const {
+  return texture_streamer_ ? texture_streamer_->resolve(handle) : handle;
+}
+
 rhi::TextureHandle Renderer::create_texture(int width, int height,
                                             const uint8_t *data) {
   if (!texture_loader_) {
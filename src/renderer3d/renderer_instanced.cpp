@@ -1,6 +1,7 @@
 #include "pixel/renderer3d/renderer_instanced.hpp"
 #include "pixel/renderer3d/clip_space.hpp"
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
 #include <iostream>
 #include <string_view>
 
@@ -49,6 +50,7 @@ std::unique_ptr<InstancedMesh> InstancedMesh::create(rhi::Device *device,
   instanced->device_ = device;
   instanced->vertex_buffer_ = mesh.vertex_buffer();
   instanced->index_buffer_ = mesh.index_buffer();
+  instanced->format_ = mesh.format();
   instanced->vertex_count_ = mesh.vertex_count();
   instanced->index_count_ = mesh.index_count();
   instanced->max_instances_ = max_instances;
@@ -61,7 +63,7 @@ std::unique_ptr<InstancedMesh> InstancedMesh::create(rhi::Device *device,
   instance_desc.hostVisible = true;
   instanced->instance_buffer_ = device->createBuffer(instance_desc);
 
-  instanced->instance_data_.reserve(max_instances);
+  instanced->gpu_instances_.reserve(max_instances);
 
   std::cout << "Created instanced mesh with capacity for " << max_instances
             << " instances (GPU buffer: " << instance_desc.size << " bytes)"
@@ -74,84 +76,43 @@ InstancedMesh::~InstancedMesh() {
   // RHI handles cleanup
 }
 
-void InstancedMesh::set_instances(const std::vector<InstanceData> &instances) {
-  // === DIAGNOSTIC LOGGING START ===
-  std::cerr << "\n" << std::string(70, '=') << std::endl;
-  std::cerr << "InstancedMesh::set_instances() CALLED" << std::endl;
-  std::cerr << std::string(70, '=') << std::endl;
-  std::cerr << "Input:" << std::endl;
-  std::cerr << "  instances.size(): " << instances.size() << std::endl;
-  std::cerr << "  max_instances_:   " << max_instances_ << std::endl;
-
-  if (instances.empty()) {
-    std::cerr << "\n❌ WARNING: Empty instance vector!" << std::endl;
-    std::cerr << std::string(70, '=') << "\n" << std::endl;
-  }
-
-  if (!instances.empty()) {
-    std::cerr << "\nFirst 3 instances:" << std::endl;
-    for (size_t i = 0; i < std::min(size_t(3), instances.size()); ++i) {
-      const auto &inst = instances[i];
-      std::cerr << "  [" << i << "] pos=(" << inst.position.x << ", "
-                << inst.position.y << ", " << inst.position.z << "), scale=("
-                << inst.scale.x << ", " << inst.scale.y << ", " << inst.scale.z
-                << ")" << std::endl;
-    }
+void InstancedMesh::set_instances(std::span<const InstanceData> instances) {
+  size_t count = instances.size();
+  if (count > max_instances_) {
+    std::cerr << "Warning: Clamping " << count << " instances to max "
+              << max_instances_ << std::endl;
+    count = max_instances_;
   }
-  // === DIAGNOSTIC LOGGING END ===
 
-  instance_data_ = instances;
-  if (instance_data_.size() > max_instances_) {
-    // === DIAGNOSTIC LOGGING ===
-    std::cerr << "\n⚠ WARNING: Clamping " << instance_data_.size()
-              << " instances to max " << max_instances_ << std::endl;
-    // === END ===
-    instance_data_.resize(max_instances_);
+  // Convert straight into the persistent GPU-format staging
+  std::span<InstanceGPUData> out = begin_instance_write(count);
+  for (size_t i = 0; i < out.size(); ++i) {
+    out[i] = instances[i].to_gpu_data();
   }
+  commit_instances(out.size());
+}
 
-  instance_count_ = instance_data_.size();
-
-  // Convert to GPU format
-  std::vector<InstanceGPUData> gpu_data;
-  gpu_data.reserve(instance_count_);
-  for (const auto &inst : instance_data_) {
-    gpu_data.push_back(inst.to_gpu_data());
+void InstancedMesh::set_gpu_instances(
+    std::span<const InstanceGPUData> instances) {
+  size_t count = instances.size();
+  if (count > max_instances_) {
+    std::cerr << "Warning: Clamping " << count << " instances to max "
+              << max_instances_ << std::endl;
+    count = max_instances_;
   }
 
-  // === DIAGNOSTIC LOGGING ===
-  std::cerr << "\nUploading to GPU:" << std::endl;
-  std::cerr << "  gpu_data.size():     " << gpu_data.size() << std::endl;
-  std::cerr << "  total bytes:         "
-            << (gpu_data.size() * sizeof(InstanceGPUData)) << std::endl;
-  std::cerr << "  instance_buffer_.id: " << instance_buffer_.id << std::endl;
-  // === END ===
+  // Keep the staging mirror in sync so update_instance() stays valid
+  gpu_instances_.assign(instances.begin(), instances.begin() + count);
+  instance_count_ = count;
 
-  // Upload to GPU
-  if (!gpu_data.empty() && instance_buffer_.id != 0) {
-    auto *cmd = device_->getImmediate();
-    std::span<const std::byte> bytes(
-        reinterpret_cast<const std::byte *>(gpu_data.data()),
-        gpu_data.size() * sizeof(InstanceGPUData));
-    cmd->copyToBuffer(instance_buffer_, 0, bytes);
+  if (count == 0 || instance_buffer_.id == 0)
+    return;
 
-    // === DIAGNOSTIC LOGGING ===
-    std::cerr << "  ✓ Instance data uploaded to GPU" << std::endl;
-    std::cerr << "\nFinal state:" << std::endl;
-    std::cerr << "  instance_count_: " << instance_count_ << std::endl;
-    std::cerr << std::string(70, '=') << "\n" << std::endl;
-    // === END ===
-  } else {
-    // === DIAGNOSTIC LOGGING ===
-    std::cerr << "  ❌ ERROR: Cannot upload to GPU!" << std::endl;
-    if (gpu_data.empty()) {
-      std::cerr << "     - gpu_data is empty" << std::endl;
-    }
-    if (instance_buffer_.id == 0) {
-      std::cerr << "     - instance_buffer_ handle is invalid (0)" << std::endl;
-    }
-    std::cerr << std::string(70, '=') << "\n" << std::endl;
-    // === END ===
-  }
+  auto *cmd = device_->getImmediate();
+  cmd->copyToBuffer(instance_buffer_, 0,
+                    std::span<const std::byte>(
+                        reinterpret_cast<const std::byte *>(instances.data()),
+                        count * sizeof(InstanceGPUData)));
 }
 
 void InstancedMesh::update_instance(size_t index, const InstanceData &data) {
@@ -162,10 +123,9 @@ void InstancedMesh::update_instance(size_t index, const InstanceData &data) {
     return;
   }
 
-  instance_data_[index] = data;
-
   // Convert to GPU format and update single instance
-  InstanceGPUData gpu_data = data.to_gpu_data();
+  gpu_instances_[index] = data.to_gpu_data();
+  const InstanceGPUData &gpu_data = gpu_instances_[index];
 
   auto *cmd = device_->getImmediate();
   cmd->copyToBuffer(
@@ -174,6 +134,26 @@ void InstancedMesh::update_instance(size_t index, const InstanceData &data) {
                                  sizeof(InstanceGPUData)));
 }
 
+std::span<InstanceGPUData> InstancedMesh::begin_instance_write(size_t count) {
+  count = std::min(count, max_instances_);
+  gpu_instances_.resize(count);
+  return std::span<InstanceGPUData>(gpu_instances_.data(), count);
+}
+
+void InstancedMesh::commit_instances(size_t count) {
+  instance_count_ = std::min(count, gpu_instances_.size());
+  if (instance_count_ == 0 || instance_buffer_.id == 0) {
+    return;
+  }
+
+  auto *cmd = device_->getImmediate();
+  cmd->copyToBuffer(instance_buffer_, 0,
+                    std::span<const std::byte>(
+                        reinterpret_cast<const std::byte *>(
+                            gpu_instances_.data()),
+                        instance_count_ * sizeof(InstanceGPUData)));
+}
+
 void InstancedMesh::draw(rhi::CmdList *cmd) const {
   // === DIAGNOSTIC LOGGING ===
   std::cerr << "\n--- InstancedMesh::draw() ---" << std::endl;
@@ -193,16 +173,18 @@ void InstancedMesh::draw(rhi::CmdList *cmd) const {
   // === END ===
 
   cmd->setVertexBuffer(vertex_buffer_);
-  cmd->setIndexBuffer(index_buffer_);
+  cmd->setIndexBuffer(index_buffer_, 0, format_.index_format);
   cmd->setInstanceBuffer(instance_buffer_, sizeof(InstanceGPUData));
 
   // === DIAGNOSTIC LOGGING ===
   std::cerr << "  ✓ Buffers set" << std::endl;
-  std::cerr << "  Calling drawIndexed(" << index_count_ << ", 0, "
-            << instance_count_ << ")..." << std::endl;
+  std::cerr << "  Calling drawIndexed(" << index_count_ << ", "
+            << format_.first_index << ", " << instance_count_ << ", "
+            << format_.base_vertex << ")..." << std::endl;
   // === END ===
 
-  cmd->drawIndexed(index_count_, 0, instance_count_);
+  cmd->drawIndexed(index_count_, format_.first_index, instance_count_,
+                   format_.base_vertex);
 
   // === DIAGNOSTIC LOGGING ===
   std::cerr << "  ✓ drawIndexed() returned" << std::endl;
@@ -271,8 +253,9 @@ void RendererInstanced::draw_instanced(Renderer &renderer,
             << (base_material.depth_write ? "YES" : "NO") << std::endl;
   // === END ===
 
-  auto pipeline_handle =
-      shader->pipeline(base_material.shader_variant, base_material.blend_mode);
+  const ShaderVariantKey variant =
+      base_material.shader_variant.with_vertex_layout(mesh.format().vertex_layout);
+  auto pipeline_handle = shader->pipeline(variant, base_material.blend_mode);
 
   // === DIAGNOSTIC LOGGING ===
   std::cerr << "\nPipeline:" << std::endl;
@@ -301,12 +284,12 @@ void RendererInstanced::draw_instanced(Renderer &renderer,
   glm::mat4 model = glm::mat4(1.0f);
 
   // Set model matrix
-  const ShaderReflection &reflection =
-      shader->reflection(base_material.shader_variant);
+  const ShaderReflection &reflection = shader->reflection(variant);
   const bool force_metal_uniforms = renderer.device() &&
                                    renderer.device()->backend_name() &&
                                    std::string_view(renderer.device()->backend_name())
                                            .find("Metal") != std::string_view::npos;
+  set_mesh_format_uniforms(cmd, mesh.format(), reflection, force_metal_uniforms);
 
   // === DIAGNOSTIC LOGGING ===
   std::cerr << "\nUniforms:" << std::endl;
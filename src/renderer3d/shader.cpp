@@ -1,6 +1,7 @@
 #include "pixel/renderer3d/renderer.hpp"
 #include "pixel/platform/shader_loader.hpp"
 #include "pixel/renderer3d/shader_reflection.hpp"
+#include "pixel/renderer3d/shader_variant_manifest.hpp"
 #include "pixel/renderer3d/shader_variant_system.hpp"
 
 #include <iostream>
@@ -58,6 +59,21 @@ std::string ShaderVariantKey::cache_key() const {
   return key;
 }
 
+rhi::VertexLayout ShaderVariantKey::vertex_layout() const {
+  return has_define(kCompressedVertexDefine) ? rhi::VertexLayout::Compressed
+                                             : rhi::VertexLayout::Standard;
+}
+
+ShaderVariantKey
+ShaderVariantKey::with_vertex_layout(rhi::VertexLayout layout) const {
+  ShaderVariantKey key = *this;
+  if (layout == rhi::VertexLayout::Compressed)
+    key.set_define(std::string(kCompressedVertexDefine));
+  else
+    key.clear_define(kCompressedVertexDefine);
+  return key;
+}
+
 ShaderVariantKey ShaderVariantKey::from_defines(
     std::initializer_list<std::pair<std::string, std::string>> defines) {
   ShaderVariantKey key;
@@ -104,14 +120,22 @@ std::unique_ptr<Shader> Shader::create(rhi::Device *device,
 
   const bool is_shadow_shader = vert_path.find("shadow") != std::string::npos ||
                                 frag_path.find("shadow") != std::string::npos;
+  // Impostor billboards consume the per-instance stream like instanced shaders
+  const bool is_impostor_shader =
+      vert_path.find("impostor") != std::string::npos ||
+      frag_path.find("impostor") != std::string::npos;
   const bool is_instanced_shader =
+      is_impostor_shader ||
       vert_path.find("instanced") != std::string::npos ||
       frag_path.find("instanced") != std::string::npos;
 
   shader->is_shadow_shader_ = is_shadow_shader;
   shader->is_instanced_shader_ = is_instanced_shader;
 
-  if (is_shadow_shader && is_instanced_shader) {
+  if (is_impostor_shader) {
+    shader->vs_stage_ = "vs_impostor_instanced";
+    shader->fs_stage_ = "fs_impostor";
+  } else if (is_shadow_shader && is_instanced_shader) {
     shader->vs_stage_ = "vs_shadow_instanced";
     shader->fs_stage_ = "fs_shadow";
   } else if (is_shadow_shader) {
@@ -155,6 +179,17 @@ Shader::get_or_create_variant(const ShaderVariantKey &variant) const {
     return it->second;
   }
 
+  // Until a runtime-compiled variant lands, draw with the precompiled
+  // variant for the same vertex layout instead of stalling the frame
+  if (variant_system_ &&
+      !variant_system_->variant_ready(make_build_context(), variant)) {
+    const ShaderVariantKey fallback =
+        ShaderVariantKey{}.with_vertex_layout(variant.vertex_layout());
+    if (fallback.cache_key() != key) {
+      return get_or_create_variant(fallback);
+    }
+  }
+
   VariantData data = build_variant(variant);
   auto [inserted, success] =
       variant_cache_.emplace(std::move(key), std::move(data));
@@ -194,12 +229,34 @@ rhi::PipelineHandle Shader::pipeline(Material::BlendMode mode) const {
 
 rhi::PipelineHandle Shader::pipeline(const ShaderVariantKey &variant,
                                      Material::BlendMode mode) const {
-  VariantData &data = get_or_create_variant(variant);
   size_t index = static_cast<size_t>(mode);
   if (index >= Material::kBlendModeCount) {
     index = static_cast<size_t>(Material::BlendMode::Alpha);
   }
 
+  // Recorded before the build so variants that fall back or fail to compile
+  // still reach the manifest
+  if (variant_recorder_) {
+    uint32_t &recorded = recorded_blend_modes_[variant.cache_key()];
+    const uint32_t mode_bit = 1u << index;
+    if (!(recorded & mode_bit)) {
+      recorded |= mode_bit;
+      ShaderVariantManifest::Entry entry;
+      entry.vert_path = vert_path_;
+      entry.frag_path = frag_path_;
+      entry.variant = variant;
+      entry.module_variant =
+          variant_system_
+              ? variant_system_->module_variant(make_build_context(), variant)
+              : variant;
+      entry.blend_mode = static_cast<Material::BlendMode>(index);
+      entry.color_format = VariantData::kColorFormat;
+      variant_recorder_->add(std::move(entry));
+    }
+  }
+
+  VariantData &data = get_or_create_variant(variant);
+
   const rhi::PipelineHandle handle = data.pipelines[index];
   if (handle.id != 0) {
     return handle;
@@ -0,0 +1,255 @@
+#include "pixel/renderer3d/shader_archive.hpp"
+
+#include "pixel/platform/resources.hpp"
+#include "pixel/platform/shader_loader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+namespace pixel::renderer3d {
+
+namespace {
+
+constexpr char kArchiveMagic[8] = {'P', 'X', 'S', 'H', 'A', 'R', '0', '1'};
+constexpr uint32_t kArchiveVersion = 1;
+constexpr size_t kHeaderSize = 24;
+constexpr size_t kEntrySize = 40;
+constexpr size_t kBlobAlignment = 8;
+
+template <typename T> T read_value(const uint8_t *data, size_t offset) {
+  T value;
+  std::memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+template <typename T>
+void write_value(std::vector<uint8_t> &out, size_t offset, T value) {
+  std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+size_t align_up(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+struct EntryRecord {
+  uint64_t hash;
+  uint32_t name_offset;
+  uint32_t name_size;
+  uint64_t bytecode_offset;
+  uint32_t bytecode_size;
+  uint32_t reflection_size;
+  uint64_t reflection_offset;
+};
+
+EntryRecord read_entry(const uint8_t *data, size_t index) {
+  const size_t base = kHeaderSize + index * kEntrySize;
+  EntryRecord record;
+  record.hash = read_value<uint64_t>(data, base);
+  record.name_offset = read_value<uint32_t>(data, base + 8);
+  record.name_size = read_value<uint32_t>(data, base + 12);
+  record.bytecode_offset = read_value<uint64_t>(data, base + 16);
+  record.bytecode_size = read_value<uint32_t>(data, base + 24);
+  record.reflection_size = read_value<uint32_t>(data, base + 28);
+  record.reflection_offset = read_value<uint64_t>(data, base + 32);
+  return record;
+}
+
+bool in_bounds(uint64_t offset, uint64_t size, size_t file_size) {
+  return offset <= file_size && size <= file_size - offset;
+}
+
+} // namespace
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+std::unique_ptr<ShaderArchive> ShaderArchive::open(const std::string &path) {
+  auto file = core::MappedFile::open(path);
+  if (!file) {
+    std::cerr << "ShaderArchive: Cannot open " << path << std::endl;
+    return nullptr;
+  }
+  auto archive = std::unique_ptr<ShaderArchive>(new ShaderArchive());
+  archive->file_ = std::move(file);
+  archive->data_ = reinterpret_cast<const uint8_t *>(archive->file_->bytes().data());
+  if (!archive->parse()) {
+    std::cerr << "ShaderArchive: " << path << " is not a valid shader archive"
+              << std::endl;
+    return nullptr;
+  }
+  return archive;
+}
+
+bool ShaderArchive::parse() {
+  const size_t file_size = file_->size();
+  if (file_size < kHeaderSize ||
+      std::memcmp(data_, kArchiveMagic, sizeof(kArchiveMagic)) != 0 ||
+      read_value<uint32_t>(data_, 8) != kArchiveVersion) {
+    return false;
+  }
+  entry_count_ = read_value<uint32_t>(data_, 12);
+  slot_count_ = read_value<uint32_t>(data_, 16);
+  if (slot_count_ == 0 || (slot_count_ & (slot_count_ - 1)) != 0 ||
+      slot_count_ <= entry_count_ ||
+      !in_bounds(kHeaderSize,
+                 entry_count_ * kEntrySize + slot_count_ * sizeof(uint32_t),
+                 file_size)) {
+    return false;
+  }
+
+  // Validate every record up front so find() can trust offsets
+  for (size_t i = 0; i < entry_count_; ++i) {
+    const EntryRecord record = read_entry(data_, i);
+    if (!in_bounds(record.name_offset, record.name_size, file_size) ||
+        !in_bounds(record.bytecode_offset, record.bytecode_size, file_size) ||
+        !in_bounds(record.reflection_offset, record.reflection_size, file_size) ||
+        record.bytecode_offset % 4 != 0) {
+      return false;
+    }
+  }
+  const size_t slots = kHeaderSize + entry_count_ * kEntrySize;
+  for (size_t i = 0; i < slot_count_; ++i) {
+    if (read_value<uint32_t>(data_, slots + i * sizeof(uint32_t)) > entry_count_)
+      return false;
+  }
+  return true;
+}
+
+const ShaderArchive *ShaderArchive::shared() {
+  static const std::unique_ptr<ShaderArchive> archive =
+      []() -> std::unique_ptr<ShaderArchive> {
+    const std::string path = platform::get_resource_path() + kDefaultPath;
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec))
+      return nullptr;
+    auto opened = open(path);
+    if (opened) {
+      std::cout << "ShaderArchive: Mapped " << opened->size()
+                << " shader stages from " << path << std::endl;
+    }
+    return opened;
+  }();
+  return archive.get();
+}
+
+uint64_t ShaderArchive::hash_key(std::string_view key) {
+  // FNV-1a
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (char c : key) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+std::optional<ShaderArchive::Entry> ShaderArchive::find(std::string_view key) const {
+  const uint64_t hash = hash_key(key);
+  const size_t slots = kHeaderSize + entry_count_ * kEntrySize;
+  const size_t mask = slot_count_ - 1;
+  for (size_t probe = 0; probe < slot_count_; ++probe) {
+    const size_t slot = (static_cast<size_t>(hash) + probe) & mask;
+    const uint32_t index = read_value<uint32_t>(data_, slots + slot * sizeof(uint32_t));
+    if (index == 0)
+      return std::nullopt;
+
+    const EntryRecord record = read_entry(data_, index - 1);
+    if (record.hash != hash || record.name_size != key.size() ||
+        std::memcmp(data_ + record.name_offset, key.data(), key.size()) != 0) {
+      continue;
+    }
+    Entry entry;
+    entry.bytecode = {data_ + record.bytecode_offset, record.bytecode_size};
+    entry.reflection = {data_ + record.reflection_offset, record.reflection_size};
+    return entry;
+  }
+  return std::nullopt;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+void ShaderArchiveWriter::add(std::string key, std::vector<uint8_t> bytecode,
+                              std::vector<uint8_t> reflection) {
+  for (PendingEntry &entry : entries_) {
+    if (entry.key == key) {
+      entry.bytecode = std::move(bytecode);
+      entry.reflection = std::move(reflection);
+      return;
+    }
+  }
+  entries_.push_back({std::move(key), std::move(bytecode), std::move(reflection)});
+}
+
+bool ShaderArchiveWriter::write(const std::string &path) const {
+  // At most half full keeps probe sequences short
+  size_t slot_count = 2;
+  while (slot_count < entries_.size() * 2)
+    slot_count *= 2;
+
+  const size_t slots = kHeaderSize + entries_.size() * kEntrySize;
+  std::vector<uint8_t> out(slots + slot_count * sizeof(uint32_t), 0);
+  std::memcpy(out.data(), kArchiveMagic, sizeof(kArchiveMagic));
+  write_value<uint32_t>(out, 8, kArchiveVersion);
+  write_value<uint32_t>(out, 12, static_cast<uint32_t>(entries_.size()));
+  write_value<uint32_t>(out, 16, static_cast<uint32_t>(slot_count));
+
+  auto append_blob = [&](const uint8_t *data, size_t size, size_t alignment) {
+    out.resize(align_up(out.size(), alignment), 0);
+    const size_t offset = out.size();
+    out.insert(out.end(), data, data + size);
+    return offset;
+  };
+
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const PendingEntry &entry = entries_[i];
+    const uint64_t hash = ShaderArchive::hash_key(entry.key);
+    const size_t name_offset = append_blob(
+        reinterpret_cast<const uint8_t *>(entry.key.data()), entry.key.size(), 1);
+    const size_t bytecode_offset =
+        append_blob(entry.bytecode.data(), entry.bytecode.size(), kBlobAlignment);
+    const size_t reflection_offset = append_blob(
+        entry.reflection.data(), entry.reflection.size(), kBlobAlignment);
+
+    const size_t base = kHeaderSize + i * kEntrySize;
+    write_value<uint64_t>(out, base, hash);
+    write_value<uint32_t>(out, base + 8, static_cast<uint32_t>(name_offset));
+    write_value<uint32_t>(out, base + 12, static_cast<uint32_t>(entry.key.size()));
+    write_value<uint64_t>(out, base + 16, bytecode_offset);
+    write_value<uint32_t>(out, base + 24, static_cast<uint32_t>(entry.bytecode.size()));
+    write_value<uint32_t>(out, base + 28,
+                          static_cast<uint32_t>(entry.reflection.size()));
+    write_value<uint64_t>(out, base + 32, reflection_offset);
+
+    size_t slot = static_cast<size_t>(hash) & (slot_count - 1);
+    while (read_value<uint32_t>(out.data(), slots + slot * sizeof(uint32_t)) != 0)
+      slot = (slot + 1) & (slot_count - 1);
+    write_value<uint32_t>(out, slots + slot * sizeof(uint32_t),
+                          static_cast<uint32_t>(i + 1));
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(out.data()),
+             static_cast<std::streamsize>(out.size()));
+  if (!file) {
+    std::cerr << "ShaderArchiveWriter: Cannot write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::vector<uint8_t> load_spirv_bytecode(const std::string &spirv_path) {
+  if (const ShaderArchive *archive = ShaderArchive::shared()) {
+    if (auto entry = archive->find(spirv_path))
+      return std::vector<uint8_t>(entry->bytecode.begin(), entry->bytecode.end());
+  }
+  return platform::load_shader_bytecode(spirv_path);
+}
+
+} // namespace pixel::renderer3d
@@ -0,0 +1,225 @@
+#include "pixel/renderer3d/shader_compiler.hpp"
+
+#include "pixel/platform/resources.hpp"
+#include "pixel/platform/shader_loader.hpp"
+#include "pixel/renderer3d/renderer.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#if defined(PIXEL_RUNTIME_SHADER_COMPILER)
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+#endif
+
+namespace pixel::renderer3d {
+
+struct ShaderCompiler::Job {
+  std::string source_path;
+  std::string spirv_path;
+  ShaderStage stage{ShaderStage::Unknown};
+  ShaderVariantKey variant;
+  std::promise<bool> done;
+};
+
+namespace {
+
+std::string make_define_preamble(const ShaderVariantKey &variant) {
+  std::string preamble;
+  for (const auto &[name, value] : variant.defines()) {
+    preamble.append("#define ");
+    preamble.append(name);
+    if (!value.empty()) {
+      preamble.push_back(' ');
+      preamble.append(value);
+    }
+    preamble.push_back('\n');
+  }
+  return preamble;
+}
+
+#if defined(PIXEL_RUNTIME_SHADER_COMPILER)
+EShLanguage to_glslang_stage(ShaderStage stage) {
+  switch (stage) {
+  case ShaderStage::Vertex:
+    return EShLangVertex;
+  case ShaderStage::Fragment:
+    return EShLangFragment;
+  case ShaderStage::Compute:
+    return EShLangCompute;
+  case ShaderStage::Unknown:
+    break;
+  }
+  throw std::runtime_error("unsupported shader stage");
+}
+#endif
+
+} // namespace
+
+bool ShaderCompiler::available() {
+#if defined(PIXEL_RUNTIME_SHADER_COMPILER)
+  return true;
+#else
+  return false;
+#endif
+}
+
+ShaderCompiler &ShaderCompiler::shared() {
+  static ShaderCompiler compiler;
+  return compiler;
+}
+
+ShaderCompiler::~ShaderCompiler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+std::vector<uint32_t> ShaderCompiler::compile(std::string_view source,
+                                              ShaderStage stage,
+                                              const ShaderVariantKey &variant,
+                                              std::string_view name) {
+#if defined(PIXEL_RUNTIME_SHADER_COMPILER)
+  // Never finalized; the symbol tables are shared by every later compile
+  static const bool initialized = glslang::InitializeProcess();
+  (void)initialized;
+
+  // Same environment glslangValidator -V targets for the build-time variants
+  const EShLanguage language = to_glslang_stage(stage);
+  const std::string preamble = make_define_preamble(variant);
+  const std::string label(name);
+  const char *strings[] = {source.data()};
+  const int lengths[] = {static_cast<int>(source.size())};
+  const char *names[] = {label.c_str()};
+
+  glslang::TShader shader(language);
+  shader.setStringsWithLengthsAndNames(strings, lengths, names, 1);
+  shader.setPreamble(preamble.c_str());
+  shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan,
+                     100);
+  shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+  shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+
+  const auto messages =
+      static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+  if (!shader.parse(GetDefaultResources(), 100, false, messages)) {
+    throw std::runtime_error(label + ": " + shader.getInfoLog());
+  }
+
+  glslang::TProgram program;
+  program.addShader(&shader);
+  if (!program.link(messages)) {
+    throw std::runtime_error(label + ": " + program.getInfoLog());
+  }
+
+  std::vector<uint32_t> words;
+  glslang::GlslangToSpv(*program.getIntermediate(language), words);
+  if (words.empty()) {
+    throw std::runtime_error(label + ": SPIR-V generation produced no code");
+  }
+  return words;
+#else
+  (void)source;
+  (void)stage;
+  (void)variant;
+  throw std::runtime_error(std::string(name) +
+                           ": built without PIXEL_RUNTIME_SHADER_COMPILER");
+#endif
+}
+
+std::shared_future<bool> ShaderCompiler::request(const std::string &source_path,
+                                                 const std::string &spirv_path,
+                                                 ShaderStage stage,
+                                                 const ShaderVariantKey &variant) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = jobs_.find(spirv_path);
+  if (it != jobs_.end()) {
+    return it->second;
+  }
+
+  auto job = std::make_shared<Job>();
+  job->source_path = source_path;
+  job->spirv_path = spirv_path;
+  job->stage = stage;
+  job->variant = variant;
+  std::shared_future<bool> result = job->done.get_future().share();
+  jobs_.emplace(spirv_path, result);
+  queue_.push_back(std::move(job));
+
+  if (!worker_.joinable()) {
+    worker_ = std::thread(&ShaderCompiler::worker_loop, this);
+  }
+  work_available_.notify_one();
+  std::cout << "ShaderCompiler: Queued " << spirv_path << std::endl;
+  return result;
+}
+
+void ShaderCompiler::worker_loop() {
+  for (;;) {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_available_.wait(lock,
+                           [this] { return stopping_ || !queue_.empty(); });
+      if (stopping_) {
+        // Unblock anyone still waiting on abandoned jobs
+        for (auto &pending : queue_) {
+          pending->done.set_value(false);
+        }
+        queue_.clear();
+        return;
+      }
+      job = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    job->done.set_value(run(*job));
+  }
+}
+
+bool ShaderCompiler::run(const Job &job) {
+  namespace fs = std::filesystem;
+  try {
+    const std::string source = platform::load_shader_file(job.source_path);
+    const std::vector<uint32_t> words =
+        compile(source, job.stage, job.variant, job.source_path);
+
+    // Written beside a temporary name first so a concurrent load never reads
+    // a partial file
+    const fs::path output = fs::path(platform::get_resource_path()) / job.spirv_path;
+    fs::path temporary = output;
+    temporary += ".tmp";
+    std::error_code ec;
+    fs::create_directories(output.parent_path(), ec);
+    {
+      std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char *>(words.data()),
+                static_cast<std::streamsize>(words.size() * sizeof(uint32_t)));
+      if (!out) {
+        throw std::runtime_error("unable to write " + temporary.string());
+      }
+    }
+    fs::rename(temporary, output, ec);
+    if (ec) {
+      fs::remove(temporary, ec);
+      throw std::runtime_error("unable to write " + output.string());
+    }
+    std::cout << "ShaderCompiler: Compiled " << job.spirv_path << std::endl;
+    return true;
+  } catch (const std::exception &e) {
+    std::cerr << "ShaderCompiler: Failed to compile " << job.spirv_path << ": "
+              << e.what() << std::endl;
+    return false;
+  }
+}
+
+} // namespace pixel::renderer3d
@@ -3,11 +3,14 @@
 #include <spirv_reflect.h>
 
 #include <algorithm>
+#include <array>
 #include <cctype>
 #include <cstdint>
+#include <cstring>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -182,6 +185,14 @@ bool ShaderBlock::uses_stage(ShaderStage stage) const {
   return (stage_mask & stage_bit_value(stage)) != 0;
 }
 
+void ShaderSpecializationConstant::add_stage(ShaderStage stage) {
+  stage_mask |= stage_bit_value(stage);
+}
+
+bool ShaderSpecializationConstant::uses_stage(ShaderStage stage) const {
+  return (stage_mask & stage_bit_value(stage)) != 0;
+}
+
 uint32_t ShaderReflection::stage_bit(ShaderStage stage) {
   return stage_bit_value(stage);
 }
@@ -248,6 +259,19 @@ void ShaderReflection::add_block(ShaderBlock block) {
   add_lookup(blocks_order_.back().instance_name, index);
 }
 
+void ShaderReflection::add_specialization_constant(
+    ShaderSpecializationConstant constant) {
+  for (ShaderSpecializationConstant &existing : specialization_constants_) {
+    if (existing.constant_id != constant.constant_id)
+      continue;
+    existing.stage_mask |= constant.stage_mask;
+    if (existing.type == ShaderUniformType::Unknown)
+      existing.type = constant.type;
+    return;
+  }
+  specialization_constants_.push_back(std::move(constant));
+}
+
 void ShaderReflection::merge(const ShaderReflection &other) {
   for (const auto &[name, uniform] : other.uniforms_) {
     add_uniform(uniform);
@@ -256,6 +280,10 @@ void ShaderReflection::merge(const ShaderReflection &other) {
   for (const auto &block : other.blocks_order_) {
     add_block(block);
   }
+
+  for (const auto &constant : other.specialization_constants_) {
+    add_specialization_constant(constant);
+  }
 }
 
 bool ShaderReflection::has_uniform(std::string_view name) const {
@@ -309,6 +337,15 @@ std::optional<uint32_t> ShaderReflection::binding_for_block(
   return block->binding;
 }
 
+const ShaderSpecializationConstant *
+ShaderReflection::find_specialization_constant(std::string_view name) const {
+  for (const ShaderSpecializationConstant &constant : specialization_constants_) {
+    if (constant.name == name)
+      return &constant;
+  }
+  return nullptr;
+}
+
 ShaderReflection reflect_spirv(std::span<const uint32_t> words,
                                ShaderStage stage) {
   ShaderReflection reflection;
@@ -406,6 +443,303 @@ ShaderReflection reflect_spirv(std::span<const uint32_t> words,
   }
 
   destroy_module();
+
+  for (ShaderSpecializationConstant &constant :
+       reflect_specialization_constants(words, stage)) {
+    reflection.add_specialization_constant(std::move(constant));
+  }
+  return reflection;
+}
+
+// ============================================================================
+// Specialization constants
+// ============================================================================
+
+namespace {
+
+constexpr uint32_t kSpirvMagic = 0x07230203;
+constexpr size_t kSpirvHeaderWords = 5;
+constexpr uint32_t kOpName = 5;
+constexpr uint32_t kOpTypeBool = 20;
+constexpr uint32_t kOpTypeInt = 21;
+constexpr uint32_t kOpTypeFloat = 22;
+constexpr uint32_t kOpSpecConstantTrue = 48;
+constexpr uint32_t kOpSpecConstantFalse = 49;
+constexpr uint32_t kOpSpecConstant = 50;
+constexpr uint32_t kOpDecorate = 71;
+constexpr uint32_t kDecorationSpecId = 1;
+
+std::string spirv_string(std::span<const uint32_t> operands) {
+  std::string value;
+  for (uint32_t word : operands) {
+    for (int byte = 0; byte < 4; ++byte) {
+      const char c = static_cast<char>((word >> (byte * 8)) & 0xFFu);
+      if (c == '\0')
+        return value;
+      value.push_back(c);
+    }
+  }
+  return value;
+}
+
+} // namespace
+
+std::vector<ShaderSpecializationConstant>
+reflect_specialization_constants(std::span<const uint32_t> words,
+                                 ShaderStage stage) {
+  if (words.size() < kSpirvHeaderWords || words[0] != kSpirvMagic) {
+    throw std::runtime_error("SPIR-V module has no valid header");
+  }
+
+  struct Declaration {
+    uint32_t result_id;
+    uint32_t type_id;
+    uint32_t value;
+  };
+  std::vector<Declaration> declarations;
+  std::unordered_map<uint32_t, uint32_t> spec_ids;
+  std::unordered_map<uint32_t, std::string> names;
+  std::unordered_map<uint32_t, ShaderUniformType> types;
+
+  size_t offset = kSpirvHeaderWords;
+  while (offset < words.size()) {
+    const uint32_t word_count = words[offset] >> 16;
+    const uint32_t opcode = words[offset] & 0xFFFFu;
+    if (word_count == 0 || word_count > words.size() - offset) {
+      throw std::runtime_error("SPIR-V instruction runs past the module end");
+    }
+    const std::span<const uint32_t> operands =
+        words.subspan(offset + 1, word_count - 1);
+    offset += word_count;
+
+    switch (opcode) {
+    case kOpName:
+      if (operands.size() >= 2)
+        names[operands[0]] = spirv_string(operands.subspan(1));
+      break;
+    case kOpTypeBool:
+      if (operands.size() >= 1)
+        types[operands[0]] = ShaderUniformType::Bool;
+      break;
+    case kOpTypeInt:
+      if (operands.size() >= 3) {
+        types[operands[0]] =
+            operands[2] != 0 ? ShaderUniformType::Int : ShaderUniformType::UInt;
+      }
+      break;
+    case kOpTypeFloat:
+      if (operands.size() >= 1)
+        types[operands[0]] = ShaderUniformType::Float;
+      break;
+    case kOpSpecConstantTrue:
+    case kOpSpecConstantFalse:
+      if (operands.size() >= 2) {
+        declarations.push_back(
+            {operands[1], operands[0], opcode == kOpSpecConstantTrue ? 1u : 0u});
+      }
+      break;
+    case kOpSpecConstant:
+      if (operands.size() >= 3)
+        declarations.push_back({operands[1], operands[0], operands[2]});
+      break;
+    case kOpDecorate:
+      if (operands.size() >= 3 && operands[1] == kDecorationSpecId)
+        spec_ids[operands[0]] = operands[2];
+      break;
+    default:
+      break;
+    }
+  }
+
+  std::vector<ShaderSpecializationConstant> constants;
+  for (const Declaration &declaration : declarations) {
+    auto spec_id = spec_ids.find(declaration.result_id);
+    if (spec_id == spec_ids.end())
+      continue;
+
+    ShaderSpecializationConstant constant;
+    constant.constant_id = spec_id->second;
+    auto name = names.find(declaration.result_id);
+    constant.name = name != names.end() && !name->second.empty()
+                        ? name->second
+                        : "constant_" + std::to_string(constant.constant_id);
+    auto type = types.find(declaration.type_id);
+    constant.type =
+        type != types.end() ? type->second : ShaderUniformType::Unknown;
+    constant.default_value = declaration.value;
+    constant.add_stage(stage);
+    constants.push_back(std::move(constant));
+  }
+  return constants;
+}
+
+// ============================================================================
+// Serialization
+// ============================================================================
+
+namespace {
+
+constexpr std::array<char, 8> kReflectionMagic{'P', 'X', 'R', 'E', 'F', 'L', 'C', '1'};
+// Version 2 appends specialization constants
+constexpr uint32_t kReflectionVersion = 2;
+
+class ReflectionWriter {
+public:
+  template <typename T> void put(const T &value) {
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+    out_.insert(out_.end(), bytes, bytes + sizeof(T));
+  }
+
+  void put_string(const std::string &value) {
+    put(static_cast<uint32_t>(value.size()));
+    out_.insert(out_.end(), value.begin(), value.end());
+  }
+
+  void put_binding(const std::optional<uint32_t> &binding) {
+    put(binding ? static_cast<int32_t>(*binding) : static_cast<int32_t>(-1));
+  }
+
+  std::vector<uint8_t> take() { return std::move(out_); }
+
+private:
+  std::vector<uint8_t> out_;
+};
+
+class ReflectionReader {
+public:
+  explicit ReflectionReader(std::span<const uint8_t> bytes) : bytes_(bytes) {}
+
+  template <typename T> T get(const char *what) {
+    T value;
+    std::memcpy(&value, take(sizeof(T), what), sizeof(T));
+    return value;
+  }
+
+  std::string get_string() {
+    const uint32_t size = get<uint32_t>("string length");
+    const uint8_t *data = take(size, "string payload");
+    return std::string(reinterpret_cast<const char *>(data), size);
+  }
+
+  std::optional<uint32_t> get_binding() {
+    const int32_t binding = get<int32_t>("binding");
+    if (binding < 0)
+      return std::nullopt;
+    return static_cast<uint32_t>(binding);
+  }
+
+private:
+  const uint8_t *take(size_t size, const char *what) {
+    if (size > bytes_.size() - offset_) {
+      throw std::runtime_error(std::string("truncated reflection data reading ") +
+                               what);
+    }
+    const uint8_t *data = bytes_.data() + offset_;
+    offset_ += size;
+    return data;
+  }
+
+  std::span<const uint8_t> bytes_;
+  size_t offset_ = 0;
+};
+
+} // namespace
+
+std::vector<uint8_t> serialize_reflection(const ShaderReflection &reflection) {
+  ReflectionWriter out;
+  out.put(kReflectionMagic);
+  out.put(kReflectionVersion);
+
+  const auto uniforms = reflection.uniforms();
+  out.put(static_cast<uint32_t>(uniforms.size()));
+  for (const auto &[name, uniform] : uniforms) {
+    out.put_string(name);
+    out.put(static_cast<uint8_t>(uniform.type));
+    out.put(uniform.array_size);
+    out.put(uniform.stage_mask);
+    out.put_binding(uniform.binding);
+  }
+
+  const auto blocks = reflection.blocks();
+  out.put(static_cast<uint32_t>(blocks.size()));
+  for (const ShaderBlock &block : blocks) {
+    out.put(static_cast<uint8_t>(block.type));
+    out.put_string(block.block_name);
+    out.put_string(block.instance_name);
+    out.put(block.stage_mask);
+    out.put_binding(block.binding);
+    out.put(static_cast<uint32_t>(block.members.size()));
+    for (const ShaderBlockMember &member : block.members) {
+      out.put_string(member.name);
+      out.put(static_cast<uint8_t>(member.type));
+      out.put(member.array_size);
+    }
+  }
+
+  const auto &constants = reflection.specialization_constants();
+  out.put(static_cast<uint32_t>(constants.size()));
+  for (const ShaderSpecializationConstant &constant : constants) {
+    out.put_string(constant.name);
+    out.put(static_cast<uint8_t>(constant.type));
+    out.put(constant.constant_id);
+    out.put(constant.default_value);
+    out.put(constant.stage_mask);
+  }
+  return out.take();
+}
+
+ShaderReflection deserialize_reflection(std::span<const uint8_t> bytes) {
+  ReflectionReader in(bytes);
+  if (in.get<std::array<char, 8>>("header") != kReflectionMagic)
+    throw std::runtime_error("unexpected reflection header magic");
+  const uint32_t version = in.get<uint32_t>("version");
+  if (version == 0 || version > kReflectionVersion)
+    throw std::runtime_error("unsupported reflection version");
+
+  ShaderReflection reflection;
+  const uint32_t uniform_count = in.get<uint32_t>("uniform count");
+  for (uint32_t i = 0; i < uniform_count; ++i) {
+    ShaderUniform uniform;
+    uniform.name = in.get_string();
+    uniform.type = static_cast<ShaderUniformType>(in.get<uint8_t>("uniform type"));
+    uniform.array_size = in.get<uint32_t>("uniform array size");
+    uniform.stage_mask = in.get<uint32_t>("uniform stages");
+    uniform.binding = in.get_binding();
+    reflection.add_uniform(std::move(uniform));
+  }
+
+  const uint32_t block_count = in.get<uint32_t>("block count");
+  for (uint32_t i = 0; i < block_count; ++i) {
+    ShaderBlock block;
+    block.type = static_cast<ShaderBlockType>(in.get<uint8_t>("block type"));
+    block.block_name = in.get_string();
+    block.instance_name = in.get_string();
+    block.stage_mask = in.get<uint32_t>("block stages");
+    block.binding = in.get_binding();
+    const uint32_t member_count = in.get<uint32_t>("member count");
+    for (uint32_t m = 0; m < member_count; ++m) {
+      ShaderBlockMember member;
+      member.name = in.get_string();
+      member.type = static_cast<ShaderUniformType>(in.get<uint8_t>("member type"));
+      member.array_size = in.get<uint32_t>("member array size");
+      block.members.push_back(std::move(member));
+    }
+    reflection.add_block(std::move(block));
+  }
+
+  if (version >= 2) {
+    const uint32_t constant_count = in.get<uint32_t>("constant count");
+    for (uint32_t i = 0; i < constant_count; ++i) {
+      ShaderSpecializationConstant constant;
+      constant.name = in.get_string();
+      constant.type =
+          static_cast<ShaderUniformType>(in.get<uint8_t>("constant type"));
+      constant.constant_id = in.get<uint32_t>("constant id");
+      constant.default_value = in.get<uint32_t>("constant default");
+      constant.stage_mask = in.get<uint32_t>("constant stages");
+      reflection.add_specialization_constant(std::move(constant));
+    }
+  }
   return reflection;
 }
 
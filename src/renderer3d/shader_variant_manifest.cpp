@@ -0,0 +1,229 @@
+#include "pixel/renderer3d/shader_variant_manifest.hpp"
+
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+namespace pixel::renderer3d {
+
+namespace {
+
+constexpr std::array<std::pair<Material::BlendMode, const char *>,
+                     Material::kBlendModeCount>
+    kBlendModes = {{
+        {Material::BlendMode::Alpha, "Alpha"},
+        {Material::BlendMode::Additive, "Additive"},
+        {Material::BlendMode::Multiply, "Multiply"},
+        {Material::BlendMode::Opaque, "Opaque"},
+    }};
+
+// Formats a pipeline can render to
+constexpr std::pair<rhi::Format, const char *> kColorFormats[] = {
+    {rhi::Format::RGBA8, "RGBA8"},
+    {rhi::Format::BGRA8, "BGRA8"},
+    {rhi::Format::RGBA8Srgb, "RGBA8Srgb"},
+    {rhi::Format::R8, "R8"},
+    {rhi::Format::R16F, "R16F"},
+    {rhi::Format::RG16F, "RG16F"},
+    {rhi::Format::RGBA16F, "RGBA16F"},
+};
+
+template <typename Value, typename Table>
+const char *find_name(const Table &table, Value value) {
+  for (const auto &[entry_value, name] : table) {
+    if (entry_value == value)
+      return name;
+  }
+  return nullptr;
+}
+
+template <typename Value, typename Table>
+std::optional<Value> find_value(const Table &table, std::string_view name) {
+  for (const auto &[value, entry_name] : table) {
+    if (name == entry_name)
+      return value;
+  }
+  return std::nullopt;
+}
+
+// The build passes defines to glslangValidator as -DNAME=VALUE and names the
+// .spv after them, so only plain tokens survive the trip; an empty value
+// would be compiled as "1"
+bool is_define_token(std::string_view token) {
+  if (token.empty())
+    return false;
+  for (char c : token) {
+    const unsigned char uc = static_cast<unsigned char>(c);
+    if (uc <= ' ' || c == ',' || c == '=' || c == ';' || c == '|' || c == 0x7f)
+      return false;
+  }
+  return true;
+}
+
+bool is_representable(const ShaderVariantKey &variant) {
+  for (const auto &[name, value] : variant.defines()) {
+    if (!is_define_token(name) || !is_define_token(value))
+      return false;
+  }
+  return true;
+}
+
+bool is_path_field(const std::string &path) {
+  return !path.empty() && path.find_first_of("\t\r\n") == std::string::npos;
+}
+
+// Unlike getline, keeps a trailing empty field (empty <defines>)
+std::vector<std::string_view> split_fields(std::string_view line) {
+  std::vector<std::string_view> fields;
+  size_t start = 0;
+  for (;;) {
+    const size_t tab = line.find('\t', start);
+    fields.push_back(line.substr(start, tab - start));
+    if (tab == std::string_view::npos)
+      break;
+    start = tab + 1;
+  }
+  return fields;
+}
+
+} // namespace
+
+std::string ShaderVariantManifest::format_defines(const ShaderVariantKey &variant) {
+  std::string text;
+  for (const auto &[name, value] : variant.defines()) {
+    if (!text.empty())
+      text.push_back(',');
+    text.append(name);
+    text.push_back('=');
+    text.append(value);
+  }
+  return text;
+}
+
+std::optional<ShaderVariantKey>
+ShaderVariantManifest::parse_defines(std::string_view text) {
+  ShaderVariantKey variant;
+  while (!text.empty()) {
+    const size_t comma = text.find(',');
+    const std::string_view define = text.substr(0, comma);
+    text = comma == std::string_view::npos ? std::string_view{}
+                                           : text.substr(comma + 1);
+    if (define.empty())
+      continue;
+
+    // NAME alone means NAME=1, as in PIXEL_SHADER_VARIANTS
+    const size_t equals = define.find('=');
+    const std::string_view name = define.substr(0, equals);
+    const std::string_view value =
+        equals == std::string_view::npos ? "1" : define.substr(equals + 1);
+    if (!is_define_token(name) || !is_define_token(value))
+      return std::nullopt;
+    variant.set_define(std::string(name), std::string(value));
+  }
+  return variant;
+}
+
+std::optional<ShaderVariantManifest>
+ShaderVariantManifest::load(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "ShaderVariantManifest: Cannot open " << path << std::endl;
+    return std::nullopt;
+  }
+
+  ShaderVariantManifest manifest;
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(file, line)) {
+    ++line_number;
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    const std::vector<std::string_view> fields = split_fields(line);
+    bool ok = false;
+    if (fields[0] == "variant" && fields.size() == 7) {
+      Entry entry;
+      entry.vert_path = fields[1];
+      entry.frag_path = fields[2];
+      const auto blend_mode =
+          find_value<Material::BlendMode>(kBlendModes, fields[3]);
+      const auto color_format = find_value<rhi::Format>(kColorFormats, fields[4]);
+      auto module_variant = parse_defines(fields[5]);
+      auto variant = parse_defines(fields[6]);
+      ok = blend_mode && color_format && module_variant && variant &&
+           is_path_field(entry.vert_path) && is_path_field(entry.frag_path);
+      if (ok) {
+        entry.blend_mode = *blend_mode;
+        entry.color_format = *color_format;
+        entry.module_variant = std::move(*module_variant);
+        entry.variant = std::move(*variant);
+        manifest.add(std::move(entry));
+      }
+    }
+    if (!ok) {
+      std::cerr << "ShaderVariantManifest: " << path << ":" << line_number
+                << ": Malformed record" << std::endl;
+      return std::nullopt;
+    }
+  }
+  return manifest;
+}
+
+bool ShaderVariantManifest::save(const std::string &path) const {
+  std::ofstream file(path, std::ios::trunc);
+  file << "# pixel shader variant manifest\n";
+  file << "# variant\t<vert>\t<frag>\t<blend>\t<format>\t<module defines>"
+          "\t<defines>\n";
+  for (const Entry &entry : entries_) {
+    file << make_record(entry) << '\n';
+  }
+  if (!file) {
+    std::cerr << "ShaderVariantManifest: Cannot write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool ShaderVariantManifest::add(Entry entry) {
+  if (!is_path_field(entry.vert_path) || !is_path_field(entry.frag_path) ||
+      !find_name(kBlendModes, entry.blend_mode) ||
+      !find_name(kColorFormats, entry.color_format) ||
+      !is_representable(entry.variant) ||
+      !is_representable(entry.module_variant)) {
+    return false;
+  }
+  if (!records_.insert(make_record(entry)).second) {
+    return false;
+  }
+  entries_.push_back(std::move(entry));
+  return true;
+}
+
+void ShaderVariantManifest::merge(const ShaderVariantManifest &other) {
+  for (const Entry &entry : other.entries_) {
+    add(entry);
+  }
+}
+
+std::string ShaderVariantManifest::make_record(const Entry &entry) {
+  std::string record = "variant\t";
+  record.append(entry.vert_path);
+  record.push_back('\t');
+  record.append(entry.frag_path);
+  record.push_back('\t');
+  record.append(find_name(kBlendModes, entry.blend_mode));
+  record.push_back('\t');
+  record.append(find_name(kColorFormats, entry.color_format));
+  record.push_back('\t');
+  record.append(format_defines(entry.module_variant));
+  record.push_back('\t');
+  record.append(format_defines(entry.variant));
+  return record;
+}
+
+} // namespace pixel::renderer3d
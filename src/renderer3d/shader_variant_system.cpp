@@ -1,18 +1,27 @@
 #include "pixel/renderer3d/shader_variant_system.hpp"
 
+#include "pixel/platform/resources.hpp"
 #include "pixel/platform/shader_loader.hpp"
 #include "pixel/renderer3d/renderer.hpp"
+#include "pixel/renderer3d/shader_archive.hpp"
+#include "pixel/renderer3d/shader_compiler.hpp"
 
 #include <array>
+#include <bit>
 #include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <system_error>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -86,31 +95,6 @@ void ensure_directory_for_file(const std::string &path) {
   }
 }
 
-void write_string(std::ofstream &out, const std::string &value) {
-  const uint32_t size = static_cast<uint32_t>(value.size());
-  out.write(reinterpret_cast<const char *>(&size), sizeof(size));
-  if (size > 0) {
-    out.write(value.data(), static_cast<std::streamsize>(size));
-  }
-}
-
-std::string read_string(std::ifstream &in) {
-  uint32_t size = 0;
-  in.read(reinterpret_cast<char *>(&size), sizeof(size));
-  if (!in)
-    throw std::runtime_error("Failed to read string length from reflection cache");
-  std::string value(size, '\0');
-  if (size > 0) {
-    in.read(value.data(), static_cast<std::streamsize>(size));
-    if (!in)
-      throw std::runtime_error("Failed to read string payload from reflection cache");
-  }
-  return value;
-}
-
-constexpr std::array<char, 8> kReflectionCacheMagic{'P', 'X', 'R', 'E', 'F', 'L', 'C', '1'};
-constexpr uint32_t kReflectionCacheVersion = 1;
-
 void write_reflection_cache(const ShaderReflection &reflection,
                             const std::string &path) {
   try {
@@ -118,52 +102,11 @@ void write_reflection_cache(const ShaderReflection &reflection,
     std::ofstream out(path, std::ios::binary | std::ios::trunc);
     if (!out)
       throw std::runtime_error("unable to open file for writing");
-
-    out.write(kReflectionCacheMagic.data(),
-              static_cast<std::streamsize>(kReflectionCacheMagic.size()));
-    out.write(reinterpret_cast<const char *>(&kReflectionCacheVersion),
-              sizeof(kReflectionCacheVersion));
-
-    const auto uniforms = reflection.uniforms();
-    const uint32_t uniform_count = static_cast<uint32_t>(uniforms.size());
-    out.write(reinterpret_cast<const char *>(&uniform_count), sizeof(uniform_count));
-    for (const auto &[name, uniform] : uniforms) {
-      write_string(out, name);
-      const uint8_t type = static_cast<uint8_t>(uniform.type);
-      out.write(reinterpret_cast<const char *>(&type), sizeof(type));
-      out.write(reinterpret_cast<const char *>(&uniform.array_size),
-                sizeof(uniform.array_size));
-      out.write(reinterpret_cast<const char *>(&uniform.stage_mask),
-                sizeof(uniform.stage_mask));
-      const int32_t binding = uniform.binding ? static_cast<int32_t>(*uniform.binding)
-                                              : static_cast<int32_t>(-1);
-      out.write(reinterpret_cast<const char *>(&binding), sizeof(binding));
-    }
-
-    const auto blocks = reflection.blocks();
-    const uint32_t block_count = static_cast<uint32_t>(blocks.size());
-    out.write(reinterpret_cast<const char *>(&block_count), sizeof(block_count));
-    for (const ShaderBlock &block : blocks) {
-      const uint8_t type = static_cast<uint8_t>(block.type);
-      out.write(reinterpret_cast<const char *>(&type), sizeof(type));
-      write_string(out, block.block_name);
-      write_string(out, block.instance_name);
-      out.write(reinterpret_cast<const char *>(&block.stage_mask),
-                sizeof(block.stage_mask));
-      const int32_t binding = block.binding ? static_cast<int32_t>(*block.binding)
-                                            : static_cast<int32_t>(-1);
-      out.write(reinterpret_cast<const char *>(&binding), sizeof(binding));
-
-      const uint32_t member_count = static_cast<uint32_t>(block.members.size());
-      out.write(reinterpret_cast<const char *>(&member_count), sizeof(member_count));
-      for (const ShaderBlockMember &member : block.members) {
-        write_string(out, member.name);
-        const uint8_t member_type = static_cast<uint8_t>(member.type);
-        out.write(reinterpret_cast<const char *>(&member_type), sizeof(member_type));
-        out.write(reinterpret_cast<const char *>(&member.array_size),
-                  sizeof(member.array_size));
-      }
-    }
+    const std::vector<uint8_t> bytes = serialize_reflection(reflection);
+    out.write(reinterpret_cast<const char *>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+    if (!out)
+      throw std::runtime_error("unable to write file");
   } catch (const std::exception &e) {
     std::cerr << "  Warning: Failed to persist shader reflection cache '" << path
               << "': " << e.what() << std::endl;
@@ -176,86 +119,108 @@ std::optional<ShaderReflection> load_reflection_cache(const std::string &path) {
     return std::nullopt;
 
   try {
-    std::ifstream in(path, std::ios::binary);
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
     if (!in)
       throw std::runtime_error("unable to open file for reading");
-
-    std::array<char, kReflectionCacheMagic.size()> magic{};
-    in.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+    std::vector<uint8_t> bytes(static_cast<size_t>(in.tellg()));
+    in.seekg(0, std::ios::beg);
+    in.read(reinterpret_cast<char *>(bytes.data()),
+            static_cast<std::streamsize>(bytes.size()));
     if (!in)
-      throw std::runtime_error("unable to read cache header");
-    if (magic != kReflectionCacheMagic)
-      throw std::runtime_error("unexpected cache header magic");
-
-    uint32_t version = 0;
-    in.read(reinterpret_cast<char *>(&version), sizeof(version));
-    if (!in)
-      throw std::runtime_error("unable to read cache version");
-    if (version != kReflectionCacheVersion)
-      throw std::runtime_error("unsupported reflection cache version");
+      throw std::runtime_error("unable to read file");
+    return deserialize_reflection(bytes);
+  } catch (const std::exception &e) {
+    std::cerr << "  Warning: Failed to load shader reflection cache '" << path
+              << "': " << e.what() << std::endl;
+    return std::nullopt;
+  }
+}
 
-    ShaderReflection reflection;
+// One compiled stage: from the shader archive when it holds the variant
+// (bytecode mapped, reflection precomputed at build time), otherwise from the
+// loose .spv file
+struct StageBinary {
+  std::span<const uint8_t> bytecode;
+  std::vector<uint8_t> storage;
+  std::span<const uint8_t> archived_reflection;
+  bool from_archive = false;
+};
 
-    uint32_t uniform_count = 0;
-    in.read(reinterpret_cast<char *>(&uniform_count), sizeof(uniform_count));
-    if (!in)
-      throw std::runtime_error("unable to read uniform count");
-    for (uint32_t i = 0; i < uniform_count; ++i) {
-      ShaderUniform uniform;
-      uniform.name = read_string(in);
-      uint8_t type = 0;
-      in.read(reinterpret_cast<char *>(&type), sizeof(type));
-      uniform.type = static_cast<ShaderUniformType>(type);
-      in.read(reinterpret_cast<char *>(&uniform.array_size), sizeof(uniform.array_size));
-      in.read(reinterpret_cast<char *>(&uniform.stage_mask), sizeof(uniform.stage_mask));
-      int32_t binding = -1;
-      in.read(reinterpret_cast<char *>(&binding), sizeof(binding));
-      if (binding >= 0)
-        uniform.binding = static_cast<uint32_t>(binding);
-      reflection.add_uniform(std::move(uniform));
+StageBinary load_stage_binary(const std::string &spirv_path) {
+  StageBinary stage;
+  if (const ShaderArchive *archive = ShaderArchive::shared()) {
+    if (auto entry = archive->find(spirv_path)) {
+      stage.bytecode = entry->bytecode;
+      stage.archived_reflection = entry->reflection;
+      stage.from_archive = true;
+      return stage;
     }
+  }
+  stage.storage = platform::load_shader_bytecode(spirv_path);
+  stage.bytecode = std::span<const uint8_t>(stage.storage);
+  return stage;
+}
 
-    uint32_t block_count = 0;
-    in.read(reinterpret_cast<char *>(&block_count), sizeof(block_count));
-    if (!in)
-      throw std::runtime_error("unable to read block count");
-    for (uint32_t i = 0; i < block_count; ++i) {
-      ShaderBlock block;
-      uint8_t type = 0;
-      in.read(reinterpret_cast<char *>(&type), sizeof(type));
-      block.type = static_cast<ShaderBlockType>(type);
-      block.block_name = read_string(in);
-      block.instance_name = read_string(in);
-      in.read(reinterpret_cast<char *>(&block.stage_mask), sizeof(block.stage_mask));
-      int32_t binding = -1;
-      in.read(reinterpret_cast<char *>(&binding), sizeof(binding));
-      if (binding >= 0)
-        block.binding = static_cast<uint32_t>(binding);
-
-      uint32_t member_count = 0;
-      in.read(reinterpret_cast<char *>(&member_count), sizeof(member_count));
-      block.members.reserve(member_count);
-      for (uint32_t m = 0; m < member_count; ++m) {
-        ShaderBlockMember member;
-        member.name = read_string(in);
-        uint8_t member_type = 0;
-        in.read(reinterpret_cast<char *>(&member_type), sizeof(member_type));
-        member.type = static_cast<ShaderUniformType>(member_type);
-        in.read(reinterpret_cast<char *>(&member.array_size), sizeof(member.array_size));
-        block.members.push_back(std::move(member));
-      }
+ShaderStage stage_from_source_path(std::string_view source_path) {
+  const std::string extension =
+      std::filesystem::path(source_path).extension().string();
+  if (extension == ".vert")
+    return ShaderStage::Vertex;
+  if (extension == ".frag")
+    return ShaderStage::Fragment;
+  if (extension == ".comp")
+    return ShaderStage::Compute;
+  return ShaderStage::Unknown;
+}
 
-      reflection.add_block(std::move(block));
-    }
+bool stage_binary_exists(const std::string &spirv_path) {
+  if (const ShaderArchive *archive = ShaderArchive::shared()) {
+    if (archive->find(spirv_path))
+      return true;
+  }
+  std::error_code ec;
+  return std::filesystem::exists(platform::get_resource_path() + spirv_path, ec);
+}
 
-    return reflection;
-  } catch (const std::exception &e) {
-    std::cerr << "  Warning: Failed to load shader reflection cache '" << path
-              << "': " << e.what() << std::endl;
+// Variants missing from PIXEL_SHADER_VARIANTS are compiled from the GLSL
+// source when the runtime compiler is built in. The SPIR-V is cached under
+// the same make_spirv_path() name, so the next launch loads it directly.
+// Returns nullopt when the stage is already available or cannot be compiled.
+std::optional<std::shared_future<bool>>
+compile_missing_stage(const std::string &source_path,
+                      const ShaderVariantKey &variant) {
+  if (!ShaderCompiler::available())
+    return std::nullopt;
+  const std::string spirv_path = make_spirv_path(source_path, variant);
+  if (stage_binary_exists(spirv_path))
     return std::nullopt;
+  return ShaderCompiler::shared().request(
+      source_path, spirv_path, stage_from_source_path(source_path), variant);
+}
+
+bool stage_compile_pending(const std::string &source_path,
+                           const ShaderVariantKey &variant) {
+  auto pending = compile_missing_stage(source_path, variant);
+  return pending && pending->wait_for(std::chrono::seconds(0)) !=
+                        std::future_status::ready;
+}
+
+void wait_for_missing_stages(const ShaderVariantBuildContext &context,
+                             const ShaderVariantKey &variant) {
+  for (const std::string *source_path : {&context.vert_path, &context.frag_path}) {
+    if (auto pending = compile_missing_stage(*source_path, variant))
+      pending->wait();
   }
 }
 
+ShaderReflection reflect_stage_binary(const ShaderReflectionSystem &system,
+                                      const StageBinary &binary,
+                                      ShaderStage stage) {
+  if (!binary.archived_reflection.empty())
+    return deserialize_reflection(binary.archived_reflection);
+  return system.reflect_stage(binary.bytecode, stage);
+}
+
 std::span<const uint32_t> span_to_words(std::span<const uint8_t> bytes) {
   if (bytes.empty() || (bytes.size() % sizeof(uint32_t)) != 0) {
     throw std::runtime_error("SPIR-V bytecode must be non-empty and 4-byte aligned");
@@ -292,6 +257,99 @@ std::string apply_variant_defines(const std::string &source,
   return with_defines;
 }
 
+// Variant defines that name one of the shader's specialization constants are
+// applied at pipeline creation; the remaining defines still select the
+// compiled module (SPIR-V file / Metal source)
+struct SpecializedVariant {
+  ShaderVariantKey module_variant;
+  uint32_t constant_count = 0;
+  std::array<rhi::SpecializationConstant, rhi::kMaxSpecializationConstants>
+      constants{};
+};
+
+std::optional<uint32_t>
+parse_constant_value(const ShaderSpecializationConstant &constant,
+                     const std::string &value) {
+  const char *begin = value.data();
+  const char *end = value.data() + value.size();
+  switch (constant.type) {
+  case ShaderUniformType::Bool:
+    if (value.empty() || value == "true")
+      return 1u;
+    if (value == "false")
+      return 0u;
+    [[fallthrough]];
+  case ShaderUniformType::Int: {
+    int32_t parsed = 0;
+    auto [ptr, ec] = std::from_chars(begin, end, parsed);
+    if (ec != std::errc() || ptr != end)
+      return std::nullopt;
+    if (constant.type == ShaderUniformType::Bool)
+      return parsed != 0 ? 1u : 0u;
+    return static_cast<uint32_t>(parsed);
+  }
+  case ShaderUniformType::UInt: {
+    uint32_t parsed = 0;
+    auto [ptr, ec] = std::from_chars(begin, end, parsed);
+    if (ec != std::errc() || ptr != end)
+      return std::nullopt;
+    return parsed;
+  }
+  case ShaderUniformType::Float: {
+    char *parsed_end = nullptr;
+    const float parsed = std::strtof(value.c_str(), &parsed_end);
+    if (value.empty() || parsed_end != end)
+      return std::nullopt;
+    return std::bit_cast<uint32_t>(parsed);
+  }
+  default:
+    return std::nullopt;
+  }
+}
+
+rhi::SpecializationConstantType to_rhi_constant_type(ShaderUniformType type) {
+  switch (type) {
+  case ShaderUniformType::Int:
+    return rhi::SpecializationConstantType::Int;
+  case ShaderUniformType::UInt:
+    return rhi::SpecializationConstantType::UInt;
+  case ShaderUniformType::Float:
+    return rhi::SpecializationConstantType::Float;
+  default:
+    return rhi::SpecializationConstantType::Bool;
+  }
+}
+
+SpecializedVariant split_specialization(const ShaderVariantKey &variant,
+                                        const ShaderReflection &base) {
+  SpecializedVariant split;
+  split.module_variant = variant;
+  for (const auto &[name, value] : variant.defines()) {
+    const ShaderSpecializationConstant *constant =
+        base.find_specialization_constant(name);
+    if (!constant || split.constant_count == split.constants.size())
+      continue;
+    const auto parsed = parse_constant_value(*constant, value);
+    if (!parsed) {
+      std::cerr << "  Warning: Define " << name << "=" << value
+                << " does not fit its specialization constant; compiling it"
+                << " into the module instead" << std::endl;
+      continue;
+    }
+    rhi::SpecializationConstant &out = split.constants[split.constant_count++];
+    out.id = constant->constant_id;
+    out.type = to_rhi_constant_type(constant->type);
+    out.value = *parsed;
+    split.module_variant.clear_define(name);
+  }
+  return split;
+}
+
+void apply_specialization(const SpecializedVariant &split, rhi::PipelineDesc &desc) {
+  desc.specializationConstantCount = split.constant_count;
+  desc.specializationConstants = split.constants;
+}
+
 class SpirvShaderReflectionSystem : public ShaderReflectionSystem {
 public:
   ShaderReflection reflect_stage(std::span<const uint8_t> bytecode,
@@ -338,37 +396,26 @@ public:
 
     ShaderVariantData data{};
 
-    std::string vert_spirv_path = make_spirv_path(context.vert_path, variant);
-    std::string frag_spirv_path = make_spirv_path(context.frag_path, variant);
-
-    std::cout << "  Vertex SPIR-V:   " << vert_spirv_path << std::endl;
-    std::cout << "  Fragment SPIR-V: " << frag_spirv_path << std::endl;
-
-    std::vector<uint8_t> vert_bytes =
-        platform::load_shader_bytecode(vert_spirv_path);
-    std::vector<uint8_t> frag_bytes =
-        platform::load_shader_bytecode(frag_spirv_path);
-
-    auto vert_span = std::span<const uint8_t>(vert_bytes.data(), vert_bytes.size());
-    auto frag_span = std::span<const uint8_t>(frag_bytes.data(), frag_bytes.size());
-
-    data.vs = context.device->createShaderFromBytecode(context.vs_stage, vert_span);
-    if (data.vs.id == 0) {
-      throw std::runtime_error("Failed to create vertex shader from SPIR-V bytecode");
+    const SpecializedVariant split = specialize(context, variant);
+    const Module &module = get_or_load_module(context, split.module_variant);
+    if (split.constant_count > 0) {
+      std::cout << "  Specialization constants: " << split.constant_count
+                << " (module shared with '" << split.module_variant.cache_key()
+                << "')" << std::endl;
     }
 
-    data.fs = context.device->createShaderFromBytecode(context.fs_stage, frag_span);
-    if (data.fs.id == 0) {
-      throw std::runtime_error("Failed to create fragment shader from SPIR-V bytecode");
-    }
+    data.vs = module.vs;
+    data.fs = module.fs;
 
     auto build_desc = [&](const rhi::BlendState &blend) {
       rhi::PipelineDesc desc{};
       desc.vs = data.vs;
       desc.fs = data.fs;
+      desc.vertexLayout = variant.vertex_layout();
       desc.colorAttachmentCount = 1;
-      desc.colorAttachments[0].format = rhi::Format::BGRA8;
+      desc.colorAttachments[0].format = ShaderVariantData::kColorFormat;
       desc.colorAttachments[0].blend = blend;
+      apply_specialization(split, desc);
       return desc;
     };
 
@@ -381,22 +428,87 @@ public:
     data.pipelines[static_cast<size_t>(Material::BlendMode::Opaque)] =
         context.device->createPipeline(build_desc(rhi::make_disabled_blend_state()));
 
-    ShaderReflection vert_reflection =
-        reflection_->reflect_stage(vert_span, ShaderStage::Vertex);
-    ShaderReflection frag_reflection =
-        reflection_->reflect_stage(frag_span, ShaderStage::Fragment);
-    data.reflection = std::move(vert_reflection);
-    data.reflection.merge(frag_reflection);
+    data.reflection = module.reflection;
     reflection_->finalize_reflection(context, variant, data.reflection);
+    return data;
+  }
 
-    write_reflection_cache(data.reflection,
-                           make_reflection_cache_path(context.vert_path, variant));
+  bool variant_ready(const ShaderVariantBuildContext &context,
+                     const ShaderVariantKey &variant) const override {
+    const ShaderVariantKey modules = module_variant(context, variant);
+    return !stage_compile_pending(context.vert_path, modules) &&
+           !stage_compile_pending(context.frag_path, modules);
+  }
 
-    return data;
+  ShaderVariantKey module_variant(const ShaderVariantBuildContext &context,
+                                  const ShaderVariantKey &variant) const override {
+    return specialize(context, variant).module_variant;
   }
 
 private:
+  struct Module {
+    rhi::ShaderHandle vs{0};
+    rhi::ShaderHandle fs{0};
+    ShaderReflection reflection{};
+  };
+
+  // The default module's reflection lists the constants every variant of
+  // this shader can specialize
+  SpecializedVariant specialize(const ShaderVariantBuildContext &context,
+                                const ShaderVariantKey &variant) const {
+    if (variant.empty())
+      return SpecializedVariant{variant};
+    return split_specialization(
+        variant, get_or_load_module(context, ShaderVariantKey{}).reflection);
+  }
+
+  const Module &get_or_load_module(const ShaderVariantBuildContext &context,
+                                   const ShaderVariantKey &variant) const {
+    const std::string key = variant.cache_key();
+    auto it = modules_.find(key);
+    if (it != modules_.end())
+      return it->second;
+
+    wait_for_missing_stages(context, variant);
+    std::string vert_spirv_path = make_spirv_path(context.vert_path, variant);
+    std::string frag_spirv_path = make_spirv_path(context.frag_path, variant);
+
+    const StageBinary vert = load_stage_binary(vert_spirv_path);
+    const StageBinary frag = load_stage_binary(frag_spirv_path);
+    const bool from_archive = vert.from_archive && frag.from_archive;
+
+    std::cout << "  Vertex SPIR-V:   " << vert_spirv_path
+              << (vert.from_archive ? " (archive)" : "") << std::endl;
+    std::cout << "  Fragment SPIR-V: " << frag_spirv_path
+              << (frag.from_archive ? " (archive)" : "") << std::endl;
+
+    Module module{};
+    module.vs = context.device->createShaderFromBytecode(context.vs_stage, vert.bytecode);
+    if (module.vs.id == 0) {
+      throw std::runtime_error("Failed to create vertex shader from SPIR-V bytecode");
+    }
+
+    module.fs = context.device->createShaderFromBytecode(context.fs_stage, frag.bytecode);
+    if (module.fs.id == 0) {
+      throw std::runtime_error("Failed to create fragment shader from SPIR-V bytecode");
+    }
+
+    module.reflection = reflect_stage_binary(*reflection_, vert, ShaderStage::Vertex);
+    module.reflection.merge(
+        reflect_stage_binary(*reflection_, frag, ShaderStage::Fragment));
+
+    // The archive already carries reflection; only loose files need a cache
+    if (!from_archive) {
+      write_reflection_cache(module.reflection,
+                             make_reflection_cache_path(context.vert_path, variant));
+    }
+
+    return modules_.emplace(key, std::move(module)).first->second;
+  }
+
   std::unique_ptr<ShaderReflectionSystem> reflection_;
+  // Variants differing only in specialization constants share a module
+  mutable std::unordered_map<std::string, Module> modules_;
 };
 
 class MetalShaderVariantSystem : public ShaderVariantSystem {
@@ -413,13 +525,19 @@ public:
 
     std::cout << "  Using Metal shader compilation path" << std::endl;
 
+    // Constant defines become function constants; only the rest are
+    // prepended to the source, so such variants reuse one library
+    const SpecializedVariant split = specialize(context, variant);
+    const ShaderVariantKey &module_variant = split.module_variant;
+
     std::span<const uint8_t> source_span{};
     std::string variant_source_storage;
     if (!context.metal_source_code.empty()) {
-      if (variant.empty()) {
+      if (module_variant.empty()) {
         source_span = string_to_span(context.metal_source_code);
       } else {
-        variant_source_storage = apply_variant_defines(context.metal_source_code, variant);
+        variant_source_storage =
+            apply_variant_defines(context.metal_source_code, module_variant);
         source_span = string_to_span(variant_source_storage);
       }
     }
@@ -438,9 +556,11 @@ public:
       rhi::PipelineDesc desc{};
       desc.vs = data.vs;
       desc.fs = data.fs;
+      desc.vertexLayout = variant.vertex_layout();
       desc.colorAttachmentCount = 1;
-      desc.colorAttachments[0].format = rhi::Format::BGRA8;
+      desc.colorAttachments[0].format = ShaderVariantData::kColorFormat;
       desc.colorAttachments[0].blend = blend;
+      apply_specialization(split, desc);
       return desc;
     };
 
@@ -453,33 +573,61 @@ public:
     data.pipelines[static_cast<size_t>(Material::BlendMode::Opaque)] =
         context.device->createPipeline(build_desc(rhi::make_disabled_blend_state()));
 
+    data.reflection = get_or_load_reflection(context, module_variant);
+    reflection_->finalize_reflection(context, variant, data.reflection);
+    return data;
+  }
+
+  bool variant_ready(const ShaderVariantBuildContext &context,
+                     const ShaderVariantKey &variant) const override {
+    const ShaderVariantKey modules = module_variant(context, variant);
+    return !stage_compile_pending(context.vert_path, modules) &&
+           !stage_compile_pending(context.frag_path, modules);
+  }
+
+  ShaderVariantKey module_variant(const ShaderVariantBuildContext &context,
+                                  const ShaderVariantKey &variant) const override {
+    return specialize(context, variant).module_variant;
+  }
+
+private:
+  SpecializedVariant specialize(const ShaderVariantBuildContext &context,
+                                const ShaderVariantKey &variant) const {
+    if (variant.empty())
+      return SpecializedVariant{variant};
+    return split_specialization(
+        variant, get_or_load_reflection(context, ShaderVariantKey{}));
+  }
+
+  const ShaderReflection &
+  get_or_load_reflection(const ShaderVariantBuildContext &context,
+                         const ShaderVariantKey &variant) const {
+    const std::string key = variant.cache_key();
+    auto it = reflections_.find(key);
+    if (it != reflections_.end())
+      return it->second;
+
+    ShaderReflection reflection;
     bool reflection_from_spirv = false;
     bool reflection_loaded = false;
     const std::string cache_path =
         make_reflection_cache_path(context.vert_path, variant);
 
     try {
+      // Metal compiles its own source; SPIR-V is only needed for reflection
+      wait_for_missing_stages(context, variant);
       std::string vert_spirv_path = make_spirv_path(context.vert_path, variant);
       std::string frag_spirv_path = make_spirv_path(context.frag_path, variant);
       std::cout << "  Attempting to load SPIR-V reflection data from:"
                 << "\n    VS: " << vert_spirv_path << "\n    FS: " << frag_spirv_path
                 << std::endl;
 
-      std::vector<uint8_t> vert_bytes =
-          platform::load_shader_bytecode(vert_spirv_path);
-      std::vector<uint8_t> frag_bytes =
-          platform::load_shader_bytecode(frag_spirv_path);
-
-      auto vert_span = std::span<const uint8_t>(vert_bytes.data(), vert_bytes.size());
-      auto frag_span = std::span<const uint8_t>(frag_bytes.data(), frag_bytes.size());
-
-      ShaderReflection vert_reflection =
-          reflection_->reflect_stage(vert_span, ShaderStage::Vertex);
-      ShaderReflection frag_reflection =
-          reflection_->reflect_stage(frag_span, ShaderStage::Fragment);
-      data.reflection = std::move(vert_reflection);
-      data.reflection.merge(frag_reflection);
-      reflection_from_spirv = true;
+      const StageBinary vert = load_stage_binary(vert_spirv_path);
+      const StageBinary frag = load_stage_binary(frag_spirv_path);
+
+      reflection = reflect_stage_binary(*reflection_, vert, ShaderStage::Vertex);
+      reflection.merge(reflect_stage_binary(*reflection_, frag, ShaderStage::Fragment));
+      reflection_from_spirv = !(vert.from_archive && frag.from_archive);
       reflection_loaded = true;
     } catch (const std::exception &e) {
       std::cerr << "  Warning: Metal shader reflection SPIR-V load failed: " << e.what()
@@ -489,7 +637,7 @@ public:
     if (!reflection_loaded) {
       if (auto cached = load_reflection_cache(cache_path)) {
         std::cout << "  Loaded cached reflection data from " << cache_path << std::endl;
-        data.reflection = std::move(*cached);
+        reflection = std::move(*cached);
         reflection_loaded = true;
       }
     }
@@ -499,17 +647,15 @@ public:
           "Failed to obtain Metal shader reflection data; expected SPIR-V or cache file");
     }
 
-    reflection_->finalize_reflection(context, variant, data.reflection);
-
     if (reflection_from_spirv) {
-      write_reflection_cache(data.reflection, cache_path);
+      write_reflection_cache(reflection, cache_path);
     }
 
-    return data;
+    return reflections_.emplace(key, std::move(reflection)).first->second;
   }
 
-private:
   std::unique_ptr<ShaderReflectionSystem> reflection_;
+  mutable std::unordered_map<std::string, ShaderReflection> reflections_;
 };
 
 } // namespace
@@ -0,0 +1,511 @@
+// src/renderer3d/spatial_index.cpp - Dynamic BVH over bounding spheres
+#include "pixel/renderer3d/spatial_index.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace pixel::renderer3d {
+
+namespace {
+
+glm::vec4 normalize_plane(const glm::vec4 &plane) {
+  glm::vec3 normal = glm::vec3(plane);
+  float length = glm::length(normal);
+  if (length <= 0.0f)
+    return plane;
+  return plane / length;
+}
+
+glm::vec3 to_glm(const Vec3 &v) { return glm::vec3(v.x, v.y, v.z); }
+
+float surface_area(const glm::vec3 &min, const glm::vec3 &max) {
+  const glm::vec3 d = max - min;
+  return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool aabb_contains(const glm::vec3 &outer_min, const glm::vec3 &outer_max,
+                   const glm::vec3 &inner_min, const glm::vec3 &inner_max) {
+  return outer_min.x <= inner_min.x && outer_min.y <= inner_min.y &&
+         outer_min.z <= inner_min.z && inner_max.x <= outer_max.x &&
+         inner_max.y <= outer_max.y && inner_max.z <= outer_max.z;
+}
+
+bool aabb_overlaps(const glm::vec3 &a_min, const glm::vec3 &a_max,
+                   const glm::vec3 &b_min, const glm::vec3 &b_max) {
+  return a_min.x <= b_max.x && b_min.x <= a_max.x && a_min.y <= b_max.y &&
+         b_min.y <= a_max.y && a_min.z <= b_max.z && b_min.z <= a_max.z;
+}
+
+// Box fully outside any plane (tests the corner furthest along the normal)
+bool aabb_outside_frustum(const FrustumPlanes &planes, const glm::vec3 &min,
+                          const glm::vec3 &max) {
+  for (const glm::vec4 &plane : planes) {
+    const glm::vec3 p(plane.x >= 0.0f ? max.x : min.x,
+                      plane.y >= 0.0f ? max.y : min.y,
+                      plane.z >= 0.0f ? max.z : min.z);
+    if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f)
+      return true;
+  }
+  return false;
+}
+
+bool sphere_outside_frustum(const FrustumPlanes &planes,
+                            const glm::vec3 &center, float radius) {
+  for (const glm::vec4 &plane : planes) {
+    if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+      return true;
+  }
+  return false;
+}
+
+float aabb_distance_sq(const glm::vec3 &min, const glm::vec3 &max,
+                       const glm::vec3 &point) {
+  const glm::vec3 closest = glm::clamp(point, min, max);
+  const glm::vec3 d = point - closest;
+  return glm::dot(d, d);
+}
+
+// Slab test; `inv_dir` components may be +/-inf for axis-parallel rays
+bool ray_hits_aabb(const glm::vec3 &origin, const glm::vec3 &inv_dir,
+                   float max_t, const glm::vec3 &min, const glm::vec3 &max) {
+  const glm::vec3 t0 = (min - origin) * inv_dir;
+  const glm::vec3 t1 = (max - origin) * inv_dir;
+  const glm::vec3 t_small = glm::min(t0, t1);
+  const glm::vec3 t_big = glm::max(t0, t1);
+  const float t_enter = std::max({t_small.x, t_small.y, t_small.z, 0.0f});
+  const float t_exit = std::min({t_big.x, t_big.y, t_big.z, max_t});
+  return t_enter <= t_exit;
+}
+
+// Entry distance along a normalised ray, 0 when the origin is inside
+bool ray_hits_sphere(const glm::vec3 &origin, const glm::vec3 &dir,
+                     float max_t, const glm::vec3 &center, float radius,
+                     float &t_out) {
+  const glm::vec3 oc = origin - center;
+  const float b = glm::dot(oc, dir);
+  const float c = glm::dot(oc, oc) - radius * radius;
+  if (c <= 0.0f) {
+    t_out = 0.0f;
+    return true;
+  }
+  if (b > 0.0f)
+    return false;
+  const float disc = b * b - c;
+  if (disc < 0.0f)
+    return false;
+  t_out = -b - std::sqrt(disc);
+  return t_out <= max_t;
+}
+
+} // namespace
+
+FrustumPlanes extract_frustum_planes(const glm::mat4 &view_proj) {
+  FrustumPlanes planes{};
+  // Column-major layout in GLM
+  // Left
+  planes[0] = normalize_plane(glm::vec4(view_proj[0][3] + view_proj[0][0],
+                                        view_proj[1][3] + view_proj[1][0],
+                                        view_proj[2][3] + view_proj[2][0],
+                                        view_proj[3][3] + view_proj[3][0]));
+  // Right
+  planes[1] = normalize_plane(glm::vec4(view_proj[0][3] - view_proj[0][0],
+                                        view_proj[1][3] - view_proj[1][0],
+                                        view_proj[2][3] - view_proj[2][0],
+                                        view_proj[3][3] - view_proj[3][0]));
+  // Bottom
+  planes[2] = normalize_plane(glm::vec4(view_proj[0][3] + view_proj[0][1],
+                                        view_proj[1][3] + view_proj[1][1],
+                                        view_proj[2][3] + view_proj[2][1],
+                                        view_proj[3][3] + view_proj[3][1]));
+  // Top
+  planes[3] = normalize_plane(glm::vec4(view_proj[0][3] - view_proj[0][1],
+                                        view_proj[1][3] - view_proj[1][1],
+                                        view_proj[2][3] - view_proj[2][1],
+                                        view_proj[3][3] - view_proj[3][1]));
+  // Near
+  planes[4] = normalize_plane(glm::vec4(view_proj[0][3] + view_proj[0][2],
+                                        view_proj[1][3] + view_proj[1][2],
+                                        view_proj[2][3] + view_proj[2][2],
+                                        view_proj[3][3] + view_proj[3][2]));
+  // Far
+  planes[5] = normalize_plane(glm::vec4(view_proj[0][3] - view_proj[0][2],
+                                        view_proj[1][3] - view_proj[1][2],
+                                        view_proj[2][3] - view_proj[2][2],
+                                        view_proj[3][3] - view_proj[3][2]));
+  return planes;
+}
+
+// ============================================================================
+// SpatialIndex Implementation
+// ============================================================================
+
+SpatialIndex::SpatialIndex(float fat_margin)
+    : fat_margin_(std::max(fat_margin, 0.0f)) {}
+
+void SpatialIndex::reserve(size_t proxies) {
+  // A tree with n leaves has n - 1 internal nodes
+  nodes_.reserve(proxies > 0 ? proxies * 2 - 1 : 0);
+}
+
+void SpatialIndex::clear() {
+  nodes_.clear();
+  root_ = kNull;
+  free_list_ = kNull;
+  proxy_count_ = 0;
+}
+
+int SpatialIndex::height() const {
+  return root_ == kNull ? 0 : nodes_[root_].height;
+}
+
+uint32_t SpatialIndex::allocate_node() {
+  uint32_t index;
+  if (free_list_ != kNull) {
+    index = free_list_;
+    free_list_ = nodes_[index].parent;
+    nodes_[index] = Node{};
+  } else {
+    index = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+  }
+  nodes_[index].height = 0;
+  return index;
+}
+
+void SpatialIndex::free_node(uint32_t index) {
+  nodes_[index].parent = free_list_;
+  nodes_[index].height = -1;
+  free_list_ = index;
+}
+
+SpatialIndex::ProxyID SpatialIndex::insert(const Vec3 &center, float radius,
+                                           uint32_t user_data) {
+  const uint32_t leaf = allocate_node();
+  Node &node = nodes_[leaf];
+  node.center = to_glm(center);
+  node.radius = std::max(radius, 0.0f);
+  node.user_data = user_data;
+  const glm::vec3 extent(node.radius + fat_margin_);
+  node.min = node.center - extent;
+  node.max = node.center + extent;
+
+  insert_leaf(leaf);
+  ++proxy_count_;
+  return leaf;
+}
+
+bool SpatialIndex::move(ProxyID proxy, const Vec3 &center, float radius) {
+  if (proxy >= nodes_.size() || nodes_[proxy].height != 0)
+    return false;
+
+  Node &node = nodes_[proxy];
+  node.center = to_glm(center);
+  node.radius = std::max(radius, 0.0f);
+
+  const glm::vec3 tight_min = node.center - glm::vec3(node.radius);
+  const glm::vec3 tight_max = node.center + glm::vec3(node.radius);
+  if (aabb_contains(node.min, node.max, tight_min, tight_max))
+    return false;
+
+  remove_leaf(proxy);
+  const glm::vec3 margin(fat_margin_);
+  nodes_[proxy].min = tight_min - margin;
+  nodes_[proxy].max = tight_max + margin;
+  insert_leaf(proxy);
+  return true;
+}
+
+void SpatialIndex::remove(ProxyID proxy) {
+  if (proxy >= nodes_.size() || nodes_[proxy].height != 0)
+    return;
+  remove_leaf(proxy);
+  free_node(proxy);
+  --proxy_count_;
+}
+
+void SpatialIndex::insert_leaf(uint32_t leaf) {
+  nodes_[leaf].parent = kNull;
+  if (root_ == kNull) {
+    root_ = leaf;
+    return;
+  }
+
+  // Descend towards the sibling that minimises the added surface area
+  const glm::vec3 leaf_min = nodes_[leaf].min;
+  const glm::vec3 leaf_max = nodes_[leaf].max;
+  uint32_t index = root_;
+  while (!nodes_[index].is_leaf()) {
+    const Node &node = nodes_[index];
+    const float area = surface_area(node.min, node.max);
+    const float combined_area = surface_area(glm::min(node.min, leaf_min),
+                                             glm::max(node.max, leaf_max));
+    const float cost = 2.0f * combined_area;
+    const float inheritance = 2.0f * (combined_area - area);
+
+    auto descend_cost = [&](uint32_t child) {
+      const Node &c = nodes_[child];
+      const float merged = surface_area(glm::min(c.min, leaf_min),
+                                        glm::max(c.max, leaf_max));
+      if (c.is_leaf())
+        return merged + inheritance;
+      return merged - surface_area(c.min, c.max) + inheritance;
+    };
+    const float cost0 = descend_cost(node.child0);
+    const float cost1 = descend_cost(node.child1);
+
+    if (cost < cost0 && cost < cost1)
+      break;
+    index = cost0 < cost1 ? node.child0 : node.child1;
+  }
+
+  const uint32_t sibling = index;
+  const uint32_t old_parent = nodes_[sibling].parent;
+  const uint32_t new_parent = allocate_node();
+  Node &parent = nodes_[new_parent];
+  parent.parent = old_parent;
+  parent.min = glm::min(nodes_[sibling].min, leaf_min);
+  parent.max = glm::max(nodes_[sibling].max, leaf_max);
+  parent.height = nodes_[sibling].height + 1;
+  parent.child0 = sibling;
+  parent.child1 = leaf;
+  nodes_[sibling].parent = new_parent;
+  nodes_[leaf].parent = new_parent;
+
+  if (old_parent == kNull) {
+    root_ = new_parent;
+  } else if (nodes_[old_parent].child0 == sibling) {
+    nodes_[old_parent].child0 = new_parent;
+  } else {
+    nodes_[old_parent].child1 = new_parent;
+  }
+
+  refit_upwards(nodes_[leaf].parent);
+}
+
+void SpatialIndex::remove_leaf(uint32_t leaf) {
+  if (leaf == root_) {
+    root_ = kNull;
+    return;
+  }
+
+  const uint32_t parent = nodes_[leaf].parent;
+  const uint32_t grand_parent = nodes_[parent].parent;
+  const uint32_t sibling = nodes_[parent].child0 == leaf
+                               ? nodes_[parent].child1
+                               : nodes_[parent].child0;
+
+  if (grand_parent == kNull) {
+    root_ = sibling;
+    nodes_[sibling].parent = kNull;
+    free_node(parent);
+    return;
+  }
+
+  if (nodes_[grand_parent].child0 == parent)
+    nodes_[grand_parent].child0 = sibling;
+  else
+    nodes_[grand_parent].child1 = sibling;
+  nodes_[sibling].parent = grand_parent;
+  free_node(parent);
+
+  refit_upwards(grand_parent);
+}
+
+void SpatialIndex::refit_upwards(uint32_t index) {
+  while (index != kNull) {
+    index = balance(index);
+    Node &node = nodes_[index];
+    const Node &a = nodes_[node.child0];
+    const Node &b = nodes_[node.child1];
+    node.height = 1 + std::max(a.height, b.height);
+    node.min = glm::min(a.min, b.min);
+    node.max = glm::max(a.max, b.max);
+    index = node.parent;
+  }
+}
+
+// Rotates the taller grandchild up when the subtree heights of `index`
+// differ by more than one. Returns the node now occupying that slot.
+uint32_t SpatialIndex::balance(uint32_t index_a) {
+  Node &a = nodes_[index_a];
+  if (a.is_leaf() || a.height < 2)
+    return index_a;
+
+  const uint32_t index_b = a.child0;
+  const uint32_t index_c = a.child1;
+  Node &b = nodes_[index_b];
+  Node &c = nodes_[index_c];
+  const int32_t skew = c.height - b.height;
+
+  auto rotate_up = [&](uint32_t index_up, Node &up, Node &other,
+                       bool up_was_child1) {
+    const uint32_t index_f = up.child0;
+    const uint32_t index_g = up.child1;
+    Node &f = nodes_[index_f];
+    Node &g = nodes_[index_g];
+
+    up.child0 = index_a;
+    up.parent = a.parent;
+    a.parent = index_up;
+
+    if (up.parent == kNull) {
+      root_ = index_up;
+    } else if (nodes_[up.parent].child0 == index_a) {
+      nodes_[up.parent].child0 = index_up;
+    } else {
+      nodes_[up.parent].child1 = index_up;
+    }
+
+    // Keep the taller grandchild under `up`, hand the shorter one to `a`
+    const bool keep_f = f.height > g.height;
+    const uint32_t index_keep = keep_f ? index_f : index_g;
+    const uint32_t index_give = keep_f ? index_g : index_f;
+    Node &keep = nodes_[index_keep];
+    Node &give = nodes_[index_give];
+
+    up.child1 = index_keep;
+    if (up_was_child1)
+      a.child1 = index_give;
+    else
+      a.child0 = index_give;
+    give.parent = index_a;
+
+    a.min = glm::min(other.min, give.min);
+    a.max = glm::max(other.max, give.max);
+    a.height = 1 + std::max(other.height, give.height);
+    up.min = glm::min(a.min, keep.min);
+    up.max = glm::max(a.max, keep.max);
+    up.height = 1 + std::max(a.height, keep.height);
+  };
+
+  if (skew > 1) {
+    rotate_up(index_c, c, b, true);
+    return index_c;
+  }
+  if (skew < -1) {
+    rotate_up(index_b, b, c, false);
+    return index_b;
+  }
+  return index_a;
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+void SpatialIndex::query_frustum(const FrustumPlanes &planes,
+                                 std::vector<uint32_t> &out) const {
+  if (root_ == kNull)
+    return;
+
+  std::array<uint32_t, kMaxStack> stack;
+  size_t top = 0;
+  stack[top++] = root_;
+  while (top > 0) {
+    const Node &node = nodes_[stack[--top]];
+    if (aabb_outside_frustum(planes, node.min, node.max))
+      continue;
+    if (node.is_leaf()) {
+      if (!sphere_outside_frustum(planes, node.center, node.radius))
+        out.push_back(node.user_data);
+      continue;
+    }
+    stack[top++] = node.child0;
+    stack[top++] = node.child1;
+  }
+}
+
+void SpatialIndex::query_sphere(const Vec3 &center, float radius,
+                                std::vector<uint32_t> &out) const {
+  if (root_ == kNull)
+    return;
+
+  const glm::vec3 c = to_glm(center);
+  const float radius_sq = radius * radius;
+
+  std::array<uint32_t, kMaxStack> stack;
+  size_t top = 0;
+  stack[top++] = root_;
+  while (top > 0) {
+    const Node &node = nodes_[stack[--top]];
+    if (aabb_distance_sq(node.min, node.max, c) > radius_sq)
+      continue;
+    if (node.is_leaf()) {
+      const float reach = radius + node.radius;
+      const glm::vec3 d = node.center - c;
+      if (glm::dot(d, d) <= reach * reach)
+        out.push_back(node.user_data);
+      continue;
+    }
+    stack[top++] = node.child0;
+    stack[top++] = node.child1;
+  }
+}
+
+void SpatialIndex::query_aabb(const Vec3 &min, const Vec3 &max,
+                              std::vector<uint32_t> &out) const {
+  if (root_ == kNull)
+    return;
+
+  const glm::vec3 box_min = to_glm(min);
+  const glm::vec3 box_max = to_glm(max);
+
+  std::array<uint32_t, kMaxStack> stack;
+  size_t top = 0;
+  stack[top++] = root_;
+  while (top > 0) {
+    const Node &node = nodes_[stack[--top]];
+    if (!aabb_overlaps(node.min, node.max, box_min, box_max))
+      continue;
+    if (node.is_leaf()) {
+      if (aabb_distance_sq(box_min, box_max, node.center) <=
+          node.radius * node.radius)
+        out.push_back(node.user_data);
+      continue;
+    }
+    stack[top++] = node.child0;
+    stack[top++] = node.child1;
+  }
+}
+
+void SpatialIndex::query_ray(const Vec3 &origin, const Vec3 &direction,
+                             float max_t, std::vector<RayHit> &out) const {
+  if (root_ == kNull)
+    return;
+
+  const glm::vec3 o = to_glm(origin);
+  glm::vec3 dir = to_glm(direction);
+  const float length = glm::length(dir);
+  if (length <= 0.0f)
+    return;
+  dir /= length;
+
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  const glm::vec3 inv_dir(dir.x != 0.0f ? 1.0f / dir.x : inf,
+                          dir.y != 0.0f ? 1.0f / dir.y : inf,
+                          dir.z != 0.0f ? 1.0f / dir.z : inf);
+
+  const size_t first = out.size();
+  std::array<uint32_t, kMaxStack> stack;
+  size_t top = 0;
+  stack[top++] = root_;
+  while (top > 0) {
+    const Node &node = nodes_[stack[--top]];
+    if (!ray_hits_aabb(o, inv_dir, max_t, node.min, node.max))
+      continue;
+    if (node.is_leaf()) {
+      float t = 0.0f;
+      if (ray_hits_sphere(o, dir, max_t, node.center, node.radius, t))
+        out.push_back({node.user_data, t});
+      continue;
+    }
+    stack[top++] = node.child0;
+    stack[top++] = node.child1;
+  }
+
+  std::sort(out.begin() + static_cast<std::ptrdiff_t>(first), out.end(),
+            [](const RayHit &a, const RayHit &b) { return a.t < b.t; });
+}
+
+} // namespace pixel::renderer3d
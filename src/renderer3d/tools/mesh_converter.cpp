@@ -0,0 +1,224 @@
+// pixel_mesh_converter - cooks Wavefront OBJ files into .pxmesh containers
+//
+//   pixel_mesh_converter [options] <output.pxmesh> <lod0.obj> [<lodN.obj>@<distance> ...]
+//
+// Options:
+//   --compressed   store the 20-byte compressed vertex layout
+//   --no-optimize  skip vertex cache / overdraw / fetch reordering
+//   --no-16bit     always store 32-bit indices
+
+#include "pixel/renderer3d/mesh_file.hpp"
+#include "pixel/renderer3d/mesh_optimizer.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace pixel::renderer3d;
+
+namespace {
+
+// Resolves a 1-based (or negative, relative) OBJ index; returns -1 if absent
+int resolve_index(const std::string &token, size_t count) {
+  if (token.empty())
+    return -1;
+  const long value = std::strtol(token.c_str(), nullptr, 10);
+  if (value > 0 && static_cast<size_t>(value) <= count)
+    return static_cast<int>(value - 1);
+  if (value < 0 && static_cast<size_t>(-value) <= count)
+    return static_cast<int>(count + value);
+  return -2;
+}
+
+bool load_obj(const std::string &path, MeshFileLodSource &out) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+
+  std::vector<Vec3> positions;
+  std::vector<Vec3> normals;
+  std::vector<Vec2> texcoords;
+  // (position, texcoord, normal) -> output vertex
+  std::map<std::tuple<int, int, int>, uint32_t> vertex_lookup;
+  bool has_normals = true;
+
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    std::istringstream ss(line);
+    std::string tag;
+    ss >> tag;
+    if (tag == "v") {
+      Vec3 p{0, 0, 0};
+      ss >> p.x >> p.y >> p.z;
+      positions.push_back(p);
+    } else if (tag == "vn") {
+      Vec3 n{0, 0, 0};
+      ss >> n.x >> n.y >> n.z;
+      normals.push_back(n);
+    } else if (tag == "vt") {
+      Vec2 t{0, 0};
+      ss >> t.x >> t.y;
+      // OBJ puts v=0 at the bottom; the renderer samples top-down
+      t.y = 1.0f - t.y;
+      texcoords.push_back(t);
+    } else if (tag == "f") {
+      std::vector<uint32_t> polygon;
+      std::string corner;
+      while (ss >> corner) {
+        std::string parts[3];
+        size_t part = 0;
+        for (char c : corner) {
+          if (c == '/') {
+            if (++part > 2)
+              break;
+          } else {
+            parts[part] += c;
+          }
+        }
+        const int p = resolve_index(parts[0], positions.size());
+        const int t = resolve_index(parts[1], texcoords.size());
+        const int n = resolve_index(parts[2], normals.size());
+        if (p < 0 || t == -2 || n == -2) {
+          std::cerr << path << ":" << line_number << ": bad face index"
+                    << std::endl;
+          return false;
+        }
+        has_normals = has_normals && n >= 0;
+
+        auto [it, inserted] = vertex_lookup.try_emplace(
+            std::make_tuple(p, t, n),
+            static_cast<uint32_t>(out.vertices.size()));
+        if (inserted) {
+          Vertex v{};
+          v.position = positions[p];
+          v.normal = n >= 0 ? normals[n] : Vec3{0, 0, 0};
+          v.texcoord = t >= 0 ? texcoords[t] : Vec2{0, 0};
+          v.color = Color{1, 1, 1, 1};
+          out.vertices.push_back(v);
+        }
+        polygon.push_back(it->second);
+      }
+      // Fan-triangulate convex polygons
+      for (size_t i = 2; i < polygon.size(); ++i) {
+        out.indices.push_back(polygon[0]);
+        out.indices.push_back(polygon[i - 1]);
+        out.indices.push_back(polygon[i]);
+      }
+    }
+  }
+
+  if (!has_normals) {
+    // Area-weighted smooth normals over shared vertices
+    for (auto &v : out.vertices)
+      v.normal = Vec3{0, 0, 0};
+    for (size_t i = 0; i + 2 < out.indices.size(); i += 3) {
+      Vertex &a = out.vertices[out.indices[i]];
+      Vertex &b = out.vertices[out.indices[i + 1]];
+      Vertex &c = out.vertices[out.indices[i + 2]];
+      const Vec3 e1{b.position.x - a.position.x, b.position.y - a.position.y,
+                    b.position.z - a.position.z};
+      const Vec3 e2{c.position.x - a.position.x, c.position.y - a.position.y,
+                    c.position.z - a.position.z};
+      const Vec3 face{e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z,
+                      e1.x * e2.y - e1.y * e2.x};
+      for (Vertex *v : {&a, &b, &c}) {
+        v->normal.x += face.x;
+        v->normal.y += face.y;
+        v->normal.z += face.z;
+      }
+    }
+    for (auto &v : out.vertices) {
+      const float len = std::sqrt(v.normal.x * v.normal.x +
+                                  v.normal.y * v.normal.y +
+                                  v.normal.z * v.normal.z);
+      v.normal = len > 0.0f ? Vec3{v.normal.x / len, v.normal.y / len,
+                                   v.normal.z / len}
+                            : Vec3{0, 1, 0};
+    }
+  }
+
+  std::cout << path << ": " << out.vertices.size() << " vertices, "
+            << out.indices.size() / 3 << " triangles" << std::endl;
+  return !out.indices.empty();
+}
+
+void print_usage() {
+  std::cerr << "usage: pixel_mesh_converter [--compressed] [--no-optimize] "
+               "[--no-16bit] <output.pxmesh> <lod0.obj> "
+               "[<lodN.obj>@<distance> ...]"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  MeshOptions options;
+  options.optimize = true;
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--compressed") {
+      options.vertex_layout = pixel::rhi::VertexLayout::Compressed;
+    } else if (arg == "--no-optimize") {
+      options.optimize = false;
+    } else if (arg == "--no-16bit") {
+      options.allow_16bit_indices = false;
+    } else if (arg.rfind("--", 0) == 0) {
+      print_usage();
+      return 1;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() < 2) {
+    print_usage();
+    return 1;
+  }
+
+  std::vector<MeshFileLodSource> lods;
+  for (size_t i = 1; i < positional.size(); ++i) {
+    std::string path = positional[i];
+    float distance = 0.0f;
+    if (i > 1) {
+      const size_t at = path.rfind('@');
+      if (at == std::string::npos) {
+        std::cerr << "LOD " << i - 1 << " needs a switch distance (file@distance)"
+                  << std::endl;
+        return 1;
+      }
+      distance = std::strtof(path.c_str() + at + 1, nullptr);
+      path.resize(at);
+    }
+    MeshFileLodSource lod;
+    lod.switch_distance = distance;
+    if (!load_obj(path, lod))
+      return 1;
+    lods.push_back(std::move(lod));
+  }
+
+  // Optimise here rather than in write_mesh_file() so the cache stats can be
+  // reported per LOD
+  if (options.optimize) {
+    for (size_t i = 0; i < lods.size(); ++i) {
+      const auto stats =
+          mesh_optimizer::optimize_mesh(lods[i].vertices, lods[i].indices);
+      std::cout << "  LOD " << i << ": ACMR " << stats.acmr_before << " -> "
+                << stats.acmr_after << std::endl;
+    }
+    options.optimize = false;
+  }
+
+  if (!write_mesh_file(positional[0], lods, options))
+    return 1;
+  std::cout << "Wrote " << positional[0] << std::endl;
+  return 0;
+}
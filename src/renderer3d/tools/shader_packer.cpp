@@ -0,0 +1,92 @@
+// pixel_shader_packer - packs compiled SPIR-V stages into one shader archive
+//
+//   pixel_shader_packer <output.pxsa> <key_prefix> <stage.spv> [...]
+//
+// Each stage is stored under <key_prefix><file name>, the path
+// make_spirv_path() produces at runtime (e.g. assets/shaders/spirv/), along
+// with its reflection so startup never parses SPIR-V. The stage comes from
+// the .vert/.frag/.comp part of the file name.
+
+#include "pixel/renderer3d/shader_archive.hpp"
+#include "pixel/renderer3d/shader_reflection.hpp"
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace pixel::renderer3d;
+
+namespace {
+
+ShaderStage stage_from_file_name(const std::string &name) {
+  if (name.find(".vert") != std::string::npos)
+    return ShaderStage::Vertex;
+  if (name.find(".frag") != std::string::npos)
+    return ShaderStage::Fragment;
+  if (name.find(".comp") != std::string::npos)
+    return ShaderStage::Compute;
+  return ShaderStage::Unknown;
+}
+
+bool read_file(const std::string &path, std::vector<uint8_t> &out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+  out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  if (out.empty() || out.size() % sizeof(uint32_t) != 0) {
+    std::cerr << path << " is not SPIR-V" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void print_usage() {
+  std::cerr << "usage: pixel_shader_packer <output.pxsa> <key_prefix> "
+               "<stage.spv> [...]"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    print_usage();
+    return 1;
+  }
+  const std::string output = argv[1];
+  const std::string prefix = argv[2];
+
+  ShaderArchiveWriter writer;
+  for (int i = 3; i < argc; ++i) {
+    const std::string path = argv[i];
+    const std::string name = std::filesystem::path(path).filename().string();
+    std::vector<uint8_t> bytecode;
+    if (!read_file(path, bytecode))
+      return 1;
+
+    std::vector<uint8_t> reflection;
+    try {
+      const std::span<const uint32_t> words(
+          reinterpret_cast<const uint32_t *>(bytecode.data()),
+          bytecode.size() / sizeof(uint32_t));
+      reflection =
+          serialize_reflection(reflect_spirv(words, stage_from_file_name(name)));
+    } catch (const std::exception &e) {
+      std::cerr << "Cannot reflect " << path << ": " << e.what() << std::endl;
+      return 1;
+    }
+    writer.add(prefix + name, std::move(bytecode), std::move(reflection));
+  }
+
+  if (!writer.write(output))
+    return 1;
+  std::cout << "Packed " << writer.size() << " shader stages into " << output
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,335 @@
+// pixel_texture_cooker - cooks source images into GPU-ready .ktx2 blobs
+//
+//   pixel_texture_cooker [options] <input_dir> <output_dir>
+//
+// Every PNG/JPEG/TGA/BMP under <input_dir> becomes <output_dir>/<path>.ktx2
+// (rock.png -> rock.png.ktx2, see cooked_texture_path()) with its mip chain,
+// next to where the asset staging step copies the source, so TextureLoader
+// picks up the blob in its place. Directories containing a `.atlas` file are
+// packed into one atlas, <dir>.ktx2, with a sprite record per image.
+// Everything is listed in <output_dir>/textures.manifest. Textures and
+// atlases whose blob is newer than every source are skipped unless the
+// options or an atlas's member list changed.
+//
+// Options:
+//   --premultiply         store RGB premultiplied by alpha
+//   --bc                  BC1 (opaque) / BC3 (alpha) block compression
+//   --linear              colour is linear data (normal maps, masks)
+//   --alpha-cutoff <x>    preserve alpha-test coverage at threshold x
+//   --no-mips             store level 0 only
+//   --force               re-cook everything
+
+#include "pixel/resources/texture_cooker.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <stb_image.h>
+
+namespace fs = std::filesystem;
+using namespace pixel::resources;
+
+namespace {
+
+constexpr uint32_t kAtlasPadding = 4;
+// Levels whose texels still fall inside the padding
+constexpr uint32_t kAtlasMaxLevels = 3;
+constexpr const char *kManifestName = "textures.manifest";
+
+struct Image {
+  int width = 0;
+  int height = 0;
+  stbi_uc *pixels = nullptr;
+
+  Image() = default;
+  Image(const Image &) = delete;
+  Image &operator=(const Image &) = delete;
+  Image(Image &&other) noexcept
+      : width(other.width), height(other.height), pixels(other.pixels) {
+    other.pixels = nullptr;
+  }
+  ~Image() { stbi_image_free(pixels); }
+};
+
+bool is_image_path(const fs::path &path) {
+  std::string extension = path.extension().string();
+  for (char &c : extension)
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  return extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+         extension == ".tga" || extension == ".bmp";
+}
+
+bool load_image(const fs::path &path, Image &image) {
+  int channels = 0;
+  image.pixels = stbi_load(path.string().c_str(), &image.width, &image.height,
+                           &channels, 4);
+  if (!image.pixels) {
+    std::cerr << "Cannot decode " << path.string() << ": "
+              << stbi_failure_reason() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Manifest paths always use '/'
+std::string manifest_path(const fs::path &path) {
+  return path.generic_string();
+}
+
+bool write_blob(const fs::path &output, const CookedTexture &cooked) {
+  std::error_code ec;
+  fs::create_directories(output.parent_path(), ec);
+  return write_ktx2(output.string(), cooked);
+}
+
+TextureManifest::Texture describe(const std::string &source,
+                                  const std::string &blob,
+                                  const CookedTexture &cooked) {
+  TextureManifest::Texture texture;
+  texture.source = source;
+  texture.cooked = blob;
+  texture.format = cooked.format;
+  texture.width = cooked.width;
+  texture.height = cooked.height;
+  texture.levels = static_cast<uint32_t>(cooked.levels.size());
+  texture.premultiplied_alpha = cooked.premultiplied_alpha;
+  return texture;
+}
+
+// An atlas can be reused when the previous run packed exactly these sprites
+// and its blob is newer than every member and the folder's .atlas file
+bool atlas_is_current(const TextureManifest &previous, const fs::path &input_dir,
+                      const fs::path &folder,
+                      const std::vector<fs::path> &members,
+                      const std::set<std::string> &names,
+                      const fs::path &blob, const fs::path &output) {
+  const auto *record = previous.find_texture(manifest_path(folder));
+  if (!record || record->cooked != manifest_path(blob))
+    return false;
+
+  std::set<std::string> packed;
+  for (const auto &sprite : previous.sprites()) {
+    if (sprite.atlas == manifest_path(blob))
+      packed.insert(sprite.name);
+  }
+  if (packed != names)
+    return false;
+
+  if (!cooked_texture_is_current((input_dir / folder / ".atlas").string(),
+                                 output.string()))
+    return false;
+  for (const fs::path &relative : members) {
+    if (!cooked_texture_is_current((input_dir / relative).string(),
+                                   output.string()))
+      return false;
+  }
+  return true;
+}
+
+void print_usage() {
+  std::cerr << "usage: pixel_texture_cooker [--premultiply] [--bc] [--linear] "
+               "[--alpha-cutoff <x>] [--no-mips] [--force] <input_dir> "
+               "<output_dir>"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  CookOptions options;
+  bool force = false;
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--premultiply") {
+      options.mipmaps.premultiply_alpha = true;
+    } else if (arg == "--bc") {
+      options.block_compress = true;
+    } else if (arg == "--linear") {
+      options.mipmaps.srgb = false;
+    } else if (arg == "--alpha-cutoff" && i + 1 < argc) {
+      options.mipmaps.alpha_cutoff = std::strtof(argv[++i], nullptr);
+    } else if (arg == "--no-mips") {
+      options.generate_mips = false;
+    } else if (arg == "--force") {
+      force = true;
+    } else if (arg.rfind("--", 0) == 0) {
+      print_usage();
+      return 1;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() != 2) {
+    print_usage();
+    return 1;
+  }
+  const fs::path input_dir = positional[0];
+  const fs::path output_dir = positional[1];
+  if (!fs::is_directory(input_dir)) {
+    std::cerr << "Not a directory: " << input_dir.string() << std::endl;
+    return 1;
+  }
+
+  std::ostringstream stamp;
+  stamp << "premultiply=" << options.mipmaps.premultiply_alpha
+        << " bc=" << options.block_compress << " srgb=" << options.mipmaps.srgb
+        << " alpha_cutoff=" << options.mipmaps.alpha_cutoff
+        << " mips=" << options.generate_mips;
+
+  // Results from the previous run, for skipping unchanged textures
+  const fs::path manifest_file = output_dir / kManifestName;
+  std::optional<TextureManifest> previous;
+  if (!force && fs::exists(manifest_file)) {
+    previous = TextureManifest::load(manifest_file.string());
+    if (previous && previous->options() != stamp.str())
+      previous.reset();
+  }
+
+  // Sort sources into plain textures and atlas folders
+  std::vector<fs::path> textures;
+  std::map<fs::path, std::vector<fs::path>> atlases;
+  for (const auto &entry : fs::recursive_directory_iterator(input_dir)) {
+    if (!entry.is_regular_file() || !is_image_path(entry.path()))
+      continue;
+    const fs::path relative = entry.path().lexically_relative(input_dir);
+    if (fs::exists(entry.path().parent_path() / ".atlas")) {
+      atlases[relative.parent_path()].push_back(relative);
+    } else {
+      textures.push_back(relative);
+    }
+  }
+
+  TextureManifest manifest;
+  manifest.set_options(stamp.str());
+  size_t cooked_count = 0;
+  size_t skipped_count = 0;
+  bool ok = true;
+
+  for (const fs::path &relative : textures) {
+    const fs::path source = input_dir / relative;
+    const fs::path blob = cooked_texture_path(relative.string());
+    const fs::path output = output_dir / blob;
+
+    const auto *record =
+        previous ? previous->find_texture(manifest_path(relative)) : nullptr;
+    if (record && cooked_texture_is_current(source.string(), output.string())) {
+      // Keep the blob newer than the staged copy of its source
+      std::error_code ec;
+      fs::last_write_time(output, fs::file_time_type::clock::now(), ec);
+      manifest.add_texture(*record);
+      ++skipped_count;
+      continue;
+    }
+
+    Image image;
+    if (!load_image(source, image)) {
+      ok = false;
+      continue;
+    }
+    const CookedTexture cooked =
+        cook_texture(image.pixels, static_cast<uint32_t>(image.width),
+                     static_cast<uint32_t>(image.height), options);
+    if (!write_blob(output, cooked)) {
+      ok = false;
+      continue;
+    }
+    manifest.add_texture(
+        describe(manifest_path(relative), manifest_path(blob), cooked));
+    ++cooked_count;
+  }
+
+  for (const auto &[folder, members] : atlases) {
+    const fs::path blob =
+        (folder.empty() ? std::string("atlas") : folder.string()) + ".ktx2";
+    const fs::path output = output_dir / blob;
+
+    // Sprites are named by stem, so ui/ok.png and ui/ok.jpg would collide
+    std::set<std::string> names;
+    bool unique = true;
+    for (const fs::path &relative : members)
+      unique = names.insert(manifest_path(folder / relative.stem())).second &&
+               unique;
+    if (!unique) {
+      std::cerr << "Atlas " << folder.string()
+                << " has images that differ only by extension" << std::endl;
+      ok = false;
+      continue;
+    }
+
+    if (previous && atlas_is_current(*previous, input_dir, folder, members,
+                                     names, blob, output)) {
+      std::error_code ec;
+      fs::last_write_time(output, fs::file_time_type::clock::now(), ec);
+      manifest.add_texture(*previous->find_texture(manifest_path(folder)));
+      for (const auto &sprite : previous->sprites()) {
+        if (sprite.atlas == manifest_path(blob))
+          manifest.add_sprite(sprite);
+      }
+      ++skipped_count;
+      continue;
+    }
+
+    std::vector<Image> images;
+    std::vector<AtlasImage> inputs;
+    images.reserve(members.size());
+    for (const fs::path &relative : members) {
+      Image image;
+      if (!load_image(input_dir / relative, image)) {
+        ok = false;
+        continue;
+      }
+      AtlasImage input;
+      input.name = manifest_path(folder / relative.stem());
+      input.width = static_cast<uint32_t>(image.width);
+      input.height = static_cast<uint32_t>(image.height);
+      input.rgba = image.pixels;
+      inputs.push_back(input);
+      images.push_back(std::move(image));
+    }
+
+    if (inputs.empty())
+      continue;
+    const auto atlas = pack_atlas(inputs, kAtlasPadding);
+    if (!atlas) {
+      std::cerr << "Atlas " << folder.string() << " does not fit" << std::endl;
+      ok = false;
+      continue;
+    }
+    CookOptions atlas_options = options;
+    if (atlas_options.mipmaps.max_levels == 0 ||
+        atlas_options.mipmaps.max_levels > kAtlasMaxLevels) {
+      atlas_options.mipmaps.max_levels = kAtlasMaxLevels;
+    }
+    const CookedTexture cooked = cook_texture(atlas->rgba.data(), atlas->width,
+                                              atlas->height, atlas_options);
+    if (!write_blob(output, cooked)) {
+      ok = false;
+      continue;
+    }
+    manifest.add_texture(
+        describe(manifest_path(folder), manifest_path(blob), cooked));
+    for (const AtlasRect &rect : atlas->rects) {
+      manifest.add_sprite(TextureManifest::Sprite{
+          rect.name, manifest_path(blob), rect.x, rect.y, rect.width,
+          rect.height});
+    }
+    ++cooked_count;
+  }
+
+  std::error_code ec;
+  fs::create_directories(output_dir, ec);
+  if (!manifest.save(manifest_file.string()))
+    return 1;
+  std::cout << "Cooked " << cooked_count << " textures (" << skipped_count
+            << " up to date) into " << output_dir.string() << std::endl;
+  return ok ? 0 : 1;
+}
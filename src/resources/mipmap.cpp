@@ -0,0 +1,227 @@
+#include "pixel/resources/mipmap.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PIXEL_MIPMAP_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PIXEL_MIPMAP_NEON 1
+#endif
+
+namespace pixel::resources {
+
+namespace {
+
+float srgb_to_linear(float c) {
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+struct SrgbTables {
+  std::array<float, 256> to_linear;
+  // to_linear of the midpoint between codes i and i + 1; the encoded value
+  // of x is the number of thresholds below it (round-to-nearest in sRGB)
+  std::array<float, 255> thresholds;
+
+  SrgbTables() {
+    for (int i = 0; i < 256; ++i)
+      to_linear[i] = srgb_to_linear(i / 255.0f);
+    for (int i = 0; i < 255; ++i)
+      thresholds[i] = srgb_to_linear((i + 0.5f) / 255.0f);
+  }
+};
+
+const SrgbTables& srgb_tables() {
+  static const SrgbTables tables;
+  return tables;
+}
+
+uint8_t encode_unorm(float value) {
+  return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+uint8_t encode_srgb(float linear) {
+  const auto& t = srgb_tables().thresholds;
+  return static_cast<uint8_t>(
+      std::upper_bound(t.begin(), t.end(), linear) - t.begin());
+}
+
+// 2x2 box filter of a float RGBA image; one texel is one 4-wide vector
+void downsample(const float* src, uint32_t src_w, uint32_t src_h, float* dst,
+                uint32_t dst_w, uint32_t dst_h) {
+  for (uint32_t y = 0; y < dst_h; ++y) {
+    const float* row0 = src + size_t(std::min(2 * y, src_h - 1)) * src_w * 4;
+    const float* row1 =
+        src + size_t(std::min(2 * y + 1, src_h - 1)) * src_w * 4;
+    float* out = dst + size_t(y) * dst_w * 4;
+    for (uint32_t x = 0; x < dst_w; ++x) {
+      const size_t x0 = size_t(std::min(2 * x, src_w - 1)) * 4;
+      const size_t x1 = size_t(std::min(2 * x + 1, src_w - 1)) * 4;
+#if defined(PIXEL_MIPMAP_SSE2)
+      const __m128 top =
+          _mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1));
+      const __m128 bottom =
+          _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1));
+      const __m128 sum = _mm_add_ps(top, bottom);
+      _mm_storeu_ps(out + x * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#elif defined(PIXEL_MIPMAP_NEON)
+      const float32x4_t sum =
+          vaddq_f32(vaddq_f32(vld1q_f32(row0 + x0), vld1q_f32(row0 + x1)),
+                    vaddq_f32(vld1q_f32(row1 + x0), vld1q_f32(row1 + x1)));
+      vst1q_f32(out + x * 4, vmulq_n_f32(sum, 0.25f));
+#else
+      for (int c = 0; c < 4; ++c) {
+        out[x * 4 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] +
+                          row1[x1 + c]) *
+                         0.25f;
+      }
+#endif
+    }
+  }
+}
+
+// Measured on the 8-bit values the alpha test will actually see
+float alpha_coverage(const float* texels, size_t count, float cutoff,
+                     float scale) {
+  size_t passing = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (encode_unorm(texels[i * 4 + 3] * scale) * (1.0f / 255.0f) > cutoff)
+      ++passing;
+  }
+  return static_cast<float>(passing) / static_cast<float>(count);
+}
+
+// Scale for a level's alpha that brings its coverage closest to `target`
+float coverage_scale(const float* texels, size_t count, float cutoff,
+                     float target) {
+  float low = 0.0f;
+  float high = 4.0f;
+  float best = 1.0f;
+  float best_error = std::abs(alpha_coverage(texels, count, cutoff, 1.0f) -
+                              target);
+  for (int i = 0; i < 12; ++i) {
+    const float scale = 0.5f * (low + high);
+    const float coverage = alpha_coverage(texels, count, cutoff, scale);
+    const float error = std::abs(coverage - target);
+    if (error < best_error) {
+      best = scale;
+      best_error = error;
+    }
+    if (coverage < target)
+      low = scale;
+    else
+      high = scale;
+  }
+  return best;
+}
+
+// With `premultiplied`, texels hold linear RGB * alpha; colour is recovered,
+// encoded, and then multiplied by the stored alpha
+void encode_level(const float* texels, size_t count, bool srgb,
+                  bool premultiplied, float alpha_scale, uint8_t* out) {
+  for (size_t i = 0; i < count; ++i) {
+    const float alpha = texels[i * 4 + 3];
+    const uint8_t stored_alpha = encode_unorm(alpha * alpha_scale);
+    out[i * 4 + 3] = stored_alpha;
+    const float unweight = premultiplied && alpha > 0.0f ? 1.0f / alpha : 1.0f;
+    for (int c = 0; c < 3; ++c) {
+      const float value = texels[i * 4 + c] * unweight;
+      uint8_t encoded = srgb ? encode_srgb(value) : encode_unorm(value);
+      if (premultiplied) {
+        encoded = static_cast<uint8_t>((encoded * stored_alpha + 127) / 255);
+      }
+      out[i * 4 + c] = encoded;
+    }
+  }
+}
+
+} // namespace
+
+uint32_t mip_level_count(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  uint32_t size = std::max(width, height);
+  while (size > 1) {
+    size >>= 1;
+    ++levels;
+  }
+  return levels;
+}
+
+MipChain generate_mipmaps(const uint8_t* rgba, uint32_t width, uint32_t height,
+                          const MipmapOptions& options) {
+  MipChain chain;
+  if (!rgba || width == 0 || height == 0)
+    return chain;
+
+  uint32_t level_count = mip_level_count(width, height);
+  if (options.max_levels > 0)
+    level_count = std::min(level_count, options.max_levels);
+
+  size_t total = 0;
+  for (uint32_t level = 0, w = width, h = height; level < level_count;
+       ++level, w = std::max(1u, w / 2), h = std::max(1u, h / 2)) {
+    const size_t size = size_t(w) * h * 4;
+    chain.levels.push_back(MipChain::Level{w, h, total, size});
+    total += size;
+  }
+  chain.data.resize(total);
+  std::memcpy(chain.data.data(), rgba, chain.levels[0].size);
+  if (level_count == 1 && !options.premultiply_alpha)
+    return chain;
+
+  // Decode level 0 to linear float RGBA
+  const size_t base_count = size_t(width) * height;
+  const auto& to_linear = srgb_tables().to_linear;
+  std::vector<float> current(base_count * 4);
+  for (size_t i = 0; i < base_count; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      const uint8_t value = rgba[i * 4 + c];
+      current[i * 4 + c] =
+          options.srgb ? to_linear[value] : value * (1.0f / 255.0f);
+    }
+    current[i * 4 + 3] = rgba[i * 4 + 3] * (1.0f / 255.0f);
+    if (options.premultiply_alpha) {
+      for (int c = 0; c < 3; ++c)
+        current[i * 4 + c] *= current[i * 4 + 3];
+    }
+  }
+  if (options.premultiply_alpha) {
+    encode_level(current.data(), base_count, options.srgb, true, 1.0f,
+                 chain.data.data());
+  }
+
+  const bool preserve_coverage = options.alpha_cutoff > 0.0f;
+  const float base_coverage =
+      preserve_coverage
+          ? alpha_coverage(current.data(), base_count, options.alpha_cutoff,
+                           1.0f)
+          : 0.0f;
+
+  // Each level is filtered from the previous unscaled level; coverage
+  // scaling only touches the encoded output so errors do not compound
+  std::vector<float> next;
+  for (uint32_t level = 1; level < level_count; ++level) {
+    const MipChain::Level& src = chain.levels[level - 1];
+    const MipChain::Level& dst = chain.levels[level];
+    next.resize(size_t(dst.width) * dst.height * 4);
+    downsample(current.data(), src.width, src.height, next.data(), dst.width,
+               dst.height);
+
+    const size_t count = size_t(dst.width) * dst.height;
+    float alpha_scale = 1.0f;
+    if (preserve_coverage && base_coverage > 0.0f && base_coverage < 1.0f) {
+      alpha_scale = coverage_scale(next.data(), count, options.alpha_cutoff,
+                                   base_coverage);
+    }
+    encode_level(next.data(), count, options.srgb, options.premultiply_alpha,
+                 alpha_scale, chain.data.data() + dst.offset);
+    current.swap(next);
+  }
+  return chain;
+}
+
+} // namespace pixel::resources
@@ -0,0 +1,354 @@
+#include "pixel/resources/texture_container.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+namespace pixel::resources {
+
+namespace {
+
+constexpr uint8_t kKtx2Identifier[12] = {0xAB, 'K',  'T',  'X', ' ',  '2',
+                                         '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+constexpr size_t kKtx2HeaderSize = 80;
+constexpr size_t kKtx2LevelEntrySize = 24;
+// Word 2 of the basic descriptor block: model, primaries, transfer, flags
+constexpr size_t kKtx2DfdFlagsWord = 4 + 8;
+constexpr uint32_t kKtx2DfdFlagAlphaPremultiplied = 1;
+
+constexpr char kDdsMagic[4] = {'D', 'D', 'S', ' '};
+constexpr size_t kDdsHeaderSize = 124;
+constexpr size_t kDdsDx10HeaderSize = 20;
+constexpr uint32_t kDdsFlagMipMapCount = 0x20000;
+constexpr uint32_t kDdsFlagDepth = 0x800000;
+constexpr uint32_t kDdsPixelFourCC = 0x4;
+constexpr uint32_t kDdsPixelRgb = 0x40;
+constexpr uint32_t kDdsCaps2Cubemap = 0x200;
+constexpr uint32_t kDdsCaps2Volume = 0x200000;
+constexpr uint32_t kDxgiDimensionTexture2D = 3;
+constexpr uint32_t kDxgiMiscTextureCube = 0x4;
+constexpr uint32_t kDdsAlphaModeMask = 0x7;
+constexpr uint32_t kDdsAlphaModePremultiplied = 2;
+
+template <typename T>
+T read(std::span<const std::byte> bytes, size_t offset) {
+  T value;
+  std::memcpy(&value, bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+constexpr uint32_t four_cc(char a, char b, char c, char d) {
+  return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) |
+         (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+}
+
+rhi::Format format_from_vk(uint32_t vk_format) {
+  switch (vk_format) {
+  case 9: // VK_FORMAT_R8_UNORM
+    return rhi::Format::R8;
+  case 37: // VK_FORMAT_R8G8B8A8_UNORM
+    return rhi::Format::RGBA8;
+  case 43: // VK_FORMAT_R8G8B8A8_SRGB
+    return rhi::Format::RGBA8Srgb;
+  case 44: // VK_FORMAT_B8G8R8A8_UNORM
+    return rhi::Format::BGRA8;
+  case 76: // VK_FORMAT_R16_SFLOAT
+    return rhi::Format::R16F;
+  case 83: // VK_FORMAT_R16G16_SFLOAT
+    return rhi::Format::RG16F;
+  case 97: // VK_FORMAT_R16G16B16A16_SFLOAT
+    return rhi::Format::RGBA16F;
+  case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+  case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+    return rhi::Format::BC1;
+  case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+  case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+    return rhi::Format::BC1Srgb;
+  case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+    return rhi::Format::BC3;
+  case 138: // VK_FORMAT_BC3_SRGB_BLOCK
+    return rhi::Format::BC3Srgb;
+  case 139: // VK_FORMAT_BC4_UNORM_BLOCK
+    return rhi::Format::BC4;
+  case 141: // VK_FORMAT_BC5_UNORM_BLOCK
+    return rhi::Format::BC5;
+  case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+    return rhi::Format::BC7;
+  case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+    return rhi::Format::BC7Srgb;
+  default:
+    return rhi::Format::Unknown;
+  }
+}
+
+rhi::Format format_from_dxgi(uint32_t dxgi_format) {
+  switch (dxgi_format) {
+  case 10: // DXGI_FORMAT_R16G16B16A16_FLOAT
+    return rhi::Format::RGBA16F;
+  case 28: // DXGI_FORMAT_R8G8B8A8_UNORM
+    return rhi::Format::RGBA8;
+  case 29: // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+    return rhi::Format::RGBA8Srgb;
+  case 34: // DXGI_FORMAT_R16G16_FLOAT
+    return rhi::Format::RG16F;
+  case 54: // DXGI_FORMAT_R16_FLOAT
+    return rhi::Format::R16F;
+  case 61: // DXGI_FORMAT_R8_UNORM
+    return rhi::Format::R8;
+  case 71: // DXGI_FORMAT_BC1_UNORM
+    return rhi::Format::BC1;
+  case 72: // DXGI_FORMAT_BC1_UNORM_SRGB
+    return rhi::Format::BC1Srgb;
+  case 77: // DXGI_FORMAT_BC3_UNORM
+    return rhi::Format::BC3;
+  case 78: // DXGI_FORMAT_BC3_UNORM_SRGB
+    return rhi::Format::BC3Srgb;
+  case 80: // DXGI_FORMAT_BC4_UNORM
+    return rhi::Format::BC4;
+  case 83: // DXGI_FORMAT_BC5_UNORM
+    return rhi::Format::BC5;
+  case 87: // DXGI_FORMAT_B8G8R8A8_UNORM
+    return rhi::Format::BGRA8;
+  case 98: // DXGI_FORMAT_BC7_UNORM
+    return rhi::Format::BC7;
+  case 99: // DXGI_FORMAT_BC7_UNORM_SRGB
+    return rhi::Format::BC7Srgb;
+  default:
+    return rhi::Format::Unknown;
+  }
+}
+
+// Pre-DX10 pixel formats: FourCC block codes and 32-bit RGBA masks
+rhi::Format format_from_dds_pixel_format(std::span<const std::byte> bytes,
+                                         size_t offset) {
+  const uint32_t flags = read<uint32_t>(bytes, offset + 4);
+  if (flags & kDdsPixelFourCC) {
+    switch (read<uint32_t>(bytes, offset + 8)) {
+    case four_cc('D', 'X', 'T', '1'):
+      return rhi::Format::BC1;
+    case four_cc('D', 'X', 'T', '5'):
+      return rhi::Format::BC3;
+    case four_cc('A', 'T', 'I', '1'):
+    case four_cc('B', 'C', '4', 'U'):
+      return rhi::Format::BC4;
+    case four_cc('A', 'T', 'I', '2'):
+    case four_cc('B', 'C', '5', 'U'):
+      return rhi::Format::BC5;
+    default:
+      return rhi::Format::Unknown;
+    }
+  }
+  if ((flags & kDdsPixelRgb) && read<uint32_t>(bytes, offset + 12) == 32) {
+    const uint32_t red_mask = read<uint32_t>(bytes, offset + 16);
+    const uint32_t blue_mask = read<uint32_t>(bytes, offset + 24);
+    if (red_mask == 0x000000FF && blue_mask == 0x00FF0000)
+      return rhi::Format::RGBA8;
+    if (red_mask == 0x00FF0000 && blue_mask == 0x000000FF)
+      return rhi::Format::BGRA8;
+  }
+  return rhi::Format::Unknown;
+}
+
+uint32_t full_chain_levels(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+    ++levels;
+  }
+  return levels;
+}
+
+} // namespace
+
+bool TextureContainer::is_container_path(const std::string& path) {
+  const size_t dot = path.find_last_of('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string extension = path.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) {
+                   return static_cast<char>(std::tolower(c));
+                 });
+  return extension == "ktx2" || extension == "dds";
+}
+
+std::unique_ptr<TextureContainer>
+TextureContainer::open(const std::string& path) {
+  auto file = core::MappedFile::open(path);
+  if (!file) {
+    std::cerr << "TextureContainer: Cannot open " << path << std::endl;
+    return nullptr;
+  }
+
+  auto container = std::unique_ptr<TextureContainer>(new TextureContainer());
+  container->file_ = std::move(file);
+  const auto bytes = container->file_->bytes();
+
+  bool ok = false;
+  if (bytes.size() >= sizeof(kKtx2Identifier) &&
+      std::memcmp(bytes.data(), kKtx2Identifier,
+                  sizeof(kKtx2Identifier)) == 0) {
+    container->kind_ = Kind::KTX2;
+    ok = container->parse_ktx2();
+  } else if (bytes.size() >= sizeof(kDdsMagic) &&
+             std::memcmp(bytes.data(), kDdsMagic, sizeof(kDdsMagic)) == 0) {
+    container->kind_ = Kind::DDS;
+    ok = container->parse_dds();
+  } else {
+    std::cerr << "TextureContainer: " << path << " is not a KTX2 or DDS file"
+              << std::endl;
+  }
+  if (!ok) {
+    return nullptr;
+  }
+  return container;
+}
+
+bool TextureContainer::parse_ktx2() {
+  const auto bytes = file_->bytes();
+  auto fail = [&](const char* reason) {
+    std::cerr << "TextureContainer: " << path() << ": " << reason << std::endl;
+    return false;
+  };
+  if (bytes.size() < kKtx2HeaderSize) {
+    return fail("truncated KTX2 header");
+  }
+
+  const uint32_t vk_format = read<uint32_t>(bytes, 12);
+  width_ = read<uint32_t>(bytes, 20);
+  height_ = read<uint32_t>(bytes, 24);
+  const uint32_t depth = read<uint32_t>(bytes, 28);
+  const uint32_t layer_count = read<uint32_t>(bytes, 32);
+  const uint32_t face_count = read<uint32_t>(bytes, 36);
+  // 0 asks the loader to generate mips; only the base level is stored
+  const uint32_t level_count = std::max(1u, read<uint32_t>(bytes, 40));
+  const uint32_t supercompression = read<uint32_t>(bytes, 44);
+
+  if (width_ == 0 || height_ == 0 || depth > 1 || layer_count > 1 ||
+      face_count != 1) {
+    return fail("only single 2D KTX2 images are supported");
+  }
+  if (supercompression != 0) {
+    return fail("supercompressed KTX2 (Basis/zstd) is not supported");
+  }
+  format_ = format_from_vk(vk_format);
+  if (format_ == rhi::Format::Unknown) {
+    return fail("unsupported KTX2 vkFormat");
+  }
+  if (level_count > full_chain_levels(width_, height_) ||
+      kKtx2HeaderSize + size_t(level_count) * kKtx2LevelEntrySize >
+          bytes.size()) {
+    return fail("truncated KTX2 level index");
+  }
+
+  // The DFD is optional for our purposes; without one alpha is straight
+  const uint32_t dfd_offset = read<uint32_t>(bytes, 48);
+  const uint32_t dfd_length = read<uint32_t>(bytes, 52);
+  if (dfd_length >= kKtx2DfdFlagsWord + 4 && dfd_offset <= bytes.size() &&
+      dfd_length <= bytes.size() - dfd_offset) {
+    const uint32_t word = read<uint32_t>(bytes, dfd_offset + kKtx2DfdFlagsWord);
+    premultiplied_alpha_ = ((word >> 24) & kKtx2DfdFlagAlphaPremultiplied) != 0;
+  }
+
+  levels_.reserve(level_count);
+  for (uint32_t level = 0; level < level_count; ++level) {
+    const size_t entry = kKtx2HeaderSize + size_t(level) * kKtx2LevelEntrySize;
+    const uint64_t offset = read<uint64_t>(bytes, entry);
+    const uint64_t length = read<uint64_t>(bytes, entry + 8);
+    const uint32_t w = std::max(1u, width_ >> level);
+    const uint32_t h = std::max(1u, height_ >> level);
+    if (length != rhi::format_level_size(format_, w, h)) {
+      return fail("KTX2 level size does not match its format");
+    }
+    if (offset > bytes.size() || length > bytes.size() - offset) {
+      return fail("KTX2 level data past end of file");
+    }
+    levels_.push_back(bytes.subspan(static_cast<size_t>(offset),
+                                    static_cast<size_t>(length)));
+  }
+  return true;
+}
+
+bool TextureContainer::parse_dds() {
+  const auto bytes = file_->bytes();
+  auto fail = [&](const char* reason) {
+    std::cerr << "TextureContainer: " << path() << ": " << reason << std::endl;
+    return false;
+  };
+  if (bytes.size() < 4 + kDdsHeaderSize ||
+      read<uint32_t>(bytes, 4) != kDdsHeaderSize) {
+    return fail("truncated DDS header");
+  }
+
+  const uint32_t flags = read<uint32_t>(bytes, 8);
+  height_ = read<uint32_t>(bytes, 12);
+  width_ = read<uint32_t>(bytes, 16);
+  const uint32_t depth = read<uint32_t>(bytes, 24);
+  const uint32_t mip_count = read<uint32_t>(bytes, 28);
+  const size_t pixel_format = 76;
+  const uint32_t caps2 = read<uint32_t>(bytes, 112);
+
+  if (width_ == 0 || height_ == 0 || (caps2 & kDdsCaps2Cubemap) ||
+      (caps2 & kDdsCaps2Volume) || ((flags & kDdsFlagDepth) && depth > 1)) {
+    return fail("only single 2D DDS images are supported");
+  }
+
+  size_t data_offset = 4 + kDdsHeaderSize;
+  const bool has_dx10 =
+      (read<uint32_t>(bytes, pixel_format + 4) & kDdsPixelFourCC) &&
+      read<uint32_t>(bytes, pixel_format + 8) == four_cc('D', 'X', '1', '0');
+  if (has_dx10) {
+    if (bytes.size() < data_offset + kDdsDx10HeaderSize) {
+      return fail("truncated DDS DX10 header");
+    }
+    const uint32_t dxgi_format = read<uint32_t>(bytes, data_offset);
+    const uint32_t dimension = read<uint32_t>(bytes, data_offset + 4);
+    const uint32_t misc = read<uint32_t>(bytes, data_offset + 8);
+    const uint32_t array_size = read<uint32_t>(bytes, data_offset + 12);
+    const uint32_t misc2 = read<uint32_t>(bytes, data_offset + 16);
+    if (dimension != kDxgiDimensionTexture2D || (misc & kDxgiMiscTextureCube) ||
+        array_size > 1) {
+      return fail("only single 2D DDS images are supported");
+    }
+    format_ = format_from_dxgi(dxgi_format);
+    premultiplied_alpha_ =
+        (misc2 & kDdsAlphaModeMask) == kDdsAlphaModePremultiplied;
+    data_offset += kDdsDx10HeaderSize;
+  } else {
+    format_ = format_from_dds_pixel_format(bytes, pixel_format);
+  }
+  if (format_ == rhi::Format::Unknown) {
+    return fail("unsupported DDS pixel format");
+  }
+
+  const uint32_t level_count =
+      (flags & kDdsFlagMipMapCount) && mip_count > 0 ? mip_count : 1;
+  if (level_count > full_chain_levels(width_, height_)) {
+    return fail("invalid DDS mip count");
+  }
+
+  // Levels follow the headers back to back, largest first
+  size_t offset = data_offset;
+  levels_.reserve(level_count);
+  for (uint32_t level = 0; level < level_count; ++level) {
+    const uint32_t w = std::max(1u, width_ >> level);
+    const uint32_t h = std::max(1u, height_ >> level);
+    const size_t length = rhi::format_level_size(format_, w, h);
+    if (offset > bytes.size() || length > bytes.size() - offset) {
+      return fail("DDS level data past end of file");
+    }
+    levels_.push_back(bytes.subspan(offset, length));
+    offset += length;
+  }
+  return true;
+}
+
+size_t TextureContainer::payload_bytes() const {
+  size_t total = 0;
+  for (const auto& level : levels_) {
+    total += level.size();
+  }
+  return total;
+}
+
+} // namespace pixel::resources
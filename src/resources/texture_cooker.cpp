@@ -0,0 +1,531 @@
+#include "pixel/resources/texture_cooker.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <system_error>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+namespace pixel::resources {
+
+namespace {
+
+constexpr uint8_t kKtx2Identifier[12] = {0xAB, 'K',  'T',  'X', ' ',  '2',
+                                         '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+constexpr size_t kKtx2HeaderSize = 80;
+constexpr size_t kKtx2LevelEntrySize = 24;
+constexpr char kWriterKey[] = "KTXwriter";
+constexpr char kWriterValue[] = "pixel texture cooker";
+
+// Khronos Data Format values used by the basic descriptor block
+constexpr uint32_t kDfModelRgbsda = 1;
+constexpr uint32_t kDfModelBc1a = 128;
+constexpr uint32_t kDfModelBc3 = 130;
+constexpr uint32_t kDfModelBc4 = 131;
+constexpr uint32_t kDfModelBc5 = 132;
+constexpr uint32_t kDfModelBc7 = 134;
+constexpr uint32_t kDfPrimariesBt709 = 1;
+constexpr uint32_t kDfTransferLinear = 1;
+constexpr uint32_t kDfTransferSrgb = 2;
+constexpr uint32_t kDfFlagAlphaPremultiplied = 1;
+constexpr uint32_t kDfChannelAlpha = 15;
+constexpr uint32_t kDfQualifierLinear = 0x80;
+
+struct FormatInfo {
+  rhi::Format format;
+  const char* name;
+  uint32_t vk_format;
+  uint32_t model;
+  bool srgb;
+};
+
+constexpr FormatInfo kFormats[] = {
+    {rhi::Format::R8, "R8", 9, kDfModelRgbsda, false},
+    {rhi::Format::RGBA8, "RGBA8", 37, kDfModelRgbsda, false},
+    {rhi::Format::RGBA8Srgb, "RGBA8Srgb", 43, kDfModelRgbsda, true},
+    {rhi::Format::BC1, "BC1", 133, kDfModelBc1a, false},
+    {rhi::Format::BC1Srgb, "BC1Srgb", 134, kDfModelBc1a, true},
+    {rhi::Format::BC3, "BC3", 137, kDfModelBc3, false},
+    {rhi::Format::BC3Srgb, "BC3Srgb", 138, kDfModelBc3, true},
+    {rhi::Format::BC4, "BC4", 139, kDfModelBc4, false},
+    {rhi::Format::BC5, "BC5", 141, kDfModelBc5, false},
+    {rhi::Format::BC7, "BC7", 145, kDfModelBc7, false},
+    {rhi::Format::BC7Srgb, "BC7Srgb", 146, kDfModelBc7, true},
+};
+
+const FormatInfo* find_format(rhi::Format format) {
+  for (const FormatInfo& info : kFormats) {
+    if (info.format == format)
+      return &info;
+  }
+  return nullptr;
+}
+
+const FormatInfo* find_format(const std::string& name) {
+  for (const FormatInfo& info : kFormats) {
+    if (name == info.name)
+      return &info;
+  }
+  return nullptr;
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+  uint8_t bytes[4];
+  std::memcpy(bytes, &value, 4);
+  out.insert(out.end(), bytes, bytes + 4);
+}
+
+void patch_u32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+  std::memcpy(out.data() + offset, &value, 4);
+}
+
+void patch_u64(std::vector<uint8_t>& out, size_t offset, uint64_t value) {
+  std::memcpy(out.data() + offset, &value, 8);
+}
+
+void pad_to(std::vector<uint8_t>& out, size_t alignment) {
+  out.resize((out.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+// One sample of a basic descriptor: `bits` wide at `offset`
+void put_dfd_sample(std::vector<uint8_t>& out, uint32_t offset, uint32_t bits,
+                    uint32_t channel, uint32_t upper) {
+  put_u32(out, offset | ((bits - 1) << 16) | (channel << 24));
+  put_u32(out, 0); // sample position
+  put_u32(out, 0); // lower
+  put_u32(out, upper);
+}
+
+// Basic data format descriptor, including the leading dfdTotalSize
+std::vector<uint8_t> make_dfd(const FormatInfo& info, bool premultiplied) {
+  const bool compressed = info.model != kDfModelRgbsda;
+  const uint32_t block_bytes = rhi::format_block_bytes(info.format);
+  std::vector<uint8_t> samples;
+  if (!compressed) {
+    static constexpr uint32_t kChannels[4] = {0, 1, 2, kDfChannelAlpha};
+    for (uint32_t c = 0; c < block_bytes; ++c) {
+      uint32_t channel = kChannels[block_bytes == 1 ? 0 : c];
+      // Alpha is never sRGB-encoded
+      if (channel == kDfChannelAlpha && info.srgb)
+        channel |= kDfQualifierLinear;
+      put_dfd_sample(samples, c * 8, 8, channel, 255);
+    }
+  } else if (info.model == kDfModelBc3) {
+    put_dfd_sample(samples, 0, 64, kDfChannelAlpha, ~0u);
+    put_dfd_sample(samples, 64, 64, 0, ~0u);
+  } else if (info.model == kDfModelBc5) {
+    put_dfd_sample(samples, 0, 64, 0, ~0u);
+    put_dfd_sample(samples, 64, 64, 1, ~0u);
+  } else {
+    put_dfd_sample(samples, 0, block_bytes * 8, 0, ~0u);
+  }
+
+  const uint32_t block_size = 24 + static_cast<uint32_t>(samples.size());
+  std::vector<uint8_t> dfd;
+  put_u32(dfd, 4 + block_size);
+  put_u32(dfd, 0); // Khronos vendor, basic descriptor type
+  put_u32(dfd, 2 | (block_size << 16));
+  put_u32(dfd, info.model | (kDfPrimariesBt709 << 8) |
+                   ((info.srgb ? kDfTransferSrgb : kDfTransferLinear) << 16) |
+                   ((premultiplied ? kDfFlagAlphaPremultiplied : 0) << 24));
+  put_u32(dfd, compressed ? 0x0303u : 0u); // texel block dimensions - 1
+  put_u32(dfd, block_bytes);               // bytes in plane 0
+  put_u32(dfd, 0);
+  dfd.insert(dfd.end(), samples.begin(), samples.end());
+  return dfd;
+}
+
+} // namespace
+
+// ============================================================================
+// Cooking
+// ============================================================================
+
+CookedTexture cook_texture(const uint8_t* rgba, uint32_t width, uint32_t height,
+                           const CookOptions& options) {
+  CookedTexture cooked;
+  MipmapOptions mipmaps = options.mipmaps;
+  if (!options.generate_mips) {
+    mipmaps.max_levels = 1;
+  }
+  const MipChain chain = generate_mipmaps(rgba, width, height, mipmaps);
+  if (chain.levels.empty()) {
+    return cooked;
+  }
+
+  cooked.width = width;
+  cooked.height = height;
+  cooked.premultiplied_alpha = mipmaps.premultiply_alpha;
+  cooked.format = rhi::Format::RGBA8;
+  if (options.block_compress) {
+    // Coverage rescaling never lowers an opaque image's alpha, so level 0
+    // decides whether BC1 loses anything
+    bool has_alpha = false;
+    for (size_t i = 3; i < chain.levels[0].size && !has_alpha; i += 4) {
+      has_alpha = chain.data[i] != 255;
+    }
+    cooked.format = has_alpha ? rhi::Format::BC3 : rhi::Format::BC1;
+  }
+
+  cooked.levels.reserve(chain.levels.size());
+  for (const MipChain::Level& level : chain.levels) {
+    const uint8_t* texels = chain.data.data() + level.offset;
+    if (cooked.format == rhi::Format::RGBA8) {
+      cooked.levels.emplace_back(texels, texels + level.size);
+    } else {
+      cooked.levels.push_back(
+          compress_bc(texels, level.width, level.height, cooked.format));
+    }
+  }
+  return cooked;
+}
+
+std::vector<uint8_t> compress_bc(const uint8_t* rgba, uint32_t width,
+                                 uint32_t height, rhi::Format format) {
+  std::vector<uint8_t> blocks;
+  if (!rgba || width == 0 || height == 0) {
+    return blocks;
+  }
+  const bool bc1 = format == rhi::Format::BC1 || format == rhi::Format::BC1Srgb;
+  const bool bc3 = format == rhi::Format::BC3 || format == rhi::Format::BC3Srgb;
+  const bool bc4 = format == rhi::Format::BC4;
+  const bool bc5 = format == rhi::Format::BC5;
+  if (!bc1 && !bc3 && !bc4 && !bc5) {
+    std::cerr << "compress_bc: unsupported format" << std::endl;
+    return blocks;
+  }
+
+  const uint32_t block_bytes = rhi::format_block_bytes(format);
+  blocks.resize(rhi::format_level_size(format, width, height));
+  uint8_t* out = blocks.data();
+  uint8_t texels[16 * 4];
+  for (uint32_t by = 0; by < height; by += 4) {
+    for (uint32_t bx = 0; bx < width; bx += 4) {
+      // Gather a 4x4 block, repeating the last row/column past the edge
+      for (uint32_t y = 0; y < 4; ++y) {
+        const uint32_t sy = std::min(by + y, height - 1);
+        for (uint32_t x = 0; x < 4; ++x) {
+          const uint32_t sx = std::min(bx + x, width - 1);
+          const uint8_t* src = rgba + (size_t(sy) * width + sx) * 4;
+          uint8_t* dst = texels + (y * 4 + x) * (bc4 ? 1 : bc5 ? 2 : 4);
+          std::memcpy(dst, src, bc4 ? 1 : bc5 ? 2 : 4);
+        }
+      }
+      if (bc4) {
+        stb_compress_bc4_block(out, texels);
+      } else if (bc5) {
+        stb_compress_bc5_block(out, texels);
+      } else {
+        stb_compress_dxt_block(out, texels, bc3 ? 1 : 0, STB_DXT_HIGHQUAL);
+      }
+      out += block_bytes;
+    }
+  }
+  return blocks;
+}
+
+bool write_ktx2(const std::string& path, const CookedTexture& texture) {
+  const FormatInfo* info = find_format(texture.format);
+  if (!info) {
+    std::cerr << "write_ktx2: " << path << ": unsupported format" << std::endl;
+    return false;
+  }
+  if (texture.width == 0 || texture.height == 0 || texture.levels.empty()) {
+    std::cerr << "write_ktx2: " << path << ": empty texture" << std::endl;
+    return false;
+  }
+  for (size_t level = 0; level < texture.levels.size(); ++level) {
+    const uint32_t w = std::max(1u, texture.width >> level);
+    const uint32_t h = std::max(1u, texture.height >> level);
+    if (texture.levels[level].size() !=
+        rhi::format_level_size(texture.format, w, h)) {
+      std::cerr << "write_ktx2: " << path << ": level " << level
+                << " size does not match its format" << std::endl;
+      return false;
+    }
+  }
+
+  const uint32_t level_count = static_cast<uint32_t>(texture.levels.size());
+  std::vector<uint8_t> out(kKtx2Identifier,
+                           kKtx2Identifier + sizeof(kKtx2Identifier));
+  put_u32(out, info->vk_format);
+  put_u32(out, 1); // typeSize: 8-bit channels, or 1 for blocks
+  put_u32(out, texture.width);
+  put_u32(out, texture.height);
+  put_u32(out, 0); // depth
+  put_u32(out, 0); // layers
+  put_u32(out, 1); // faces
+  put_u32(out, level_count);
+  put_u32(out, 0); // no supercompression
+  const size_t index = out.size();
+  out.resize(kKtx2HeaderSize + level_count * kKtx2LevelEntrySize, 0);
+
+  // Data format descriptor, then key/value data, each 4-byte aligned
+  const std::vector<uint8_t> dfd = make_dfd(*info, texture.premultiplied_alpha);
+  patch_u32(out, index, static_cast<uint32_t>(out.size()));
+  patch_u32(out, index + 4, static_cast<uint32_t>(dfd.size()));
+  out.insert(out.end(), dfd.begin(), dfd.end());
+
+  const size_t kvd_offset = out.size();
+  put_u32(out, sizeof(kWriterKey) + sizeof(kWriterValue));
+  out.insert(out.end(), kWriterKey, kWriterKey + sizeof(kWriterKey));
+  out.insert(out.end(), kWriterValue, kWriterValue + sizeof(kWriterValue));
+  pad_to(out, 4);
+  patch_u32(out, index + 8, static_cast<uint32_t>(kvd_offset));
+  patch_u32(out, index + 12, static_cast<uint32_t>(out.size() - kvd_offset));
+
+  // Levels are stored smallest first, each aligned to lcm(block size, 4)
+  const size_t alignment =
+      std::lcm<size_t>(rhi::format_block_bytes(texture.format), 4);
+  for (uint32_t level = level_count; level-- > 0;) {
+    pad_to(out, alignment);
+    const auto& bytes = texture.levels[level];
+    const size_t entry = kKtx2HeaderSize + size_t(level) * kKtx2LevelEntrySize;
+    patch_u64(out, entry, out.size());
+    patch_u64(out, entry + 8, bytes.size());
+    patch_u64(out, entry + 16, bytes.size());
+    out.insert(out.end(), bytes.begin(), bytes.end());
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(out.data()),
+             static_cast<std::streamsize>(out.size()));
+  if (!file) {
+    std::cerr << "write_ktx2: Cannot write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::string cooked_texture_path(const std::string& source_path) {
+  return source_path + ".ktx2";
+}
+
+bool cooked_texture_is_current(const std::string& source_path,
+                               const std::string& cooked_path) {
+  std::error_code ec;
+  const auto cooked_time = std::filesystem::last_write_time(cooked_path, ec);
+  if (ec) {
+    return false;
+  }
+  const auto source_time = std::filesystem::last_write_time(source_path, ec);
+  return ec || cooked_time >= source_time;
+}
+
+// ============================================================================
+// Atlas packing
+// ============================================================================
+
+std::optional<Atlas> pack_atlas(std::span<const AtlasImage> images,
+                                uint32_t padding, uint32_t max_extent) {
+  if (images.empty()) {
+    return std::nullopt;
+  }
+
+  // Tallest first keeps shelves tight
+  std::vector<size_t> order(images.size());
+  std::iota(order.begin(), order.end(), size_t{0});
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (images[a].height != images[b].height)
+      return images[a].height > images[b].height;
+    return images[a].width > images[b].width;
+  });
+
+  uint64_t area = 0;
+  uint32_t widest = 1;
+  for (const AtlasImage& image : images) {
+    const uint64_t w = image.width + 2ull * padding;
+    const uint64_t h = image.height + 2ull * padding;
+    area += w * h;
+    widest = static_cast<uint32_t>(std::max<uint64_t>(widest, w));
+  }
+  uint32_t width = 1;
+  while (width < widest || uint64_t(width) * width < area) {
+    width *= 2;
+  }
+
+  struct Position {
+    uint32_t x;
+    uint32_t y;
+  };
+  std::vector<Position> positions(images.size());
+  for (; width <= max_extent; width *= 2) {
+    uint32_t shelf_x = 0;
+    uint32_t shelf_y = 0;
+    uint32_t shelf_height = 0;
+    bool fits = true;
+    for (size_t i : order) {
+      const uint32_t w = images[i].width + 2 * padding;
+      const uint32_t h = images[i].height + 2 * padding;
+      if (shelf_x + w > width) {
+        shelf_y += shelf_height;
+        shelf_x = 0;
+        shelf_height = 0;
+      }
+      if (shelf_y + h > max_extent) {
+        fits = false;
+        break;
+      }
+      positions[i] = Position{shelf_x, shelf_y};
+      shelf_x += w;
+      shelf_height = std::max(shelf_height, h);
+    }
+    if (!fits) {
+      continue;
+    }
+
+    Atlas atlas;
+    atlas.width = width;
+    // Whole 4x4 blocks so the atlas can be block-compressed
+    atlas.height = std::min(max_extent, (shelf_y + shelf_height + 3) / 4 * 4);
+    atlas.rgba.assign(size_t(atlas.width) * atlas.height * 4, 0);
+    atlas.rects.reserve(images.size());
+    for (size_t i = 0; i < images.size(); ++i) {
+      const AtlasImage& image = images[i];
+      const uint32_t w = image.width + 2 * padding;
+      const uint32_t h = image.height + 2 * padding;
+      for (uint32_t y = 0; y < h; ++y) {
+        // Padding repeats the nearest edge texel
+        const uint32_t sy = std::min(image.height - 1,
+                                     y > padding ? y - padding : 0);
+        uint8_t* dst = atlas.rgba.data() +
+                       (size_t(positions[i].y + y) * atlas.width +
+                        positions[i].x) * 4;
+        for (uint32_t x = 0; x < w; ++x) {
+          const uint32_t sx = std::min(image.width - 1,
+                                       x > padding ? x - padding : 0);
+          std::memcpy(dst + size_t(x) * 4,
+                      image.rgba + (size_t(sy) * image.width + sx) * 4, 4);
+        }
+      }
+      atlas.rects.push_back(AtlasRect{image.name, positions[i].x + padding,
+                                      positions[i].y + padding, image.width,
+                                      image.height});
+    }
+    return atlas;
+  }
+  return std::nullopt;
+}
+
+// ============================================================================
+// Manifest
+// ============================================================================
+
+std::optional<TextureManifest> TextureManifest::load(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "TextureManifest: Cannot open " << path << std::endl;
+    return std::nullopt;
+  }
+
+  auto parse_u32 = [](const std::string& text, uint32_t& value) {
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    return ec == std::errc() && ptr == end;
+  };
+
+  TextureManifest manifest;
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(file, line)) {
+    ++line_number;
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::vector<std::string> fields;
+    std::istringstream stream(line);
+    for (std::string field; std::getline(stream, field, '\t');) {
+      fields.push_back(field);
+    }
+
+    bool ok = false;
+    if (fields[0] == "options" && fields.size() == 2) {
+      manifest.set_options(fields[1]);
+      ok = true;
+    } else if (fields[0] == "texture" && fields.size() == 8) {
+      Texture texture;
+      texture.source = fields[1];
+      texture.cooked = fields[2];
+      const FormatInfo* info = find_format(fields[3]);
+      texture.format = info ? info->format : rhi::Format::Unknown;
+      texture.premultiplied_alpha = fields[7] == "premultiplied";
+      ok = info && parse_u32(fields[4], texture.width) &&
+           parse_u32(fields[5], texture.height) &&
+           parse_u32(fields[6], texture.levels) &&
+           (texture.premultiplied_alpha || fields[7] == "straight");
+      if (ok)
+        manifest.add_texture(std::move(texture));
+    } else if (fields[0] == "sprite" && fields.size() == 7) {
+      Sprite sprite;
+      sprite.name = fields[1];
+      sprite.atlas = fields[2];
+      ok = parse_u32(fields[3], sprite.x) && parse_u32(fields[4], sprite.y) &&
+           parse_u32(fields[5], sprite.width) &&
+           parse_u32(fields[6], sprite.height);
+      if (ok)
+        manifest.add_sprite(std::move(sprite));
+    }
+    if (!ok) {
+      std::cerr << "TextureManifest: " << path << ":" << line_number
+                << ": malformed record" << std::endl;
+      return std::nullopt;
+    }
+  }
+  return manifest;
+}
+
+bool TextureManifest::save(const std::string& path) const {
+  std::ofstream file(path, std::ios::trunc);
+  file << "# pixel texture manifest\n";
+  if (!options_.empty()) {
+    file << "options\t" << options_ << '\n';
+  }
+  for (const Texture& texture : textures_) {
+    const FormatInfo* info = find_format(texture.format);
+    file << "texture\t" << texture.source << '\t' << texture.cooked << '\t'
+         << (info ? info->name : "Unknown") << '\t' << texture.width << '\t'
+         << texture.height << '\t' << texture.levels << '\t'
+         << (texture.premultiplied_alpha ? "premultiplied" : "straight")
+         << '\n';
+  }
+  for (const Sprite& sprite : sprites_) {
+    file << "sprite\t" << sprite.name << '\t' << sprite.atlas << '\t'
+         << sprite.x << '\t' << sprite.y << '\t' << sprite.width << '\t'
+         << sprite.height << '\n';
+  }
+  if (!file) {
+    std::cerr << "TextureManifest: Cannot write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+const TextureManifest::Texture*
+TextureManifest::find_texture(const std::string& source) const {
+  for (const Texture& texture : textures_) {
+    if (texture.source == source)
+      return &texture;
+  }
+  return nullptr;
+}
+
+const TextureManifest::Sprite*
+TextureManifest::find_sprite(const std::string& name) const {
+  for (const Sprite& sprite : sprites_) {
+    if (sprite.name == name)
+      return &sprite;
+  }
+  return nullptr;
+}
+
+} // namespace pixel::resources
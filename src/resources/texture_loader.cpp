@@ -1,52 +1,584 @@
 #include "pixel/resources/texture_loader.hpp"
+#include "pixel/core/mapped_file.hpp"
+#include "pixel/resources/texture_cooker.hpp"
 #include "pixel/rhi/rhi.hpp"
 #include "pixel/rhi/types.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <span>
+#include <string>
+#include <system_error>
+#include <utility>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 namespace pixel::resources {
 
+namespace {
+
+// Word-at-a-time 64-bit hash for content dedupe; matches are confirmed by
+// comparing the files (see TextureLoader::find_duplicate)
+uint64_t hash_bytes(std::span<const std::byte> bytes) {
+  constexpr uint64_t kMul = 0x9E3779B97F4A7C15ull;
+  uint64_t hash = 0xCBF29CE484222325ull ^ (bytes.size() * kMul);
+  size_t i = 0;
+  for (; i + 8 <= bytes.size(); i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes.data() + i, 8);
+    hash = (hash ^ word) * kMul;
+    hash ^= hash >> 32;
+  }
+  for (; i < bytes.size(); ++i) {
+    hash = (hash ^ static_cast<uint64_t>(bytes[i])) * kMul;
+  }
+  hash ^= hash >> 29;
+  hash *= 0xBF58476D1CE4E5B9ull;
+  hash ^= hash >> 32;
+  // 0 means "not hashed"
+  return hash != 0 ? hash : 1;
+}
+
+// Suffix telling apart chains built from one file with different options
+std::string mipmap_tag(const MipmapOptions& mipmaps) {
+  return "#mips:srgb=" + std::string(mipmaps.srgb ? "1" : "0") +
+         ",cutoff=" + std::to_string(mipmaps.alpha_cutoff) +
+         ",levels=" + std::to_string(mipmaps.max_levels) +
+         ",premultiply=" + (mipmaps.premultiply_alpha ? "1" : "0");
+}
+
+} // namespace
+
+// ============================================================================
+// TextureRef
+// ============================================================================
+
+struct TextureRef::Lease {
+  uint32_t texture_id = 0;
+  std::weak_ptr<TextureLoader::ReleaseQueue> queue;
+
+  ~Lease() {
+    if (auto released = queue.lock()) {
+      std::lock_guard<std::mutex> lock(released->mutex);
+      released->released.push_back(texture_id);
+    }
+  }
+};
+
 TextureLoader::TextureLoader(rhi::Device* device)
-    : device_(device) {
+    : TextureLoader(device, Settings{}) {}
+
+TextureLoader::TextureLoader(rhi::Device* device, const Settings& settings)
+    : device_(device), settings_(settings) {
   if (!device_) {
     throw std::invalid_argument("TextureLoader: device cannot be null");
   }
 }
 
+TextureLoader::~TextureLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::string TextureLoader::canonical_path(const std::string& path) {
+  std::error_code error;
+  std::filesystem::path canonical =
+      std::filesystem::weakly_canonical(std::filesystem::path(path), error);
+  if (error) {
+    canonical = std::filesystem::path(path).lexically_normal();
+  }
+  return canonical.generic_string();
+}
+
+std::string TextureLoader::cache_key(const std::string& canonical,
+                                     const MipmapOptions& mipmaps) const {
+  // Containers carry their own mips, so options never split their entries
+  if (mipmaps == settings_.mipmaps ||
+      TextureContainer::is_container_path(canonical)) {
+    return canonical;
+  }
+  return canonical + mipmap_tag(mipmaps);
+}
+
 rhi::TextureHandle TextureLoader::load(const std::string& path) {
-  // Check cache
-  auto it = cache_.find(path);
-  if (it != cache_.end()) {
-    return it->second;
+  return load(path, settings_.mipmaps);
+}
+
+rhi::TextureHandle TextureLoader::load(const std::string& path,
+                                       const MipmapOptions& mipmaps) {
+  CacheEntry* entry = load_entry(path, mipmaps);
+  if (!entry) {
+    return {0};
   }
+  entry->pinned = true;
+  return entry->texture;
+}
 
-  // Load image using STB
-  int width, height, channels;
-  unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+TextureRef TextureLoader::acquire(const std::string& path) {
+  return acquire(path, settings_.mipmaps);
+}
 
-  if (!data) {
+TextureRef TextureLoader::acquire(const std::string& path,
+                                  const MipmapOptions& mipmaps) {
+  CacheEntry* entry = load_entry(path, mipmaps);
+  return entry ? make_ref(*entry) : TextureRef{};
+}
+
+TextureLoader::CacheEntry*
+TextureLoader::load_entry(const std::string& path,
+                          const MipmapOptions& mipmaps) {
+  const std::string canonical = canonical_path(path);
+  const std::string key = cache_key(canonical, mipmaps);
+
+  // Check cache
+  if (CacheEntry* cached = find_cached(key)) {
+    ++stats_.hits;
+    return cached;
+  }
+  ++stats_.misses;
+
+  DecodedImage image;
+  decode(canonical, mipmaps, image);
+  if (image.failed()) {
     std::cerr << "TextureLoader: Failed to load texture: " << path << std::endl;
-    return {0};
+    return nullptr;
   }
 
-  // Create texture
-  auto texture_handle = create(width, height, data);
-  stbi_image_free(data);
+  // Same bytes under another name
+  if (CacheEntry* duplicate = find_duplicate(image)) {
+    ++stats_.content_dedupes;
+    duplicate->paths.push_back(key);
+    by_path_[key] = duplicate->texture.id;
+    return duplicate;
+  }
 
+  const auto texture_handle =
+      image.container ? create(*image.container) : create(image.chain);
   if (texture_handle.id == 0) {
     std::cerr << "TextureLoader: Failed to create texture from: " << path << std::endl;
-    return {0};
+    return nullptr;
   }
 
-  // Cache the result
-  cache_[path] = texture_handle;
+  const uint32_t width = image.container ? image.container->width()
+                                         : image.chain.levels[0].width;
+  const uint32_t height = image.container ? image.container->height()
+                                          : image.chain.levels[0].height;
+  std::cout << "TextureLoader: Loaded texture: " << path << " (" << width
+            << "x" << height << ")" << std::endl;
 
-  std::cout << "TextureLoader: Loaded texture: " << path << " (" << width << "x" << height << ")" << std::endl;
+  return &insert_cached(key, texture_handle, image);
+}
 
-  return texture_handle;
+void TextureLoader::decode(const std::string& path,
+                           const MipmapOptions& mipmaps,
+                           DecodedImage& image) const {
+  // Pre-encoded containers upload from the mapping without decoding
+  if (TextureContainer::is_container_path(path)) {
+    image.mipmaps = settings_.mipmaps;
+    image.container = TextureContainer::open(path);
+    if (image.container && settings_.dedupe_by_content) {
+      image.content_hash = hash_bytes(image.container->file_bytes());
+      image.content_path = path;
+    }
+    return;
+  }
+
+  image.mipmaps = mipmaps;
+
+  // An up-to-date cooked blob replaces decoding; BC blobs only when the
+  // device can sample them, and only in the alpha mode decoding would give.
+  // Blobs are cooked with the build-wide options, so per-load overrides
+  // always decode.
+  if (settings_.prefer_cooked && mipmaps == settings_.mipmaps) {
+    const std::string cooked = cooked_texture_path(path);
+    if (cooked_texture_is_current(path, cooked)) {
+      auto container = TextureContainer::open(cooked);
+      if (container && container->premultiplied_alpha() !=
+                           settings_.mipmaps.premultiply_alpha) {
+        std::cerr << "TextureLoader: " << cooked
+                  << " alpha mode does not match MipmapOptions::"
+                     "premultiply_alpha, decoding "
+                  << path << " instead" << std::endl;
+        container.reset();
+      }
+      if (container &&
+          (!rhi::format_is_block_compressed(container->format()) ||
+           device_->caps().textureCompressionBC)) {
+        if (settings_.dedupe_by_content) {
+          image.content_hash = hash_bytes(container->file_bytes());
+          image.content_path = cooked;
+        }
+        image.container = std::move(container);
+        return;
+      }
+    }
+  }
+
+  // Decode from a mapping so hashing and decoding share one read
+  auto file = core::MappedFile::open(path);
+  if (!file) {
+    return;
+  }
+  const auto bytes = file->bytes();
+  if (settings_.dedupe_by_content) {
+    image.content_hash = hash_bytes(bytes);
+    // Copies only share a texture when their chains were built alike
+    if (mipmaps != settings_.mipmaps) {
+      const std::string tag = mipmap_tag(mipmaps);
+      image.content_hash ^=
+          hash_bytes(std::as_bytes(std::span(tag.data(), tag.size())));
+      image.content_hash += image.content_hash == 0;
+    }
+    image.content_path = path;
+  }
+
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  uint8_t* pixels = stbi_load_from_memory(
+      reinterpret_cast<const stbi_uc*>(bytes.data()),
+      static_cast<int>(bytes.size()), &width, &height, &channels, 4);
+  if (pixels) {
+    image.chain = build_chain(pixels, width, height, mipmaps);
+    stbi_image_free(pixels);
+  }
+}
+
+// ============================================================================
+// Cache bookkeeping
+// ============================================================================
+
+TextureLoader::CacheEntry* TextureLoader::find_cached(const std::string& key) {
+  auto it = by_path_.find(key);
+  return it != by_path_.end() ? &entries_.at(it->second) : nullptr;
+}
+
+TextureLoader::CacheEntry*
+TextureLoader::find_duplicate(const DecodedImage& image) {
+  if (image.content_hash == 0) {
+    return nullptr;
+  }
+  auto it = by_content_.find(image.content_hash);
+  if (it == by_content_.end()) {
+    return nullptr;
+  }
+  CacheEntry& entry = entries_.at(it->second);
+  if (entry.bytes != image.upload_bytes() || entry.mipmaps != image.mipmaps) {
+    return nullptr;
+  }
+
+  // The hash only nominates a candidate; different files that collide must
+  // not share a texture. Only runs on a hash hit, so usually for a real copy.
+  if (entry.content_path != image.content_path) {
+    auto ours = core::MappedFile::open(image.content_path);
+    auto theirs = core::MappedFile::open(entry.content_path);
+    if (!ours || !theirs || ours->size() != theirs->size() ||
+        std::memcmp(ours->bytes().data(), theirs->bytes().data(),
+                    ours->size()) != 0) {
+      std::cerr << "TextureLoader: Content hash collision between "
+                << image.content_path << " and " << entry.content_path
+                << std::endl;
+      return nullptr;
+    }
+  }
+  return &entry;
+}
+
+TextureLoader::CacheEntry&
+TextureLoader::insert_cached(const std::string& key,
+                             rhi::TextureHandle texture,
+                             const DecodedImage& image) {
+  CacheEntry& entry = entries_[texture.id];
+  entry.texture = texture;
+  entry.paths.push_back(key);
+  entry.content_hash = image.content_hash;
+  entry.content_path = image.content_path;
+  entry.mipmaps = image.mipmaps;
+  entry.bytes = image.upload_bytes();
+  by_path_[key] = texture.id;
+  if (entry.content_hash != 0) {
+    by_content_.emplace(entry.content_hash, texture.id);
+  }
+  stats_.textures = entries_.size();
+  stats_.bytes += entry.bytes;
+  return entry;
+}
+
+TextureRef TextureLoader::make_ref(CacheEntry& entry) {
+  auto lease = std::make_shared<TextureRef::Lease>();
+  lease->texture_id = entry.texture.id;
+  lease->queue = release_queue_;
+  ++entry.refs;
+  return TextureRef(std::move(lease), entry.texture);
+}
+
+void TextureLoader::schedule_release(CacheEntry& entry) {
+  entry.release_frame = frame_;
+  pending_releases_.push_back(PendingRelease{entry.texture.id, frame_});
+  stats_.pending_releases = pending_releases_.size();
+}
+
+size_t TextureLoader::process_releases() {
+  std::vector<uint32_t> released;
+  {
+    std::lock_guard<std::mutex> lock(release_queue_->mutex);
+    released.swap(release_queue_->released);
+  }
+  for (uint32_t texture_id : released) {
+    auto it = entries_.find(texture_id);
+    if (it == entries_.end()) {
+      continue;
+    }
+    CacheEntry& entry = it->second;
+    if (--entry.refs == 0 && !entry.pinned) {
+      schedule_release(entry);
+    }
+  }
+
+  size_t destroyed = 0;
+  while (!pending_releases_.empty() &&
+         pending_releases_.front().frame + settings_.release_delay_frames <=
+             frame_) {
+    const PendingRelease pending = pending_releases_.front();
+    pending_releases_.pop_front();
+
+    // Skip textures acquired again (or released again later) meanwhile
+    auto it = entries_.find(pending.texture_id);
+    if (it == entries_.end()) {
+      continue;
+    }
+    CacheEntry& entry = it->second;
+    if (entry.refs != 0 || entry.pinned ||
+        entry.release_frame != pending.frame) {
+      continue;
+    }
+
+    for (const std::string& key : entry.paths) {
+      by_path_.erase(key);
+    }
+    if (entry.content_hash != 0) {
+      auto content = by_content_.find(entry.content_hash);
+      if (content != by_content_.end() &&
+          content->second == pending.texture_id) {
+        by_content_.erase(content);
+      }
+    }
+    device_->destroyTexture(entry.texture);
+    stats_.bytes -= entry.bytes;
+    entries_.erase(it);
+    ++destroyed;
+  }
+
+  stats_.textures = entries_.size();
+  stats_.pending_releases = pending_releases_.size();
+  stats_.released += destroyed;
+  ++frame_;
+  return destroyed;
+}
+
+// ============================================================================
+// Asynchronous loading
+// ============================================================================
+
+AsyncTextureRef TextureLoader::load_async(const std::string& path) {
+  return request_async(path, settings_.mipmaps, true);
+}
+
+AsyncTextureRef TextureLoader::load_async(const std::string& path,
+                                          const MipmapOptions& mipmaps) {
+  return request_async(path, mipmaps, true);
+}
+
+AsyncTextureRef TextureLoader::acquire_async(const std::string& path) {
+  return request_async(path, settings_.mipmaps, false);
+}
+
+AsyncTextureRef TextureLoader::acquire_async(const std::string& path,
+                                             const MipmapOptions& mipmaps) {
+  return request_async(path, mipmaps, false);
+}
+
+AsyncTextureRef TextureLoader::request_async(const std::string& path,
+                                             const MipmapOptions& mipmaps,
+                                             bool pin) {
+  const std::string canonical = canonical_path(path);
+  const std::string key = cache_key(canonical, mipmaps);
+
+  if (CacheEntry* cached = find_cached(key)) {
+    ++stats_.hits;
+    auto result = std::make_shared<AsyncTexture>();
+    result->path_ = canonical;
+    result->key_ = key;
+    result->mipmaps_ = mipmaps;
+    result->state_ = AsyncTexture::State::Ready;
+    result->texture_ = cached->texture;
+    if (pin) {
+      cached->pinned = true;
+    } else {
+      result->ref_ = make_ref(*cached);
+    }
+    return result;
+  }
+
+  auto pending = in_flight_.find(key);
+  if (pending != in_flight_.end()) {
+    pending->second->pin_ = pending->second->pin_ || pin;
+    return pending->second;
+  }
+  ++stats_.misses;
+
+  auto result = std::make_shared<AsyncTexture>();
+  result->path_ = canonical;
+  result->key_ = key;
+  result->mipmaps_ = mipmaps;
+  result->placeholder_ = placeholder();
+  result->pin_ = pin;
+  in_flight_[key] = result;
+
+  // The pool starts on first use so synchronous-only users pay nothing
+  if (workers_.empty()) {
+    uint32_t count = settings_.worker_count;
+    if (count == 0) {
+      const uint32_t hardware = std::thread::hardware_concurrency();
+      count = hardware > 1 ? hardware - 1 : 1;
+    }
+    workers_.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      workers_.emplace_back(&TextureLoader::worker_loop, this);
+    }
+    std::cout << "TextureLoader: Started " << count << " decode threads"
+              << std::endl;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decode_queue_.push_back(result);
+  }
+  work_available_.notify_one();
+  return result;
+}
+
+void TextureLoader::worker_loop() {
+  for (;;) {
+    std::shared_ptr<AsyncTexture> target;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_available_.wait(lock, [this] {
+        return stopping_ || !decode_queue_.empty();
+      });
+      if (stopping_) {
+        return;
+      }
+      target = std::move(decode_queue_.front());
+      decode_queue_.pop_front();
+    }
+
+    // path_ and mipmaps_ are immutable once queued; decode() only reads
+    // settings_
+    DecodedImage image;
+    image.target = target;
+    decode(target->path_, target->mipmaps_, image);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoded_.push_back(std::move(image));
+  }
+}
+
+size_t TextureLoader::process_uploads() {
+  std::deque<DecodedImage> batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t budget_used = 0;
+    while (!decoded_.empty()) {
+      const size_t bytes = decoded_.front().upload_bytes();
+      if (!batch.empty() &&
+          budget_used + bytes > settings_.upload_budget_bytes) {
+        break;
+      }
+      budget_used += bytes;
+      batch.push_back(std::move(decoded_.front()));
+      decoded_.pop_front();
+    }
+  }
+
+  for (auto& image : batch) {
+    AsyncTexture& target = *image.target;
+    in_flight_.erase(target.key_);
+
+    if (image.failed()) {
+      std::cerr << "TextureLoader: Failed to load texture: " << target.path_
+                << std::endl;
+      target.state_ = AsyncTexture::State::Failed;
+      continue;
+    }
+
+    // A synchronous load() of the same path may have finished meanwhile,
+    // or the same bytes may already be cached under another name
+    CacheEntry* entry = find_cached(target.key_);
+    if (!entry) {
+      CacheEntry* duplicate = find_duplicate(image);
+      if (duplicate) {
+        ++stats_.content_dedupes;
+        duplicate->paths.push_back(target.key_);
+        by_path_[target.key_] = duplicate->texture.id;
+        entry = duplicate;
+      }
+    }
+    if (!entry) {
+      const auto texture_handle =
+          image.container ? create(*image.container) : create(image.chain);
+      if (texture_handle.id != 0) {
+        entry = &insert_cached(target.key_, texture_handle, image);
+      }
+    }
+    const int width = static_cast<int>(image.container
+                                           ? image.container->width()
+                                           : image.chain.levels[0].width);
+    const int height = static_cast<int>(image.container
+                                            ? image.container->height()
+                                            : image.chain.levels[0].height);
+    image.chain = {};
+    image.container.reset();
+
+    if (!entry) {
+      std::cerr << "TextureLoader: Failed to create texture from: "
+                << target.path_ << std::endl;
+      target.state_ = AsyncTexture::State::Failed;
+      continue;
+    }
+
+    if (target.pin_) {
+      entry->pinned = true;
+    }
+    target.ref_ = make_ref(*entry);
+    target.texture_ = entry->texture;
+    target.width_ = width;
+    target.height_ = height;
+    target.state_ = AsyncTexture::State::Ready;
+    std::cout << "TextureLoader: Loaded texture (async): " << target.path_
+              << " (" << width << "x" << height << ")" << std::endl;
+  }
+  return batch.size();
+}
+
+size_t TextureLoader::pending_async_loads() const {
+  return in_flight_.size();
+}
+
+rhi::TextureHandle TextureLoader::placeholder() {
+  if (placeholder_.id == 0) {
+    const uint8_t white[4] = {255, 255, 255, 255};
+    placeholder_ = create(1, 1, white);
+  }
+  return placeholder_;
 }
 
 rhi::TextureHandle TextureLoader::create(int width, int height, const uint8_t* data) {
@@ -76,6 +608,76 @@ rhi::TextureHandle TextureLoader::create(int width, int height, const uint8_t* d
   return texture_handle;
 }
 
+rhi::TextureHandle TextureLoader::create(const MipChain& chain) {
+  if (chain.levels.empty()) {
+    return {0};
+  }
+
+  rhi::TextureDesc desc;
+  desc.size = {chain.levels[0].width, chain.levels[0].height};
+  desc.format = rhi::Format::RGBA8;
+  desc.mipLevels = static_cast<uint32_t>(chain.levels.size());
+  desc.renderTarget = false;
+
+  auto texture_handle = device_->createTexture(desc);
+  if (texture_handle.id == 0) {
+    return texture_handle;
+  }
+
+  // Every level goes up in one command list submission
+  auto* cmd = device_->getImmediate();
+  cmd->begin();
+  for (size_t level = 0; level < chain.levels.size(); ++level) {
+    cmd->copyToTexture(texture_handle, static_cast<uint32_t>(level),
+                       chain.level_data(level));
+  }
+  cmd->end();
+
+  return texture_handle;
+}
+
+rhi::TextureHandle TextureLoader::create(const TextureContainer& container) {
+  if (rhi::format_is_block_compressed(container.format()) &&
+      !device_->caps().textureCompressionBC) {
+    std::cerr << "TextureLoader: " << container.path()
+              << " is block-compressed but the device cannot sample BC formats"
+              << std::endl;
+    return {0};
+  }
+
+  rhi::TextureDesc desc;
+  desc.size = {container.width(), container.height()};
+  desc.format = container.format();
+  desc.mipLevels = container.level_count();
+  desc.renderTarget = false;
+
+  auto texture_handle = device_->createTexture(desc);
+  if (texture_handle.id == 0) {
+    return texture_handle;
+  }
+
+  // Spans point into the mapping; the backend copies from the mapped pages
+  auto* cmd = device_->getImmediate();
+  cmd->begin();
+  for (uint32_t level = 0; level < container.level_count(); ++level) {
+    cmd->copyToTexture(texture_handle, level, container.level_data(level));
+  }
+  cmd->end();
+
+  return texture_handle;
+}
+
+MipChain TextureLoader::build_chain(const uint8_t* rgba, int width,
+                                    int height,
+                                    const MipmapOptions& mipmaps) const {
+  MipmapOptions options = mipmaps;
+  if (!settings_.generate_mipmaps) {
+    options.max_levels = 1;
+  }
+  return generate_mipmaps(rgba, static_cast<uint32_t>(width),
+                          static_cast<uint32_t>(height), options);
+}
+
 rhi::TextureHandle TextureLoader::create_array(int width, int height, int layers) {
   // Create texture array descriptor
   rhi::TextureDesc desc;
@@ -99,16 +701,13 @@ rhi::TextureHandle TextureLoader::load_array(const std::vector<std::string>& pat
     return {0};
   }
 
-  // Load first texture to determine dimensions
+  // The first image's header determines the dimensions; no need to decode it
+  // twice
   int width, height, channels;
-  unsigned char* first_data =
-      stbi_load(paths[0].c_str(), &width, &height, &channels, 4);
-
-  if (!first_data) {
+  if (!stbi_info(paths[0].c_str(), &width, &height, &channels)) {
     std::cerr << "TextureLoader: Failed to load first texture: " << paths[0] << std::endl;
     return {0};
   }
-  stbi_image_free(first_data);
 
   // Create texture array
   auto array_handle = create_array(width, height, static_cast<int>(paths.size()));
@@ -164,7 +763,14 @@ void TextureLoader::set_array_layer(rhi::TextureHandle array_handle, int layer,
 }
 
 void TextureLoader::clear_cache() {
-  cache_.clear();
+  for (auto& [id, entry] : entries_) {
+    if (entry.pinned) {
+      entry.pinned = false;
+      if (entry.refs == 0) {
+        schedule_release(entry);
+      }
+    }
+  }
 }
 
 } // namespace pixel::resources
@@ -0,0 +1,409 @@
+#include "pixel/resources/texture_streamer.hpp"
+#include "pixel/resources/texture_cooker.hpp"
+#include "pixel/rhi/rhi.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include <stb_image.h>
+
+namespace pixel::resources {
+
+uint32_t mip_for_screen_extent(uint32_t texture_extent, float screen_extent) {
+  if (texture_extent <= 1) {
+    return 0;
+  }
+  // Sub-pixel (or invalid) coverage wants the 1x1 level
+  if (!(screen_extent >= 1.0f)) {
+    return mip_level_count(texture_extent, 1) - 1;
+  }
+  const float ratio = static_cast<float>(texture_extent) / screen_extent;
+  if (ratio <= 1.0f) {
+    return 0;
+  }
+  // Round toward the finer level so textures never look blurrier than
+  // one texel per pixel
+  return static_cast<uint32_t>(std::floor(std::log2(ratio)));
+}
+
+TextureStreamer::TextureStreamer(rhi::Device* device)
+    : TextureStreamer(device, Settings{}) {}
+
+TextureStreamer::TextureStreamer(rhi::Device* device, const Settings& settings)
+    : device_(device), settings_(settings) {
+  if (!device_) {
+    throw std::invalid_argument("TextureStreamer: device cannot be null");
+  }
+}
+
+TextureStreamer::~TextureStreamer() {
+  for (auto& [id, entry] : entries_) {
+    device_->destroyTexture(entry.texture);
+  }
+  for (const Retired& retired : retired_) {
+    device_->destroyTexture(retired.texture);
+  }
+}
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+rhi::TextureHandle TextureStreamer::add(const std::string& path) {
+  return add(path, settings_.mipmaps);
+}
+
+rhi::TextureHandle TextureStreamer::add(const std::string& path,
+                                        const MipmapOptions& mipmaps) {
+  // Blobs are cooked with the build-wide options
+  if (settings_.prefer_cooked && mipmaps == settings_.mipmaps &&
+      !TextureContainer::is_container_path(path)) {
+    const std::string cooked = cooked_texture_path(path);
+    if (cooked_texture_is_current(path, cooked)) {
+      auto container = TextureContainer::open(cooked);
+      // Only in the alpha mode decoding would give
+      if (container && container->premultiplied_alpha() !=
+                           settings_.mipmaps.premultiply_alpha) {
+        std::cerr << "TextureStreamer: " << cooked
+                  << " alpha mode does not match MipmapOptions::"
+                     "premultiply_alpha, decoding "
+                  << path << " instead" << std::endl;
+        container.reset();
+      }
+      if (container &&
+          (!rhi::format_is_block_compressed(container->format()) ||
+           device_->caps().textureCompressionBC)) {
+        return add(std::move(container));
+      }
+    }
+  }
+
+  if (TextureContainer::is_container_path(path)) {
+    auto container = TextureContainer::open(path);
+    if (!container) {
+      std::cerr << "TextureStreamer: Failed to load texture: " << path
+                << std::endl;
+      return {0};
+    }
+    return add(std::move(container));
+  }
+
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  uint8_t* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+  if (!pixels) {
+    std::cerr << "TextureStreamer: Failed to load texture: " << path
+              << std::endl;
+    return {0};
+  }
+  MipChain chain =
+      generate_mipmaps(pixels, static_cast<uint32_t>(width),
+                       static_cast<uint32_t>(height), mipmaps);
+  stbi_image_free(pixels);
+  return add(std::move(chain));
+}
+
+rhi::TextureHandle TextureStreamer::add(MipChain chain) {
+  if (chain.levels.empty()) {
+    return {0};
+  }
+
+  Entry entry;
+  entry.chain = std::move(chain);
+  entry.format = rhi::Format::RGBA8;
+  for (size_t level = 0; level < entry.chain.levels.size(); ++level) {
+    entry.levels.push_back(Level{entry.chain.levels[level].width,
+                                 entry.chain.levels[level].height,
+                                 entry.chain.level_data(level)});
+  }
+  return add_entry(std::move(entry));
+}
+
+rhi::TextureHandle
+TextureStreamer::add(std::unique_ptr<TextureContainer> container) {
+  if (!container) {
+    return {0};
+  }
+  if (rhi::format_is_block_compressed(container->format()) &&
+      !device_->caps().textureCompressionBC) {
+    std::cerr << "TextureStreamer: " << container->path()
+              << " is block-compressed but the device cannot sample BC formats"
+              << std::endl;
+    return {0};
+  }
+
+  Entry entry;
+  entry.format = container->format();
+  for (uint32_t level = 0; level < container->level_count(); ++level) {
+    entry.levels.push_back(
+        Level{std::max(1u, container->width() >> level),
+              std::max(1u, container->height() >> level),
+              container->level_data(level)});
+  }
+  entry.container = std::move(container);
+  return add_entry(std::move(entry));
+}
+
+rhi::TextureHandle TextureStreamer::add_entry(Entry entry) {
+  // Spans into a moved MipChain or container stay valid: neither the
+  // vector's buffer nor the mapping moves
+  const uint32_t last = static_cast<uint32_t>(entry.levels.size()) - 1;
+  uint32_t tail = 0;
+  while (tail < last && std::max(entry.levels[tail].width,
+                                 entry.levels[tail].height) >
+                            settings_.tail_extent) {
+    ++tail;
+  }
+  entry.tail_mip = tail;
+  entry.resident_mip = tail;
+  entry.target_mip = tail;
+
+  entry.texture = upload(entry, tail);
+  if (entry.texture.id == 0) {
+    std::cerr << "TextureStreamer: Failed to create texture" << std::endl;
+    return {0};
+  }
+  stats_.resident_bytes += range_bytes(entry, tail);
+
+  // Backends never reuse texture ids, so the first one doubles as the
+  // stable handle after that texture has been replaced
+  const rhi::TextureHandle stable = entry.texture;
+  entries_.emplace(stable.id, std::move(entry));
+  stats_.textures = entries_.size();
+  return stable;
+}
+
+void TextureStreamer::remove(rhi::TextureHandle handle) {
+  auto it = entries_.find(handle.id);
+  if (it == entries_.end()) {
+    return;
+  }
+  stats_.resident_bytes -= range_bytes(it->second, it->second.resident_mip);
+  retire(it->second.texture);
+  entries_.erase(it);
+  stats_.textures = entries_.size();
+  stats_.retiring = retired_.size();
+}
+
+// ============================================================================
+// Feedback
+// ============================================================================
+
+bool TextureStreamer::is_streamed(rhi::TextureHandle handle) const {
+  return entries_.count(handle.id) != 0;
+}
+
+rhi::TextureHandle TextureStreamer::resolve(rhi::TextureHandle handle) const {
+  auto it = entries_.find(handle.id);
+  return it != entries_.end() ? it->second.texture : handle;
+}
+
+rhi::TextureHandle TextureStreamer::resolve(rhi::TextureHandle handle,
+                                            float screen_extent) {
+  auto it = entries_.find(handle.id);
+  if (it == entries_.end()) {
+    return handle;
+  }
+  const Level& base = it->second.levels[0];
+  request(handle,
+          mip_for_screen_extent(std::max(base.width, base.height),
+                                screen_extent));
+  return it->second.texture;
+}
+
+void TextureStreamer::request(rhi::TextureHandle handle, uint32_t mip) {
+  auto it = entries_.find(handle.id);
+  if (it == entries_.end()) {
+    return;
+  }
+  Entry& entry = it->second;
+  const uint32_t last = static_cast<uint32_t>(entry.levels.size()) - 1;
+  entry.requested_mip = std::min({entry.requested_mip, mip, last});
+  entry.last_used = frame_;
+}
+
+uint32_t TextureStreamer::resident_mip(rhi::TextureHandle handle) const {
+  auto it = entries_.find(handle.id);
+  return it != entries_.end() ? it->second.resident_mip : 0;
+}
+
+// ============================================================================
+// Residency
+// ============================================================================
+
+size_t TextureStreamer::update() {
+  stats_.uploaded_bytes = 0;
+  stats_.levels_streamed_in = 0;
+  stats_.levels_evicted = 0;
+
+  // Destroy replaced textures no frame in flight can still sample
+  while (!retired_.empty() &&
+         retired_.front().frame + settings_.retire_frames <= frame_) {
+    device_->destroyTexture(retired_.front().texture);
+    retired_.pop_front();
+  }
+
+  std::vector<Entry*> wanted;
+  std::vector<Entry*> lru;
+  lru.reserve(entries_.size());
+  for (auto& [id, entry] : entries_) {
+    entry.target_mip = entry.resident_mip;
+    if (entry.requested_mip < entry.resident_mip) {
+      wanted.push_back(&entry);
+    }
+    lru.push_back(&entry);
+  }
+
+  // Textures covering the most screen first
+  auto wanted_extent = [](const Entry* entry) {
+    const Level& level = entry->levels[entry->requested_mip];
+    return std::max(level.width, level.height);
+  };
+  std::sort(wanted.begin(), wanted.end(),
+            [&](const Entry* a, const Entry* b) {
+              return wanted_extent(a) > wanted_extent(b);
+            });
+
+  // Eviction order: least recently used, then largest finest level
+  std::sort(lru.begin(), lru.end(), [](const Entry* a, const Entry* b) {
+    if (a->last_used != b->last_used) {
+      return a->last_used < b->last_used;
+    }
+    return a->levels[a->resident_mip].data.size() >
+           b->levels[b->resident_mip].data.size();
+  });
+
+  size_t total = stats_.resident_bytes;
+  size_t next_victim = 0;
+  // Drops the finest planned level of the least recently used texture other
+  // than `keep`. Textures drawn this frame are only touched when
+  // `allow_recent` is set, so two visible textures never trade levels.
+  auto evict_one = [&](const Entry* keep, bool allow_recent) {
+    for (size_t i = next_victim; i < lru.size(); ++i) {
+      Entry& victim = *lru[i];
+      if (!allow_recent && victim.last_used >= frame_) {
+        return false;
+      }
+      if (victim.target_mip >= victim.tail_mip) {
+        if (i == next_victim) {
+          ++next_victim;
+        }
+        continue;
+      }
+      if (&victim == keep) {
+        continue;
+      }
+      total -= victim.levels[victim.target_mip].data.size();
+      ++victim.target_mip;
+      return true;
+    }
+    return false;
+  };
+
+  size_t upload_planned = 0;
+  for (Entry* entry : wanted) {
+    if (upload_planned > 0 &&
+        upload_planned + range_bytes(*entry, entry->requested_mip) >
+            settings_.upload_budget_bytes) {
+      break;
+    }
+
+    // Step one level at a time so a tight budget still gets partway
+    uint32_t mip = entry->target_mip;
+    while (mip > entry->requested_mip) {
+      const size_t extra = entry->levels[mip - 1].data.size();
+      while (total + extra > settings_.budget_bytes &&
+             evict_one(entry, false)) {
+      }
+      if (total + extra > settings_.budget_bytes) {
+        break;
+      }
+      total += extra;
+      --mip;
+    }
+    if (mip < entry->target_mip) {
+      upload_planned += range_bytes(*entry, mip);
+      entry->target_mip = mip;
+    }
+  }
+
+  // Over budget without any new requests (budget lowered, or many tails)
+  while (total > settings_.budget_bytes && evict_one(nullptr, true)) {
+  }
+
+  size_t changed = 0;
+  for (auto& [id, entry] : entries_) {
+    entry.requested_mip = kNoRequest;
+    if (entry.target_mip == entry.resident_mip) {
+      continue;
+    }
+
+    const rhi::TextureHandle texture = upload(entry, entry.target_mip);
+    if (texture.id == 0) {
+      std::cerr << "TextureStreamer: Failed to create texture for mip "
+                << entry.target_mip << std::endl;
+      continue;
+    }
+    if (entry.target_mip < entry.resident_mip) {
+      stats_.levels_streamed_in += entry.resident_mip - entry.target_mip;
+    } else {
+      stats_.levels_evicted += entry.target_mip - entry.resident_mip;
+    }
+    stats_.resident_bytes += range_bytes(entry, entry.target_mip);
+    stats_.resident_bytes -= range_bytes(entry, entry.resident_mip);
+    retire(entry.texture);
+    entry.texture = texture;
+    entry.resident_mip = entry.target_mip;
+    ++changed;
+  }
+
+  stats_.retiring = retired_.size();
+  ++frame_;
+  return changed;
+}
+
+size_t TextureStreamer::range_bytes(const Entry& entry,
+                                    uint32_t first_mip) const {
+  size_t bytes = 0;
+  for (size_t level = first_mip; level < entry.levels.size(); ++level) {
+    bytes += entry.levels[level].data.size();
+  }
+  return bytes;
+}
+
+rhi::TextureHandle TextureStreamer::upload(const Entry& entry,
+                                           uint32_t first_mip) {
+  const Level& base = entry.levels[first_mip];
+  rhi::TextureDesc desc;
+  desc.size = {base.width, base.height};
+  desc.format = entry.format;
+  desc.mipLevels = static_cast<uint32_t>(entry.levels.size()) - first_mip;
+  desc.renderTarget = false;
+
+  auto texture_handle = device_->createTexture(desc);
+  if (texture_handle.id == 0) {
+    return texture_handle;
+  }
+
+  // The RHI has no texture-to-texture copy, so even an eviction re-sends
+  // the remaining (coarser, about a third as large) levels from the source
+  auto* cmd = device_->getImmediate();
+  cmd->begin();
+  for (uint32_t level = first_mip; level < entry.levels.size(); ++level) {
+    cmd->copyToTexture(texture_handle, level - first_mip,
+                       entry.levels[level].data);
+  }
+  cmd->end();
+
+  stats_.uploaded_bytes += range_bytes(entry, first_mip);
+  return texture_handle;
+}
+
+void TextureStreamer::retire(rhi::TextureHandle texture) {
+  retired_.push_back(Retired{texture, frame_});
+}
+
+} // namespace pixel::resources
@@ -411,7 +411,8 @@ void MetalCmdList::setVertexBuffer(BufferHandle handle, size_t offset) {
   }
 }
 
-void MetalCmdList::setIndexBuffer(BufferHandle handle, size_t offset) {
+void MetalCmdList::setIndexBuffer(BufferHandle handle, size_t offset,
+                                  IndexFormat format) {
   // === DIAGNOSTIC LOGGING ===
   std::cerr << "setIndexBuffer(): handle=" << handle.id << ", offset=" << offset
             << std::endl;
@@ -419,6 +420,7 @@ void MetalCmdList::setIndexBuffer(BufferHandle handle, size_t offset) {
 
   impl_->current_ib_ = handle;
   impl_->current_ib_offset_ = offset;
+  impl_->current_ib_format_ = format;
 
   if (handle.id == 0) {
     return;
@@ -505,8 +507,8 @@ void MetalCmdList::copyToTexture(TextureHandle texture, uint32_t mipLevel,
   const MTLTextureResource &tex = it->second;
   int mipWidth = std::max(1, tex.width >> mipLevel);
   int mipHeight = std::max(1, tex.height >> mipLevel);
-  size_t bytesPerRow = mipWidth * getBytesPerPixel(tex.format);
-  size_t bytesPerImage = bytesPerRow * mipHeight;
+  size_t bytesPerRow = format_row_pitch(tex.format, mipWidth);
+  size_t bytesPerImage = format_level_size(tex.format, mipWidth, mipHeight);
   MTLRegion region = MTLRegionMake2D(0, 0, mipWidth, mipHeight);
 
   [tex.texture replaceRegion:region
@@ -534,8 +536,8 @@ void MetalCmdList::copyToTextureLayer(TextureHandle texture, uint32_t layer,
 
   int mipWidth = std::max(1, tex.width >> mipLevel);
   int mipHeight = std::max(1, tex.height >> mipLevel);
-  size_t bytesPerRow = mipWidth * getBytesPerPixel(tex.format);
-  size_t bytesPerImage = bytesPerRow * mipHeight;
+  size_t bytesPerRow = format_row_pitch(tex.format, mipWidth);
+  size_t bytesPerImage = format_level_size(tex.format, mipWidth, mipHeight);
   MTLRegion region = MTLRegionMake2D(0, 0, mipWidth, mipHeight);
 
   [tex.texture replaceRegion:region
@@ -547,7 +549,7 @@ void MetalCmdList::copyToTextureLayer(TextureHandle texture, uint32_t layer,
 }
 
 void MetalCmdList::drawIndexed(uint32_t indexCount, uint32_t firstIndex,
-                               uint32_t instanceCount) {
+                               uint32_t instanceCount, int32_t baseVertex) {
   // === DIAGNOSTIC LOGGING START ===
   std::cerr << "\n" << std::string(60, '=') << std::endl;
   std::cerr << "drawIndexed() CALLED" << std::endl;
@@ -556,6 +558,7 @@ void MetalCmdList::drawIndexed(uint32_t indexCount, uint32_t firstIndex,
   std::cerr << "  indexCount:     " << indexCount << std::endl;
   std::cerr << "  firstIndex:     " << firstIndex << std::endl;
   std::cerr << "  instanceCount:  " << instanceCount << std::endl;
+  std::cerr << "  baseVertex:     " << baseVertex << std::endl;
   std::cerr << "\nPipeline State:" << std::endl;
   std::cerr << "  pipeline.id:    " << impl_->current_pipeline_.id << std::endl;
   std::cerr << "  index_buf.id:   " << impl_->current_ib_.id << std::endl;
@@ -624,8 +627,9 @@ void MetalCmdList::drawIndexed(uint32_t indexCount, uint32_t firstIndex,
     return;
   }
 
-  size_t indexOffset =
-      impl_->current_ib_offset_ + firstIndex * sizeof(uint32_t);
+  const bool index16 = impl_->current_ib_format_ == IndexFormat::Uint16;
+  size_t indexOffset = impl_->current_ib_offset_ +
+                       firstIndex * index_format_size(impl_->current_ib_format_);
 
   // === DIAGNOSTIC LOGGING ===
   std::cerr << "\n✓ All preconditions met, issuing draw call..." << std::endl;
@@ -634,10 +638,13 @@ void MetalCmdList::drawIndexed(uint32_t indexCount, uint32_t firstIndex,
 
   [impl_->render_encoder_ drawIndexedPrimitives:MTLPrimitiveTypeTriangle
                                      indexCount:indexCount
-                                      indexType:MTLIndexTypeUInt32
+                                      indexType:(index16 ? MTLIndexTypeUInt16
+                                                         : MTLIndexTypeUInt32)
                                     indexBuffer:ib_it->second.buffer
                               indexBufferOffset:indexOffset
-                                  instanceCount:instanceCount];
+                                  instanceCount:instanceCount
+                                     baseVertex:baseVertex
+                                   baseInstance:0];
 
   // === DIAGNOSTIC LOGGING ===
   std::cerr << "✓ SUCCESS: Draw call issued to Metal" << std::endl;
@@ -647,6 +654,41 @@ void MetalCmdList::drawIndexed(uint32_t indexCount, uint32_t firstIndex,
   impl_->resetUniformBlock();
 }
 
+void MetalCmdList::drawIndexedIndirect(BufferHandle args, size_t offset) {
+  if (impl_->current_pipeline_.id == 0 || impl_->current_ib_.id == 0) {
+    std::cerr << "MetalCmdList::drawIndexedIndirect(): pipeline or index "
+                 "buffer not set"
+              << std::endl;
+    return;
+  }
+  if (!impl_->render_encoder_ ||
+      impl_->active_encoder_ != Impl::EncoderState::Render) {
+    std::cerr << "MetalCmdList::drawIndexedIndirect(): no active render pass"
+              << std::endl;
+    return;
+  }
+
+  auto ib_it = impl_->buffers_->find(impl_->current_ib_.id);
+  auto args_it = impl_->buffers_->find(args.id);
+  if (ib_it == impl_->buffers_->end() || args_it == impl_->buffers_->end()) {
+    std::cerr << "MetalCmdList::drawIndexedIndirect(): buffer not found"
+              << std::endl;
+    return;
+  }
+
+  // firstIndex and baseVertex come from the argument buffer
+  const bool index16 = impl_->current_ib_format_ == IndexFormat::Uint16;
+  [impl_->render_encoder_
+      drawIndexedPrimitives:MTLPrimitiveTypeTriangle
+                  indexType:(index16 ? MTLIndexTypeUInt16 : MTLIndexTypeUInt32)
+                indexBuffer:ib_it->second.buffer
+          indexBufferOffset:impl_->current_ib_offset_
+             indirectBuffer:args_it->second.buffer
+       indirectBufferOffset:offset];
+
+  impl_->resetUniformBlock();
+}
+
 void MetalCmdList::setComputePipeline(PipelineHandle handle) {
   std::cerr << "MetalCmdList::setComputePipeline(): handle=" << handle.id
             << std::endl;
@@ -36,6 +36,17 @@ bool supports_sampler_compare(id<MTLDevice> device) {
   return supported;
 }
 
+bool supports_bc_compression(id<MTLDevice> device) {
+  if (!device) {
+    return false;
+  }
+  if (@available(macOS 11.0, *)) {
+    return [device supportsBCTextureCompression];
+  }
+  // Intel/AMD Macs before Big Sur always expose the BC formats
+  return true;
+}
+
 } // namespace
 
 namespace pixel::rhi {
@@ -73,7 +84,12 @@ MetalDevice::MetalDevice(void *device, void *layer, void *depth_texture,
                  " device. Shadows will be disabled."
               << std::endl;
   }
+  caps_.textureCompressionBC = supports_bc_compression(metalDevice);
   caps_.uniformBuffers = true;
+  caps_.timerQueries = true;
+  caps_.layeredRenderTargets = true;
+  caps_.computeStorageBuffers = true;
+  caps_.indirectDraw = true;
   caps_.clipSpaceYDown = false;
   caps_.clipSpaceDepthZeroToOne = true;
 }
@@ -3,19 +3,80 @@
 #ifdef __APPLE__
 
 #include "pixel/rhi/backends/metal/metal_internal.hpp"
+#include <algorithm>
 #include <iostream>
 
 namespace pixel::rhi {
 
+namespace {
+
+MTLDataType toMTLDataType(SpecializationConstantType type) {
+  switch (type) {
+  case SpecializationConstantType::Bool:
+    return MTLDataTypeBool;
+  case SpecializationConstantType::Int:
+    return MTLDataTypeInt;
+  case SpecializationConstantType::UInt:
+    return MTLDataTypeUInt;
+  case SpecializationConstantType::Float:
+    return MTLDataTypeFloat;
+  }
+  return MTLDataTypeUInt;
+}
+
+// Function constants are bound when a function is fetched from its library,
+// so a specialized pipeline re-fetches each stage with the constant values.
+// Values for indices a function does not declare are ignored.
+id<MTLFunction> specializeFunction(const MTLShaderResource &shader,
+                                   const PipelineCacheKey &key) {
+  if (key.specialization_count == 0 || !shader.library) {
+    return shader.function;
+  }
+
+  MTLFunctionConstantValues *values = [[MTLFunctionConstantValues alloc] init];
+  for (uint32_t i = 0; i < key.specialization_count; ++i) {
+    const SpecializationConstant &constant = key.specialization_constants[i];
+    if (constant.type == SpecializationConstantType::Bool) {
+      const bool flag = constant.value != 0;
+      [values setConstantValue:&flag type:MTLDataTypeBool atIndex:constant.id];
+    } else {
+      [values setConstantValue:&constant.value
+                          type:toMTLDataType(constant.type)
+                       atIndex:constant.id];
+    }
+  }
+
+  NSError *error = nil;
+  id<MTLFunction> function =
+      [shader.library newFunctionWithName:shader.function.name
+                           constantValues:values
+                                    error:&error];
+  if (!function) {
+    std::cerr << "Failed to specialize shader function "
+              << [shader.function.name UTF8String] << ": "
+              << [[error localizedDescription] UTF8String] << std::endl;
+  }
+  return function;
+}
+
+} // namespace
+
 PipelineHandle MetalDevice::createPipeline(const PipelineDesc &desc) {
   std::cerr << "MetalDevice::createPipeline()" << std::endl;
   std::cerr << "  VS handle: " << desc.vs.id << " FS handle: " << desc.fs.id
             << " CS handle: " << desc.cs.id << std::endl;
   MTLPipelineResource pipeline;
 
+  const uint32_t specializationCount = std::min<uint32_t>(
+      desc.specializationConstantCount,
+      static_cast<uint32_t>(kMaxSpecializationConstants));
+
   if (desc.cs.id != 0) {
     PipelineCacheKey cacheKey{};
     cacheKey.cs_id = desc.cs.id;
+    cacheKey.specialization_count = specializationCount;
+    std::copy_n(desc.specializationConstants.begin(), specializationCount,
+                cacheKey.specialization_constants.begin());
     auto cached = impl_->pipeline_cache_.find(cacheKey);
     if (cached != impl_->pipeline_cache_.end()) {
       return cached->second;
@@ -27,9 +88,15 @@ PipelineHandle MetalDevice::createPipeline(const PipelineDesc &desc) {
       return PipelineHandle{0};
     }
 
+    id<MTLFunction> computeFunction =
+        specializeFunction(cs_it->second, cacheKey);
+    if (!computeFunction) {
+      return PipelineHandle{0};
+    }
+
     NSError *error = nil;
     pipeline.compute_pipeline_state = [impl_->device_
-        newComputePipelineStateWithFunction:cs_it->second.function
+        newComputePipelineStateWithFunction:computeFunction
                                       error:&error];
 
     if (!pipeline.compute_pipeline_state) {
@@ -63,6 +130,7 @@ PipelineHandle MetalDevice::createPipeline(const PipelineDesc &desc) {
   cacheKey.vs_id = desc.vs.id;
   cacheKey.fs_id = desc.fs.id;
   cacheKey.instanced = isInstanced;
+  cacheKey.vertex_layout = desc.vertexLayout;
 
   std::array<ColorAttachmentDesc, kMaxColorAttachments> attachments{};
   uint32_t colorAttachmentCount = desc.colorAttachmentCount;
@@ -86,6 +154,9 @@ PipelineHandle MetalDevice::createPipeline(const PipelineDesc &desc) {
 
   cacheKey.color_attachment_count = colorAttachmentCount;
   cacheKey.color_attachments = attachments;
+  cacheKey.specialization_count = specializationCount;
+  std::copy_n(desc.specializationConstants.begin(), specializationCount,
+              cacheKey.specialization_constants.begin());
 
   auto cached = impl_->pipeline_cache_.find(cacheKey);
   if (cached != impl_->pipeline_cache_.end()) {
@@ -94,8 +165,13 @@ PipelineHandle MetalDevice::createPipeline(const PipelineDesc &desc) {
 
   MTLRenderPipelineDescriptor *pipelineDesc =
       [[MTLRenderPipelineDescriptor alloc] init];
-  pipelineDesc.vertexFunction = vs_it->second.function;
-  pipelineDesc.fragmentFunction = fs_it->second.function;
+  id<MTLFunction> vertexFunction = specializeFunction(vs_it->second, cacheKey);
+  id<MTLFunction> fragmentFunction = specializeFunction(fs_it->second, cacheKey);
+  if (!vertexFunction || !fragmentFunction) {
+    return PipelineHandle{0};
+  }
+  pipelineDesc.vertexFunction = vertexFunction;
+  pipelineDesc.fragmentFunction = fragmentFunction;
   for (uint32_t i = 0; i < colorAttachmentCount; ++i) {
     const auto &attachment = attachments[i];
     pipelineDesc.colorAttachments[i].pixelFormat =
@@ -139,7 +215,7 @@ PipelineHandle MetalDevice::createPipeline(const PipelineDesc &desc) {
   pipelineDesc.depthAttachmentPixelFormat = MTLPixelFormatDepth32Float;
 
   MTLVertexDescriptor *vertexDesc =
-      impl_->getOrCreateVertexDescriptor(isInstanced);
+      impl_->getOrCreateVertexDescriptor(isInstanced, desc.vertexLayout);
 
   if (!vertexDesc) {
     std::cerr << "  ERROR: Failed to acquire vertex descriptor" << std::endl;
@@ -89,6 +89,12 @@ TextureHandle MetalDevice::createTexture(const TextureDesc &desc) {
   return TextureHandle{handle_id};
 }
 
+void MetalDevice::destroyTexture(TextureHandle handle) {
+  // Command buffers retain the textures they reference, so dropping ours is
+  // safe even while earlier frames are still in flight
+  impl_->textures_.erase(handle.id);
+}
+
 SamplerHandle MetalDevice::createSampler(const SamplerDesc &desc) {
   std::cerr << "MetalDevice::createSampler()" << std::endl;
   std::cerr << "  minFilter="
@@ -188,6 +194,8 @@ ShaderHandle MetalDevice::createShader(std::string_view stage,
     functionName = @"vertex_shadow_depth_instanced";
   } else if (stage == "vs_shadow") {
     functionName = @"vertex_shadow_depth";
+  } else if (stage == "vs_impostor_instanced") {
+    functionName = @"vertex_impostor";
   } else if (stage == "fs") {
     functionName = @"fragment_main";
   } else if (stage == "fs_instanced") {
@@ -196,10 +204,14 @@ ShaderHandle MetalDevice::createShader(std::string_view stage,
     functionName = @"fragment_shadow_depth";
   } else if (stage == "fs_shadow") {
     functionName = @"fragment_shadow_depth";
+  } else if (stage == "fs_impostor") {
+    functionName = @"fragment_impostor";
   } else if (stage == "cs_culling") {
     functionName = @"culling_compute";
   } else if (stage == "cs_lod") {
     functionName = @"lod_compute";
+  } else if (stage == "cs_meshlet_cull") {
+    functionName = @"meshlet_cull_compute";
   } else if (stage == "cs_test") {
     functionName = @"test_compute";
   } else {
@@ -72,6 +72,24 @@ MTLPixelFormat toMTLFormat(Format format) {
     return MTLPixelFormatDepth24Unorm_Stencil8;
   case Format::D32F:
     return MTLPixelFormatDepth32Float;
+  case Format::RGBA8Srgb:
+    return MTLPixelFormatRGBA8Unorm_sRGB;
+  case Format::BC1:
+    return MTLPixelFormatBC1_RGBA;
+  case Format::BC1Srgb:
+    return MTLPixelFormatBC1_RGBA_sRGB;
+  case Format::BC3:
+    return MTLPixelFormatBC3_RGBA;
+  case Format::BC3Srgb:
+    return MTLPixelFormatBC3_RGBA_sRGB;
+  case Format::BC4:
+    return MTLPixelFormatBC4_RUnorm;
+  case Format::BC5:
+    return MTLPixelFormatBC5_RGUnorm;
+  case Format::BC7:
+    return MTLPixelFormatBC7_RGBAUnorm;
+  case Format::BC7Srgb:
+    return MTLPixelFormatBC7_RGBAUnorm_sRGB;
   default:
     return MTLPixelFormatRGBA8Unorm;
   }
@@ -342,6 +360,10 @@ void MetalCmdList::setUniformVec4(const char *name, const float *vec4) {
     memcpy(uniforms->lightingParams, vec4, sizeof(float) * 4);
   } else if (name_str == "materialParams") {
     memcpy(uniforms->materialParams, vec4, sizeof(float) * 4);
+  } else if (name_str == "positionOffset") {
+    memcpy(uniforms->positionOffset, vec4, sizeof(float) * 4);
+  } else if (name_str == "positionScale") {
+    memcpy(uniforms->positionScale, vec4, sizeof(float) * 4);
   }
 
   impl_->bindCurrentUniformBlock(impl_->render_encoder_);
@@ -122,7 +122,8 @@ const VulkanDevice::BufferResource &getBuffer(const VulkanDevice &device,
 
 const VulkanDevice::TextureResource &getTexture(const VulkanDevice &device,
                                                 TextureHandle handle) {
-  if (handle.id == 0 || handle.id >= device.textures_.size()) {
+  if (handle.id == 0 || handle.id >= device.textures_.size() ||
+      device.textures_[handle.id].image == VK_NULL_HANDLE) {
     throw std::runtime_error("Invalid Vulkan texture handle");
   }
   return device.textures_[handle.id];
@@ -173,6 +174,8 @@ struct VulkanCmdList::PixelUniformBufferData {
   alignas(16) int32_t useTextureArray[4]{};
   alignas(16) int32_t uDitherEnabled[4]{};
   alignas(16) int32_t shadowsEnabled[4]{};
+  alignas(16) float positionOffset[4]{};
+  alignas(16) float positionScale[4]{1.0f, 1.0f, 1.0f, 0.0f};
 };
 
 void VulkanCmdList::resetDescriptorState() {
@@ -553,14 +556,16 @@ void VulkanCmdList::setVertexBuffer(BufferHandle handle, size_t offset) {
   vkCmdBindVertexBuffers(activeCommandBuffer_, 0, 1, buffers, offsets);
 }
 
-void VulkanCmdList::setIndexBuffer(BufferHandle handle, size_t offset) {
+void VulkanCmdList::setIndexBuffer(BufferHandle handle, size_t offset,
+                                   IndexFormat format) {
   if (activeCommandBuffer_ == VK_NULL_HANDLE) {
     throw std::runtime_error("Vulkan setIndexBuffer called before begin");
   }
 
   const auto &buffer = getBuffer(device_, handle);
   vkCmdBindIndexBuffer(activeCommandBuffer_, buffer.buffer, offset,
-                       VK_INDEX_TYPE_UINT32);
+                       format == IndexFormat::Uint16 ? VK_INDEX_TYPE_UINT16
+                                                     : VK_INDEX_TYPE_UINT32);
 }
 
 void VulkanCmdList::setInstanceBuffer(BufferHandle, size_t, size_t) {
@@ -661,6 +666,20 @@ void VulkanCmdList::setUniformVec4(const char *name, const float *vec4) {
     return;
   }
 
+  if (uniformName == "positionOffset") {
+    std::memcpy(pixelUniforms_.positionOffset, vec4, sizeof(float) * 4);
+    ensurePixelUniformResources();
+    pixelUniformsDirty_ = true;
+    return;
+  }
+
+  if (uniformName == "positionScale") {
+    std::memcpy(pixelUniforms_.positionScale, vec4, sizeof(float) * 4);
+    ensurePixelUniformResources();
+    pixelUniformsDirty_ = true;
+    return;
+  }
+
   (void)vec4;
 }
 
@@ -938,7 +957,7 @@ void VulkanCmdList::signalFence(FenceHandle handle) {
 }
 
 void VulkanCmdList::drawIndexed(uint32_t indexCount, uint32_t firstIndex,
-                                uint32_t instanceCount) {
+                                uint32_t instanceCount, int32_t baseVertex) {
   if (activeCommandBuffer_ == VK_NULL_HANDLE) {
     throw std::runtime_error("Vulkan drawIndexed called before begin");
   }
@@ -951,8 +970,28 @@ void VulkanCmdList::drawIndexed(uint32_t indexCount, uint32_t firstIndex,
 
   bindDescriptorSetIfNeeded();
 
-  vkCmdDrawIndexed(activeCommandBuffer_, indexCount, instanceCount, firstIndex, 0,
-                   0);
+  vkCmdDrawIndexed(activeCommandBuffer_, indexCount, instanceCount, firstIndex,
+                   baseVertex, 0);
+}
+
+void VulkanCmdList::drawIndexedIndirect(BufferHandle args, size_t offset) {
+  if (activeCommandBuffer_ == VK_NULL_HANDLE) {
+    throw std::runtime_error("Vulkan drawIndexedIndirect called before begin");
+  }
+  if (!renderPassActive_) {
+    throw std::runtime_error(
+        "Vulkan drawIndexedIndirect requires active render pass");
+  }
+  if (currentGraphicsPipeline_.id == 0) {
+    throw std::runtime_error(
+        "Vulkan drawIndexedIndirect requires bound graphics pipeline");
+  }
+
+  bindDescriptorSetIfNeeded();
+
+  const auto &buffer = getBuffer(device_, args);
+  vkCmdDrawIndexedIndirect(activeCommandBuffer_, buffer.buffer, offset, 1,
+                           sizeof(DrawIndexedIndirectArgs));
 }
 
 void VulkanCmdList::endRender() {
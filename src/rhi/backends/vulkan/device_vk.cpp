@@ -124,6 +124,9 @@ VkBufferUsageFlags toVkBufferUsage(BufferUsage usage, bool hostVisible) {
   if (has(BufferUsage::TransferDst)) {
     flags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
   }
+  if (has(BufferUsage::Indirect)) {
+    flags |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+  }
 
   if (hostVisible) {
     flags |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
@@ -156,6 +159,24 @@ VkFormat toVkFormat(Format format) {
     return VK_FORMAT_D24_UNORM_S8_UINT;
   case Format::D32F:
     return VK_FORMAT_D32_SFLOAT;
+  case Format::RGBA8Srgb:
+    return VK_FORMAT_R8G8B8A8_SRGB;
+  case Format::BC1:
+    return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+  case Format::BC1Srgb:
+    return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+  case Format::BC3:
+    return VK_FORMAT_BC3_UNORM_BLOCK;
+  case Format::BC3Srgb:
+    return VK_FORMAT_BC3_SRGB_BLOCK;
+  case Format::BC4:
+    return VK_FORMAT_BC4_UNORM_BLOCK;
+  case Format::BC5:
+    return VK_FORMAT_BC5_UNORM_BLOCK;
+  case Format::BC7:
+    return VK_FORMAT_BC7_UNORM_BLOCK;
+  case Format::BC7Srgb:
+    return VK_FORMAT_BC7_SRGB_BLOCK;
   case Format::Unknown:
   default:
     return VK_FORMAT_UNDEFINED;
@@ -566,6 +587,23 @@ TextureHandle VulkanDevice::createTexture(const TextureDesc &desc) {
   return TextureHandle{static_cast<uint32_t>(textures_.size() - 1)};
 }
 
+void VulkanDevice::destroyTexture(TextureHandle handle) {
+  if (device_ == VK_NULL_HANDLE || handle.id == 0 ||
+      handle.id >= textures_.size()) {
+    return;
+  }
+
+  // The slot stays in place (empty) so handle ids are never reused
+  TextureResource &texture = textures_[handle.id];
+  if (texture.view != VK_NULL_HANDLE) {
+    vkDestroyImageView(device_, texture.view, nullptr);
+  }
+  if (texture.image != VK_NULL_HANDLE && allocator_ != nullptr) {
+    vmaDestroyImage(allocator_, texture.image, texture.allocation);
+  }
+  texture = TextureResource{};
+}
+
 SamplerHandle VulkanDevice::createSampler(const SamplerDesc &desc) {
   VkSamplerCreateInfo samplerInfo{};
   samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -726,6 +764,28 @@ PipelineHandle VulkanDevice::createPipeline(const PipelineDesc &desc) {
     return &shaders_[handle.id];
   };
 
+  // Every constant is 32 bits wide (VkBool32 for bools), so one packed block
+  // serves all stages
+  std::array<VkSpecializationMapEntry, kMaxSpecializationConstants>
+      specializationEntries{};
+  std::array<uint32_t, kMaxSpecializationConstants> specializationData{};
+  const uint32_t specializationCount = std::min<uint32_t>(
+      desc.specializationConstantCount,
+      static_cast<uint32_t>(kMaxSpecializationConstants));
+  for (uint32_t i = 0; i < specializationCount; ++i) {
+    specializationEntries[i].constantID = desc.specializationConstants[i].id;
+    specializationEntries[i].offset = i * sizeof(uint32_t);
+    specializationEntries[i].size = sizeof(uint32_t);
+    specializationData[i] = desc.specializationConstants[i].value;
+  }
+  VkSpecializationInfo specializationInfo{};
+  specializationInfo.mapEntryCount = specializationCount;
+  specializationInfo.pMapEntries = specializationEntries.data();
+  specializationInfo.dataSize = specializationCount * sizeof(uint32_t);
+  specializationInfo.pData = specializationData.data();
+  const VkSpecializationInfo *specialization =
+      specializationCount > 0 ? &specializationInfo : nullptr;
+
   if (desc.cs.id != 0) {
     const ShaderResource *cs = getShaderResource(desc.cs);
     if (!cs || cs->stage != VK_SHADER_STAGE_COMPUTE_BIT) {
@@ -738,6 +798,7 @@ PipelineHandle VulkanDevice::createPipeline(const PipelineDesc &desc) {
     stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
     stage.module = cs->module;
     stage.pName = "main";
+    stage.pSpecializationInfo = specialization;
 
     VkComputePipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
@@ -771,6 +832,7 @@ PipelineHandle VulkanDevice::createPipeline(const PipelineDesc &desc) {
   vsStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
   vsStage.module = vs->module;
   vsStage.pName = "main";
+  vsStage.pSpecializationInfo = specialization;
   shaderStages.push_back(vsStage);
 
   VkPipelineShaderStageCreateInfo fsStage{};
@@ -779,6 +841,7 @@ PipelineHandle VulkanDevice::createPipeline(const PipelineDesc &desc) {
     fsStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fsStage.module = fs->module;
     fsStage.pName = "main";
+    fsStage.pSpecializationInfo = specialization;
     shaderStages.push_back(fsStage);
   }
 
@@ -787,30 +850,54 @@ PipelineHandle VulkanDevice::createPipeline(const PipelineDesc &desc) {
 
   VkVertexInputBindingDescription vertexBinding{};
   vertexBinding.binding = 0;
-  vertexBinding.stride = 48; // sizeof(Vertex)
+  vertexBinding.stride = vertex_layout_stride(desc.vertexLayout);
   vertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
   bindings.push_back(vertexBinding);
 
   VkVertexInputAttributeDescription attr{};
   attr.binding = 0;
-  attr.location = 0;
-  attr.format = VK_FORMAT_R32G32B32_SFLOAT;
-  attr.offset = 0;
-  attributes.push_back(attr);
+  if (desc.vertexLayout == VertexLayout::Compressed) {
+    // Bounds-relative position; dequantised in the vertex shader
+    attr.location = 0;
+    attr.format = VK_FORMAT_R16G16B16A16_SNORM;
+    attr.offset = 0;
+    attributes.push_back(attr);
+
+    // Octahedral normal
+    attr.location = 1;
+    attr.format = VK_FORMAT_R16G16_SNORM;
+    attr.offset = 8;
+    attributes.push_back(attr);
+
+    attr.location = 2;
+    attr.format = VK_FORMAT_R16G16_SFLOAT;
+    attr.offset = 12;
+    attributes.push_back(attr);
+
+    attr.location = 3;
+    attr.format = VK_FORMAT_R8G8B8A8_UNORM;
+    attr.offset = 16;
+    attributes.push_back(attr);
+  } else {
+    attr.location = 0;
+    attr.format = VK_FORMAT_R32G32B32_SFLOAT;
+    attr.offset = 0;
+    attributes.push_back(attr);
 
-  attr.location = 1;
-  attr.offset = 12;
-  attributes.push_back(attr);
+    attr.location = 1;
+    attr.offset = 12;
+    attributes.push_back(attr);
 
-  attr.location = 2;
-  attr.format = VK_FORMAT_R32G32_SFLOAT;
-  attr.offset = 24;
-  attributes.push_back(attr);
+    attr.location = 2;
+    attr.format = VK_FORMAT_R32G32_SFLOAT;
+    attr.offset = 24;
+    attributes.push_back(attr);
 
-  attr.location = 3;
-  attr.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-  attr.offset = 32;
-  attributes.push_back(attr);
+    attr.location = 3;
+    attr.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attr.offset = 32;
+    attributes.push_back(attr);
+  }
 
   if (vs->instanced) {
     VkVertexInputBindingDescription instanceBinding{};
@@ -1334,6 +1421,7 @@ void VulkanDevice::pickPhysicalDevice() {
     caps_.samplerAniso = features.samplerAnisotropy == VK_TRUE;
     caps_.maxSamplerAnisotropy =
         caps_.samplerAniso ? properties.limits.maxSamplerAnisotropy : 1.0f;
+    caps_.textureCompressionBC = features.textureCompressionBC == VK_TRUE;
 
 #ifdef VK_FORMAT_FEATURE_SAMPLED_IMAGE_DEPTH_COMPARISON_BIT
     const auto supports_depth_compare = [&](VkFormat format) {
@@ -1389,6 +1477,9 @@ void VulkanDevice::createLogicalDevice() {
   if (caps_.samplerAniso) {
     deviceFeatures.samplerAnisotropy = VK_TRUE;
   }
+  if (caps_.textureCompressionBC) {
+    deviceFeatures.textureCompressionBC = VK_TRUE;
+  }
 
   VkDeviceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
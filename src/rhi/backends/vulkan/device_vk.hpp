@@ -28,6 +28,7 @@ public:
 
   BufferHandle createBuffer(const BufferDesc &) override;
   TextureHandle createTexture(const TextureDesc &) override;
+  void destroyTexture(TextureHandle handle) override;
   SamplerHandle createSampler(const SamplerDesc &) override;
   ShaderHandle createShader(std::string_view stage,
                             std::span<const uint8_t> bytes) override;
@@ -201,7 +202,7 @@ public:
   void beginRender(const RenderPassDesc &desc) override;
   void setPipeline(PipelineHandle) override;
   void setVertexBuffer(BufferHandle, size_t) override;
-  void setIndexBuffer(BufferHandle, size_t) override;
+  void setIndexBuffer(BufferHandle, size_t, IndexFormat) override;
   void setInstanceBuffer(BufferHandle, size_t, size_t) override;
 
   void setDepthStencilState(const DepthStencilState &) override;
@@ -238,7 +239,8 @@ public:
   void signalFence(FenceHandle handle) override;
 
   void drawIndexed(uint32_t indexCount, uint32_t firstIndex,
-                   uint32_t instanceCount) override;
+                   uint32_t instanceCount, int32_t baseVertex) override;
+  void drawIndexedIndirect(BufferHandle args, size_t offset) override;
   void endRender() override;
   void copyToBuffer(BufferHandle, size_t, std::span<const std::byte>) override;
   void end() override;
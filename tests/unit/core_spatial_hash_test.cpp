@@ -0,0 +1,147 @@
+#include "pixel/core/spatial_hash.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using pixel::core::SpatialHash2D;
+using Vec2 = SpatialHash2D::Vec2;
+
+namespace {
+std::vector<uint32_t> brute_radius(const std::vector<Vec2> &pos,
+                                   const std::vector<bool> &alive, Vec2 c,
+                                   float r) {
+  std::vector<uint32_t> out;
+  for (uint32_t i = 0; i < pos.size(); ++i) {
+    const float dx = pos[i].x - c.x, dy = pos[i].y - c.y;
+    if (alive[i] && dx * dx + dy * dy <= r * r)
+      out.push_back(i);
+  }
+  return out;
+}
+} // namespace
+
+int main() {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> coord(-500.0f, 500.0f);
+  std::uniform_real_distribution<float> step(-3.0f, 3.0f);
+
+  const uint32_t count = 4000;
+  std::vector<Vec2> pos(count);
+  std::vector<bool> alive(count, true);
+  for (auto &p : pos)
+    p = Vec2(coord(rng), coord(rng));
+
+  SpatialHash2D hash(8.0f);
+  hash.rebuild(pos);
+  assert(hash.size() == count);
+
+  // Incremental moves, removals and re-inserts
+  for (int iter = 0; iter < 20000; ++iter) {
+    const uint32_t e = rng() % count;
+    if (!alive[e]) {
+      hash.insert(e, pos[e]);
+      alive[e] = true;
+    } else if (rng() % 8 == 0) {
+      hash.remove(e);
+      alive[e] = false;
+    } else {
+      pos[e] = pos[e] + Vec2(step(rng), step(rng));
+      hash.move(e, pos[e]);
+    }
+  }
+  assert(hash.size() ==
+         static_cast<size_t>(std::count(alive.begin(), alive.end(), true)));
+
+  for (int q = 0; q < 100; ++q) {
+    const Vec2 c(coord(rng), coord(rng));
+    const float r = 1.0f + static_cast<float>(rng() % 60);
+
+    std::vector<uint32_t> got;
+    hash.query_radius(c, r, got);
+    std::sort(got.begin(), got.end());
+    assert(got == brute_radius(pos, alive, c, r));
+
+    got.clear();
+    hash.query_rect(Vec2(c.x - r, c.y - r), Vec2(c.x + r, c.y + r), got);
+    std::sort(got.begin(), got.end());
+    std::vector<uint32_t> want;
+    for (uint32_t i = 0; i < count; ++i) {
+      if (alive[i] && pos[i].x >= c.x - r && pos[i].x <= c.x + r &&
+          pos[i].y >= c.y - r && pos[i].y <= c.y + r)
+        want.push_back(i);
+    }
+    assert(got == want);
+
+    const size_t k = 1 + rng() % 16;
+    std::vector<SpatialHash2D::Neighbor> nearest;
+    hash.query_nearest(c, k, nearest);
+    assert(nearest.size() == k);
+    std::vector<float> dists;
+    for (uint32_t i = 0; i < count; ++i) {
+      const float dx = pos[i].x - c.x, dy = pos[i].y - c.y;
+      if (alive[i])
+        dists.push_back(dx * dx + dy * dy);
+    }
+    std::sort(dists.begin(), dists.end());
+    for (size_t i = 0; i < k; ++i)
+      assert(nearest[i].distance_sq == dists[i]);
+  }
+
+  // Overflow entries are chained per cell: moving between cells, removing
+  // from the middle of a chain and queries away from them all stay exact
+  {
+    SpatialHash2D chained(10.0f);
+    std::vector<Vec2> start(64);
+    for (uint32_t i = 0; i < start.size(); ++i)
+      start[i] = Vec2(static_cast<float>(i) * 10.0f + 5.0f, 5.0f);
+    chained.rebuild(start);
+    // Everything piles into cell (0, 0), then half moves on to (3, 3)
+    for (uint32_t i = 0; i < 32; ++i)
+      chained.move(i, Vec2(1.0f + static_cast<float>(i) * 0.1f, 1.0f));
+    for (uint32_t i = 0; i < 32; i += 2)
+      chained.move(i, Vec2(35.0f, 35.0f));
+    chained.remove(7);
+    chained.remove(8);
+    chained.insert(100, Vec2(2.0f, 2.0f));
+
+    std::vector<uint32_t> got;
+    chained.query_rect(Vec2(0.0f, 0.0f), Vec2(9.9f, 9.9f), got);
+    std::sort(got.begin(), got.end());
+    std::vector<uint32_t> want;
+    for (uint32_t i = 1; i < 32; i += 2) {
+      if (i != 7)
+        want.push_back(i);
+    }
+    want.push_back(100);
+    assert(got == want);
+
+    got.clear();
+    chained.query_radius(Vec2(35.0f, 35.0f), 1.0f, got);
+    assert(got.size() == 15);
+    got.clear();
+    chained.query_rect(Vec2(320.0f, -50.0f), Vec2(420.0f, 50.0f), got);
+    assert(got.size() == 10); // entities 32..41 never left their cells
+    std::vector<SpatialHash2D::Neighbor> near;
+    chained.query_nearest(Vec2(35.0f, 35.0f), 3, near);
+    assert(near.size() == 3 && near[2].distance_sq == 0.0f);
+  }
+
+  // Sparse world: k exceeds the population and entities sit far apart
+  SpatialHash2D sparse(1.0f);
+  sparse.insert(0, Vec2(0.0f, 0.0f));
+  sparse.insert(5, Vec2(90000.0f, -90000.0f));
+  std::vector<SpatialHash2D::Neighbor> nearest;
+  sparse.query_nearest(Vec2(1.0f, 1.0f), 4, nearest);
+  assert(nearest.size() == 2 && nearest[0].entity == 0 &&
+         nearest[1].entity == 5);
+
+  sparse.compact();
+  nearest.clear();
+  sparse.query_nearest(Vec2(1.0f, 1.0f), 4, nearest);
+  assert(nearest.size() == 2 && nearest[0].entity == 0 &&
+         nearest[1].entity == 5);
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+// Headless rhi::Device for unit tests. Records buffer creation, texture
+// lifetimes, uploads, draws and dispatches; everything else is a no-op.
+
+#include "pixel/rhi/rhi.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace pixel::test {
+
+struct FakeCmdList : rhi::CmdList {
+  void begin() override {}
+  void beginRender(const rhi::RenderPassDesc &) override {}
+  void setPipeline(rhi::PipelineHandle) override {}
+  void setVertexBuffer(rhi::BufferHandle, size_t) override {}
+  void setIndexBuffer(rhi::BufferHandle, size_t, rhi::IndexFormat) override {}
+  void setInstanceBuffer(rhi::BufferHandle, size_t, size_t) override {}
+  void setDepthStencilState(const rhi::DepthStencilState &) override {}
+  void setDepthBias(const rhi::DepthBiasState &) override {}
+  void setUniformMat4(const char *, const float *) override {}
+  void setUniformVec3(const char *, const float *) override {}
+  void setUniformVec4(const char *, const float *) override {}
+  void setUniformInt(const char *, int) override {}
+  void setUniformFloat(const char *, float) override {}
+  void setUniformBuffer(uint32_t, rhi::BufferHandle, size_t, size_t) override {}
+  void setTexture(const char *, rhi::TextureHandle, uint32_t,
+                  rhi::SamplerHandle) override {}
+  void copyToTexture(rhi::TextureHandle, uint32_t,
+                     std::span<const std::byte> data) override {
+    uploaded += data.size();
+  }
+  void copyToTextureLayer(rhi::TextureHandle, uint32_t, uint32_t,
+                          std::span<const std::byte>) override {}
+  void setComputePipeline(rhi::PipelineHandle) override {}
+  void setStorageBuffer(uint32_t, rhi::BufferHandle, size_t, size_t) override {}
+  void dispatch(uint32_t, uint32_t, uint32_t) override { ++dispatches; }
+  void memoryBarrier() override {}
+  void resourceBarrier(std::span<const rhi::ResourceBarrierDesc>) override {}
+  void beginQuery(rhi::QueryHandle, rhi::QueryType) override {}
+  void endQuery(rhi::QueryHandle, rhi::QueryType) override {}
+  void signalFence(rhi::FenceHandle) override {}
+  void drawIndexed(uint32_t index_count, uint32_t, uint32_t, int32_t) override {
+    draws.push_back({index_count, {}});
+  }
+  void drawIndexedIndirect(rhi::BufferHandle args, size_t) override {
+    draws.push_back({0, args});
+  }
+  void endRender() override {}
+  void copyToBuffer(rhi::BufferHandle buffer, size_t offset,
+                    std::span<const std::byte> data) override {
+    buffer_writes.push_back({buffer, offset, data.size()});
+  }
+  void end() override {}
+
+  struct BufferWrite {
+    rhi::BufferHandle buffer;
+    size_t offset;
+    size_t size;
+  };
+
+  struct Draw {
+    uint32_t index_count; // 0 for indirect draws
+    rhi::BufferHandle indirect_args;
+  };
+
+  // Bytes passed to copyToTexture
+  size_t uploaded = 0;
+  std::vector<BufferWrite> buffer_writes;
+  std::vector<Draw> draws;
+  uint32_t dispatches = 0;
+};
+
+struct FakeDevice : rhi::Device {
+  const char *backend_name() const override { return "Fake"; }
+  const rhi::Caps &caps() const override { return caps_; }
+  rhi::BufferHandle createBuffer(const rhi::BufferDesc &desc) override {
+    buffers[next_id] = desc;
+    return rhi::BufferHandle{next_id++};
+  }
+  rhi::TextureHandle createTexture(const rhi::TextureDesc &desc) override {
+    live[next_id] = desc;
+    return rhi::TextureHandle{next_id++};
+  }
+  void destroyTexture(rhi::TextureHandle handle) override {
+    const size_t erased = live.erase(handle.id);
+    assert(erased == 1);
+    (void)erased;
+  }
+  rhi::SamplerHandle createSampler(const rhi::SamplerDesc &) override {
+    return {};
+  }
+  rhi::ShaderHandle createShader(std::string_view,
+                                 std::span<const uint8_t>) override {
+    return {};
+  }
+  rhi::ShaderHandle createShaderFromBytecode(std::string_view,
+                                             std::span<const uint8_t>) override {
+    return {};
+  }
+  rhi::PipelineHandle createPipeline(const rhi::PipelineDesc &) override {
+    return {};
+  }
+  rhi::FramebufferHandle createFramebuffer(const rhi::FramebufferDesc &) override {
+    return {};
+  }
+  rhi::QueryHandle createQuery(rhi::QueryType) override { return {}; }
+  void destroyQuery(rhi::QueryHandle) override {}
+  bool getQueryResult(rhi::QueryHandle, uint64_t &, bool) override {
+    return false;
+  }
+  rhi::FenceHandle createFence(bool) override { return {}; }
+  void destroyFence(rhi::FenceHandle) override {}
+  void waitFence(rhi::FenceHandle, uint64_t) override {}
+  void resetFence(rhi::FenceHandle) override {}
+  rhi::CmdList *getImmediate() override { return &cmd; }
+  void present() override {}
+  void readBuffer(rhi::BufferHandle, void *, size_t, size_t) override {}
+
+  rhi::Caps caps_;
+  FakeCmdList cmd;
+  // Buffers created and textures alive, by handle id
+  std::map<uint32_t, rhi::BufferDesc> buffers;
+  std::map<uint32_t, rhi::TextureDesc> live;
+  uint32_t next_id = 1;
+};
+
+} // namespace pixel::test
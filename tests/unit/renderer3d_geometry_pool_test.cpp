@@ -0,0 +1,159 @@
+#include "pixel/renderer3d/geometry_pool.hpp"
+#include "pixel/renderer3d/mesh.hpp"
+#include "fake_device.hpp"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using pixel::renderer3d::GeometryPool;
+using pixel::renderer3d::Mesh;
+using pixel::renderer3d::MeshOptions;
+using pixel::renderer3d::Vertex;
+using pixel::rhi::IndexFormat;
+using pixel::rhi::VertexLayout;
+using pixel::test::FakeDevice;
+
+namespace {
+
+constexpr size_t kStride = 48; // VertexLayout::Standard
+
+// 100 standard vertices and 400 index bytes per page
+GeometryPool::Settings small_pages() {
+  GeometryPool::Settings settings;
+  settings.vertex_page_bytes = 100 * kStride;
+  settings.index_page_bytes = 400;
+  return settings;
+}
+
+} // namespace
+
+int main() {
+  // Allocations pack back to back in one page per kind
+  {
+    FakeDevice device;
+    auto pool = GeometryPool::create(&device, small_pages());
+    assert(pool);
+
+    auto a = pool->allocate(VertexLayout::Standard, 10, 24);
+    auto b = pool->allocate(VertexLayout::Standard, 20, 40);
+    auto c = pool->allocate(VertexLayout::Standard, 5, 6);
+    assert(a && b && c);
+    assert(a->base_vertex == 0 && b->base_vertex == 10 && c->base_vertex == 30);
+    assert(a->index_offset == 0 && b->index_offset == 24 &&
+           c->index_offset == 64);
+    // Index ranges stay 4-byte aligned
+    assert(c->index_bytes == 8);
+    assert(a->vertex_buffer.id == c->vertex_buffer.id);
+    assert(a->index_buffer.id == c->index_buffer.id);
+    assert(device.buffers.at(a->vertex_buffer.id).size == 100 * kStride);
+
+    GeometryPool::Stats stats = pool->stats();
+    assert(stats.vertex_pages == 1 && stats.index_pages == 1);
+    assert(stats.allocations == 3);
+    assert(stats.vertex_bytes_used == 35 * kStride);
+    assert(stats.index_bytes_used == 72);
+
+    // Uploads land at the allocation's offsets; oversized data is refused
+    std::vector<std::byte> vertices(20 * kStride);
+    std::vector<std::byte> indices(40);
+    pool->upload(*b, vertices, indices);
+    assert(device.cmd.buffer_writes.size() == 2);
+    assert(device.cmd.buffer_writes[0].offset == 10 * kStride);
+    assert(device.cmd.buffer_writes[1].offset == 24);
+    std::vector<std::byte> too_many(21 * kStride);
+    pool->upload(*b, too_many, indices);
+    assert(device.cmd.buffer_writes.size() == 2);
+
+    // A freed range is reused first-fit by the next allocation that fits
+    pool->free(*b);
+    auto d = pool->allocate(VertexLayout::Standard, 15, 32);
+    assert(d && d->base_vertex == 10 && d->index_offset == 24);
+    assert(pool->stats().vertex_pages == 1);
+
+    // Freeing neighbours coalesces them with the gap left after d into one
+    // range ahead of c that exactly fits e; the next allocation goes past c
+    pool->free(*a);
+    pool->free(*d);
+    auto e = pool->allocate(VertexLayout::Standard, 30, 64);
+    assert(e && e->base_vertex == 0 && e->index_offset == 0);
+    auto f = pool->allocate(VertexLayout::Standard, 5, 8);
+    assert(f && f->base_vertex == 35 && f->index_offset == 72);
+    stats = pool->stats();
+    assert(stats.vertex_pages == 1 && stats.index_pages == 1);
+    assert(stats.allocations == 3);
+
+    // Full pages and oversized requests get new pages
+    auto big = pool->allocate(VertexLayout::Standard, 250, 1000);
+    assert(big && big->base_vertex == 0 && big->index_offset == 0);
+    assert(big->vertex_buffer.id != e->vertex_buffer.id);
+    assert(device.buffers.at(big->vertex_buffer.id).size == 250 * kStride);
+    // Each layout has its own pages
+    auto packed = pool->allocate(VertexLayout::Compressed, 10, 12);
+    assert(packed && packed->base_vertex == 0);
+    assert(packed->vertex_buffer.id != e->vertex_buffer.id &&
+           packed->vertex_buffer.id != big->vertex_buffer.id);
+    stats = pool->stats();
+    assert(stats.vertex_pages == 3 && stats.index_pages == 2);
+
+    pool->free(*big);
+    pool->free(*packed);
+    pool->free(*c);
+    pool->free(*e);
+    pool->free(*f);
+    stats = pool->stats();
+    assert(stats.allocations == 0);
+    assert(stats.vertex_bytes_used == 0 && stats.index_bytes_used == 0);
+
+    assert(!pool->allocate(VertexLayout::Standard, 0, 4));
+    (void)stats;
+  }
+
+  // Pooled meshes draw at base_vertex / first_index and give their ranges
+  // back retire_frames frames after they are destroyed
+  {
+    FakeDevice device;
+    auto pool = GeometryPool::create(&device, small_pages());
+    const std::vector<Vertex> quad(4);
+    const std::vector<uint32_t> quad_indices = {0, 1, 2, 2, 3, 0};
+    const std::vector<Vertex> tri(3);
+    const std::vector<uint32_t> tri_indices = {0, 1, 2};
+    MeshOptions options;
+    options.pool = pool.get();
+
+    auto first = Mesh::create(&device, quad, quad_indices, options);
+    auto second = Mesh::create(&device, tri, tri_indices, options);
+    assert(first && second && first->pooled() && second->pooled());
+    assert(second->format().index_format == IndexFormat::Uint16);
+    assert(first->format().base_vertex == 0);
+    assert(first->format().first_index == 0);
+    // 6 u16 indices = 12 bytes before the second mesh
+    assert(second->format().base_vertex == 4);
+    assert(second->format().first_index == 6);
+    assert(first->vertex_buffer().id == second->vertex_buffer().id);
+
+    // A frame in flight may still draw the first mesh, so its range is not
+    // handed out again until retire_frames frames have begun
+    first.reset();
+    assert(pool->stats().allocations == 2 && pool->stats().retiring == 1);
+    auto third = Mesh::create(&device, tri, tri_indices, options);
+    assert(third->format().base_vertex == 7);
+    for (uint32_t frame = 1; frame < small_pages().retire_frames; ++frame)
+      pool->begin_frame();
+    assert(pool->stats().retiring == 1);
+    pool->begin_frame();
+    assert(pool->stats().allocations == 2 && pool->stats().retiring == 0);
+    auto fourth = Mesh::create(&device, tri, tri_indices, options);
+    assert(fourth->format().base_vertex == 0);
+    assert(fourth->format().first_index == 0);
+
+    second.reset();
+    third.reset();
+    fourth.reset();
+    for (uint32_t frame = 0; frame < small_pages().retire_frames; ++frame)
+      pool->begin_frame();
+    assert(pool->stats().allocations == 0);
+  }
+
+  return 0;
+}
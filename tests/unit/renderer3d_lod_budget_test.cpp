@@ -0,0 +1,115 @@
+#include "pixel/renderer3d/lod.hpp"
+#include <cassert>
+#include <cmath>
+
+using pixel::renderer3d::LODBudgetConfig;
+namespace lod_budget = pixel::renderer3d::lod_budget;
+
+namespace {
+
+LODBudgetConfig make_config() {
+  LODBudgetConfig config;
+  config.enabled = true;
+  config.target_frame_ms = 16.0f;
+  config.hysteresis = 0.1f;
+  config.smoothing = 1.0f; // no EMA lag: each sample is the frame time
+  config.raise_step = 0.05f;
+  config.lower_step = 0.02f;
+  config.settle_frames = 10;
+  config.min_bias = 1.0f;
+  config.max_bias = 3.0f;
+  return config;
+}
+
+bool near(float a, float b) { return std::fabs(a - b) < 1e-4f; }
+
+// One frame with the given CPU and GPU times; GPU time lands first, as the
+// renderer's timer results arrive before the next CPU submission
+void frame(double cpu_ms, double gpu_ms) {
+  lod_budget::submit_gpu_frame_time(gpu_ms);
+  lod_budget::submit_cpu_frame_time(cpu_ms);
+}
+
+} // namespace
+
+int main() {
+  // Disabled: the bias stays neutral whatever the frame times
+  {
+    LODBudgetConfig config = make_config();
+    config.enabled = false;
+    lod_budget::configure(config);
+    lod_budget::reset();
+    for (int i = 0; i < 50; ++i)
+      frame(40.0, 40.0);
+    assert(lod_budget::bias() == 1.0f);
+  }
+
+  lod_budget::configure(make_config());
+
+  // Over budget raises every frame and clamps at max_bias
+  {
+    lod_budget::reset();
+    assert(lod_budget::bias() == 1.0f);
+    frame(30.0, 30.0);
+    assert(near(lod_budget::bias(), 1.05f));
+    for (int i = 0; i < 100; ++i)
+      frame(30.0, 30.0);
+    assert(lod_budget::bias() == 3.0f);
+  }
+
+  // GPU-bound frames count as over budget even when the CPU is idle
+  {
+    lod_budget::reset();
+    for (int i = 0; i < 4; ++i)
+      frame(2.0, 25.0);
+    assert(near(lod_budget::bias(), 1.2f));
+  }
+
+  // Under budget waits settle_frames before lowering, then clamps at
+  // min_bias; a frame inside the dead band restarts the wait
+  {
+    lod_budget::set_bias(2.0f);
+    for (int i = 0; i < 9; ++i)
+      frame(5.0, 5.0);
+    assert(near(lod_budget::bias(), 2.0f));
+    frame(16.0, 16.0);
+    for (int i = 0; i < 9; ++i)
+      frame(5.0, 5.0);
+    assert(near(lod_budget::bias(), 2.0f));
+    frame(5.0, 5.0);
+    assert(near(lod_budget::bias(), 1.98f));
+    for (int i = 0; i < 200; ++i)
+      frame(5.0, 5.0);
+    assert(lod_budget::bias() == 1.0f);
+  }
+
+  // Closed loop: a GPU-bound scene whose cost falls as the bias rises
+  // settles inside the dead band and stays there
+  {
+    LODBudgetConfig config = make_config();
+    config.smoothing = 0.2f;
+    config.max_bias = 4.0f;
+    lod_budget::configure(config);
+    lod_budget::reset();
+    const double band = config.target_frame_ms * config.hysteresis;
+    auto gpu_cost = [] { return 40.0 / lod_budget::bias(); };
+
+    for (int i = 0; i < 1000; ++i)
+      frame(4.0, gpu_cost());
+    const float settled = lod_budget::bias();
+    assert(std::fabs(gpu_cost() - config.target_frame_ms) <= band);
+    for (int i = 0; i < 1000; ++i)
+      frame(4.0, gpu_cost());
+    assert(std::fabs(lod_budget::bias() - settled) <= 0.1f);
+    (void)band;
+    (void)settled;
+  }
+
+  // Manual overrides are clamped to the configured range
+  lod_budget::set_bias(10.0f);
+  assert(lod_budget::bias() == 4.0f);
+  lod_budget::set_bias(0.0f);
+  assert(lod_budget::bias() == 1.0f);
+
+  return 0;
+}
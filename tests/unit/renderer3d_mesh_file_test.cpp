@@ -0,0 +1,150 @@
+#include "pixel/renderer3d/mesh_file.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using pixel::renderer3d::MeshFile;
+using pixel::renderer3d::MeshFileLodSource;
+using pixel::renderer3d::MeshOptions;
+using pixel::renderer3d::Vec3;
+using pixel::renderer3d::Vertex;
+namespace rhi = pixel::rhi;
+
+namespace {
+
+MeshFileLodSource make_grid(int size, float distance) {
+  MeshFileLodSource lod;
+  lod.switch_distance = distance;
+  for (int z = 0; z <= size; ++z) {
+    for (int x = 0; x <= size; ++x) {
+      Vertex v{};
+      v.position = Vec3(static_cast<float>(x), 0.5f, static_cast<float>(z));
+      v.normal = Vec3(0.0f, 1.0f, 0.0f);
+      lod.vertices.push_back(v);
+    }
+  }
+  for (int z = 0; z < size; ++z) {
+    for (int x = 0; x < size; ++x) {
+      const uint32_t i = static_cast<uint32_t>(z * (size + 1) + x);
+      const uint32_t row = static_cast<uint32_t>(size + 1);
+      lod.indices.insert(lod.indices.end(),
+                         {i, i + row, i + 1, i + 1, i + row, i + row + 1});
+    }
+  }
+  return lod;
+}
+
+uint32_t read_index(const MeshFile &file, size_t lod, size_t i) {
+  const auto bytes = file.index_data(lod);
+  if (file.format().index_format == rhi::IndexFormat::Uint16) {
+    uint16_t value;
+    std::memcpy(&value, bytes.data() + i * sizeof(value), sizeof(value));
+    return value;
+  }
+  uint32_t value;
+  std::memcpy(&value, bytes.data() + i * sizeof(value), sizeof(value));
+  return value;
+}
+
+} // namespace
+
+int main() {
+  const auto dir = std::filesystem::temp_directory_path();
+  const std::string path = (dir / "pixel_mesh_file_test.pxmesh").string();
+
+  // Two LODs with an odd u16 index count in the second: ranges stay aligned
+  std::vector<MeshFileLodSource> lods = {make_grid(8, 0.0f),
+                                         make_grid(1, 40.0f)};
+  lods[1].indices.resize(3);
+  assert(pixel::renderer3d::write_mesh_file(path, lods));
+
+  {
+    auto file = MeshFile::open(path);
+    assert(file);
+    assert(file->lods().size() == 2);
+    assert(file->format().index_format == rhi::IndexFormat::Uint16);
+    assert(file->header().bounds_max[0] == 8.0f);
+    assert(file->lods()[1].switch_distance == 40.0f);
+    assert(file->lods()[1].first_index % 2 == 0);
+
+    for (size_t lod = 0; lod < lods.size(); ++lod) {
+      assert(file->vertex_data(lod).size() ==
+             lods[lod].vertices.size() * sizeof(Vertex));
+      assert(file->index_data(lod).size() % 4 == 0);
+      Vertex first;
+      std::memcpy(&first, file->vertex_data(lod).data(), sizeof(first));
+      assert(first.position.y == 0.5f);
+      for (size_t i = 0; i < lods[lod].indices.size(); ++i)
+        assert(read_index(*file, lod, i) == lods[lod].indices[i]);
+    }
+  }
+
+  // Compressed layout with 32-bit indices
+  MeshOptions options;
+  options.vertex_layout = rhi::VertexLayout::Compressed;
+  options.allow_16bit_indices = false;
+  assert(pixel::renderer3d::write_mesh_file(path, lods, options));
+  {
+    auto file = MeshFile::open(path);
+    assert(file);
+    assert(file->format().compressed());
+    assert(file->format().index_format == rhi::IndexFormat::Uint32);
+    assert(file->format().position_scale.x == 4.0f);
+    assert(file->vertex_data(0).size() == lods[0].vertices.size() * 20);
+    assert(read_index(*file, 0, 5) == lods[0].indices[5]);
+
+    // Decoding the mapped payload recovers positions within quantisation
+    std::vector<pixel::renderer3d::CompressedVertex> packed(
+        lods[0].vertices.size());
+    std::memcpy(packed.data(), file->vertex_data(0).data(),
+                file->vertex_data(0).size());
+    const auto decoded =
+        pixel::renderer3d::decompress_vertices(packed, file->format());
+    for (size_t i = 0; i < decoded.size(); ++i) {
+      assert(std::abs(decoded[i].position.x - lods[0].vertices[i].position.x) <
+             1e-3f);
+      assert(std::abs(decoded[i].position.y - 0.5f) < 1e-3f);
+      assert(std::abs(decoded[i].normal.y - 1.0f) < 1e-3f);
+    }
+  }
+
+  // Truncated files and foreign data are rejected
+  std::vector<char> bytes(std::filesystem::file_size(path));
+  std::ifstream(path, std::ios::binary).read(bytes.data(), bytes.size());
+
+  // So is an index past its LOD's vertices, even one inside the payload
+  {
+    std::vector<char> corrupt = bytes;
+    pixel::renderer3d::MeshFileHeader header;
+    std::memcpy(&header, corrupt.data(), sizeof(header));
+    pixel::renderer3d::MeshFileLod lod1;
+    std::memcpy(&lod1,
+                corrupt.data() + header.lod_table_offset +
+                    sizeof(pixel::renderer3d::MeshFileLod),
+                sizeof(lod1));
+    const uint32_t bad = lod1.vertex_count;
+    std::memcpy(corrupt.data() + header.index_data_offset +
+                    size_t(lod1.first_index) * sizeof(uint32_t),
+                &bad, sizeof(bad));
+    std::ofstream(path, std::ios::binary | std::ios::trunc)
+        .write(corrupt.data(), static_cast<std::streamsize>(corrupt.size()));
+    assert(!MeshFile::open(path));
+  }
+
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      .write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 4));
+  assert(!MeshFile::open(path));
+  bytes[0] = 'X';
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      .write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  assert(!MeshFile::open(path));
+
+  std::remove(path.c_str());
+  return 0;
+}
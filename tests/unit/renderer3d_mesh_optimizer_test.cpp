@@ -0,0 +1,139 @@
+#include "pixel/renderer3d/mesh_optimizer.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using pixel::renderer3d::Vec3;
+using pixel::renderer3d::Vertex;
+namespace mesh_optimizer = pixel::renderer3d::mesh_optimizer;
+
+namespace {
+using Triangle = std::array<float, 9>;
+
+// Triangles by position, rotated to a canonical corner so winding is kept
+std::vector<Triangle> triangle_set(const std::vector<Vertex> &vertices,
+                                   const std::vector<uint32_t> &indices) {
+  std::vector<Triangle> out;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    std::array<std::array<float, 3>, 3> corners;
+    for (int c = 0; c < 3; ++c) {
+      const Vec3 &p = vertices[indices[i + c]].position;
+      corners[c] = {p.x, p.y, p.z};
+    }
+    const int first = static_cast<int>(
+        std::min_element(corners.begin(), corners.end()) - corners.begin());
+    Triangle t;
+    for (int c = 0; c < 3; ++c)
+      for (int k = 0; k < 3; ++k)
+        t[c * 3 + k] = corners[(first + c) % 3][k];
+    out.push_back(t);
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+void make_sphere(int segments, int rings, std::vector<Vertex> &vertices,
+                 std::vector<uint32_t> &indices) {
+  for (int y = 0; y <= rings; ++y) {
+    for (int x = 0; x <= segments; ++x) {
+      const float theta = 3.14159265f * static_cast<float>(y) / rings;
+      const float phi = 6.28318531f * static_cast<float>(x) / segments;
+      Vertex v{};
+      v.position = Vec3(std::cos(phi) * std::sin(theta), std::cos(theta),
+                        std::sin(phi) * std::sin(theta));
+      v.normal = v.position;
+      vertices.push_back(v);
+    }
+  }
+  const uint32_t stride = static_cast<uint32_t>(segments + 1);
+  for (int y = 0; y < rings; ++y) {
+    for (int x = 0; x < segments; ++x) {
+      const uint32_t a = y * stride + x;
+      const uint32_t b = (y + 1) * stride + x;
+      indices.insert(indices.end(), {a, b, a + 1, b, b + 1, a + 1});
+    }
+  }
+}
+} // namespace
+
+int main() {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  make_sphere(48, 24, vertices, indices);
+
+  // Shuffled triangle order: the worst case procedural generators approach
+  std::mt19937 rng(3);
+  std::vector<size_t> order(indices.size() / 3);
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::shuffle(order.begin(), order.end(), rng);
+  std::vector<uint32_t> shuffled;
+  for (size_t t : order)
+    shuffled.insert(shuffled.end(),
+                    {indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]});
+
+  for (const auto *source : {&indices, &shuffled}) {
+    std::vector<Vertex> v = vertices;
+    std::vector<uint32_t> i = *source;
+    const auto expected = triangle_set(v, i);
+    const float before = mesh_optimizer::average_cache_miss_ratio(i, v.size());
+
+    mesh_optimizer::optimize_mesh(v, i);
+    const float after = mesh_optimizer::average_cache_miss_ratio(i, v.size());
+
+    assert(i.size() == source->size());
+    assert(triangle_set(v, i) == expected);
+    assert(after < before);
+    assert(after < 0.8f);
+
+    // Vertex fetch order: every index is either seen or the next new one
+    uint32_t next = 0;
+    for (uint32_t index : i) {
+      assert(index <= next);
+      if (index == next)
+        ++next;
+    }
+    assert(next == v.size());
+  }
+
+  // Degenerate and duplicate triangles, including ones only reachable through
+  // vertex 0, come out as a permutation of the input
+  const std::vector<std::vector<uint32_t>> odd_lists = {
+      {1, 2, 3, 0, 0, 0},
+      {1, 2, 3, 0, 4, 5},
+      {2, 2, 2, 1, 2, 3, 1, 2, 3, 0, 0, 5, 4, 4, 4},
+  };
+  for (const auto &list : odd_lists) {
+    std::vector<uint32_t> reordered = list;
+    mesh_optimizer::optimize_vertex_cache(reordered, 6);
+    assert(reordered.size() == list.size());
+
+    auto triangles = [](const std::vector<uint32_t> &l) {
+      std::vector<std::array<uint32_t, 3>> out;
+      for (size_t t = 0; t < l.size(); t += 3)
+        out.push_back({l[t], l[t + 1], l[t + 2]});
+      std::sort(out.begin(), out.end());
+      return out;
+    };
+    assert(triangles(reordered) == triangles(list));
+  }
+
+  // Unreferenced vertices are dropped, invalid lists are left alone
+  std::vector<Vertex> sparse(8);
+  for (size_t k = 0; k < sparse.size(); ++k)
+    sparse[k].position = Vec3(static_cast<float>(k), 0.0f, 0.0f);
+  std::vector<uint32_t> sparse_indices = {5, 6, 7};
+  assert(mesh_optimizer::optimize_vertex_fetch(sparse, sparse_indices) == 3);
+  assert(sparse[0].position.x == 5.0f && sparse_indices[0] == 0);
+
+  std::vector<uint32_t> broken = {0, 1, 9};
+  std::vector<Vertex> three(3);
+  mesh_optimizer::optimize_mesh(three, broken);
+  assert(broken[2] == 9 && three.size() == 3);
+
+  return 0;
+}
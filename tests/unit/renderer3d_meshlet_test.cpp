@@ -0,0 +1,176 @@
+#include "pixel/renderer3d/meshlet.hpp"
+#include "fake_device.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+using pixel::renderer3d::FrustumPlanes;
+using pixel::renderer3d::Mesh;
+using pixel::renderer3d::MeshletData;
+using pixel::renderer3d::MeshletMesh;
+using pixel::renderer3d::MeshOptions;
+using pixel::renderer3d::Vec3;
+using pixel::renderer3d::Vertex;
+using pixel::test::FakeDevice;
+
+namespace {
+
+// Flat XZ grid at y = 0 with every face pointing up (+Y)
+void make_grid(int size, std::vector<Vertex> &vertices,
+               std::vector<uint32_t> &indices) {
+  for (int z = 0; z <= size; ++z) {
+    for (int x = 0; x <= size; ++x) {
+      Vertex v{};
+      v.position = Vec3(static_cast<float>(x), 0.0f, static_cast<float>(z));
+      v.normal = Vec3(0.0f, 1.0f, 0.0f);
+      vertices.push_back(v);
+    }
+  }
+  const uint32_t row = static_cast<uint32_t>(size + 1);
+  for (int z = 0; z < size; ++z) {
+    for (int x = 0; x < size; ++x) {
+      const uint32_t i = static_cast<uint32_t>(z) * row + x;
+      indices.insert(indices.end(),
+                     {i, i + row, i + 1, i + 1, i + row, i + row + 1});
+    }
+  }
+}
+
+FrustumPlanes camera_planes(const glm::vec3 &eye, const glm::vec3 &target) {
+  const glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0, 0, 1));
+  const glm::mat4 proj =
+      glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 500.0f);
+  return pixel::renderer3d::extract_frustum_planes(proj * view);
+}
+
+} // namespace
+
+int main() {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  make_grid(32, vertices, indices);
+
+  const MeshletData data =
+      pixel::renderer3d::build_meshlets(vertices, indices);
+  assert(data.meshlets.size() > 1);
+  assert(data.bounds.size() == data.meshlets.size());
+
+  // Limits hold and every source triangle appears exactly once, in order
+  std::vector<uint32_t> rebuilt;
+  for (const auto &meshlet : data.meshlets) {
+    assert(meshlet.vertex_count <= pixel::renderer3d::kMeshletMaxVertices);
+    assert(meshlet.triangle_count <= pixel::renderer3d::kMeshletMaxTriangles);
+    for (uint32_t t = 0; t < meshlet.triangle_count * 3; ++t) {
+      const uint8_t local = data.triangles[meshlet.triangle_offset + t];
+      assert(local < meshlet.vertex_count);
+      rebuilt.push_back(data.vertices[meshlet.vertex_offset + local]);
+    }
+  }
+  assert(rebuilt == indices);
+
+  // A flat patch gets a tight cone pointing along its normal
+  for (const auto &bounds : data.bounds) {
+    assert(bounds.cone_cutoff < 0.01f);
+    assert(bounds.cone_axis.y > 0.99f);
+    assert(bounds.radius > 0.0f);
+  }
+
+  // Seen from above everything in view survives; from below the cones cull
+  // every cluster even though all spheres are inside the frustum
+  const glm::mat4 model(1.0f);
+  const glm::vec3 target(16.0f, 0.0f, 16.0f);
+  const glm::vec3 above(16.0f, 60.0f, 16.0f);
+  const glm::vec3 below(16.0f, -60.0f, 16.0f);
+  const FrustumPlanes planes_above = camera_planes(above, target);
+  const FrustumPlanes planes_below = camera_planes(below, target);
+  for (const auto &bounds : data.bounds) {
+    assert(pixel::renderer3d::meshlet_visible(bounds, model, planes_above,
+                                              above));
+    assert(!pixel::renderer3d::meshlet_visible(bounds, model, planes_below,
+                                               below));
+  }
+
+  // Moving the mesh out of view frustum-culls it; the eye is given in object
+  // space, so the cone test alone would keep it
+  const glm::mat4 moved =
+      glm::translate(glm::mat4(1.0f), glm::vec3(1000.0f, 0.0f, 0.0f));
+  const glm::vec3 eye_object =
+      glm::vec3(glm::inverse(moved) * glm::vec4(above, 1.0f));
+  const size_t visible_moved = std::count_if(
+      data.bounds.begin(), data.bounds.end(), [&](const auto &bounds) {
+        return pixel::renderer3d::meshlet_visible(bounds, moved, planes_above,
+                                                  eye_object);
+      });
+  assert(visible_moved == 0);
+
+  // Invalid input yields no meshlets
+  indices.push_back(0);
+  assert(pixel::renderer3d::build_meshlets(vertices, indices).meshlets.empty());
+  indices.pop_back();
+  indices.insert(indices.end(), {0, 1, static_cast<uint32_t>(vertices.size())});
+  assert(pixel::renderer3d::build_meshlets(vertices, indices).meshlets.empty());
+  indices.resize(indices.size() - 3);
+
+  // Without storage buffers and indirect draws the mesh culls on the CPU:
+  // each placement in a frame gets its own index buffer, nothing is
+  // dispatched and next_frame() moves on to the next slot set, reusing a
+  // set's buffers only once every frame in flight has passed
+  {
+    FakeDevice device;
+    MeshOptions options;
+    options.keep_cpu_data = true;
+    auto mesh = Mesh::create(&device, vertices, indices, options);
+    auto meshlets = MeshletMesh::create(&device, *mesh);
+    assert(meshlets && !meshlets->gpu_culling());
+    assert(meshlets->meshlet_count() == data.meshlets.size());
+
+    const size_t buffers_before = device.buffers.size();
+    const auto first = meshlets->prepare_cull(model, planes_above, above);
+    const auto second = meshlets->prepare_cull(moved, planes_above, above);
+    const auto third = meshlets->prepare_cull(model, planes_below, below);
+    assert(first && second && third);
+    assert(*first == 0 && *second == 1 && *third == 2);
+    assert(meshlets->pending_culls() == 3);
+    assert(device.buffers.size() == buffers_before + 3);
+
+    const MeshletMesh::CullSlot &seen = meshlets->cull_slot(*first);
+    assert(seen.index_count == indices.size());
+    assert(seen.draw_args.id == 0);
+    assert(meshlets->cull_slot(*second).index_count == 0);
+    assert(meshlets->cull_slot(*third).index_count == 0);
+    assert(seen.visible_indices.id !=
+           meshlets->cull_slot(*second).visible_indices.id);
+    assert(meshlets->visible_index_count() == indices.size());
+    assert(meshlets->visible_meshlet_count() == data.meshlets.size());
+    assert(device.cmd.buffer_writes.back().buffer.id == seen.visible_indices.id);
+    assert(device.cmd.buffer_writes.back().size ==
+           indices.size() * sizeof(uint32_t));
+
+    meshlets->record_culls(&device.cmd);
+    assert(device.cmd.dispatches == 0);
+
+    const uint32_t seen_buffer = seen.visible_indices.id;
+    meshlets->next_frame();
+    assert(meshlets->pending_culls() == 0 && meshlets->visible_index_count() == 0);
+    const auto next = meshlets->prepare_cull(model, planes_above, above);
+    assert(next && *next == 0);
+    assert(meshlets->cull_slot(*next).visible_indices.id != seen_buffer);
+    assert(device.buffers.size() == buffers_before + 4);
+
+    for (uint32_t f = 1; f < MeshletMesh::kFramesInFlight; ++f)
+      meshlets->next_frame();
+    const auto again = meshlets->prepare_cull(model, planes_above, above);
+    assert(again && *again == 0);
+    assert(meshlets->cull_slot(*again).visible_indices.id == seen_buffer);
+    assert(device.buffers.size() == buffers_before + 4);
+    (void)seen_buffer;
+    (void)next;
+    (void)first;
+    (void)second;
+    (void)third;
+    (void)again;
+  }
+  return 0;
+}
@@ -0,0 +1,300 @@
+#include "pixel/renderer3d/lod.hpp"
+#include "pixel/renderer3d/picking.hpp"
+#include "pixel/renderer3d/renderer.hpp"
+#include "fake_device.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+using pixel::renderer3d::Camera;
+using pixel::renderer3d::InstanceData;
+using pixel::renderer3d::LODConfig;
+using pixel::renderer3d::LODMesh;
+using pixel::renderer3d::Mesh;
+using pixel::renderer3d::MeshOptions;
+using pixel::renderer3d::PickingScene;
+using pixel::renderer3d::PickID;
+using pixel::renderer3d::TriangleBVH;
+using pixel::renderer3d::Vec3;
+using pixel::renderer3d::Vertex;
+using pixel::test::FakeDevice;
+
+namespace {
+
+bool near(float a, float b, float eps = 1e-3f) { return std::fabs(a - b) < eps; }
+
+glm::vec3 to_glm(const Vec3 &v) { return glm::vec3(v.x, v.y, v.z); }
+
+// True when `v` points the same way as `dir`
+bool same_direction(const glm::vec3 &v, const glm::vec3 &dir) {
+  const glm::vec3 a = glm::normalize(v);
+  const glm::vec3 b = glm::normalize(dir);
+  return glm::length(glm::cross(a, b)) < 1e-3f && glm::dot(a, b) > 0.0f;
+}
+
+// Point at NDC (x, y, z) mapped back to world space through the camera's own
+// view and projection matrices
+glm::vec3 unproject(const Camera &camera, int width, int height, float x,
+                    float y, float z) {
+  float view[16];
+  float proj[16];
+  camera.get_view_matrix(view);
+  camera.get_projection_matrix(proj, width, height);
+  const glm::mat4 inv =
+      glm::inverse(glm::make_mat4(proj) * glm::make_mat4(view));
+  const glm::vec4 p = inv * glm::vec4(x, y, z, 1.0f);
+  return glm::vec3(p) / p.w;
+}
+
+// Unit cube centred on the origin
+void make_cube(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+  for (int i = 0; i < 8; ++i) {
+    Vertex v{};
+    v.position = Vec3((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f,
+                      (i & 4) ? 0.5f : -0.5f);
+    vertices.push_back(v);
+  }
+  indices = {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+             2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+}
+
+// Bumpy XZ grid, enough triangles for a multi-level BVH
+void make_terrain(int size, std::vector<Vertex> &vertices,
+                  std::vector<uint32_t> &indices) {
+  for (int z = 0; z <= size; ++z) {
+    for (int x = 0; x <= size; ++x) {
+      Vertex v{};
+      v.position = Vec3(static_cast<float>(x),
+                        std::sin(x * 0.7f) * std::cos(z * 0.4f) * 2.0f,
+                        static_cast<float>(z));
+      vertices.push_back(v);
+    }
+  }
+  const uint32_t row = static_cast<uint32_t>(size + 1);
+  for (int z = 0; z < size; ++z) {
+    for (int x = 0; x < size; ++x) {
+      const uint32_t i = static_cast<uint32_t>(z) * row + x;
+      indices.insert(indices.end(),
+                     {i, i + row, i + 1, i + 1, i + row, i + row + 1});
+    }
+  }
+}
+
+// Reference: every triangle, double-sided Moller-Trumbore
+bool brute_raycast(const std::vector<Vertex> &vertices,
+                   const std::vector<uint32_t> &indices, const glm::vec3 &o,
+                   const glm::vec3 &d, float max_t, float &best_t) {
+  bool hit = false;
+  best_t = max_t;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    const glm::vec3 v0 = to_glm(vertices[indices[i]].position);
+    const glm::vec3 e1 = to_glm(vertices[indices[i + 1]].position) - v0;
+    const glm::vec3 e2 = to_glm(vertices[indices[i + 2]].position) - v0;
+    const glm::vec3 p = glm::cross(d, e2);
+    const float det = glm::dot(e1, p);
+    if (std::fabs(det) < 1e-8f)
+      continue;
+    const glm::vec3 s = o - v0;
+    const float u = glm::dot(s, p) / det;
+    const glm::vec3 q = glm::cross(s, e1);
+    const float v = glm::dot(d, q) / det;
+    const float t = glm::dot(e2, q) / det;
+    if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t <= best_t) {
+      best_t = t;
+      hit = true;
+    }
+  }
+  return hit;
+}
+
+} // namespace
+
+int main() {
+  // Camera rays pass through the pixel's point on the far plane
+  {
+    Camera camera;
+    camera.position = Vec3(3.0f, 4.0f, 10.0f);
+    camera.target = Vec3(0.0f, 1.0f, 0.0f);
+    const int width = 800;
+    const int height = 600;
+
+    Vec3 origin;
+    Vec3 direction;
+    camera.screen_ray(400.0f, 300.0f, width, height, origin, direction);
+    assert(near(origin.x, 3.0f) && near(origin.y, 4.0f) &&
+           near(origin.z, 10.0f));
+    assert(near(glm::length(to_glm(direction)), 1.0f));
+    assert(same_direction(to_glm(direction),
+                          to_glm(camera.target) - to_glm(camera.position)));
+
+    const float pixels[][2] = {{0.0f, 0.0f}, {800.0f, 600.0f}, {120.0f, 450.0f}};
+    for (const auto &pixel : pixels) {
+      camera.screen_ray(pixel[0], pixel[1], width, height, origin, direction);
+      const float ndc_x = 2.0f * pixel[0] / width - 1.0f;
+      const float ndc_y = 1.0f - 2.0f * pixel[1] / height;
+      const glm::vec3 far_point =
+          unproject(camera, width, height, ndc_x, ndc_y, 1.0f);
+      assert(same_direction(far_point - to_glm(origin), to_glm(direction)));
+    }
+
+    // Orthographic rays are parallel and start level with the pixel
+    camera.mode = Camera::ProjectionMode::Orthographic;
+    camera.ortho_size = 5.0f;
+    const glm::vec3 forward =
+        to_glm(camera.target) - to_glm(camera.position);
+    for (const auto &pixel : pixels) {
+      camera.screen_ray(pixel[0], pixel[1], width, height, origin, direction);
+      assert(same_direction(to_glm(direction), forward));
+      const float ndc_x = 2.0f * pixel[0] / width - 1.0f;
+      const float ndc_y = 1.0f - 2.0f * pixel[1] / height;
+      const glm::vec3 far_point =
+          unproject(camera, width, height, ndc_x, ndc_y, 1.0f);
+      assert(same_direction(far_point - to_glm(origin), forward));
+    }
+  }
+
+  // The triangle BVH finds the same nearest hit as testing every triangle
+  {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    make_terrain(48, vertices, indices);
+    TriangleBVH bvh;
+    bvh.build(vertices, indices);
+    assert(bvh.triangle_count() == indices.size() / 3);
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> coord(-5.0f, 53.0f);
+    int hits = 0;
+    for (int i = 0; i < 500; ++i) {
+      const glm::vec3 o(coord(rng), 10.0f, coord(rng));
+      const glm::vec3 target(coord(rng), -2.0f, coord(rng));
+      const glm::vec3 d = glm::normalize(target - o);
+      float want_t = 0.0f;
+      float got_t = 0.0f;
+      uint32_t triangle = 0;
+      const bool want = brute_raycast(vertices, indices, o, d, 100.0f, want_t);
+      const bool got = bvh.raycast(o, d, 100.0f, got_t, triangle);
+      assert(want == got);
+      if (got) {
+        assert(near(want_t, got_t, 1e-4f));
+        assert(triangle % 3 == 0 && triangle < indices.size());
+        ++hits;
+      }
+    }
+    assert(hits > 100);
+    (void)hits;
+  }
+
+  FakeDevice device;
+  std::vector<Vertex> cube_vertices;
+  std::vector<uint32_t> cube_indices;
+  make_cube(cube_vertices, cube_indices);
+  MeshOptions options;
+  options.keep_cpu_data = true;
+  auto cube = Mesh::create(&device, cube_vertices, cube_indices, options);
+  assert(cube);
+
+  const Vec3 one(1.0f, 1.0f, 1.0f);
+  const Vec3 zero(0.0f, 0.0f, 0.0f);
+  const Vec3 ray_origin(0.0f, 0.0f, 10.0f);
+  const Vec3 ray_dir(0.0f, 0.0f, -2.0f); // need not be normalised
+
+  // Nearest triangle hit wins regardless of registration order
+  PickingScene scene;
+  const PickID far_pick = scene.add(*cube, Vec3(0, 0, -5), zero, one, 2);
+  const PickID near_pick = scene.add(*cube, Vec3(0, 0, 0), zero, one, 1);
+  assert(scene.size() == 2);
+  {
+    auto hit = scene.raycast(ray_origin, ray_dir, 100.0f);
+    assert(hit && hit->id == 1 && hit->pickable == near_pick);
+    assert(!hit->lod_mesh);
+    assert(near(hit->distance, 9.5f) && near(hit->position.z, 0.5f));
+    assert(!scene.raycast(ray_origin, ray_dir, 9.0f));
+
+    // A large cube whose bounding sphere starts first but whose surface is
+    // behind the near cube does not steal the hit
+    const PickID big =
+        scene.add(*cube, Vec3(0, 0, -3), Vec3(0.0f, 0.785398f, 0.0f),
+                  Vec3(6.0f, 6.0f, 4.0f), 3);
+    hit = scene.raycast(ray_origin, ray_dir, 100.0f);
+    assert(hit && hit->id == 1);
+    scene.remove(big);
+
+    // Moving the near cube off the ray exposes the far one
+    scene.update(near_pick, Vec3(5, 0, 0), zero, one);
+    hit = scene.raycast(ray_origin, ray_dir, 100.0f);
+    assert(hit && hit->id == 2 && hit->pickable == far_pick);
+    assert(near(hit->distance, 14.5f));
+
+    // Rotation and scale go through the model matrix
+    scene.update(far_pick, Vec3(0, 0, -5), Vec3(0.0f, 0.785398f, 0.0f),
+                 Vec3(2.0f, 2.0f, 2.0f));
+    hit = scene.raycast(ray_origin, ray_dir, 100.0f);
+    assert(hit && hit->id == 2 && near(hit->distance, 15.0f - std::sqrt(2.0f)));
+
+    scene.remove(far_pick);
+    scene.remove(near_pick);
+    assert(scene.size() == 0 && !scene.raycast(ray_origin, ray_dir, 100.0f));
+  }
+
+  // Instances of a LODMesh are picked through its own spatial index and
+  // reported as (lod_mesh, instance)
+  {
+    LODConfig config;
+    config.spatial.enabled = true;
+    auto lod = LODMesh::create(&device, *cube, *cube, *cube, 16, config);
+    assert(lod);
+
+    std::vector<InstanceData> instances(4);
+    instances[0].position = Vec3(0, 0, -8);
+    instances[1].position = Vec3(0, 0, 2);
+    instances[1].scale = Vec3(2.0f, 2.0f, 2.0f);
+    instances[2].position = Vec3(4, 0, 4); // off the ray
+    instances[3].position = Vec3(0, 0, -2);
+    for (InstanceData &inst : instances)
+      inst.culling_radius = 0.9f;
+    lod->set_instances(std::span<const InstanceData>(instances));
+
+    const PickID set = scene.add_instances(*lod, *cube, 9);
+    assert(set != pixel::renderer3d::INVALID_PICK);
+    auto hit = scene.raycast(ray_origin, ray_dir, 100.0f);
+    assert(hit && hit->id == 9 && hit->pickable == set);
+    assert(hit->lod_mesh == lod.get() && hit->instance == 1);
+    assert(near(hit->distance, 7.0f));
+
+    // update_instance() keeps the index in step
+    InstanceData moved = instances[1];
+    moved.position = Vec3(0, 10, 2);
+    lod->update_instance(1, moved);
+    hit = scene.raycast(ray_origin, ray_dir, 100.0f);
+    assert(hit && hit->instance == 3 && near(hit->distance, 11.5f));
+
+    // Instances and regular pickables compete for the nearest hit
+    const PickID plain = scene.add(*cube, Vec3(0, 0, 0), zero, one, 4);
+    hit = scene.raycast(ray_origin, ray_dir, 100.0f);
+    assert(hit && hit->id == 4 && !hit->lod_mesh);
+    scene.remove(plain);
+
+    scene.remove_instances(set);
+    assert(!scene.raycast(ray_origin, ray_dir, 100.0f));
+
+    // Without a spatial index there is nothing to query
+    auto plain_lod = LODMesh::create(&device, *cube, *cube, *cube, 16);
+    assert(scene.add_instances(*plain_lod, *cube, 10) ==
+           pixel::renderer3d::INVALID_PICK);
+  }
+
+  // Meshes without CPU geometry are refused
+  {
+    auto gpu_only = Mesh::create(&device, cube_vertices, cube_indices);
+    assert(scene.add(*gpu_only, zero, zero, one, 5) ==
+           pixel::renderer3d::INVALID_PICK);
+  }
+
+  return 0;
+}
@@ -0,0 +1,157 @@
+#include "pixel/renderer3d/shader_archive.hpp"
+#include "pixel/renderer3d/shader_reflection.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using pixel::renderer3d::deserialize_reflection;
+using pixel::renderer3d::serialize_reflection;
+using pixel::renderer3d::ShaderArchive;
+using pixel::renderer3d::ShaderArchiveWriter;
+using pixel::renderer3d::ShaderBlock;
+using pixel::renderer3d::ShaderBlockType;
+using pixel::renderer3d::ShaderReflection;
+using pixel::renderer3d::ShaderStage;
+using pixel::renderer3d::ShaderUniform;
+using pixel::renderer3d::ShaderUniformType;
+
+namespace {
+
+std::vector<uint8_t> make_words(uint32_t seed, size_t count) {
+  std::vector<uint8_t> bytes(count * sizeof(uint32_t));
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t word = seed * 2654435761u + static_cast<uint32_t>(i);
+    std::memcpy(bytes.data() + i * sizeof(uint32_t), &word, sizeof(word));
+  }
+  return bytes;
+}
+
+ShaderReflection make_reflection() {
+  ShaderReflection reflection;
+  ShaderUniform sampler;
+  sampler.name = "baseColorTexture";
+  sampler.type = ShaderUniformType::Sampler2D;
+  sampler.binding = 3;
+  sampler.add_stage(ShaderStage::Fragment);
+  reflection.add_uniform(sampler);
+
+  ShaderBlock block;
+  block.type = ShaderBlockType::Uniform;
+  block.block_name = "FrameUniforms";
+  block.instance_name = "frame";
+  block.binding = 0;
+  block.add_stage(ShaderStage::Vertex);
+  block.members.push_back({"viewProj", ShaderUniformType::Mat4, 1});
+  block.members.push_back({"lights", ShaderUniformType::Vec4, 8});
+  reflection.add_block(block);
+  return reflection;
+}
+
+} // namespace
+
+int main() {
+  const auto dir =
+      std::filesystem::temp_directory_path() / "pixel_shader_archive_test";
+  std::filesystem::create_directories(dir);
+
+  // Reflection survives serialization
+  const std::vector<uint8_t> reflection_bytes =
+      serialize_reflection(make_reflection());
+  {
+    const ShaderReflection loaded = deserialize_reflection(reflection_bytes);
+    const ShaderUniform *sampler = loaded.find_uniform("baseColorTexture");
+    assert(sampler && sampler->is_sampler() && sampler->binding == 3u);
+    assert(sampler->uses_stage(ShaderStage::Fragment));
+    assert(!sampler->uses_stage(ShaderStage::Vertex));
+
+    const ShaderBlock *block = loaded.find_block("FrameUniforms");
+    assert(block && block->is_uniform() && block->instance_name == "frame");
+    assert(block->members.size() == 2 && block->members[1].array_size == 8);
+    assert(loaded.binding_for_block("frame") == 0u);
+
+    // Truncated data is rejected instead of read past the end
+    bool threw = false;
+    try {
+      deserialize_reflection(
+          std::span(reflection_bytes).first(reflection_bytes.size() - 3));
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    assert(threw);
+    (void)threw;
+  }
+
+  // Many entries round-trip through the hash table
+  const std::string path = (dir / "shaders.pxsa").string();
+  constexpr uint32_t kEntries = 37;
+  {
+    ShaderArchiveWriter writer;
+    for (uint32_t i = 0; i < kEntries; ++i) {
+      writer.add("assets/shaders/spirv/variant" + std::to_string(i) + ".frag.spv",
+                 make_words(i, 5 + i), i % 2 ? reflection_bytes
+                                              : std::vector<uint8_t>{});
+    }
+    // Re-adding a key replaces the entry
+    writer.add("assets/shaders/spirv/variant0.frag.spv", make_words(100, 3), {});
+    assert(writer.size() == kEntries);
+    assert(writer.write(path));
+  }
+  {
+    auto archive = ShaderArchive::open(path);
+    assert(archive);
+    assert(archive->size() == kEntries);
+    for (uint32_t i = 0; i < kEntries; ++i) {
+      const auto entry = archive->find("assets/shaders/spirv/variant" +
+                                       std::to_string(i) + ".frag.spv");
+      assert(entry);
+      const auto expected = i == 0 ? make_words(100, 3) : make_words(i, 5 + i);
+      assert(entry->bytecode.size() == expected.size());
+      assert(std::memcmp(entry->bytecode.data(), expected.data(),
+                         expected.size()) == 0);
+      assert(reinterpret_cast<uintptr_t>(entry->bytecode.data()) % 4 == 0);
+      assert(entry->reflection.size() == (i % 2 ? reflection_bytes.size() : 0));
+    }
+    assert(!archive->find("assets/shaders/spirv/missing.frag.spv"));
+    assert(!archive->find(""));
+
+    const auto entry = archive->find("assets/shaders/spirv/variant1.frag.spv");
+    assert(deserialize_reflection(entry->reflection).has_sampler(
+        "baseColorTexture"));
+    (void)entry;
+  }
+
+  // An empty archive is valid and finds nothing
+  {
+    const std::string empty = (dir / "empty.pxsa").string();
+    assert(ShaderArchiveWriter().write(empty));
+    auto archive = ShaderArchive::open(empty);
+    assert(archive && archive->size() == 0);
+    assert(!archive->find("anything"));
+  }
+
+  // Corrupt and truncated files are rejected
+  {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    const std::string truncated = (dir / "truncated.pxsa").string();
+    std::ofstream(truncated, std::ios::binary).write(bytes.data(), 200);
+    assert(!ShaderArchive::open(truncated));
+
+    bytes[0] = 'X';
+    const std::string corrupt = (dir / "corrupt.pxsa").string();
+    std::ofstream(corrupt, std::ios::binary)
+        .write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    assert(!ShaderArchive::open(corrupt));
+    assert(!ShaderArchive::open((dir / "absent.pxsa").string()));
+  }
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
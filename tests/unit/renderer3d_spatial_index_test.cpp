@@ -0,0 +1,217 @@
+#include "pixel/renderer3d/spatial_index.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using pixel::renderer3d::FrustumPlanes;
+using pixel::renderer3d::SpatialIndex;
+using pixel::renderer3d::Vec3;
+
+namespace {
+
+struct Sphere {
+  glm::vec3 center{0.0f};
+  float radius = 0.0f;
+  SpatialIndex::ProxyID proxy = SpatialIndex::kInvalidProxy;
+  bool alive = false;
+};
+
+Vec3 to_vec3(const glm::vec3 &v) { return Vec3(v.x, v.y, v.z); }
+
+std::vector<uint32_t> sorted(std::vector<uint32_t> ids) {
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+// Brute-force references, using the same exact sphere tests as the leaves
+
+std::vector<uint32_t> brute_frustum(const std::vector<Sphere> &spheres,
+                                    const FrustumPlanes &planes) {
+  std::vector<uint32_t> out;
+  for (uint32_t i = 0; i < spheres.size(); ++i) {
+    if (!spheres[i].alive)
+      continue;
+    bool inside = true;
+    for (const glm::vec4 &plane : planes) {
+      if (glm::dot(glm::vec3(plane), spheres[i].center) + plane.w <
+          -spheres[i].radius)
+        inside = false;
+    }
+    if (inside)
+      out.push_back(i);
+  }
+  return out;
+}
+
+std::vector<uint32_t> brute_sphere(const std::vector<Sphere> &spheres,
+                                   const glm::vec3 &center, float radius) {
+  std::vector<uint32_t> out;
+  for (uint32_t i = 0; i < spheres.size(); ++i) {
+    const glm::vec3 d = spheres[i].center - center;
+    const float reach = radius + spheres[i].radius;
+    if (spheres[i].alive && glm::dot(d, d) <= reach * reach)
+      out.push_back(i);
+  }
+  return out;
+}
+
+std::vector<uint32_t> brute_aabb(const std::vector<Sphere> &spheres,
+                                 const glm::vec3 &min, const glm::vec3 &max) {
+  std::vector<uint32_t> out;
+  for (uint32_t i = 0; i < spheres.size(); ++i) {
+    const glm::vec3 d =
+        spheres[i].center - glm::clamp(spheres[i].center, min, max);
+    if (spheres[i].alive &&
+        glm::dot(d, d) <= spheres[i].radius * spheres[i].radius)
+      out.push_back(i);
+  }
+  return out;
+}
+
+std::vector<uint32_t> brute_ray(const std::vector<Sphere> &spheres,
+                                const glm::vec3 &origin, const glm::vec3 &dir,
+                                float max_t) {
+  std::vector<uint32_t> out;
+  for (uint32_t i = 0; i < spheres.size(); ++i) {
+    if (!spheres[i].alive)
+      continue;
+    const glm::vec3 oc = origin - spheres[i].center;
+    const float b = glm::dot(oc, dir);
+    const float c = glm::dot(oc, oc) - spheres[i].radius * spheres[i].radius;
+    if (c <= 0.0f) {
+      out.push_back(i);
+      continue;
+    }
+    const float disc = b * b - c;
+    if (b <= 0.0f && disc >= 0.0f && -b - std::sqrt(disc) <= max_t)
+      out.push_back(i);
+  }
+  return out;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> coord(-200.0f, 200.0f);
+  std::uniform_real_distribution<float> size(0.2f, 6.0f);
+  std::uniform_real_distribution<float> step(-2.0f, 2.0f);
+
+  SpatialIndex index(0.5f);
+  assert(index.empty() && index.height() == 0);
+
+  const uint32_t count = 2000;
+  std::vector<Sphere> spheres(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    Sphere &s = spheres[i];
+    s.center = glm::vec3(coord(rng), coord(rng) * 0.25f, coord(rng));
+    s.radius = size(rng);
+    s.proxy = index.insert(to_vec3(s.center), s.radius, i);
+    s.alive = true;
+    assert(index.user_data(s.proxy) == i);
+  }
+  assert(index.size() == count);
+
+  // Small moves stay inside the fat AABB; teleports re-insert the leaf
+  {
+    Sphere &s = spheres[0];
+    assert(!index.move(s.proxy, to_vec3(s.center), s.radius));
+    s.center = s.center + glm::vec3(0.1f, 0.0f, 0.0f);
+    assert(!index.move(s.proxy, to_vec3(s.center), s.radius));
+    s.center = glm::vec3(150.0f, 0.0f, -150.0f);
+    assert(index.move(s.proxy, to_vec3(s.center), s.radius));
+  }
+
+  // Random moves, removals and re-inserts
+  for (int iter = 0; iter < 8000; ++iter) {
+    const uint32_t i = rng() % count;
+    Sphere &s = spheres[i];
+    if (!s.alive) {
+      s.proxy = index.insert(to_vec3(s.center), s.radius, i);
+      s.alive = true;
+    } else if (rng() % 6 == 0) {
+      index.remove(s.proxy);
+      s.proxy = SpatialIndex::kInvalidProxy;
+      s.alive = false;
+    } else {
+      s.center = s.center + glm::vec3(step(rng), step(rng), step(rng));
+      if (rng() % 4 == 0)
+        s.radius = size(rng);
+      index.move(s.proxy, to_vec3(s.center), s.radius);
+    }
+  }
+  const size_t alive = static_cast<size_t>(
+      std::count_if(spheres.begin(), spheres.end(),
+                    [](const Sphere &s) { return s.alive; }));
+  assert(index.size() == alive);
+  // Rotations keep the tree within a small factor of log2(n)
+  assert(index.height() <= 4 * static_cast<int>(std::log2(alive) + 1.0f));
+
+  std::vector<uint32_t> got;
+  for (int q = 0; q < 60; ++q) {
+    const glm::vec3 eye(coord(rng), 20.0f, coord(rng));
+    const glm::vec3 target(coord(rng), 0.0f, coord(rng));
+    const glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+    const glm::mat4 proj =
+        glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 150.0f);
+    const FrustumPlanes planes =
+        pixel::renderer3d::extract_frustum_planes(proj * view);
+    got.clear();
+    index.query_frustum(planes, got);
+    assert(sorted(got) == brute_frustum(spheres, planes));
+
+    const glm::vec3 center(coord(rng), coord(rng) * 0.25f, coord(rng));
+    const float radius = 1.0f + static_cast<float>(rng() % 40);
+    got.clear();
+    index.query_sphere(to_vec3(center), radius, got);
+    assert(sorted(got) == brute_sphere(spheres, center, radius));
+
+    const glm::vec3 extent(radius, radius * 0.5f, radius * 2.0f);
+    got.clear();
+    index.query_aabb(to_vec3(center - extent), to_vec3(center + extent), got);
+    assert(sorted(got) == brute_aabb(spheres, center - extent, center + extent));
+
+    const glm::vec3 dir = glm::normalize(target - eye);
+    const float max_t = 50.0f + static_cast<float>(rng() % 300);
+    std::vector<SpatialIndex::RayHit> hits;
+    index.query_ray(to_vec3(eye), to_vec3(dir * 3.0f), max_t, hits);
+    got.clear();
+    for (size_t h = 0; h < hits.size(); ++h) {
+      got.push_back(hits[h].user_data);
+      // Nearest first, within range
+      assert(hits[h].t >= 0.0f && hits[h].t <= max_t);
+      assert(h == 0 || hits[h - 1].t <= hits[h].t);
+    }
+    assert(sorted(got) == brute_ray(spheres, eye, dir, max_t));
+  }
+
+  // Queries append to what the caller already has
+  got.assign(1, 0xABCDu);
+  index.query_sphere(to_vec3(spheres[1].center), 0.0f, got);
+  assert(got.size() >= 1 && got[0] == 0xABCDu);
+
+  // Removing everything empties the tree; it stays usable afterwards
+  for (Sphere &s : spheres) {
+    if (s.alive)
+      index.remove(s.proxy);
+    s.alive = false;
+  }
+  assert(index.empty() && index.height() == 0);
+  got.clear();
+  index.query_sphere(Vec3(0.0f, 0.0f, 0.0f), 1000.0f, got);
+  assert(got.empty());
+
+  const SpatialIndex::ProxyID reused =
+      index.insert(Vec3(1.0f, 2.0f, 3.0f), 1.0f, 42u);
+  assert(index.size() == 1 && index.user_data(reused) == 42u);
+  index.clear();
+  assert(index.empty());
+
+  (void)alive;
+  (void)reused;
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include "pixel/renderer3d/shader_reflection.hpp"
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using pixel::renderer3d::deserialize_reflection;
+using pixel::renderer3d::reflect_specialization_constants;
+using pixel::renderer3d::serialize_reflection;
+using pixel::renderer3d::ShaderReflection;
+using pixel::renderer3d::ShaderSpecializationConstant;
+using pixel::renderer3d::ShaderStage;
+using pixel::renderer3d::ShaderUniformType;
+
+namespace {
+
+// Minimal hand-assembled module; only the instructions the scanner reads
+class SpirvBuilder {
+public:
+  SpirvBuilder() { words_ = {0x07230203u, 0x00010000u, 0u, 100u, 0u}; }
+
+  void op(uint32_t opcode, std::vector<uint32_t> operands) {
+    words_.push_back(static_cast<uint32_t>(operands.size() + 1) << 16 | opcode);
+    words_.insert(words_.end(), operands.begin(), operands.end());
+  }
+
+  void name(uint32_t id, const std::string &text) {
+    std::vector<uint32_t> operands{id};
+    std::vector<uint32_t> packed((text.size() + 4) / 4, 0u);
+    std::memcpy(packed.data(), text.data(), text.size());
+    operands.insert(operands.end(), packed.begin(), packed.end());
+    op(5, operands);
+  }
+
+  const std::vector<uint32_t> &words() const { return words_; }
+
+private:
+  std::vector<uint32_t> words_;
+};
+
+// layout(constant_id = 3) const bool USE_DITHER = true;
+// layout(constant_id = 7) const int LIGHT_COUNT = -2;
+// layout(constant_id = 9) const float FADE = 0.5;
+// plus one ordinary OpSpecConstant without a SpecId
+std::vector<uint32_t> make_module() {
+  SpirvBuilder spirv;
+  spirv.name(10, "USE_DITHER");
+  spirv.name(11, "LIGHT_COUNT");
+  spirv.op(71, {10, 1, 3});
+  spirv.op(71, {11, 1, 7});
+  spirv.op(71, {12, 1, 9});
+  spirv.op(71, {11, 30, 0}); // unrelated decoration (Location)
+  spirv.op(20, {1});         // OpTypeBool %1
+  spirv.op(21, {2, 32, 1});  // OpTypeInt %2 32 signed
+  spirv.op(22, {4, 32});     // OpTypeFloat %4 32
+  spirv.op(48, {1, 10});     // OpSpecConstantTrue
+  spirv.op(50, {2, 11, static_cast<uint32_t>(-2)});
+  spirv.op(50, {4, 12, std::bit_cast<uint32_t>(0.5f)});
+  spirv.op(50, {2, 13, 5});
+  return spirv.words();
+}
+
+} // namespace
+
+int main() {
+  const std::vector<uint32_t> module = make_module();
+
+  // Constants with their ids, types and defaults
+  {
+    const auto constants =
+        reflect_specialization_constants(module, ShaderStage::Fragment);
+    assert(constants.size() == 3);
+
+    assert(constants[0].name == "USE_DITHER");
+    assert(constants[0].constant_id == 3);
+    assert(constants[0].type == ShaderUniformType::Bool);
+    assert(constants[0].default_value == 1);
+    assert(constants[0].uses_stage(ShaderStage::Fragment));
+    assert(!constants[0].uses_stage(ShaderStage::Vertex));
+
+    assert(constants[1].name == "LIGHT_COUNT");
+    assert(constants[1].type == ShaderUniformType::Int);
+    assert(static_cast<int32_t>(constants[1].default_value) == -2);
+
+    // Unnamed constants fall back to their id
+    assert(constants[2].name == "constant_9");
+    assert(constants[2].type == ShaderUniformType::Float);
+    assert(std::bit_cast<float>(constants[2].default_value) == 0.5f);
+    (void)constants;
+  }
+
+  // Malformed modules are rejected
+  {
+    bool threw = false;
+    try {
+      reflect_specialization_constants(std::vector<uint32_t>{1, 2, 3},
+                                       ShaderStage::Vertex);
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    assert(threw);
+
+    std::vector<uint32_t> truncated = module;
+    truncated.pop_back();
+    threw = false;
+    try {
+      reflect_specialization_constants(truncated, ShaderStage::Vertex);
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    assert(threw);
+    (void)threw;
+  }
+
+  // Stages merge into one constant and survive serialization
+  {
+    ShaderReflection reflection;
+    for (auto &constant :
+         reflect_specialization_constants(module, ShaderStage::Vertex)) {
+      reflection.add_specialization_constant(constant);
+    }
+    ShaderReflection fragment;
+    for (auto &constant :
+         reflect_specialization_constants(module, ShaderStage::Fragment)) {
+      fragment.add_specialization_constant(constant);
+    }
+    reflection.merge(fragment);
+    assert(reflection.specialization_constants().size() == 3);
+
+    const ShaderReflection loaded =
+        deserialize_reflection(serialize_reflection(reflection));
+    const ShaderSpecializationConstant *dither =
+        loaded.find_specialization_constant("USE_DITHER");
+    assert(dither && dither->constant_id == 3);
+    assert(dither->uses_stage(ShaderStage::Vertex) &&
+           dither->uses_stage(ShaderStage::Fragment));
+    assert(loaded.find_specialization_constant("LIGHT_COUNT")->type ==
+           ShaderUniformType::Int);
+    assert(!loaded.find_specialization_constant("missing"));
+    (void)dither;
+  }
+
+  return 0;
+}
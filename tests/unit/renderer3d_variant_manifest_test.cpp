@@ -0,0 +1,117 @@
+#include "pixel/renderer3d/shader_variant_manifest.hpp"
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using pixel::renderer3d::Material;
+using pixel::renderer3d::ShaderVariantKey;
+using pixel::renderer3d::ShaderVariantManifest;
+
+namespace {
+
+ShaderVariantManifest::Entry make_entry(Material::BlendMode mode) {
+  ShaderVariantManifest::Entry entry;
+  entry.vert_path = "assets/shaders/default.vert";
+  entry.frag_path = "assets/shaders/default.frag";
+  entry.variant = ShaderVariantKey::from_defines(
+      {{"USE_FOG", "1"}, {"PIXEL_COMPRESSED_VERTEX", "1"}});
+  entry.module_variant =
+      ShaderVariantKey::from_defines({{"PIXEL_COMPRESSED_VERTEX", "1"}});
+  entry.blend_mode = mode;
+  return entry;
+}
+
+} // namespace
+
+int main() {
+  const auto dir =
+      std::filesystem::temp_directory_path() / "pixel_variant_manifest_test";
+  std::filesystem::create_directories(dir);
+
+  // Defines use the PIXEL_SHADER_VARIANTS syntax, sorted like cache keys
+  {
+    const ShaderVariantKey variant =
+        ShaderVariantKey::from_defines({{"B", "2"}, {"A", "x"}});
+    assert(ShaderVariantManifest::format_defines(variant) == "A=x,B=2");
+    assert(ShaderVariantManifest::format_defines(ShaderVariantKey{}).empty());
+
+    const auto parsed = ShaderVariantManifest::parse_defines("B=2,A=x");
+    assert(parsed && parsed->cache_key() == variant.cache_key());
+    // A bare name means NAME=1
+    assert(ShaderVariantManifest::parse_defines("FOG")->cache_key() ==
+           ShaderVariantKey::from_defines({{"FOG", "1"}}).cache_key());
+    assert(ShaderVariantManifest::parse_defines("")->empty());
+    assert(!ShaderVariantManifest::parse_defines("A=1=2"));
+    assert(!ShaderVariantManifest::parse_defines("A=,B=1"));
+    (void)parsed;
+  }
+
+  // Identical records are kept once; each blend mode is its own record
+  const std::string path = (dir / "variants.manifest").string();
+  {
+    ShaderVariantManifest manifest;
+    assert(manifest.add(make_entry(Material::BlendMode::Alpha)));
+    assert(!manifest.add(make_entry(Material::BlendMode::Alpha)));
+    assert(manifest.add(make_entry(Material::BlendMode::Opaque)));
+
+    auto default_entry = make_entry(Material::BlendMode::Alpha);
+    default_entry.variant = ShaderVariantKey{};
+    default_entry.module_variant = ShaderVariantKey{};
+    assert(manifest.add(default_entry));
+
+    // Defines the SPIR-V build cannot reproduce are not recorded
+    auto empty_value = make_entry(Material::BlendMode::Alpha);
+    empty_value.variant.set_define("FLAG", "");
+    assert(!manifest.add(empty_value));
+    auto comma = make_entry(Material::BlendMode::Alpha);
+    comma.variant.set_define("LIST", "1,2");
+    assert(!manifest.add(comma));
+
+    assert(manifest.size() == 3);
+    assert(manifest.save(path));
+  }
+
+  // Records survive a round trip, empty define fields included
+  {
+    const auto loaded = ShaderVariantManifest::load(path);
+    assert(loaded && loaded->size() == 3);
+    const auto &entries = loaded->entries();
+    assert(entries[0].vert_path == "assets/shaders/default.vert");
+    assert(entries[0].frag_path == "assets/shaders/default.frag");
+    assert(entries[0].blend_mode == Material::BlendMode::Alpha);
+    assert(entries[0].color_format == pixel::rhi::Format::BGRA8);
+    assert(entries[0].variant.cache_key() ==
+           make_entry(Material::BlendMode::Alpha).variant.cache_key());
+    assert(entries[0].module_variant.has_define("PIXEL_COMPRESSED_VERTEX"));
+    assert(!entries[0].module_variant.has_define("USE_FOG"));
+    assert(entries[1].blend_mode == Material::BlendMode::Opaque);
+    assert(entries[2].variant.empty() && entries[2].module_variant.empty());
+
+    // Merging skips what is already present
+    ShaderVariantManifest merged = *loaded;
+    merged.merge(*loaded);
+    ShaderVariantManifest extra;
+    assert(extra.add(make_entry(Material::BlendMode::Additive)));
+    merged.merge(extra);
+    assert(merged.size() == 4);
+    (void)entries;
+  }
+
+  // Malformed files are rejected
+  {
+    const std::string bad = (dir / "bad.manifest").string();
+    std::ofstream(bad) << "variant\ta.vert\ta.frag\tAlpha\tBGRA8\t\n";
+    assert(!ShaderVariantManifest::load(bad));
+    std::ofstream(bad) << "variant\ta.vert\ta.frag\tGlow\tBGRA8\t\t\n";
+    assert(!ShaderVariantManifest::load(bad));
+    std::ofstream(bad) << "# comment only\n\n";
+    const auto empty = ShaderVariantManifest::load(bad);
+    assert(empty && empty->empty());
+    assert(!ShaderVariantManifest::load((dir / "absent.manifest").string()));
+    (void)empty;
+  }
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
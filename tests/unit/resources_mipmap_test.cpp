@@ -0,0 +1,101 @@
+#include "pixel/resources/mipmap.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using pixel::resources::MipChain;
+using pixel::resources::MipmapOptions;
+
+namespace {
+
+float coverage(const MipChain &chain, size_t level, float cutoff) {
+  const auto &info = chain.levels[level];
+  const uint8_t *texels = chain.data.data() + info.offset;
+  size_t passing = 0;
+  const size_t count = size_t(info.width) * info.height;
+  for (size_t i = 0; i < count; ++i) {
+    if (texels[i * 4 + 3] / 255.0f > cutoff)
+      ++passing;
+  }
+  return static_cast<float>(passing) / static_cast<float>(count);
+}
+
+} // namespace
+
+int main() {
+  // Chain layout follows the GPU rule and packs levels back to back
+  assert(pixel::resources::mip_level_count(256, 64) == 9);
+  assert(pixel::resources::mip_level_count(1, 1) == 1);
+  assert(pixel::resources::mip_level_count(5, 3) == 3);
+
+  // Black/white checkerboard: the sRGB average of 0 and 255 is ~188, the
+  // naive average 128
+  const uint32_t size = 64;
+  std::vector<uint8_t> checker(size * size * 4);
+  for (uint32_t y = 0; y < size; ++y) {
+    for (uint32_t x = 0; x < size; ++x) {
+      uint8_t *texel = &checker[(y * size + x) * 4];
+      const uint8_t value = ((x + y) & 1) ? 255 : 0;
+      texel[0] = texel[1] = texel[2] = value;
+      texel[3] = 255;
+    }
+  }
+
+  const MipChain srgb_chain =
+      pixel::resources::generate_mipmaps(checker.data(), size, size);
+  assert(srgb_chain.levels.size() == 7);
+  size_t offset = 0;
+  for (size_t level = 0; level < srgb_chain.levels.size(); ++level) {
+    const auto &info = srgb_chain.levels[level];
+    assert(info.width == (size >> level) && info.height == (size >> level));
+    assert(info.offset == offset && info.size == info.width * info.height * 4);
+    offset += info.size;
+  }
+  assert(srgb_chain.data.size() == offset);
+  assert(srgb_chain.level_data(0)[0] == std::byte{0});
+  for (size_t level = 1; level < srgb_chain.levels.size(); ++level) {
+    const uint8_t *texel = srgb_chain.data.data() + srgb_chain.levels[level].offset;
+    assert(texel[0] == 188 && texel[3] == 255);
+  }
+
+  MipmapOptions linear;
+  linear.srgb = false;
+  linear.max_levels = 3;
+  const MipChain linear_chain =
+      pixel::resources::generate_mipmaps(checker.data(), size, size, linear);
+  assert(linear_chain.levels.size() == 3);
+  assert(linear_chain.data[linear_chain.levels[2].offset] == 128);
+
+  // Non-square, odd sizes bottom out at 1 on each axis independently
+  const MipChain odd =
+      pixel::resources::generate_mipmaps(checker.data(), 5, 3);
+  assert(odd.levels.size() == 3);
+  assert(odd.levels[1].width == 2 && odd.levels[1].height == 1);
+  assert(odd.levels[2].width == 1 && odd.levels[2].height == 1);
+
+  // Sparse cutout, ~30% of texels opaque at random. Plain averaging thins it
+  // out at distance; coverage preservation keeps each level near level 0
+  std::vector<uint8_t> cutout(size * size * 4, 255);
+  uint32_t seed = 12345;
+  for (size_t i = 0; i < size * size; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    cutout[i * 4 + 3] = (seed >> 16) % 10 < 3 ? 255 : 0;
+  }
+  MipmapOptions preserve;
+  preserve.alpha_cutoff = 0.5f;
+  const MipChain thin =
+      pixel::resources::generate_mipmaps(cutout.data(), size, size);
+  const MipChain kept =
+      pixel::resources::generate_mipmaps(cutout.data(), size, size, preserve);
+  const float base = coverage(kept, 0, 0.5f);
+  assert(base > 0.2f && base < 0.4f);
+  for (size_t level = 2; level <= 4; ++level)
+    assert(coverage(thin, level, 0.5f) < base * 0.5f);
+  for (size_t level = 1; level <= 4; ++level)
+    assert(std::abs(coverage(kept, level, 0.5f) - base) < 0.05f);
+
+  assert(pixel::resources::generate_mipmaps(nullptr, 4, 4).levels.empty());
+  assert(pixel::resources::generate_mipmaps(checker.data(), 0, 4).levels.empty());
+  return 0;
+}
@@ -0,0 +1,164 @@
+#include "pixel/resources/texture_loader.hpp"
+#include "pixel/rhi/rhi.hpp"
+#include "fake_device.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace pixel::rhi;
+using pixel::resources::MipmapOptions;
+using pixel::resources::TextureLoader;
+using pixel::resources::TextureRef;
+using pixel::test::FakeDevice;
+
+namespace {
+
+// Uncompressed 4x4 RGBA DDS whose pixels are all `fill`
+void write_dds(const std::filesystem::path &path, uint8_t fill) {
+  std::vector<uint8_t> out(128 + 64, fill);
+  auto put = [&](size_t offset, uint32_t value) {
+    std::memcpy(out.data() + offset, &value, 4);
+  };
+  std::memset(out.data(), 0, 128);
+  std::memcpy(out.data(), "DDS ", 4);
+  put(4, 124);
+  put(8, 0x1007);
+  put(12, 4);
+  put(16, 4);
+  put(28, 1);
+  put(76, 32);
+  put(80, 0x41);
+  put(88, 32);
+  put(92, 0x000000FF);
+  put(96, 0x0000FF00);
+  put(100, 0x00FF0000);
+  put(104, 0xFF000000);
+  put(108, 0x1000);
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      .write(reinterpret_cast<const char *>(out.data()),
+             static_cast<std::streamsize>(out.size()));
+}
+
+// Advances the loader's release clock by `count` frames
+// 2x2 binary PPM of black and white columns
+void write_ppm(const std::filesystem::path &path) {
+  const uint8_t pixels[] = {0, 0, 0, 255, 255, 255, 0, 0, 0, 255, 255, 255};
+  std::ofstream file(path, std::ios::binary);
+  file << "P6\n2 2\n255\n";
+  file.write(reinterpret_cast<const char *>(pixels), sizeof(pixels));
+}
+
+void run_frames(TextureLoader &loader, int count) {
+  for (int i = 0; i < count; ++i)
+    loader.process_releases();
+}
+
+} // namespace
+
+int main() {
+  const auto dir =
+      std::filesystem::temp_directory_path() / "pixel_texture_cache_test";
+  std::filesystem::create_directories(dir / "sub");
+  std::filesystem::current_path(dir);
+  write_dds(dir / "a.dds", 10);
+  write_dds(dir / "copy_of_a.dds", 10);
+  write_dds(dir / "b.dds", 20);
+  write_ppm(dir / "normal.ppm");
+  write_ppm(dir / "copy_of_normal.ppm");
+
+  // Spellings of one file share a cache key
+  const std::string key = TextureLoader::canonical_path("a.dds");
+  assert(std::filesystem::path(key).is_absolute());
+  assert(TextureLoader::canonical_path("./a.dds") == key);
+  assert(TextureLoader::canonical_path("sub/../a.dds") == key);
+  assert(TextureLoader::canonical_path((dir / "a.dds").string()) == key);
+
+  FakeDevice device;
+  TextureRef survivor;
+  {
+    TextureLoader::Settings settings;
+    settings.release_delay_frames = 2;
+    TextureLoader loader(&device, settings);
+
+    const TextureHandle a = loader.load("a.dds");
+    assert(a.id != 0);
+    assert(loader.load("./a.dds").id == a.id);
+    assert(loader.cache_stats().misses == 1);
+    assert(loader.cache_stats().hits == 1);
+
+    // Identical bytes under another name reuse the texture
+    assert(loader.load("copy_of_a.dds").id == a.id);
+    assert(loader.cache_stats().content_dedupes == 1);
+    assert(loader.cache_stats().textures == 1);
+    assert(loader.cache_stats().bytes == 64);
+
+    // Counted references: copies share one reference, and the texture
+    // is destroyed release_delay_frames after the last one goes
+    TextureRef b = loader.acquire("b.dds");
+    assert(b && b.texture().id != a.id);
+    TextureRef b_copy = b;
+    b.reset();
+    run_frames(loader, 4);
+    assert(device.live.count(b_copy.texture().id) == 1);
+    const uint32_t b_id = b_copy.texture().id;
+    b_copy.reset();
+    loader.process_releases();
+    assert(device.live.count(b_id) == 1);
+    assert(loader.cache_stats().pending_releases == 1);
+    run_frames(loader, 2);
+    assert(device.live.count(b_id) == 0);
+    assert(loader.cache_stats().released == 1);
+
+    // Loading it again is a miss that creates a new texture
+    TextureRef again = loader.acquire("b.dds");
+    assert(again.texture().id != b_id);
+
+    // Re-acquiring before the delay expires cancels the release
+    const uint32_t again_id = again.texture().id;
+    again.reset();
+    loader.process_releases();
+    TextureRef revived = loader.acquire("./b.dds");
+    assert(revived.texture().id == again_id);
+    run_frames(loader, 4);
+    assert(device.live.count(again_id) == 1);
+
+    // clear_cache() unpins load() textures; held references survive
+    loader.clear_cache();
+    run_frames(loader, 3);
+    assert(device.live.count(a.id) == 0);
+    assert(device.live.count(again_id) == 1);
+    assert(loader.cache_stats().textures == 1);
+
+    // Per-load mip options build their own chain and cache entry, and only
+    // dedupe against images built the same way
+    MipmapOptions linear;
+    linear.srgb = false;
+    const TextureHandle color = loader.load("normal.ppm");
+    const TextureHandle data = loader.load("normal.ppm", linear);
+    assert(color.id != 0 && data.id != 0 && data.id != color.id);
+    assert(loader.load("./normal.ppm", linear).id == data.id);
+    assert(loader.load("copy_of_normal.ppm", linear).id == data.id);
+    assert(loader.load("copy_of_normal.ppm").id == color.id);
+    // Containers carry their own mips, so the options do not split them
+    assert(loader.load("a.dds", linear).id == loader.load("a.dds").id);
+
+    // With content hashing off, a copy is a separate texture
+    TextureLoader::Settings no_dedupe;
+    no_dedupe.dedupe_by_content = false;
+    TextureLoader plain(&device, no_dedupe);
+    assert(plain.load("a.dds").id != plain.load("copy_of_a.dds").id);
+
+    // References may outlive their loader
+    survivor = plain.acquire("b.dds");
+    assert(survivor);
+  }
+  survivor.reset();
+
+  std::filesystem::current_path(std::filesystem::temp_directory_path());
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include "pixel/resources/texture_container.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using pixel::resources::TextureContainer;
+namespace rhi = pixel::rhi;
+
+namespace {
+
+template <typename T> void put(std::vector<uint8_t> &out, size_t offset, T value) {
+  if (out.size() < offset + sizeof(T))
+    out.resize(offset + sizeof(T));
+  std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+void write_file(const std::string &path, const std::vector<uint8_t> &bytes) {
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      .write(reinterpret_cast<const char *>(bytes.data()),
+             static_cast<std::streamsize>(bytes.size()));
+}
+
+// 8x8 BC1 KTX2 with a full 4-level chain, stored smallest level first as
+// the spec recommends
+std::vector<uint8_t> make_ktx2() {
+  const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2',
+                                  '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+  std::vector<uint8_t> out(identifier, identifier + 12);
+  put<uint32_t>(out, 12, 133); // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+  put<uint32_t>(out, 16, 1);
+  put<uint32_t>(out, 20, 8);
+  put<uint32_t>(out, 24, 8);
+  put<uint32_t>(out, 28, 0);
+  put<uint32_t>(out, 32, 0);
+  put<uint32_t>(out, 36, 1);
+  put<uint32_t>(out, 40, 4);
+  put<uint32_t>(out, 44, 0);
+  put<uint64_t>(out, 72, 0); // end of index block
+
+  const size_t sizes[4] = {32, 8, 8, 8};
+  size_t offset = 80 + 4 * 24;
+  for (int level = 3; level >= 0; --level) {
+    put<uint64_t>(out, 80 + level * 24, offset);
+    put<uint64_t>(out, 80 + level * 24 + 8, sizes[level]);
+    put<uint64_t>(out, 80 + level * 24 + 16, sizes[level]);
+    for (size_t i = 0; i < sizes[level]; ++i)
+      put<uint8_t>(out, offset + i, static_cast<uint8_t>(level * 16 + i));
+    offset += sizes[level];
+  }
+  return out;
+}
+
+// Legacy DDS header; fourcc == 0 means 32-bit RGBA masks
+std::vector<uint8_t> make_dds(uint32_t width, uint32_t height, uint32_t mips,
+                              uint32_t fourcc, size_t payload) {
+  std::vector<uint8_t> out = {'D', 'D', 'S', ' '};
+  put<uint32_t>(out, 4, 124);
+  put<uint32_t>(out, 8, 0x1007 | 0x20000);
+  put<uint32_t>(out, 12, height);
+  put<uint32_t>(out, 16, width);
+  put<uint32_t>(out, 28, mips);
+  put<uint32_t>(out, 76, 32);
+  if (fourcc) {
+    put<uint32_t>(out, 80, 0x4);
+    put<uint32_t>(out, 84, fourcc);
+  } else {
+    put<uint32_t>(out, 80, 0x41);
+    put<uint32_t>(out, 88, 32);
+    put<uint32_t>(out, 92, 0x000000FF);
+    put<uint32_t>(out, 96, 0x0000FF00);
+    put<uint32_t>(out, 100, 0x00FF0000);
+    put<uint32_t>(out, 104, 0xFF000000);
+  }
+  put<uint32_t>(out, 108, 0x1000);
+  for (size_t i = 0; i < payload; ++i)
+    put<uint8_t>(out, 128 + i, static_cast<uint8_t>(i));
+  return out;
+}
+
+} // namespace
+
+int main() {
+  assert(TextureContainer::is_container_path("a/b/rock.KTX2"));
+  assert(TextureContainer::is_container_path("ui.dds"));
+  assert(!TextureContainer::is_container_path("ui.png"));
+  assert(!TextureContainer::is_container_path("dds"));
+
+  const auto dir = std::filesystem::temp_directory_path();
+  const std::string ktx2_path = (dir / "pixel_container_test.ktx2").string();
+  const std::string dds_path = (dir / "pixel_container_test.dds").string();
+
+  const auto ktx2 = make_ktx2();
+  write_file(ktx2_path, ktx2);
+  {
+    auto container = TextureContainer::open(ktx2_path);
+    assert(container);
+    assert(container->kind() == TextureContainer::Kind::KTX2);
+    assert(container->format() == rhi::Format::BC1);
+    assert(container->width() == 8 && container->height() == 8);
+    assert(container->level_count() == 4);
+    assert(container->level_data(0).size() == 32);
+    assert(container->level_data(3).size() == 8);
+    assert(container->payload_bytes() == 56);
+    for (uint32_t level = 0; level < 4; ++level)
+      assert(container->level_data(level)[1] ==
+             std::byte(static_cast<uint8_t>(level * 16 + 1)));
+  }
+
+  // Supercompressed and truncated KTX2 files are rejected
+  auto broken = ktx2;
+  put<uint32_t>(broken, 44, 2);
+  write_file(ktx2_path, broken);
+  assert(!TextureContainer::open(ktx2_path));
+  broken = ktx2;
+  broken.resize(broken.size() - 1);
+  write_file(ktx2_path, broken);
+  assert(!TextureContainer::open(ktx2_path));
+
+  // DXT5 with a partial chain; 5x3 rounds up to 2x1 blocks
+  write_file(dds_path, make_dds(5, 3, 2, 0x35545844 /* DXT5 */, 32 + 16));
+  {
+    auto container = TextureContainer::open(dds_path);
+    assert(container);
+    assert(container->kind() == TextureContainer::Kind::DDS);
+    assert(container->format() == rhi::Format::BC3);
+    assert(container->level_count() == 2);
+    assert(container->level_data(0).size() == 32);
+    assert(container->level_data(1).size() == 16);
+    assert(container->level_data(1)[0] == std::byte{32});
+  }
+
+  // Uncompressed RGBA masks
+  write_file(dds_path, make_dds(4, 4, 1, 0, 64));
+  {
+    auto container = TextureContainer::open(dds_path);
+    assert(container && container->format() == rhi::Format::RGBA8);
+    assert(container->level_data(0).size() == 64);
+  }
+
+  // More mips than the size allows, or missing payload
+  write_file(dds_path, make_dds(4, 4, 4, 0, 64 + 16 + 4 + 4));
+  assert(!TextureContainer::open(dds_path));
+  write_file(dds_path, make_dds(4, 4, 1, 0, 60));
+  assert(!TextureContainer::open(dds_path));
+
+  std::remove(ktx2_path.c_str());
+  std::remove(dds_path.c_str());
+  return 0;
+}
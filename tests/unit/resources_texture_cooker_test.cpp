@@ -0,0 +1,229 @@
+#include "pixel/resources/texture_container.hpp"
+#include "pixel/resources/texture_cooker.hpp"
+#include "pixel/resources/texture_loader.hpp"
+#include "pixel/rhi/rhi.hpp"
+#include "fake_device.hpp"
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace pixel::rhi;
+using namespace pixel::resources;
+using pixel::test::FakeDevice;
+
+namespace {
+
+std::vector<uint8_t> solid(uint32_t width, uint32_t height, uint8_t r,
+                           uint8_t g, uint8_t b, uint8_t a) {
+  std::vector<uint8_t> pixels(size_t(width) * height * 4);
+  for (size_t i = 0; i < pixels.size(); i += 4) {
+    pixels[i] = r;
+    pixels[i + 1] = g;
+    pixels[i + 2] = b;
+    pixels[i + 3] = a;
+  }
+  return pixels;
+}
+
+} // namespace
+
+int main() {
+  const auto dir =
+      std::filesystem::temp_directory_path() / "pixel_texture_cooker_test";
+  std::filesystem::create_directories(dir);
+
+  // Premultiplied level 0 scales colour by alpha
+  {
+    const auto pixels = solid(2, 2, 255, 0, 0, 128);
+    MipmapOptions options;
+    options.premultiply_alpha = true;
+    const MipChain chain = generate_mipmaps(pixels.data(), 2, 2, options);
+    assert(chain.data[0] == 128 && chain.data[3] == 128);
+  }
+
+  // Transparent texels do not bleed their colour into coarser levels
+  {
+    const uint8_t pixels[] = {0, 0, 255, 255, 255, 0, 0, 0,
+                              255, 0, 0, 0, 0, 0, 255, 255};
+    MipmapOptions options;
+    options.premultiply_alpha = true;
+    const MipChain premultiplied = generate_mipmaps(pixels, 2, 2, options);
+    const uint8_t *level1 =
+        premultiplied.data.data() + premultiplied.levels[1].offset;
+    assert(level1[0] == 0 && level1[2] == 128 && level1[3] == 128);
+
+    const MipChain straight = generate_mipmaps(pixels, 2, 2);
+    assert(straight.data[straight.levels[1].offset] > 0);
+  }
+
+  // Block compression picks BC1 for opaque images and BC3 otherwise
+  {
+    CookOptions options;
+    options.block_compress = true;
+    const auto opaque = solid(8, 8, 10, 20, 30, 255);
+    const CookedTexture bc1 = cook_texture(opaque.data(), 8, 8, options);
+    assert(bc1.format == Format::BC1);
+    assert(bc1.levels.size() == 4);
+    assert(bc1.levels[0].size() == 2 * 2 * 8);
+    assert(bc1.levels[3].size() == 8);
+
+    const auto translucent = solid(8, 8, 10, 20, 30, 200);
+    assert(cook_texture(translucent.data(), 8, 8, options).format ==
+           Format::BC3);
+
+    // Partial edge blocks still produce whole blocks
+    assert(compress_bc(opaque.data(), 5, 3, Format::BC1).size() == 2 * 8);
+    assert(compress_bc(opaque.data(), 4, 4, Format::BC7).empty());
+  }
+
+  // KTX2 blobs round-trip through TextureContainer
+  for (const bool compress : {false, true}) {
+    CookOptions options;
+    options.block_compress = compress;
+    options.mipmaps.premultiply_alpha = true;
+    const auto pixels = solid(16, 8, 200, 100, 50, 255);
+    const CookedTexture cooked = cook_texture(pixels.data(), 16, 8, options);
+    const std::string path = (dir / "roundtrip.ktx2").string();
+    assert(write_ktx2(path, cooked));
+
+    auto container = TextureContainer::open(path);
+    assert(container);
+    assert(container->kind() == TextureContainer::Kind::KTX2);
+    assert(container->format() == cooked.format);
+    assert(container->width() == 16 && container->height() == 8);
+    assert(container->premultiplied_alpha());
+    assert(container->level_count() == cooked.levels.size());
+    for (uint32_t level = 0; level < container->level_count(); ++level) {
+      const auto data = container->level_data(level);
+      assert(data.size() == cooked.levels[level].size());
+      assert(std::memcmp(data.data(), cooked.levels[level].data(),
+                         data.size()) == 0);
+    }
+  }
+  assert(cooked_texture_path("textures/rock.png") == "textures/rock.png.ktx2");
+  assert(cooked_texture_path("textures/rock.jpg") !=
+         cooked_texture_path("textures/rock.png"));
+
+  // Atlas packing with extruded padding
+  {
+    const auto a = solid(10, 10, 1, 0, 0, 255);
+    const auto b = solid(20, 5, 2, 0, 0, 255);
+    const auto c = solid(7, 7, 3, 0, 0, 255);
+    const AtlasImage images[] = {{"ui/a", 10, 10, a.data()},
+                                 {"ui/b", 20, 5, b.data()},
+                                 {"ui/c", 7, 7, c.data()}};
+    const auto atlas = pack_atlas(images, 2);
+    assert(atlas);
+    assert((atlas->width & (atlas->width - 1)) == 0);
+    assert(atlas->height % 4 == 0);
+    assert(atlas->rects.size() == 3 && atlas->rects[1].name == "ui/b");
+
+    for (size_t i = 0; i < 3; ++i) {
+      const AtlasRect &rect = atlas->rects[i];
+      assert(rect.width == images[i].width && rect.height == images[i].height);
+      assert(rect.x >= 2 && rect.y >= 2);
+      assert(rect.x + rect.width + 2 <= atlas->width);
+      assert(rect.y + rect.height + 2 <= atlas->height);
+      // Inside and two texels into the padding both hold the image
+      const uint8_t id = static_cast<uint8_t>(i + 1);
+      const size_t inside = size_t(rect.y) * atlas->width + rect.x;
+      const size_t padding = inside - 2 * atlas->width - 2;
+      assert(atlas->rgba[inside * 4] == id && atlas->rgba[padding * 4] == id);
+      (void)id;
+      // Padded rectangles never overlap
+      for (size_t j = 0; j < i; ++j) {
+        const AtlasRect &other = atlas->rects[j];
+        (void)other;
+        const bool apart = rect.x + rect.width + 2 <= other.x - 2 ||
+                           other.x + other.width + 2 <= rect.x - 2 ||
+                           rect.y + rect.height + 2 <= other.y - 2 ||
+                           other.y + other.height + 2 <= rect.y - 2;
+        assert(apart);
+        (void)apart;
+      }
+    }
+    assert(!pack_atlas(images, 2, 16));
+  }
+
+  // Manifests round-trip
+  {
+    TextureManifest manifest;
+    manifest.set_options("bc=1");
+    manifest.add_texture({"textures/rock.png", "textures/rock.ktx2",
+                          Format::BC1, 256, 128, 9, false});
+    manifest.add_texture({"sprites/ui", "sprites/ui.ktx2", Format::RGBA8, 64,
+                          32, 3, true});
+    manifest.add_sprite({"sprites/ui/button", "sprites/ui.ktx2", 4, 4, 24, 12});
+    const std::string path = (dir / "textures.manifest").string();
+    assert(manifest.save(path));
+
+    const auto loaded = TextureManifest::load(path);
+    assert(loaded);
+    assert(loaded->options() == "bc=1");
+    assert(loaded->textures().size() == 2 && loaded->sprites().size() == 1);
+    const auto *rock = loaded->find_texture("textures/rock.png");
+    assert(rock && rock->format == Format::BC1 && rock->levels == 9);
+    assert(!rock->premultiplied_alpha);
+    assert(loaded->find_texture("sprites/ui")->premultiplied_alpha);
+    const auto *button = loaded->find_sprite("sprites/ui/button");
+    assert(button && button->atlas == "sprites/ui.ktx2" && button->width == 24);
+    assert(!loaded->find_sprite("missing"));
+
+    std::ofstream(path, std::ios::app) << "texture\tbroken\n";
+    assert(!TextureManifest::load(path));
+  }
+
+  // The loader takes an up-to-date cooked blob instead of the source image
+  {
+    const auto source = dir / "cooked.png";
+    std::ofstream(source) << "not an image";
+    const auto pixels = solid(4, 4, 9, 9, 9, 255);
+    assert(write_ktx2((dir / "cooked.png.ktx2").string(),
+                      cook_texture(pixels.data(), 4, 4)));
+    std::filesystem::last_write_time(
+        source, std::filesystem::last_write_time(dir / "cooked.png.ktx2") -
+                    std::chrono::hours(1));
+
+    FakeDevice device;
+    {
+      TextureLoader loader(&device);
+      assert(loader.load(source.string()).id != 0);
+    }
+
+    // A stale blob is ignored, leaving the undecodable source
+    std::filesystem::last_write_time(
+        source, std::filesystem::last_write_time(dir / "cooked.png.ktx2") +
+                    std::chrono::hours(1));
+    {
+      TextureLoader loader(&device);
+      assert(loader.load(source.string()).id == 0);
+    }
+
+    // A premultiplied blob only stands in for a premultiplying loader
+    CookOptions premultiplied;
+    premultiplied.mipmaps.premultiply_alpha = true;
+    assert(write_ktx2((dir / "cooked.png.ktx2").string(),
+                      cook_texture(pixels.data(), 4, 4, premultiplied)));
+    std::filesystem::last_write_time(
+        source, std::filesystem::last_write_time(dir / "cooked.png.ktx2") -
+                    std::chrono::hours(1));
+    {
+      TextureLoader loader(&device);
+      assert(loader.load(source.string()).id == 0);
+    }
+    {
+      TextureLoader::Settings settings;
+      settings.mipmaps.premultiply_alpha = true;
+      TextureLoader loader(&device, settings);
+      assert(loader.load(source.string()).id != 0);
+    }
+  }
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include "pixel/resources/texture_streamer.hpp"
+#include "pixel/rhi/rhi.hpp"
+#include "fake_device.hpp"
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+using namespace pixel::rhi;
+using pixel::resources::TextureStreamer;
+using pixel::test::FakeDevice;
+
+namespace {
+
+pixel::resources::MipChain make_chain(uint32_t size) {
+  std::vector<uint8_t> pixels(size_t(size) * size * 4, 128);
+  return pixel::resources::generate_mipmaps(pixels.data(), size, size);
+}
+
+// 256x256 RGBA8 chain: levels 0 and 1, then everything from 64x64 down
+constexpr size_t kLevel0 = 256 * 256 * 4;
+constexpr size_t kLevel1 = 128 * 128 * 4;
+constexpr size_t kTail =
+    (64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2 + 1) * 4;
+
+} // namespace
+
+int main() {
+  using pixel::resources::mip_for_screen_extent;
+  assert(mip_for_screen_extent(1024, 1024.0f) == 0);
+  assert(mip_for_screen_extent(1024, 4096.0f) == 0);
+  assert(mip_for_screen_extent(1024, 512.0f) == 1);
+  assert(mip_for_screen_extent(1024, 100.0f) == 3);
+  assert(mip_for_screen_extent(1024, 0.0f) == 10);
+
+  FakeDevice device;
+  {
+    TextureStreamer::Settings settings;
+    settings.budget_bytes = 3 * kTail + kLevel0 + 2 * kLevel1;
+    settings.retire_frames = 2;
+    TextureStreamer streamer(&device, settings);
+
+    // Only the tail is uploaded up front
+    const TextureHandle a = streamer.add(make_chain(256));
+    const TextureHandle b = streamer.add(make_chain(256));
+    const TextureHandle c = streamer.add(make_chain(256));
+    assert(a.id != 0 && b.id != 0 && c.id != 0);
+    assert(streamer.resident_mip(a) == 2);
+    assert(device.live.at(a.id).size.w == 64);
+    assert(streamer.stats().resident_bytes == 3 * kTail);
+
+    // Unknown handles pass through untouched
+    assert(streamer.resolve(TextureHandle{999}).id == 999);
+
+    // Full-screen use of A streams in its finest levels
+    assert(streamer.resolve(a, 256.0f).id == a.id);
+    assert(streamer.update() == 1);
+    assert(streamer.resident_mip(a) == 0);
+    const TextureHandle a_full = streamer.resolve(a);
+    assert(a_full.id != a.id);
+    assert(device.live.at(a_full.id).mipLevels == 9);
+    assert(streamer.stats().levels_streamed_in == 2);
+    assert(streamer.stats().resident_bytes == 3 * kTail + kLevel0 + kLevel1);
+
+    // B now wants level 0 too; A is least recently used and loses level 0
+    streamer.request(b, 0);
+    assert(streamer.update() == 2);
+    assert(streamer.resident_mip(b) == 0);
+    assert(streamer.resident_mip(a) == 1);
+    assert(streamer.stats().levels_evicted == 1);
+    assert(streamer.stats().resident_bytes <= settings.budget_bytes);
+
+    // Both visible: A cannot take memory from B, and C only has its tail
+    streamer.request(a, 0);
+    streamer.request(b, 0);
+    assert(streamer.update() == 0);
+    assert(streamer.resident_mip(a) == 1);
+    assert(streamer.resident_mip(b) == 0);
+
+    // Replaced textures are destroyed once retire_frames updates pass
+    assert(device.live.count(a.id) == 0);
+    assert(device.live.size() == 3 + streamer.stats().retiring);
+    streamer.update();
+    streamer.update();
+    assert(streamer.stats().retiring == 0);
+    assert(device.live.size() == 3);
+
+    // A lower budget evicts down to the tails, never past them
+    streamer.set_budget(0);
+    assert(streamer.update() == 2);
+    assert(streamer.resident_mip(a) == 2 && streamer.resident_mip(b) == 2);
+    assert(streamer.stats().resident_bytes == 3 * kTail);
+
+    // Upgrades re-upload the whole new range, tail included
+    streamer.set_budget(settings.budget_bytes);
+    streamer.request(b, 1);
+    streamer.request(c, 1);
+    const size_t uploaded_before = device.cmd.uploaded;
+    assert(streamer.update() == 2);
+    assert(device.cmd.uploaded - uploaded_before == 2 * (kLevel1 + kTail));
+
+    streamer.remove(c);
+    assert(!streamer.is_streamed(c));
+    assert(streamer.stats().textures == 2);
+  }
+  // The destructor releases everything, including retiring textures
+  assert(device.live.empty());
+
+  // The upload budget lets one texture through per update
+  {
+    TextureStreamer::Settings settings;
+    settings.upload_budget_bytes = 1;
+    TextureStreamer streamer(&device, settings);
+    const TextureHandle a = streamer.add(make_chain(256));
+    const TextureHandle b = streamer.add(make_chain(256));
+    streamer.request(a, 0);
+    streamer.request(b, 0);
+    assert(streamer.update() == 1);
+    streamer.request(a, 0);
+    streamer.request(b, 0);
+    assert(streamer.update() == 1);
+    assert(streamer.resident_mip(a) == 0 && streamer.resident_mip(b) == 0);
+  }
+  assert(device.live.empty());
+  return 0;
+}